@@ -11,6 +11,8 @@ function connectWebSocket() {
         // listFiles('');
         // 최대 인덱스 요청
         getMaxIndex();
+        // 이후 새 메시지/수정/링크 변경은 서버가 subscription_events로 밀어 줌
+        socket.send(JSON.stringify({ action: 'message', content: 'subscribe:all' }));
     };
 
     socket.onmessage = function (event) {
@@ -40,6 +42,16 @@ function connectWebSocket() {
             case 'max_index':
                 handleMaxIndex(data.value);
                 break;
+            case 'subscribed':
+            case 'unsubscribed':
+                console.log(data.action + ' ' + data.subscription);
+                break;
+            case 'subscription_events':
+                handleSubscriptionEvents(data);
+                break;
+            case 'modify_conflict':
+                updateOutput('Message ' + data.index + ' was modified by someone else (version ' + data.expected + ' -> ' + data.version + '). Reload it and try again.');
+                break;
             default:
                 console.log('Unknown action:', data.action);
         }
@@ -185,20 +197,20 @@ function getFreeSpaceTableInfo() {
     }
 }
 function displayIndexTableInfo(data) {
-    let tableHTML = '<h2>Index Table Info</h2><table><tr><th>Index</th><th>Offset</th><th>Length</th><th>Forward Links</th><th>Backward Links</th></tr>';
+    let tableHTML = '<h2>Index Table Info</h2><table><tr><th>Index</th><th>Shard</th><th>Offset</th><th>Length</th><th>Forward Links</th><th>Backward Links</th></tr>';
     data.forEach(entry => {
         let forwardLinksString = entry.forward_links.length > 0 ? entry.forward_links.join(", ") : "None";
         let backwardLinksString = entry.backward_links.length > 0 ? entry.backward_links.join(", ") : "None";
-        tableHTML += `<tr><td>${entry.index}</td><td>${entry.offset}</td><td>${entry.length}</td><td>${forwardLinksString}</td><td>${backwardLinksString}</td></tr>`;
+        tableHTML += `<tr><td>${entry.index}</td><td>${entry.shard}</td><td>${entry.offset}</td><td>${entry.length}</td><td>${forwardLinksString}</td><td>${backwardLinksString}</td></tr>`;
     });
     tableHTML += '</table>';
     document.getElementById('tableContainer').innerHTML = tableHTML;
 }
 
 function displayFreeSpaceTableInfo(data) {
-    let tableHTML = '<h2>Free Space Table Info</h2><table><tr><th>Offset</th><th>Length</th></tr>';
+    let tableHTML = '<h2>Free Space Table Info</h2><table><tr><th>Shard</th><th>Offset</th><th>Length</th></tr>';
     data.forEach(entry => {
-        tableHTML += `<tr><td>${entry.offset}</td><td>${entry.length}</td></tr>`;
+        tableHTML += `<tr><td>${entry.shard}</td><td>${entry.offset}</td><td>${entry.length}</td></tr>`;
     });
     tableHTML += '</table>';
     document.getElementById('tableContainer').innerHTML = tableHTML;
@@ -358,6 +370,28 @@ function handleMaxIndex(value) {
     // 최대 인덱스를 받은 후 첫 번째 메시지 요청
     getMessageByIndex(currentIndex);
 }
+// 새로운 함수: 구독 이벤트 처리 (폴링 대신 서버가 변경을 알려 줌)
+function handleSubscriptionEvents(data) {
+    let refresh = false;
+    for (const event of data.events) {
+        if (event.type === 'append') {
+            if (event.index > maxIndex) {
+                maxIndex = event.index;
+            }
+        } else if (event.type === 'modify' || event.type === 'delete') {
+            refresh = refresh || event.index === currentIndex;
+        } else {
+            refresh = refresh || event.from === currentIndex || event.to === currentIndex;
+        }
+    }
+    updateIndexDisplay();
+    if (data.dropped > 0) {
+        // 놓친 변경이 있으면 최대 인덱스와 현재 메시지를 다시 읽음
+        getMaxIndex();
+    } else if (refresh) {
+        getMessageByIndex(currentIndex);
+    }
+}
 // 수정된 함수: 인덱스 변경
 function changeIndex(delta) {
     currentIndex += delta;
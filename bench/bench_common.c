@@ -0,0 +1,370 @@
+#define _XOPEN_SOURCE 700
+#include "bench_common.h"
+#include "../header/message_handler.h"
+#include "../header/recovery.h"
+#include "../header/async_io.h"
+#include "../header/record_cache.h"
+#include "../header/compression.h"
+#include "../header/text_index.h"
+#include "../header/time_index.h"
+#include "../header/dedup.h"
+#include "../header/subscription.h"
+#include "../header/replication.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ftw.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <math.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+static char bench_dir[4096];
+size_t bench_record_cache_budget = RECORD_CACHE_BUDGET;
+
+const char *bench_enter_dir(const char *dir)
+{
+    if (dir == NULL)
+    {
+        const char *parent = getenv("BENCH_DIR") != NULL ? getenv("BENCH_DIR") : "/tmp";
+        snprintf(bench_dir, sizeof(bench_dir), "%s/bench.XXXXXX", parent);
+        if (mkdtemp(bench_dir) == NULL)
+        {
+            perror("mkdtemp");
+            exit(EXIT_FAILURE);
+        }
+    }
+    else
+    {
+        if (dir != bench_dir)
+        {
+            snprintf(bench_dir, sizeof(bench_dir), "%s", dir);
+        }
+        mkdir(bench_dir, 0755);
+    }
+    if (chdir(bench_dir) != 0)
+    {
+        perror("chdir");
+        exit(EXIT_FAILURE);
+    }
+    mkdir("binary file", 0755);
+    return bench_dir;
+}
+
+const char *bench_open_store(const char *dir)
+{
+    const char *path = bench_enter_dir(dir);
+    if (!open_message_file())
+    {
+        fprintf(stderr, "Error opening message files in %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    recover_store();
+    start_recovery_validation();
+    async_io_init();
+    record_cache_init(bench_record_cache_budget);
+    compression_start();
+    text_index_start();
+    time_index_start();
+    dedup_start();
+    subscription_start();
+    return path;
+}
+
+// 서버의 cleanup()과 같은 순서로 닫습니다.
+void bench_close_store()
+{
+    wait_for_recovery_validation();
+    replication_stop();
+    subscription_stop();
+    text_index_stop();
+    time_index_stop();
+    dedup_stop();
+    compression_stop();
+    if (index_table != NULL)
+    {
+        free(index_table);
+        index_table = NULL;
+    }
+    async_io_shutdown();
+    record_cache_destroy();
+    close_message_file();
+}
+
+// 링크 수: 대부분은 적고 일부는 MAX_LINKS에 닿는 긴 꼬리 (평균 약 average)
+static uint32_t pick_link_count(uint64_t *state, uint32_t average)
+{
+    double u = (bench_random(state) >> 11) * (1.0 / 9007199254740992.0);
+    double count = average * 0.5 / pow(1.0 - u * 0.999, 0.5); // pareto (alpha 2), 평균 average
+    return count >= MAX_LINKS ? MAX_LINKS : (uint32_t)(count + 0.5);
+}
+
+void bench_build_store(uint32_t count, uint32_t length, uint32_t average_links)
+{
+    pid_t child = fork();
+    if (child < 0)
+    {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    if (child > 0)
+    {
+        int status = 0;
+        waitpid(child, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            fprintf(stderr, "Building the store failed\n");
+            exit(EXIT_FAILURE);
+        }
+        return;
+    }
+
+    if (!open_message_file())
+    {
+        _exit(1);
+    }
+    recover_store();
+    if (index_table_size + count > MAX_MESSAGES)
+    {
+        count = MAX_MESSAGES - index_table_size;
+    }
+    char *text = malloc(length + 1);
+    uint64_t state = 0xB17D;
+    int64_t timestamp = time(NULL);
+    uint32_t allocated = slab_class_size(RECORD_HEADER_SIZE + length);
+    for (uint32_t n = 0; n < count; n++)
+    {
+        uint32_t index = index_table_size + 1;
+        uint32_t shard = STORE_SHARD_OF(index);
+        uint64_t offset = STORE_OFFSET(shard, store_shards[shard].file_size);
+        bench_make_text(text, length, index);
+        if (!write_message_record(offset, allocated, index, text, length, timestamp, 0))
+        {
+            _exit(1);
+        }
+        IndexEntry *entry = &index_table[index - 1];
+        memset(entry, 0, sizeof(IndexEntry));
+        entry->index = index;
+        entry->offset = offset;
+        entry->length = allocated;
+        entry->version = 1;
+        index_table_size = index;
+
+        // 앞선 메시지로 링크를 답니다. 받는 쪽 backward 목록이 가득 차면 그 링크는 건너뜀 (add_forward_link와 같은 제한)
+        uint32_t links = index > 1 && average_links > 0 ? pick_link_count(&state, average_links) : 0;
+        for (uint32_t k = 0; k < links; k++)
+        {
+            uint64_t r = bench_random(&state);
+            // 최근 메시지와 앞쪽 메시지를 섞어 고름 (앞쪽일수록 많이 받음)
+            uint32_t target = r % 2 == 0 ? index - 1 - (uint32_t)((r >> 1) % (index - 1 < 1000 ? index - 1 : 1000))
+                                         : 1 + (uint32_t)(((r >> 1) % (index - 1)) * ((r >> 40) % 1024) / 1024);
+            IndexEntry *other = &index_table[target - 1];
+            int duplicate = 0;
+            for (uint32_t j = 0; j < entry->forward_link_count; j++)
+            {
+                duplicate |= entry->forward_links[j] == target;
+            }
+            if (duplicate || other->backward_link_count >= MAX_LINKS)
+            {
+                continue;
+            }
+            entry->forward_links[entry->forward_link_count++] = target;
+            other->backward_links[other->backward_link_count++] = index;
+        }
+    }
+    free(text);
+    save_index_table();
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        fdatasync(store_shards[shard].fd);
+    }
+    close_message_file();
+    _exit(0);
+}
+
+double bench_wait_background()
+{
+    double start = bench_now_ms();
+    wait_for_recovery_validation();
+    while (text_index_get_stats().building || time_index_get_stats().building || dedup_get_stats().building)
+    {
+        struct timespec pause = {0, 5 * 1000 * 1000};
+        nanosleep(&pause, NULL);
+    }
+    return bench_now_ms() - start;
+}
+
+int bench_run_child(void (*body)(void *arg), void *arg)
+{
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0)
+    {
+        perror("fork");
+        return 0;
+    }
+    if (child == 0)
+    {
+        body(arg);
+        fflush(stdout);
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+void bench_drop_page_cache()
+{
+    // 저장소가 열려 있지 않아도 되도록 "binary file/"의 파일을 모두 열어 내림 (shard 데이터, 인덱스 조각, free space)
+    DIR *directory = opendir("binary file");
+    if (directory == NULL)
+    {
+        return;
+    }
+    struct dirent *item;
+    while ((item = readdir(directory)) != NULL)
+    {
+        char path[4096];
+        snprintf(path, sizeof(path), "binary file/%s", item->d_name);
+        int fd = open(path, O_RDONLY);
+        if (fd >= 0)
+        {
+            fdatasync(fd);
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+    }
+    closedir(directory);
+}
+
+static int remove_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    return remove(path);
+}
+
+void bench_remove_dir(const char *dir)
+{
+    if (getenv("BENCH_KEEP") != NULL)
+    {
+        printf("Kept %s\n", dir);
+        return;
+    }
+    nftw(dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+double bench_now_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+uint64_t bench_rss_kb()
+{
+    FILE *file = fopen("/proc/self/statm", "r");
+    unsigned long size = 0, resident = 0;
+    if (file != NULL)
+    {
+        if (fscanf(file, "%lu %lu", &size, &resident) != 2)
+        {
+            resident = 0;
+        }
+        fclose(file);
+    }
+    return (uint64_t)resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+uint64_t bench_peak_rss_kb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+uint64_t bench_random(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+void bench_make_text(char *out, uint32_t length, uint64_t seed)
+{
+    // 자주 나오는 단어 몇 개와 seed마다 다른 단어를 섞음 (zipf 비슷한 분포)
+    static const char *common[] = {"message", "server", "index", "link", "store", "shard", "record", "graph",
+                                   "search", "replica", "the", "and", "of", "to", "in", "is"};
+    uint64_t state = seed * 0x9E3779B97F4A7C15ULL + 1;
+    uint32_t used = 0;
+    while (used < length)
+    {
+        char word[24];
+        uint64_t r = bench_random(&state);
+        int n;
+        if (r % 4 != 0)
+        {
+            n = snprintf(word, sizeof(word), "%s", common[(r >> 8) % (r % 3 == 0 ? 16 : 4)]);
+        }
+        else
+        {
+            n = snprintf(word, sizeof(word), "w%llu", (unsigned long long)((r >> 16) % 100000));
+        }
+        for (int i = 0; i < n && used < length; i++)
+        {
+            out[used++] = word[i];
+        }
+        if (used < length)
+        {
+            out[used++] = ' ';
+        }
+    }
+    out[length] = '\0';
+}
+
+double bench_fill_store(uint32_t count, uint32_t length)
+{
+    char *text = malloc(length + 1);
+    if (text == NULL)
+    {
+        return 0;
+    }
+    double start = bench_now_ms();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        bench_make_text(text, length, get_max_index() + 1);
+        if (append_message_to_file(text) == 0)
+        {
+            fprintf(stderr, "Append failed after %u messages\n", i);
+            break;
+        }
+    }
+    free(text);
+    return bench_now_ms() - start;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+double bench_percentile(double *values, uint32_t count, double p)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+    qsort(values, count, sizeof(double), compare_double);
+    uint32_t at = (uint32_t)(p / 100.0 * (count - 1) + 0.5);
+    return values[at < count ? at : count - 1];
+}
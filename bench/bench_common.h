@@ -0,0 +1,48 @@
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 벤치마크 프로그램이 함께 쓰는 도구. 각 프로그램은 서버 모듈(header/*.c)을 그대로 링크해
+// 임시 디렉터리의 "binary file/"에 저장소를 만들고 함수들을 직접 부릅니다 (.vscode/tasks.json의 bench 작업 참고).
+
+extern size_t bench_record_cache_budget; // bench_open_store()가 쓰는 레코드 캐시 예산 (기본 RECORD_CACHE_BUDGET)
+
+// dir이 NULL이면 BENCH_DIR 환경 변수의 디렉터리 (없으면 /tmp) 아래에 새 디렉터리를 만듭니다. 그 디렉터리로 옮겨 가 서버 main()과 같은 순서로 저장소와 모듈을 엽니다.
+// 만든 디렉터리 경로를 반환합니다 (프로그램이 끝날 때까지 유효).
+const char *bench_open_store(const char *dir);
+void bench_close_store();
+// 디렉터리만 만들고 옮겨 갑니다 (저장소는 열지 않음). fork 전에 자리를 잡을 때 씁니다.
+const char *bench_enter_dir(const char *dir);
+// bench_open_store()가 연 디렉터리를 지웁니다 (BENCH_KEEP 환경 변수가 있으면 남김).
+void bench_remove_dir(const char *dir);
+
+// count개의 메시지(length 바이트)를 저장소 함수로 직접 데이터 파일에 쓰고 인덱스를 한 번에 저장합니다.
+// append마다 인덱스 조각을 저장하면 큰 저장소를 만드는 데 너무 오래 걸리므로 읽기/시작 벤치마크의 준비에 씁니다.
+// average_links가 0이 아니면 메시지마다 평균 그만큼의 forward 링크 (긴 꼬리 분포, MAX_LINKS까지)를 답니다.
+// 자식 프로세스에서 만들므로 bench_enter_dir()로 자리를 잡은 뒤, bench_open_store() 전에 부릅니다.
+void bench_build_store(uint32_t count, uint32_t length, uint32_t average_links);
+// 시작할 때의 백그라운드 작업 (레코드 검증, 검색/시간 인덱스와 중복 제거 해시 구축)이 끝날 때까지 기다리고 걸린 시간(ms)을 반환합니다.
+double bench_wait_background();
+// body(arg)를 자식 프로세스에서 실행하고 기다립니다. 저장소 모듈의 전역 상태를 측정마다 새로 시작할 때 씁니다.
+// 자식이 0으로 끝나면 1을 반환합니다.
+int bench_run_child(void (*body)(void *arg), void *arg);
+// 현재 디렉터리의 "binary file/" 파일들 (데이터, 인덱스, free space)을 페이지 캐시에서 내립니다 (디스크에서 읽는 경우를 재기 위해).
+void bench_drop_page_cache();
+
+double bench_now_ms();
+uint64_t bench_rss_kb();      // 현재 RSS (KB)
+uint64_t bench_peak_rss_kb(); // 지금까지의 최대 RSS (KB)
+
+// length 바이트의 본문을 seed로 만들어 out에 씁니다 (NUL 포함 length + 1 바이트 필요).
+// 같은 seed면 같은 본문이고, 여러 번 나오는 단어가 섞여 있어 압축/검색 벤치마크에도 씁니다.
+void bench_make_text(char *out, uint32_t length, uint64_t seed);
+// count개의 메시지를 length 바이트씩 붙이고 걸린 시간(ms)을 반환합니다.
+double bench_fill_store(uint32_t count, uint32_t length);
+
+uint64_t bench_random(uint64_t *state); // xorshift64*
+// values를 정렬한 뒤 p (0~100) 백분위수를 반환합니다.
+double bench_percentile(double *values, uint32_t count, double p);
+
+#endif // BENCH_COMMON_H
@@ -0,0 +1,180 @@
+#include "bench_common.h"
+#include "../header/message_handler.h"
+#include "../header/compression.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// 메시지 길이대별로 압축 코덱의 디스크 사용량, 읽기 지연 시간, 쓰기 처리량을 잽니다.
+// 압축 코덱은 길이로 정해지므로 길이대마다 새 저장소를 만듭니다.
+// - short: COMPRESSION_DICT_MIN_LENGTH 이상, COMPRESSION_LZ4_MIN_LENGTH 미만 (공유 사전 deflate). 쓰기 전에 사전 학습을 끝냄
+// - long: COMPRESSION_LZ4_MIN_LENGTH 이상 (LZ4)
+// - tiny: 압축하지 않는 길이
+// 압축하지 않은 기준값은 -DCOMPRESSION_ENABLED=0으로 빌드한 bench/compression_raw로 같은 인자로 잽니다.
+// lz4/dict/skip은 그 코덱으로 쓴 레코드 수와 압축해도 슬롯이 줄지 않아 원본으로 쓴 수입니다.
+// 쓰기 처리량은 append_message_to_file() (레코드와 인덱스 조각 fsync 포함)이고, 코덱만의 속도는 따로 적습니다.
+// 사용법: compression [길이대별 메시지 수] [읽기 수]
+// 기본값: 2000 20000
+
+typedef struct {
+    const char *name;
+    uint32_t min_length;
+    uint32_t max_length;
+} Workload;
+
+static const Workload workloads[] = {
+    {"tiny", 32, 100},
+    {"short", 200, 900},
+    {"long", 2048, 16384},
+};
+
+typedef struct {
+    const Workload *workload;
+    uint32_t count;
+    uint32_t reads;
+} CompressionCase;
+
+static uint32_t pick_length(const Workload *workload, uint64_t *state)
+{
+    return workload->min_length + (uint32_t)(bench_random(state) % (workload->max_length - workload->min_length + 1));
+}
+
+// 공유 사전을 학습할 표본을 compress_record_body()로 넣고 학습이 끝날 때까지 기다립니다.
+static void train_dictionary(const Workload *workload, char *text)
+{
+    uint64_t state = 0xD1C7;
+    uint32_t fed = 0;
+    while (COMPRESSION_ENABLED && compression_get_stats().dictionary_id == 0 && fed < 4 * COMPRESSION_DICT_SAMPLE_BYTES)
+    {
+        uint32_t length = pick_length(workload, &state);
+        unsigned char *body = malloc(length);
+        bench_make_text(text, length, 0x7000000 + fed);
+        compress_record_body(text, length, body);
+        free(body);
+        fed += length;
+        while (compression_get_stats().training)
+        {
+            struct timespec pause = {0, 1000 * 1000};
+            nanosleep(&pause, NULL);
+        }
+    }
+}
+
+// 코덱만의 압축/풀기 속도 (원본 MB/s). 압축하지 않는 길이대나 압축을 끈 빌드에서는 0
+static void codec_rates(const Workload *workload, char *text, double *compress_rate, double *decompress_rate)
+{
+    *compress_rate = 0;
+    *decompress_rate = 0;
+    if (!COMPRESSION_ENABLED || workload->max_length < COMPRESSION_DICT_MIN_LENGTH)
+    {
+        return;
+    }
+    uint64_t state = 0xC0DEC;
+    unsigned char *body = malloc(workload->max_length);
+    char *out = malloc(workload->max_length + 1);
+    uint64_t raw = 0, unpacked = 0;
+    double compress_ms = 0, decompress_ms = 0;
+    for (uint32_t n = 0; n < 2000; n++)
+    {
+        uint32_t length = pick_length(workload, &state);
+        bench_make_text(text, length, 0x8000000 + n);
+        double start = bench_now_ms();
+        uint32_t stored = compress_record_body(text, length, body);
+        compress_ms += bench_now_ms() - start;
+        raw += length;
+        if (stored > 0)
+        {
+            start = bench_now_ms();
+            decompress_record_body(body, stored, out, length);
+            decompress_ms += bench_now_ms() - start;
+            unpacked += length;
+        }
+    }
+    *compress_rate = compress_ms > 0 ? raw / 1048.576 / compress_ms : 0;
+    *decompress_rate = decompress_ms > 0 ? unpacked / 1048.576 / decompress_ms : 0;
+    free(out);
+    free(body);
+}
+
+static void measure(void *arg)
+{
+    CompressionCase *test = arg;
+    const Workload *workload = test->workload;
+    char dir[4096];
+    bench_record_cache_budget = 0;
+    snprintf(dir, sizeof(dir), "%s", bench_open_store(NULL));
+    bench_wait_background();
+    char *text = malloc(workload->max_length + 1);
+    train_dictionary(workload, text);
+
+    CompressionStats before = compression_get_stats();
+    uint64_t state = 0x5107E, raw = 0;
+    double start = bench_now_ms();
+    for (uint32_t n = 0; n < test->count; n++)
+    {
+        uint32_t length = pick_length(workload, &state);
+        bench_make_text(text, length, n);
+        if (append_message_to_file(text) == 0)
+        {
+            fprintf(stderr, "Append failed after %u messages\n", n);
+            exit(EXIT_FAILURE);
+        }
+        raw += length;
+    }
+    double write_ms = bench_now_ms() - start;
+    CompressionStats after = compression_get_stats();
+    uint64_t footprint = 0;
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        footprint += store_shards[shard].file_size;
+    }
+
+    double *ms = malloc(sizeof(double) * test->reads);
+    bench_drop_page_cache();
+    for (uint32_t r = 0; r < test->reads; r++)
+    {
+        uint32_t index = 1 + (uint32_t)(bench_random(&state) % test->count);
+        double read_start = bench_now_ms();
+        char *message = get_message_by_index_and_format(index, "text");
+        ms[r] = (bench_now_ms() - read_start) * 1000;
+        if (message == NULL)
+        {
+            fprintf(stderr, "Reading message %u failed\n", index);
+            exit(EXIT_FAILURE);
+        }
+        free(message);
+    }
+    double compress_rate, decompress_rate;
+    codec_rates(workload, text, &compress_rate, &decompress_rate);
+
+    printf("%-6s %6llu %6llu %6llu %10.1f %10.1f %6.2f %9.0f %8.1f %8.1f %8.1f %9.0f %9.0f\n", workload->name,
+           (unsigned long long)(after.lz4_records - before.lz4_records),
+           (unsigned long long)(after.dict_records - before.dict_records),
+           (unsigned long long)(after.not_worth - before.not_worth), raw / 1048576.0, footprint / 1048576.0,
+           (double)raw / footprint, test->count * 1000.0 / write_ms, bench_percentile(ms, test->reads, 50),
+           bench_percentile(ms, test->reads, 99), bench_percentile(ms, test->reads, 99.9), compress_rate,
+           decompress_rate);
+    free(ms);
+    free(text);
+    bench_close_store();
+    bench_remove_dir(dir);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t count = argc > 1 && atoi(argv[1]) > 0 ? (uint32_t)atoi(argv[1]) : 2000;
+    uint32_t reads = argc > 2 && atoi(argv[2]) > 0 ? (uint32_t)atoi(argv[2]) : 20000;
+
+    printf("compression %s, record cache off, page cache dropped before reads\n",
+           COMPRESSION_ENABLED ? "enabled" : "disabled");
+    printf("%-6s %6s %6s %6s %10s %10s %6s %9s %8s %8s %8s %9s %9s\n", "length", "lz4", "dict", "skip", "raw MB",
+           "disk MB", "ratio", "writes/s", "p50 us", "p99 us", "p99.9 us", "comp MB/s", "dec MB/s");
+    int ok = 1;
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++)
+    {
+        CompressionCase test = {&workloads[w], count, reads};
+        ok &= bench_run_child(measure, &test);
+    }
+    return ok ? 0 : 1;
+}
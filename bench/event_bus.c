@@ -0,0 +1,211 @@
+#include "bench_common.h"
+#include "../header/event_bus.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+// 생산자 스레드 수 (1~64)에 따른 이벤트 버스의 경합을 잽니다.
+// 생산자들은 측정 시간 동안 쉬지 않고 변경을 넣고, 소비자 하나가 구독 디스패처와 같은 방식 (배치로 꺼내고, 비면
+// 잠시 양보한 뒤 잠듦)으로 꺼냅니다. 같은 용량의 링을 전역 mutex 하나로 보호한 구현을 비교 기준으로 함께 잽니다.
+// 디스패처가 따라가지 못하면 링이 차서 버려지므로 버린 비율도 적습니다. 생산자 작업량을 주면 변경 사이마다
+// 그만큼 빈 반복을 돌아 (저장소 쓰기 대신) 링이 가득 차지 않는 상태의 경합을 볼 수 있습니다.
+// 사용법: event_bus [최대 생산자 수] [측정 시간(초)] [생산자 작업량]
+// 기본값: 64 1 0
+
+typedef struct {
+    int (*push)(const ChangeEvent *event);
+    uint32_t (*pop_batch)(ChangeEvent *events, uint32_t max);
+    int (*wait)(int timeout_ms);
+} BusOps;
+
+typedef struct {
+    const BusOps *ops;
+    double deadline;
+    uint32_t id;
+    uint32_t work;
+    uint64_t attempts;
+    uint64_t accepted;
+} Producer;
+
+typedef struct {
+    const BusOps *ops;
+    int stopping;
+    uint64_t popped;
+    uint64_t batches;
+} Consumer;
+
+// 비교 기준: 전역 mutex 하나로 보호한 원형 링 (소비자는 배치마다 한 번 잡음)
+static ChangeEvent locked_ring[EVENT_BUS_CAPACITY];
+static uint64_t locked_head = 0, locked_tail = 0;
+static pthread_mutex_t locked_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t locked_cond = PTHREAD_COND_INITIALIZER;
+
+static int locked_push(const ChangeEvent *event)
+{
+    pthread_mutex_lock(&locked_mutex);
+    if (locked_tail - locked_head == EVENT_BUS_CAPACITY)
+    {
+        pthread_mutex_unlock(&locked_mutex);
+        return 0;
+    }
+    locked_ring[locked_tail++ % EVENT_BUS_CAPACITY] = *event;
+    pthread_cond_signal(&locked_cond);
+    pthread_mutex_unlock(&locked_mutex);
+    return 1;
+}
+
+static uint32_t locked_pop_batch(ChangeEvent *events, uint32_t max)
+{
+    pthread_mutex_lock(&locked_mutex);
+    uint32_t count = 0;
+    while (count < max && locked_head != locked_tail)
+    {
+        events[count++] = locked_ring[locked_head++ % EVENT_BUS_CAPACITY];
+    }
+    pthread_mutex_unlock(&locked_mutex);
+    return count;
+}
+
+static int locked_wait(int timeout_ms)
+{
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_nsec += (long)timeout_ms * 1000000;
+    until.tv_sec += until.tv_nsec / 1000000000;
+    until.tv_nsec %= 1000000000;
+    pthread_mutex_lock(&locked_mutex);
+    if (locked_head == locked_tail)
+    {
+        pthread_cond_timedwait(&locked_cond, &locked_mutex, &until);
+    }
+    pthread_mutex_unlock(&locked_mutex);
+    return 0;
+}
+
+static const BusOps lock_free_bus = {event_bus_push, event_bus_pop_batch, event_bus_wait};
+static const BusOps mutex_bus = {locked_push, locked_pop_batch, locked_wait};
+
+static void *producer_main(void *arg)
+{
+    Producer *producer = arg;
+    ChangeEvent event;
+    memset(&event, 0, sizeof(event));
+    event.index = producer->id;
+    while (bench_now_ms() < producer->deadline)
+    {
+        // 시간 확인 비용을 줄이려고 256번씩 넣음
+        for (int n = 0; n < 256; n++)
+        {
+            for (volatile uint32_t spin = 0; spin < producer->work; spin++)
+            {
+            }
+            event.target = (uint32_t)producer->attempts;
+            producer->accepted += producer->ops->push(&event);
+            producer->attempts++;
+        }
+    }
+    return NULL;
+}
+
+// subscription.c의 dispatcher_main과 같은 방식으로 꺼냄
+static void *consumer_main(void *arg)
+{
+    Consumer *consumer = arg;
+    ChangeEvent batch[EVENT_BUS_BATCH];
+    int idle = 0;
+    while (!__atomic_load_n(&consumer->stopping, __ATOMIC_ACQUIRE))
+    {
+        uint32_t count = consumer->ops->pop_batch(batch, EVENT_BUS_BATCH);
+        if (count == 0)
+        {
+            if (++idle <= EVENT_BUS_SPIN_YIELDS)
+            {
+                sched_yield();
+            }
+            else
+            {
+                consumer->ops->wait(EVENT_BUS_IDLE_MS);
+                idle = 0;
+            }
+            continue;
+        }
+        idle = 0;
+        consumer->popped += count;
+        consumer->batches++;
+    }
+    return NULL;
+}
+
+static void run(const char *name, const BusOps *ops, uint32_t threads, double seconds, uint32_t work)
+{
+    Producer *producers = calloc(threads, sizeof(Producer));
+    pthread_t *ids = calloc(threads, sizeof(pthread_t));
+    Consumer consumer = {ops, 0, 0, 0};
+    pthread_t consumer_id;
+    if (ops == &lock_free_bus && !event_bus_init())
+    {
+        fprintf(stderr, "Cannot create the event bus\n");
+        exit(EXIT_FAILURE);
+    }
+    locked_head = locked_tail = 0;
+    pthread_create(&consumer_id, NULL, consumer_main, &consumer);
+    double start = bench_now_ms();
+    for (uint32_t t = 0; t < threads; t++)
+    {
+        producers[t].ops = ops;
+        producers[t].deadline = start + seconds * 1000;
+        producers[t].id = t + 1;
+        producers[t].work = work;
+        pthread_create(&ids[t], NULL, producer_main, &producers[t]);
+    }
+    uint64_t attempts = 0, accepted = 0;
+    for (uint32_t t = 0; t < threads; t++)
+    {
+        pthread_join(ids[t], NULL);
+        attempts += producers[t].attempts;
+        accepted += producers[t].accepted;
+    }
+    double elapsed = bench_now_ms() - start;
+    __atomic_store_n(&consumer.stopping, 1, __ATOMIC_RELEASE);
+    if (ops == &lock_free_bus)
+    {
+        event_bus_wake();
+    }
+    else
+    {
+        pthread_mutex_lock(&locked_mutex);
+        pthread_cond_signal(&locked_cond);
+        pthread_mutex_unlock(&locked_mutex);
+    }
+    pthread_join(consumer_id, NULL);
+    uint64_t wakeups = ops == &lock_free_bus ? event_bus_get_stats().wakeups : 0;
+    if (ops == &lock_free_bus)
+    {
+        event_bus_destroy();
+    }
+    printf("%-10s %8u %12.2f %10.1f %10.1f %10.2f %10.1f %10llu\n", name, threads, attempts / elapsed / 1000.0,
+           elapsed * 1e6 * threads / (attempts ? attempts : 1), (attempts - accepted) * 100.0 / (attempts ? attempts : 1),
+           consumer.popped / elapsed / 1000.0, (double)consumer.popped / (consumer.batches ? consumer.batches : 1),
+           (unsigned long long)wakeups);
+    free(ids);
+    free(producers);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t max_threads = argc > 1 && atoi(argv[1]) > 0 ? (uint32_t)atoi(argv[1]) : 64;
+    double seconds = argc > 2 && atof(argv[2]) > 0 ? atof(argv[2]) : 1;
+    uint32_t work = argc > 3 && atoi(argv[3]) > 0 ? (uint32_t)atoi(argv[3]) : 0;
+
+    printf("%-10s %8s %12s %10s %10s %10s %10s %10s\n", "bus", "threads", "Mpush/s", "ns/push", "dropped%",
+           "Mpop/s", "batch", "wakeups");
+    for (uint32_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        run("lock-free", &lock_free_bus, threads, seconds, work);
+        run("mutex", &mutex_bus, threads, seconds, work);
+    }
+    return 0;
+}
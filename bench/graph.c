@@ -0,0 +1,121 @@
+#include "bench_common.h"
+#include "../header/message_handler.h"
+#include "../header/graph.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 링크가 달린 큰 저장소에서 그래프 질의의 지연 시간을 잽니다.
+// 메시지마다 평균 links개의 forward 링크를 앞선 메시지로 답니다 (대부분은 적고 일부는 MAX_LINKS에 닿는 긴 꼬리,
+// 앞쪽 메시지일수록 많이 링크를 받음). 질의마다 임의의 메시지를 골라 아래를 잽니다.
+// - path: graph_shortest_path() 양방향 링크, 기본 깊이/작업량
+// - path-fwd: forward 링크만 따라가는 경로 (새 메시지에서 옛 메시지로)
+// - descendants / ancestors: graph_traverse() BFS, 기본 깊이/노드 수
+// 사용법: graph [노드 수] [평균 링크 수] [질의 수]
+// 기본값: 1000000 3 2000
+
+typedef struct {
+    uint32_t nodes;
+    uint32_t queries;
+    const char *dir;
+} GraphCase;
+
+static void print_latency(const char *name, double *ms, uint32_t count, uint32_t hits, uint64_t visited)
+{
+    printf("%-12s %10.3f %10.3f %10.3f %10.3f %8.1f%% %12.0f\n", name, bench_percentile(ms, count, 50),
+           bench_percentile(ms, count, 90), bench_percentile(ms, count, 99), bench_percentile(ms, count, 100),
+           hits * 100.0 / count, (double)visited / count);
+}
+
+static void run_paths(GraphCase *test, const char *name, int directions, double *ms)
+{
+    uint64_t state = 0x9A7A + directions;
+    uint32_t hits = 0;
+    uint64_t visited = 0;
+    for (uint32_t q = 0; q < test->queries; q++)
+    {
+        uint32_t a = 1 + (uint32_t)(bench_random(&state) % test->nodes);
+        uint32_t b = 1 + (uint32_t)(bench_random(&state) % test->nodes);
+        // forward 링크는 옛 메시지를 가리키므로 새 쪽에서 출발
+        uint32_t from = a > b ? a : b, to = a > b ? b : a;
+        PathResult result;
+        double start = bench_now_ms();
+        graph_shortest_path(from, to, directions, GRAPH_DEFAULT_DEPTH, GRAPH_PATH_DEFAULT_VISITED, &result);
+        ms[q] = bench_now_ms() - start;
+        hits += result.found == 1;
+        visited += result.visited;
+        free_path_result(&result);
+    }
+    print_latency(name, ms, test->queries, hits, visited);
+}
+
+static void run_traversals(GraphCase *test, const char *name, int directions, double *ms)
+{
+    uint64_t state = 0x7EA5 + directions;
+    uint32_t truncated = 0;
+    uint64_t visited = 0;
+    for (uint32_t q = 0; q < test->queries; q++)
+    {
+        TraversalOptions options = {1 + (uint32_t)(bench_random(&state) % test->nodes), GRAPH_BFS, directions,
+                                    GRAPH_DEFAULT_DEPTH, GRAPH_DEFAULT_NODES, 0};
+        TraversalResult result;
+        double start = bench_now_ms();
+        graph_traverse(&options, &result);
+        ms[q] = bench_now_ms() - start;
+        truncated += result.truncated;
+        visited += result.count;
+        free_traversal_result(&result);
+    }
+    // traversal에서는 hit 칸에 max_nodes에 걸린 비율을 적음
+    print_latency(name, ms, test->queries, truncated, visited);
+}
+
+static void measure(void *arg)
+{
+    GraphCase *test = arg;
+    bench_open_store(test->dir);
+    bench_wait_background();
+    test->nodes = get_max_index() < test->nodes ? get_max_index() : test->nodes;
+
+    uint64_t forward = 0;
+    uint32_t full_backward = 0;
+    for (uint32_t i = 0; i < test->nodes; i++)
+    {
+        forward += index_table[i].forward_link_count;
+        full_backward += index_table[i].backward_link_count == MAX_LINKS;
+    }
+    printf("%u nodes, %.2f forward links per node, %u nodes with a full backward list\n", test->nodes,
+           (double)forward / test->nodes, full_backward);
+    printf("%-12s %10s %10s %10s %10s %9s %12s\n", "query", "p50 ms", "p90 ms", "p99 ms", "max ms", "hit",
+           "visited/q");
+
+    double *ms = malloc(sizeof(double) * test->queries);
+    run_paths(test, "path", GRAPH_FORWARD | GRAPH_BACKWARD, ms);
+    run_paths(test, "path-fwd", GRAPH_FORWARD, ms);
+    run_traversals(test, "descendants", GRAPH_FORWARD, ms);
+    run_traversals(test, "ancestors", GRAPH_BACKWARD, ms);
+    free(ms);
+    bench_close_store();
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t nodes = argc > 1 && atoi(argv[1]) > 0 ? (uint32_t)atoi(argv[1]) : 1000000;
+    uint32_t links = argc > 2 && atoi(argv[2]) >= 0 ? (uint32_t)atoi(argv[2]) : 3;
+    uint32_t queries = argc > 3 && atoi(argv[3]) > 0 ? (uint32_t)atoi(argv[3]) : 2000;
+    if (nodes > MAX_MESSAGES)
+    {
+        printf("%u nodes capped at MAX_MESSAGES (%u)\n", nodes, MAX_MESSAGES);
+        nodes = MAX_MESSAGES;
+    }
+
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s", bench_enter_dir(NULL));
+    double start = bench_now_ms();
+    bench_build_store(nodes, 64, links);
+    fprintf(stderr, "built %u nodes in %.0f ms\n", nodes, bench_now_ms() - start);
+    GraphCase test = {nodes, queries, dir};
+    int ok = bench_run_child(measure, &test);
+    bench_remove_dir(dir);
+    return ok ? 0 : 1;
+}
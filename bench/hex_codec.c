@@ -0,0 +1,134 @@
+#include "bench_common.h"
+#include "../header/hex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 16진수 인코딩 커널과 디코딩의 처리량 (입력 MB/s)을 크기별로 잽니다.
+// sprintf는 예전 get_binary_data_by_index()처럼 바이트마다 sprintf("%02x")를 부르는 방식입니다.
+// 이 CPU가 지원하지 않는 커널은 건너뛰고, 커널마다 결과가 sprintf와 같은지 먼저 확인합니다.
+// 사용법: hex_codec [크기당 측정 시간(초)]
+// 기본값: 0.3
+
+static const size_t sizes[] = {16, 256, 4096, 65536, 1 << 20};
+static const char *kernels[] = {"sprintf", "table", "ssse3", "avx2"};
+
+static void encode_sprintf(char *out, const unsigned char *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        sprintf(out + i * 2, "%02x", data[i]);
+    }
+}
+
+static void encode(const char *kernel, char *out, const unsigned char *data, size_t length)
+{
+    if (strcmp(kernel, "sprintf") == 0)
+    {
+        encode_sprintf(out, data, length);
+    }
+    else
+    {
+        hex_encode(out, data, length);
+    }
+}
+
+// seconds 동안 되풀이하고 입력 MB/s를 반환합니다
+static double encode_rate(const char *kernel, char *out, const unsigned char *data, size_t length, double seconds)
+{
+    uint64_t rounds = 0;
+    double start = bench_now_ms(), elapsed;
+    do
+    {
+        for (int n = 0; n < 16; n++)
+        {
+            encode(kernel, out, data, length);
+        }
+        rounds += 16;
+        elapsed = bench_now_ms() - start;
+    } while (elapsed < seconds * 1000);
+    return rounds * length / 1048.576 / elapsed;
+}
+
+static double decode_rate(unsigned char *out, const char *hex, size_t length, double seconds)
+{
+    uint64_t rounds = 0;
+    double start = bench_now_ms(), elapsed;
+    do
+    {
+        for (int n = 0; n < 16; n++)
+        {
+            if (hex_decode(out, hex, length * 2) != (long)length)
+            {
+                return 0;
+            }
+        }
+        rounds += 16;
+        elapsed = bench_now_ms() - start;
+    } while (elapsed < seconds * 1000);
+    return rounds * length / 1048.576 / elapsed;
+}
+
+int main(int argc, char *argv[])
+{
+    double seconds = argc > 1 && atof(argv[1]) > 0 ? atof(argv[1]) : 0.3;
+    size_t largest = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+    unsigned char *data = malloc(largest);
+    unsigned char *decoded = malloc(largest);
+    char *expected = malloc(largest * 2 + 1);
+    char *out = malloc(largest * 2 + 1);
+    uint64_t state = 0x4E5;
+    for (size_t i = 0; i < largest; i++)
+    {
+        data[i] = (unsigned char)bench_random(&state);
+    }
+    encode_sprintf(expected, data, largest);
+
+    printf("default kernel: %s\n", hex_kernel_name());
+    printf("%-8s", "MB/s");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        printf(" %12zu", sizes[s]);
+    }
+    printf("\n");
+    int ok = 1;
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+    {
+        if (strcmp(kernels[k], "sprintf") != 0 && !hex_select_kernel(kernels[k]))
+        {
+            printf("%-8s not supported on this CPU\n", kernels[k]);
+            continue;
+        }
+        // 커널마다 크기를 하나씩 어긋나게 해 꼬리 처리도 확인
+        encode(kernels[k], out, data, largest - 7);
+        if (memcmp(out, expected, (largest - 7) * 2) != 0 || out[(largest - 7) * 2] != '\0')
+        {
+            printf("%-8s output differs from sprintf\n", kernels[k]);
+            ok = 0;
+            continue;
+        }
+        printf("%-8s", kernels[k]);
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+        {
+            printf(" %12.0f", encode_rate(kernels[k], out, data, sizes[s], seconds));
+            fflush(stdout);
+        }
+        printf("\n");
+    }
+    printf("%-8s", "decode");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        printf(" %12.0f", decode_rate(decoded, expected, sizes[s], seconds));
+    }
+    printf("\n");
+    if (hex_decode(decoded, expected, largest * 2) != (long)largest || memcmp(decoded, data, largest) != 0)
+    {
+        printf("decode does not round-trip\n");
+        ok = 0;
+    }
+    free(out);
+    free(expected);
+    free(decoded);
+    free(data);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+#include "bench_common.h"
+#include "../header/message_handler.h"
+#include "../header/async_io.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// async_io_submit_batch()의 배치 크기 (큐 깊이)에 따른 임의 레코드 읽기 처리량을 잽니다.
+// 깊이마다 페이지 캐시를 내리고, 임의의 메시지 레코드 슬롯을 depth개씩 한 배치로 읽습니다.
+// NVMe에서 재려면 BENCH_DIR 환경 변수로 그 장치의 디렉터리를 지정합니다.
+// 사용법: queue_depth [메시지 수] [메시지 길이] [깊이당 측정 시간(초)]
+// 기본값: 200000 1000 2
+
+static const uint32_t depths[] = {1, 2, 4, 8, 16, 32, 64};
+
+typedef struct {
+    uint32_t count;
+    double seconds;
+    const char *dir;
+} DepthCase;
+
+static void run_depth(DepthCase *test, uint32_t depth, uint32_t max_length)
+{
+    IoRequest *requests = calloc(depth, sizeof(IoRequest));
+    unsigned char *buffers = malloc((size_t)depth * max_length);
+    uint64_t state = 0xD00D + depth;
+    uint64_t reads = 0, bytes = 0, errors = 0, batches = 0;
+    bench_drop_page_cache();
+    double start = bench_now_ms();
+    while (bench_now_ms() - start < test->seconds * 1000)
+    {
+        for (uint32_t n = 0; n < depth; n++)
+        {
+            IndexEntry *entry = &index_table[bench_random(&state) % test->count];
+            requests[n].opcode = ASYNC_IO_READ;
+            requests[n].offset = entry->offset;
+            requests[n].length = entry->length;
+            requests[n].buffer = buffers + (size_t)n * max_length;
+            requests[n].result = 0;
+        }
+        async_io_submit_batch(requests, depth);
+        for (uint32_t n = 0; n < depth; n++)
+        {
+            if (requests[n].result > 0)
+            {
+                bytes += requests[n].result;
+            }
+            else
+            {
+                errors++;
+            }
+        }
+        reads += depth;
+        batches++;
+    }
+    double elapsed = bench_now_ms() - start;
+    printf("%6u %12.0f %10.1f %14.1f %8llu\n", depth, reads * 1000.0 / elapsed, bytes / 1048.576 / elapsed,
+           elapsed * 1000.0 / batches, (unsigned long long)errors);
+    free(buffers);
+    free(requests);
+}
+
+static void measure(void *arg)
+{
+    DepthCase *test = arg;
+    bench_record_cache_budget = 0;
+    bench_open_store(test->dir);
+    bench_wait_background();
+    if (index_table_size < test->count)
+    {
+        test->count = index_table_size;
+    }
+    uint32_t max_length = 0;
+    for (uint32_t i = 0; i < test->count; i++)
+    {
+        max_length = index_table[i].length > max_length ? index_table[i].length : max_length;
+    }
+    printf("backend: %s, %u records of up to %u bytes\n", async_io_backend_name(), test->count, max_length);
+    printf("%6s %12s %10s %14s %8s\n", "depth", "reads/s", "MB/s", "us/batch", "errors");
+    for (size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); d++)
+    {
+        run_depth(test, depths[d], max_length);
+    }
+    bench_close_store();
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t count = argc > 1 && atoi(argv[1]) > 0 ? (uint32_t)atoi(argv[1]) : 200000;
+    uint32_t length = argc > 2 && atoi(argv[2]) > 0 ? (uint32_t)atoi(argv[2]) : 1000;
+    double seconds = argc > 3 && atof(argv[3]) > 0 ? atof(argv[3]) : 2;
+
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s", bench_enter_dir(NULL));
+    double start = bench_now_ms();
+    bench_build_store(count, length, 0);
+    fprintf(stderr, "built %u messages in %.0f ms\n", count, bench_now_ms() - start);
+    DepthCase test = {count, seconds, dir};
+    int ok = bench_run_child(measure, &test);
+    bench_remove_dir(dir);
+    return ok ? 0 : 1;
+}
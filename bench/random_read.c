@@ -0,0 +1,134 @@
+#include "bench_common.h"
+#include "../header/message_handler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// 저장소 크기에 따른 임의 읽기 처리량 (ops/s)을 잽니다.
+// 레코드 캐시를 끄고 페이지 캐시를 내린 상태에서 시작하므로 큰 저장소일수록 디스크 읽기가 섞입니다.
+// 크기마다 저장소를 새로 만들고, 모듈 전역 상태가 섞이지 않도록 측정은 자식 프로세스에서 합니다.
+// 사용법: random_read [크기,크기,...] [메시지 길이] [스레드 수] [측정 시간(초)]
+// 기본값: 10000,100000,1000000 256 (CPU 수) 3
+
+typedef struct {
+    uint32_t size;
+    uint32_t threads;
+    double seconds;
+    const char *dir;
+} ReadCase;
+
+typedef struct {
+    uint32_t size;
+    uint64_t seed;
+    double deadline;
+    uint64_t reads;
+    uint64_t misses;
+} ReadWorker;
+
+static void *read_worker(void *arg)
+{
+    ReadWorker *worker = arg;
+    uint64_t state = worker->seed;
+    while (bench_now_ms() < worker->deadline)
+    {
+        // 시간 확인 비용을 줄이려고 64번씩 읽음
+        for (int n = 0; n < 64; n++)
+        {
+            uint32_t index = 1 + (uint32_t)(bench_random(&state) % worker->size);
+            char *text = get_message_by_index_and_format(index, "text");
+            if (text == NULL)
+            {
+                worker->misses++;
+            }
+            free(text);
+            worker->reads++;
+        }
+    }
+    return NULL;
+}
+
+static void run_reads(ReadCase *test, uint32_t threads)
+{
+    ReadWorker *workers = calloc(threads, sizeof(ReadWorker));
+    pthread_t *ids = calloc(threads, sizeof(pthread_t));
+    bench_drop_page_cache();
+    double start = bench_now_ms();
+    for (uint32_t t = 0; t < threads; t++)
+    {
+        workers[t].size = test->size;
+        workers[t].seed = 0x1234567 + t * 7919;
+        workers[t].deadline = start + test->seconds * 1000;
+        pthread_create(&ids[t], NULL, read_worker, &workers[t]);
+    }
+    uint64_t reads = 0, misses = 0;
+    for (uint32_t t = 0; t < threads; t++)
+    {
+        pthread_join(ids[t], NULL);
+        reads += workers[t].reads;
+        misses += workers[t].misses;
+    }
+    double elapsed = bench_now_ms() - start;
+    printf("%10u %8u %14.0f %12.2f %8llu\n", test->size, threads, reads * 1000.0 / elapsed,
+           elapsed * 1000.0 * threads / (reads ? reads : 1), (unsigned long long)misses);
+    free(ids);
+    free(workers);
+}
+
+static void measure(void *arg)
+{
+    ReadCase *test = arg;
+    bench_record_cache_budget = 0; // 레코드 캐시 없이 저장소 읽기 경로만 잼
+    bench_open_store(test->dir);
+    bench_wait_background();
+    if (get_max_index() < test->size)
+    {
+        test->size = get_max_index();
+    }
+    run_reads(test, 1);
+    if (test->threads > 1)
+    {
+        run_reads(test, test->threads);
+    }
+    bench_close_store();
+}
+
+int main(int argc, char *argv[])
+{
+    const char *sizes = argc > 1 ? argv[1] : "10000,100000,1000000";
+    uint32_t length = argc > 2 && atoi(argv[2]) > 0 ? (uint32_t)atoi(argv[2]) : 256;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t threads = argc > 3 && atoi(argv[3]) > 0 ? (uint32_t)atoi(argv[3]) : (cpus > 0 ? (uint32_t)cpus : 1);
+    double seconds = argc > 4 && atof(argv[4]) > 0 ? atof(argv[4]) : 3;
+
+    printf("random reads of %u-byte messages, record cache off, page cache dropped before each run\n", length);
+    printf("%10s %8s %14s %12s %8s\n", "messages", "threads", "ops/s", "us/op", "misses");
+    char *list = strdup(sizes);
+    for (char *item = strtok(list, ","); item != NULL; item = strtok(NULL, ","))
+    {
+        uint32_t size = (uint32_t)atoi(item);
+        if (size == 0)
+        {
+            continue;
+        }
+        if (size > MAX_MESSAGES)
+        {
+            printf("%10u capped at MAX_MESSAGES (%u)\n", size, MAX_MESSAGES);
+            size = MAX_MESSAGES;
+        }
+        char dir[4096];
+        snprintf(dir, sizeof(dir), "%s", bench_enter_dir(NULL));
+        double start = bench_now_ms();
+        bench_build_store(size, length, 0);
+        fprintf(stderr, "built %u messages in %.0f ms\n", size, bench_now_ms() - start);
+        ReadCase test = {size, threads, seconds, dir};
+        if (!bench_run_child(measure, &test))
+        {
+            fprintf(stderr, "Measuring %u messages failed\n", size);
+        }
+        bench_remove_dir(dir);
+    }
+    free(list);
+    return 0;
+}
@@ -0,0 +1,220 @@
+#include "bench_common.h"
+#include "../header/message_handler.h"
+#include "../header/replication.h"
+#include "../header/crc32c.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <syslog.h>
+#include <sys/wait.h>
+
+// 한 기계에서 주 서버와 복제본 두 프로세스를 띄워 복제를 확인합니다.
+// 1. 주 서버가 메시지를 쌓음 (REPLICATION_SEND_CHUNK보다 큰 메시지 포함)
+// 2. 복제본을 붙이고, 복제본이 전체 동기화를 받는 동안 주 서버가 쓰기를 계속함 (로그가 동기화 시작 위치를 넘어감)
+// 3. 쓰기를 멈춘 뒤 두 저장소의 버전, 본문, 링크 체크섬이 같아질 때까지 기다림
+// 사용법: replication_pair [처음 메시지 수] [동기화 중 쓰기 시간(초)]
+
+#define PAIR_LARGE_EVERY 50            // 이 간격마다 큰 메시지를 씀
+#define PAIR_LARGE_LENGTH (100 * 1024) // 큰 메시지 크기 (REPLICATION_SEND_CHUNK보다 큼)
+#define PAIR_TIMEOUT_MS 60000          // 복제본이 따라잡기를 기다리는 시간
+
+typedef struct {
+    uint32_t max_index;
+    uint32_t checksum;
+} PairTarget;
+
+// 1..max_index의 버전, 본문, forward 링크로 만든 체크섬
+static uint32_t store_checksum(uint32_t max_index)
+{
+    uint32_t crc = 0;
+    pthread_rwlock_rdlock(&store_lock);
+    for (uint32_t i = 1; i <= max_index && i <= index_table_size; i++)
+    {
+        IndexEntry *entry = &index_table[i - 1];
+        char *text = read_message_text_locked(i);
+        crc = crc32c(crc, &i, sizeof(i));
+        crc = crc32c(crc, &entry->version, sizeof(entry->version));
+        if (text != NULL)
+        {
+            crc = crc32c(crc, text, strlen(text));
+            free(text);
+        }
+        crc = crc32c(crc, entry->forward_links, sizeof(uint32_t) * entry->forward_link_count);
+    }
+    pthread_rwlock_unlock(&store_lock);
+    return crc;
+}
+
+static void write_message(uint64_t *state, char *text)
+{
+    uint32_t n = get_max_index() + 1;
+    uint32_t length = n % PAIR_LARGE_EVERY == 0 ? PAIR_LARGE_LENGTH : 64 + bench_random(state) % 2048;
+    bench_make_text(text, length, n);
+    append_message_to_file(text);
+}
+
+// 복제본 프로세스: 주 서버의 목표를 받은 뒤 체크섬이 같아질 때까지 기다립니다.
+static int run_replica(const char *base, int go_fd, int result_fd)
+{
+    char byte;
+    if (read(go_fd, &byte, 1) != 1)
+    {
+        return 1;
+    }
+    char path[4096], socket_path[4096];
+    snprintf(path, sizeof(path), "%s/replica", base);
+    snprintf(socket_path, sizeof(socket_path), "%s/primary/%s", base, REPLICATION_SOCKET);
+    bench_open_store(path);
+    if (!replication_start_replica(socket_path))
+    {
+        return 1;
+    }
+
+    PairTarget target;
+    if (read(go_fd, &target, sizeof(target)) != sizeof(target))
+    {
+        return 1;
+    }
+    double start = bench_now_ms();
+    int matched = 0;
+    while (!matched && bench_now_ms() - start < PAIR_TIMEOUT_MS)
+    {
+        matched = get_max_index() >= target.max_index && store_checksum(target.max_index) == target.checksum;
+        if (!matched)
+        {
+            usleep(100 * 1000);
+        }
+    }
+    char *stats = get_replication_stats_info();
+    printf("replica: %s\n", stats);
+    printf("replica: %s after %.0f ms\n", matched ? "matched" : "did NOT match", bench_now_ms() - start);
+    // 동기화 중 로그가 시작 위치를 지웠다면 복제본이 다시 연결해 처음부터 동기화했을 것
+    const char *connects = strstr(stats, "\"connects\": ");
+    if (matched && connects != NULL && atoi(connects + strlen("\"connects\": ")) != 1)
+    {
+        printf("replica: had to reconnect during the test\n");
+        matched = 0;
+    }
+    free(stats);
+    fflush(stdout);
+    byte = matched;
+    if (write(result_fd, &byte, 1) != 1)
+    {
+        return 1;
+    }
+    bench_close_store();
+    return matched ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t initial = argc > 1 && atoi(argv[1]) > 0 ? (uint32_t)atoi(argv[1]) : 20000;
+    double write_seconds = argc > 2 ? atof(argv[2]) : 3;
+
+    char base[] = "/tmp/replication_pair.XXXXXX";
+    if (mkdtemp(base) == NULL)
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    openlog("replication_pair", LOG_PID | LOG_PERROR, LOG_USER); // 복제 경고를 stderr로도 보여 줌
+    setlogmask(LOG_UPTO(LOG_WARNING));
+    int go[2], result[2];
+    if (pipe(go) != 0 || pipe(result) != 0)
+    {
+        perror("pipe");
+        return 1;
+    }
+    // 스레드를 만들기 전에 fork
+    pid_t child = fork();
+    if (child == 0)
+    {
+        close(go[1]);
+        close(result[0]);
+        _exit(run_replica(base, go[0], result[1]));
+    }
+    close(go[0]);
+    close(result[1]);
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/primary", base);
+    bench_open_store(path);
+    if (!replication_start_primary())
+    {
+        fprintf(stderr, "Cannot start replication on the primary\n");
+        return 1;
+    }
+    char *text = malloc(PAIR_LARGE_LENGTH + 1);
+    uint64_t state = 0x5EED;
+    double start = bench_now_ms();
+    for (uint32_t i = 0; i < initial; i++)
+    {
+        write_message(&state, text);
+        if (i > 0 && i % 3 == 0)
+        {
+            add_forward_link(i, i + 1);
+        }
+    }
+    printf("primary: wrote %u messages in %.0f ms\n", initial, bench_now_ms() - start);
+
+    // 복제본을 붙이고 동기화하는 동안 쓰기를 계속함
+    char byte = 1;
+    if (write(go[1], &byte, 1) != 1)
+    {
+        return 1;
+    }
+    uint32_t writes = 0;
+    start = bench_now_ms();
+    while (bench_now_ms() - start < write_seconds * 1000)
+    {
+        uint64_t r = bench_random(&state);
+        uint32_t max = get_max_index();
+        switch (r % 8)
+        {
+        case 0:
+            modify_message_by_index(1 + (r >> 8) % max, "modified during sync");
+            break;
+        case 1:
+            add_forward_link(1 + (r >> 8) % max, 1 + (r >> 32) % max);
+            break;
+        case 2:
+            if (r % 64 == 2)
+            {
+                delete_message(1 + (r >> 8) % max);
+                break;
+            }
+            // fall through
+        default:
+            write_message(&state, text);
+            break;
+        }
+        writes++;
+    }
+    free(text);
+
+    PairTarget target = {get_max_index(), 0};
+    target.checksum = store_checksum(target.max_index);
+    printf("primary: %u writes during sync, %u messages, checksum %08x\n", writes, target.max_index, target.checksum);
+    char *stats = get_replication_stats_info();
+    printf("primary: %s\n", stats);
+    free(stats);
+    fflush(stdout);
+    if (write(go[1], &target, sizeof(target)) != sizeof(target))
+    {
+        return 1;
+    }
+
+    byte = 0;
+    if (read(result[0], &byte, 1) != 1)
+    {
+        byte = 0;
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    bench_close_store();
+    bench_remove_dir(base);
+    printf("%s\n", byte ? "PASS" : "FAIL");
+    return byte && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : 1;
+}
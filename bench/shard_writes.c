@@ -0,0 +1,118 @@
+#include "bench_common.h"
+#include "../header/message_handler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// 쓰기 스레드 수에 따른 append 처리량을 잽니다. shard 수는 빌드할 때 정해지므로 shard 수마다 따로 빌드한
+// bench/shard_writes_<n> (.vscode/tasks.json의 "bench: shard_writes (shards=n)")을 같은 인자로 돌려 비교합니다.
+// 스레드 수마다 새 저장소에서 각 스레드가 측정 시간 동안 append_message_to_file()을 부릅니다
+// (레코드와 인덱스 조각 fsync 포함. 서로 다른 shard의 fsync는 겹칠 수 있음).
+// 사용법: shard_writes [최대 쓰기 스레드 수] [측정 시간(초)] [메시지 길이]
+// 기본값: 16 3 512
+
+#define SHARD_WRITES_MAX_SAMPLES 100000 // 스레드마다 모으는 지연 시간 표본 수
+
+typedef struct {
+    uint32_t threads;
+    double seconds;
+    uint32_t length;
+} WriteCase;
+
+typedef struct {
+    double deadline;
+    uint32_t length;
+    uint32_t id;
+    uint64_t appends;
+    uint64_t failures;
+    double *samples;
+    uint32_t sample_count;
+} Writer;
+
+static void *writer_main(void *arg)
+{
+    Writer *writer = arg;
+    char *text = malloc(writer->length + 1);
+    uint64_t n = 0;
+    while (bench_now_ms() < writer->deadline)
+    {
+        bench_make_text(text, writer->length, ((uint64_t)writer->id << 32) | n++);
+        double start = bench_now_ms();
+        if (append_message_to_file(text) == 0)
+        {
+            writer->failures++;
+            continue;
+        }
+        if (writer->sample_count < SHARD_WRITES_MAX_SAMPLES)
+        {
+            writer->samples[writer->sample_count++] = bench_now_ms() - start;
+        }
+        writer->appends++;
+    }
+    free(text);
+    return NULL;
+}
+
+static void measure(void *arg)
+{
+    WriteCase *test = arg;
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s", bench_open_store(NULL));
+    bench_wait_background();
+
+    Writer *writers = calloc(test->threads, sizeof(Writer));
+    pthread_t *ids = calloc(test->threads, sizeof(pthread_t));
+    double start = bench_now_ms();
+    for (uint32_t t = 0; t < test->threads; t++)
+    {
+        writers[t].deadline = start + test->seconds * 1000;
+        writers[t].length = test->length;
+        writers[t].id = t;
+        writers[t].samples = malloc(sizeof(double) * SHARD_WRITES_MAX_SAMPLES);
+        pthread_create(&ids[t], NULL, writer_main, &writers[t]);
+    }
+    uint64_t appends = 0, failures = 0;
+    uint32_t sample_total = 0;
+    for (uint32_t t = 0; t < test->threads; t++)
+    {
+        pthread_join(ids[t], NULL);
+        appends += writers[t].appends;
+        failures += writers[t].failures;
+        sample_total += writers[t].sample_count;
+    }
+    double elapsed = bench_now_ms() - start;
+    double *samples = malloc(sizeof(double) * (sample_total ? sample_total : 1));
+    uint32_t used = 0;
+    for (uint32_t t = 0; t < test->threads; t++)
+    {
+        memcpy(samples + used, writers[t].samples, sizeof(double) * writers[t].sample_count);
+        used += writers[t].sample_count;
+        free(writers[t].samples);
+    }
+    printf("%6u %8u %12.0f %10.2f %10.3f %10.3f %10.3f %8llu\n", STORE_SHARD_COUNT, test->threads,
+           appends * 1000.0 / elapsed, appends * test->length / 1048.576 / elapsed, bench_percentile(samples, used, 50),
+           bench_percentile(samples, used, 99), bench_percentile(samples, used, 100), (unsigned long long)failures);
+    free(samples);
+    free(ids);
+    free(writers);
+    bench_close_store();
+    bench_remove_dir(dir);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t max_threads = argc > 1 && atoi(argv[1]) > 0 ? (uint32_t)atoi(argv[1]) : 16;
+    double seconds = argc > 2 && atof(argv[2]) > 0 ? atof(argv[2]) : 3;
+    uint32_t length = argc > 3 && atoi(argv[3]) > 0 ? (uint32_t)atoi(argv[3]) : 512;
+
+    printf("%6s %8s %12s %10s %10s %10s %10s %8s\n", "shards", "threads", "appends/s", "MB/s", "p50 ms", "p99 ms",
+           "max ms", "failed");
+    int ok = 1;
+    for (uint32_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        WriteCase test = {threads, seconds, length};
+        ok &= bench_run_child(measure, &test);
+    }
+    return ok ? 0 : 1;
+}
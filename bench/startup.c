@@ -0,0 +1,79 @@
+#include "bench_common.h"
+#include "../header/message_handler.h"
+#include "../header/recovery.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 저장소 크기에 따른 시작 시간을 잽니다. 서버 main()처럼 open_message_file()과 recover_store()를 부른 뒤
+// (여기까지가 포트를 열기 전까지의 시간) 백그라운드 레코드 검증이 끝날 때까지 기다립니다.
+// 크기마다 페이지 캐시를 내린 상태 (cold)와 바로 다시 연 상태 (warm)를 각각 새 프로세스에서 잽니다.
+// MAX_MESSAGES보다 큰 크기는 저장소가 받을 수 없으므로 건너뛰었다고 출력합니다.
+// 사용법: startup [크기,크기,...] [메시지 길이]
+// 기본값: 100000,1000000,10000000 256
+
+typedef struct {
+    int cold;
+} StartupCase;
+
+static void measure(void *arg)
+{
+    StartupCase *test = arg;
+    if (test->cold)
+    {
+        bench_drop_page_cache();
+    }
+    double start = bench_now_ms();
+    if (!open_message_file())
+    {
+        fprintf(stderr, "Error opening message files\n");
+        exit(EXIT_FAILURE);
+    }
+    RecoveryReport report = recover_store();
+    double ready = bench_now_ms() - start;
+    start_recovery_validation();
+    wait_for_recovery_validation();
+    double validated = bench_now_ms() - start;
+    report = get_recovery_report();
+    printf("%10u %6s %12.1f %12.1f %14.1f %8u %10llu\n", report.entries_loaded, test->cold ? "cold" : "warm",
+           report.index_load_ms, ready, validated, report.threads, (unsigned long long)bench_peak_rss_kb());
+    free(index_table);
+    index_table = NULL;
+    close_message_file();
+}
+
+int main(int argc, char *argv[])
+{
+    const char *sizes = argc > 1 ? argv[1] : "100000,1000000,10000000";
+    uint32_t length = argc > 2 && atoi(argv[2]) > 0 ? (uint32_t)atoi(argv[2]) : 256;
+
+    printf("%10s %6s %12s %12s %14s %8s %10s\n", "entries", "cache", "load ms", "ready ms", "validated ms",
+           "threads", "peak KB");
+    char *list = strdup(sizes);
+    for (char *item = strtok(list, ","); item != NULL; item = strtok(NULL, ","))
+    {
+        uint32_t size = (uint32_t)atoi(item);
+        if (size == 0)
+        {
+            continue;
+        }
+        if (size > MAX_MESSAGES)
+        {
+            printf("%10u skipped: the store holds at most MAX_MESSAGES (%u) entries\n", size, MAX_MESSAGES);
+            continue;
+        }
+        char dir[4096];
+        snprintf(dir, sizeof(dir), "%s", bench_enter_dir(NULL));
+        double start = bench_now_ms();
+        bench_build_store(size, length, 0);
+        fprintf(stderr, "built %u messages in %.0f ms\n", size, bench_now_ms() - start);
+        StartupCase cold = {1}, warm = {0};
+        if (!bench_run_child(measure, &cold) || !bench_run_child(measure, &warm))
+        {
+            fprintf(stderr, "Measuring %u messages failed\n", size);
+        }
+        bench_remove_dir(dir);
+    }
+    free(list);
+    return 0;
+}
@@ -0,0 +1,211 @@
+#include "bench_common.h"
+#include "../header/message_handler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <json-c/json.h>
+
+// get_index_table_info / get_free_space_table_info 응답의 최대 RSS 증가와 첫 바이트까지의 시간 (TTFB)을 잽니다.
+// - json-c: 예전 구현처럼 엔트리마다 json-c 객체를 만들고 한 문자열로 직렬화해 strdup (이 프로그램 안에 재현)
+// - stream: stream_index_table_info() / stream_free_space_table_info()로 고정 크기 조각을 보냄
+// - page: 앞에서부터 한 페이지만 (index_table_info는 index 필드만)
+// 방식마다 새 프로세스에서 재며, 받은 조각은 세기만 합니다 (소켓 전송 비용은 빠짐).
+// free space 엔트리를 만들려고 측정 전에 8번째 메시지마다 지웁니다.
+// 사용법: table_info [메시지 수] [페이지 크기]
+// 기본값: 1000000 1000
+
+typedef enum {
+    TABLE_INDEX_JSON,
+    TABLE_INDEX_STREAM,
+    TABLE_INDEX_PAGE,
+    TABLE_FREE_SPACE_JSON,
+    TABLE_FREE_SPACE_STREAM,
+    TABLE_FREE_SPACE_PAGE
+} TableMode;
+
+static const char *mode_names[] = {"index json-c", "index stream", "index page", "free json-c", "free stream",
+                                   "free page"};
+
+typedef struct {
+    TableMode mode;
+    uint32_t page;
+    const char *dir;
+} TableCase;
+
+typedef struct {
+    double start;
+    double first_byte_ms;
+    uint64_t bytes;
+    uint32_t chunks;
+    uint64_t max_rss_kb;
+} TableSink;
+
+static int count_chunk(void *context, const char *data, size_t length, int final)
+{
+    (void)data;
+    (void)final;
+    TableSink *sink = context;
+    if (sink->chunks == 0)
+    {
+        sink->first_byte_ms = bench_now_ms() - sink->start;
+    }
+    // statm을 읽는 비용을 줄이려고 64조각마다 RSS를 봄
+    if (sink->chunks % 64 == 0 || final)
+    {
+        uint64_t rss = bench_rss_kb();
+        sink->max_rss_kb = rss > sink->max_rss_kb ? rss : sink->max_rss_kb;
+    }
+    sink->chunks++;
+    sink->bytes += length;
+    return 1;
+}
+
+// 예전 get_index_table_info(): 전체 테이블을 json-c 객체로 만든 뒤 한 문자열로 만듦
+static char *legacy_index_table_json(TableSink *sink)
+{
+    json_object *index_array = json_object_new_array();
+    pthread_rwlock_rdlock(&store_lock);
+    for (uint32_t i = 0; i < index_table_size; i++)
+    {
+        json_object *entry = json_object_new_object();
+        json_object_object_add(entry, "index", json_object_new_int(index_table[i].index));
+        json_object_object_add(entry, "offset", json_object_new_int64(index_table[i].offset));
+        json_object_object_add(entry, "length", json_object_new_int(index_table[i].length));
+        json_object *forward_links_array = json_object_new_array();
+        for (uint32_t j = 0; j < index_table[i].forward_link_count; j++)
+        {
+            json_object_array_add(forward_links_array, json_object_new_int(index_table[i].forward_links[j]));
+        }
+        json_object_object_add(entry, "forward_links", forward_links_array);
+        json_object *backward_links_array = json_object_new_array();
+        for (uint32_t j = 0; j < index_table[i].backward_link_count; j++)
+        {
+            json_object_array_add(backward_links_array, json_object_new_int(index_table[i].backward_links[j]));
+        }
+        json_object_object_add(entry, "backward_links", backward_links_array);
+        json_object_array_add(index_array, entry);
+    }
+    pthread_rwlock_unlock(&store_lock);
+    json_object *result = json_object_new_object();
+    json_object_object_add(result, "action", json_object_new_string("index_table_info"));
+    json_object_object_add(result, "data", index_array);
+    char *response = strdup(json_object_to_json_string(result));
+    uint64_t rss = bench_rss_kb(); // 객체와 문자열이 함께 살아 있는 때가 가장 큼
+    sink->max_rss_kb = rss > sink->max_rss_kb ? rss : sink->max_rss_kb;
+    json_object_put(result);
+    return response;
+}
+
+// 예전 get_free_space_table_info()
+static char *legacy_free_space_table_json(TableSink *sink)
+{
+    json_object *free_space_array = json_object_new_array();
+    lock_all_store_shards();
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        for (uint32_t i = 0; i < store_shards[shard].free_space_size; i++)
+        {
+            json_object *entry = json_object_new_object();
+            json_object_object_add(entry, "offset", json_object_new_int64(store_shards[shard].free_space[i].offset));
+            json_object_object_add(entry, "length", json_object_new_int(store_shards[shard].free_space[i].length));
+            json_object_array_add(free_space_array, entry);
+        }
+    }
+    unlock_all_store_shards();
+    json_object *result = json_object_new_object();
+    json_object_object_add(result, "action", json_object_new_string("free_space_table_info"));
+    json_object_object_add(result, "data", free_space_array);
+    char *response = strdup(json_object_to_json_string(result));
+    uint64_t rss = bench_rss_kb();
+    sink->max_rss_kb = rss > sink->max_rss_kb ? rss : sink->max_rss_kb;
+    json_object_put(result);
+    return response;
+}
+
+static void measure(void *arg)
+{
+    TableCase *test = arg;
+    bench_open_store(test->dir);
+    bench_wait_background();
+    TableSink sink = {0, 0, 0, 0, 0};
+    uint64_t baseline = bench_rss_kb();
+    sink.max_rss_kb = baseline;
+    sink.start = bench_now_ms();
+    char *response = NULL;
+    switch (test->mode)
+    {
+    case TABLE_INDEX_JSON:
+        response = legacy_index_table_json(&sink);
+        break;
+    case TABLE_FREE_SPACE_JSON:
+        response = legacy_free_space_table_json(&sink);
+        break;
+    case TABLE_INDEX_STREAM:
+        stream_index_table_info(0, UINT32_MAX, INDEX_FIELD_ALL, 0, count_chunk, &sink);
+        break;
+    case TABLE_INDEX_PAGE:
+        stream_index_table_info(0, test->page, INDEX_FIELD_INDEX, 1, count_chunk, &sink);
+        break;
+    case TABLE_FREE_SPACE_STREAM:
+        stream_free_space_table_info(0, UINT32_MAX, 0, count_chunk, &sink);
+        break;
+    case TABLE_FREE_SPACE_PAGE:
+        stream_free_space_table_info(0, test->page, 1, count_chunk, &sink);
+        break;
+    }
+    if (response != NULL)
+    {
+        // 한 프레임으로 보내므로 첫 바이트는 문자열이 다 만들어진 뒤
+        count_chunk(&sink, response, strlen(response), 1);
+        free(response);
+    }
+    double total = bench_now_ms() - sink.start;
+    printf("%-14s %12.2f %10.1f %14llu %8u %14llu\n", mode_names[test->mode], sink.first_byte_ms, total,
+           (unsigned long long)sink.bytes, sink.chunks, (unsigned long long)(sink.max_rss_kb - baseline));
+    bench_close_store();
+}
+
+// 8번째 메시지마다 한 번의 batch로 지워 free space 엔트리를 만듭니다 (같은 shard 안에서 이웃하지 않음).
+static void make_free_space(void *arg)
+{
+    bench_open_store(arg);
+    bench_wait_background();
+    DeleteBatch batch;
+    memset(&batch, 0, sizeof(batch));
+    lock_all_store_shards();
+    pthread_rwlock_wrlock(&store_lock);
+    for (uint32_t i = 8; i <= index_table_size; i += 8)
+    {
+        delete_message_locked(i, &batch);
+    }
+    pthread_rwlock_unlock(&store_lock);
+    finish_delete_batch(&batch);
+    unlock_all_store_shards();
+    bench_close_store();
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t count = argc > 1 && atoi(argv[1]) > 0 ? (uint32_t)atoi(argv[1]) : 1000000;
+    uint32_t page = argc > 2 && atoi(argv[2]) > 0 ? (uint32_t)atoi(argv[2]) : 1000;
+
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s", bench_enter_dir(NULL));
+    double start = bench_now_ms();
+    bench_build_store(count, 64, 2);
+    if (!bench_run_child(make_free_space, dir))
+    {
+        fprintf(stderr, "Deleting messages failed\n");
+        return 1;
+    }
+    fprintf(stderr, "built %u messages in %.0f ms\n", count, bench_now_ms() - start);
+    printf("%-14s %12s %10s %14s %8s %14s\n", "response", "TTFB ms", "total ms", "bytes", "frames", "RSS growth KB");
+    int ok = 1;
+    for (int mode = TABLE_INDEX_JSON; mode <= TABLE_FREE_SPACE_PAGE; mode++)
+    {
+        TableCase test = {(TableMode)mode, page, dir};
+        ok &= bench_run_child(measure, &test);
+    }
+    bench_remove_dir(dir);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+#include "bench_common.h"
+#include "../header/message_handler.h"
+#include "../header/text_index.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 전문 검색 질의의 지연 시간을 1M 메시지 말뭉치에서 잽니다.
+// 본문은 bench_make_text()로 만들며 자주 나오는 단어 16개와 드문 단어 w0..w99999가 섞여 있습니다.
+// 시작할 때의 인덱스 구축이 끝난 뒤, 질의 종류마다 임의의 단어로 질의를 만들어 top-k를 구합니다.
+// 사용법: text_search [메시지 수] [메시지 길이] [종류별 질의 수] [k]
+// 기본값: 1000000 128 500 20
+
+typedef struct {
+    uint32_t count;
+    uint32_t queries;
+    uint32_t k;
+    const char *dir;
+} SearchCase;
+
+typedef struct {
+    const char *name;
+    const char *format; // %u 자리에는 임의의 드문 단어 번호가 들어감
+    uint32_t modulo;    // 드문 단어 번호의 범위 (접두어는 짧게)
+} QueryKind;
+
+static const QueryKind kinds[] = {
+    {"term common", "server", 1},
+    {"term rare", "w%u", 100000},
+    {"AND common", "message index", 1},
+    {"AND mixed", "server w%u", 100000},
+    {"OR rare", "w%u OR w1%u", 10000},
+    {"OR common", "graph OR replica", 1},
+    {"prefix rare", "w%u*", 1000},
+    {"prefix common", "se*", 1},
+};
+
+static void measure(void *arg)
+{
+    SearchCase *test = arg;
+    bench_open_store(test->dir);
+    double waited = bench_wait_background();
+    TextIndexStats stats = text_index_get_stats();
+    printf("%llu documents, %llu terms, %llu postings, %.1f MB of postings, built in %.0f ms (waited %.0f ms)\n",
+           (unsigned long long)stats.documents, (unsigned long long)stats.terms, (unsigned long long)stats.postings,
+           stats.posting_bytes / 1048576.0, stats.build_ms, waited);
+    printf("%-14s %10s %10s %10s %10s %12s\n", "query", "p50 ms", "p90 ms", "p99 ms", "max ms", "matches/q");
+
+    double *ms = malloc(sizeof(double) * test->queries);
+    uint64_t state = 0x5EA5C4;
+    for (size_t kind = 0; kind < sizeof(kinds) / sizeof(kinds[0]); kind++)
+    {
+        uint64_t matches = 0;
+        for (uint32_t q = 0; q < test->queries; q++)
+        {
+            char query[128];
+            uint32_t word = (uint32_t)(bench_random(&state) % kinds[kind].modulo);
+            snprintf(query, sizeof(query), kinds[kind].format, word, word);
+            SearchResult result;
+            double start = bench_now_ms();
+            if (!text_index_search(query, test->k, &result))
+            {
+                fprintf(stderr, "Search for \"%s\" failed\n", query);
+                exit(EXIT_FAILURE);
+            }
+            ms[q] = bench_now_ms() - start;
+            matches += result.total;
+            free_search_result(&result);
+        }
+        printf("%-14s %10.3f %10.3f %10.3f %10.3f %12.0f\n", kinds[kind].name, bench_percentile(ms, test->queries, 50),
+               bench_percentile(ms, test->queries, 90), bench_percentile(ms, test->queries, 99),
+               bench_percentile(ms, test->queries, 100), (double)matches / test->queries);
+    }
+    free(ms);
+    bench_close_store();
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t count = argc > 1 && atoi(argv[1]) > 0 ? (uint32_t)atoi(argv[1]) : 1000000;
+    uint32_t length = argc > 2 && atoi(argv[2]) > 0 ? (uint32_t)atoi(argv[2]) : 128;
+    uint32_t queries = argc > 3 && atoi(argv[3]) > 0 ? (uint32_t)atoi(argv[3]) : 500;
+    uint32_t k = argc > 4 && atoi(argv[4]) > 0 ? (uint32_t)atoi(argv[4]) : 20;
+    if (count > MAX_MESSAGES)
+    {
+        printf("%u messages capped at MAX_MESSAGES (%u)\n", count, MAX_MESSAGES);
+        count = MAX_MESSAGES;
+    }
+
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s", bench_enter_dir(NULL));
+    double start = bench_now_ms();
+    bench_build_store(count, length, 0);
+    fprintf(stderr, "built %u messages in %.0f ms\n", count, bench_now_ms() - start);
+    SearchCase test = {count, queries, k, dir};
+    int ok = bench_run_child(measure, &test);
+    bench_remove_dir(dir);
+    return ok ? 0 : 1;
+}
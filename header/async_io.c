@@ -0,0 +1,610 @@
+#include "async_io.h"
+#include "message_handler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+// 한 스레드가 링에 올린 요청 배치. 여러 배치가 동시에 링을 나눠 씁니다 (ring.mutex로 보호).
+typedef struct {
+    IoRequest *requests;
+    uint32_t count;
+    uint32_t next;     // 다음에 제출할 요청
+    uint32_t inflight; // 제출했지만 아직 CQE를 받지 못한 요청 수
+} RingBatch;
+
+// 링에 올라간 SQE 하나. SQE의 user_data는 이 태그의 번호입니다.
+typedef struct {
+    RingBatch *batch;
+    uint32_t request_index;
+    int slot; // 고정 버퍼 슬롯, 쓰지 않으면 -1
+} RingTag;
+
+// io_uring 링과 등록된 고정 버퍼
+typedef struct {
+    int ring_fd;
+    unsigned sq_entries;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring_ptr;
+    void *cq_ring_ptr;
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    size_t sqes_size;
+    unsigned char *fixed_buffers;
+    int free_slots[ASYNC_IO_FIXED_BUFFERS];
+    int free_slot_count;
+    RingTag tags[ASYNC_IO_QUEUE_DEPTH]; // 링에 동시에 올라가는 SQE는 태그 수를 넘지 않음 (SQ/CQ가 넘치지 않도록)
+    int free_tags[ASYNC_IO_QUEUE_DEPTH];
+    int free_tag_count;
+    int reaping; // 한 스레드가 락 밖에서 완료를 기다리는 중. CQE 수거는 그 스레드만 함
+    int failed;  // io_uring_enter가 실패해 더 이상 제출하지 않음 (이미 제출한 요청은 끝까지 수거)
+    pthread_mutex_t mutex;   // SQ 채우기, CQE 수거, 태그와 고정 버퍼 관리를 보호. 완료 대기 중에는 잡지 않음
+    pthread_cond_t progress; // CQE를 수거할 때마다 기다리는 배치를 깨움
+} IoUring;
+
+// io_uring을 쓸 수 없을 때 pread/pwrite를 대신 수행하는 스레드 풀의 작업 단위
+typedef struct PoolBatch {
+    IoRequest *requests;
+    uint32_t count;
+    uint32_t next;      // 다음에 처리할 요청 (pool_mutex로 보호)
+    uint32_t remaining; // 아직 끝나지 않은 요청 수 (pool_mutex로 보호)
+    pthread_cond_t done;
+    struct PoolBatch *next_batch;
+} PoolBatch;
+
+static AsyncIoBackend backend = ASYNC_IO_BACKEND_NONE; // 배치 처리 중에도 바뀌므로 __atomic으로 읽고 씀
+static IoUring ring = {.ring_fd = -1};
+
+static pthread_t pool_threads[ASYNC_IO_THREADS];
+static int pool_thread_count = 0;
+static PoolBatch *pool_head = NULL;
+static PoolBatch *pool_tail = NULL;
+static int pool_shutdown = 0;
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+
+// 요청 하나를 동기식 pread/pwrite로 처리합니다.
+static void perform_request(IoRequest *request)
+{
+    uint32_t shard = STORE_OFFSET_SHARD(request->offset);
+    int fd = shard < STORE_SHARD_MAX ? store_shards[shard].fd : -1;
+    if (fd < 0)
+    {
+        request->result = -EBADF;
+        return;
+    }
+    uint64_t offset = STORE_OFFSET_LOCAL(request->offset);
+    uint32_t done = 0;
+    while (done < request->length)
+    {
+        ssize_t n;
+        if (request->opcode == ASYNC_IO_READ)
+        {
+            n = pread(fd, (char *)request->buffer + done, request->length - done, offset + done);
+        }
+        else
+        {
+            n = pwrite(fd, (const char *)request->buffer + done, request->length - done, offset + done);
+        }
+        if (n < 0)
+        {
+            request->result = -errno;
+            return;
+        }
+        if (n == 0)
+        {
+            break; // 파일 끝
+        }
+        done += n;
+    }
+    request->result = done;
+}
+
+static int io_uring_setup_syscall(unsigned entries, struct io_uring_params *params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter_syscall(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int io_uring_register_syscall(int fd, unsigned opcode, const void *arg, unsigned nr_args)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void teardown_io_uring()
+{
+    if (ring.sqes != NULL && ring.sqes != MAP_FAILED)
+        munmap(ring.sqes, ring.sqes_size);
+    if (ring.cq_ring_ptr != NULL && ring.cq_ring_ptr != MAP_FAILED && ring.cq_ring_ptr != ring.sq_ring_ptr)
+        munmap(ring.cq_ring_ptr, ring.cq_ring_size);
+    if (ring.sq_ring_ptr != NULL && ring.sq_ring_ptr != MAP_FAILED)
+        munmap(ring.sq_ring_ptr, ring.sq_ring_size);
+    if (ring.ring_fd >= 0)
+        close(ring.ring_fd);
+    free(ring.fixed_buffers);
+    memset(&ring, 0, sizeof(ring));
+    ring.ring_fd = -1;
+}
+
+// io_uring 링을 만들고 shard 데이터 파일들과 고정 버퍼를 등록합니다.
+static int setup_io_uring()
+{
+    struct io_uring_params params;
+    memset(&ring, 0, sizeof(ring));
+    memset(&params, 0, sizeof(params));
+
+    ring.ring_fd = io_uring_setup_syscall(ASYNC_IO_QUEUE_DEPTH, &params);
+    if (ring.ring_fd < 0)
+    {
+        ring.ring_fd = -1;
+        return 0;
+    }
+
+    ring.sq_entries = params.sq_entries;
+    ring.sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring.cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    int single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap)
+    {
+        if (ring.cq_ring_size > ring.sq_ring_size)
+            ring.sq_ring_size = ring.cq_ring_size;
+        ring.cq_ring_size = ring.sq_ring_size;
+    }
+
+    ring.sq_ring_ptr = mmap(NULL, ring.sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.ring_fd, IORING_OFF_SQ_RING);
+    if (ring.sq_ring_ptr == MAP_FAILED)
+    {
+        teardown_io_uring();
+        return 0;
+    }
+    if (single_mmap)
+    {
+        ring.cq_ring_ptr = ring.sq_ring_ptr;
+    }
+    else
+    {
+        ring.cq_ring_ptr = mmap(NULL, ring.cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.ring_fd, IORING_OFF_CQ_RING);
+        if (ring.cq_ring_ptr == MAP_FAILED)
+        {
+            teardown_io_uring();
+            return 0;
+        }
+    }
+
+    ring.sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring.sqes = mmap(NULL, ring.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.ring_fd, IORING_OFF_SQES);
+    if (ring.sqes == MAP_FAILED)
+    {
+        teardown_io_uring();
+        return 0;
+    }
+
+    unsigned char *sq = ring.sq_ring_ptr;
+    unsigned char *cq = ring.cq_ring_ptr;
+    ring.sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring.sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring.sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring.sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring.cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring.cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring.cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring.cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    // 고정 파일: shard s의 데이터 파일 디스크립터를 s번으로 등록
+    int fds[STORE_SHARD_COUNT];
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        fds[shard] = store_shards[shard].fd;
+    }
+    if (io_uring_register_syscall(ring.ring_fd, IORING_REGISTER_FILES, fds, STORE_SHARD_COUNT) < 0)
+    {
+        teardown_io_uring();
+        return 0;
+    }
+
+    // 고정 버퍼: 짧은 레코드는 커널에 미리 매핑된 버퍼로 읽고 씁니다.
+    ring.fixed_buffers = aligned_alloc(4096, (size_t)ASYNC_IO_FIXED_BUFFERS * ASYNC_IO_FIXED_BUFFER_SIZE);
+    if (ring.fixed_buffers == NULL)
+    {
+        teardown_io_uring();
+        return 0;
+    }
+    struct iovec iovecs[ASYNC_IO_FIXED_BUFFERS];
+    for (int i = 0; i < ASYNC_IO_FIXED_BUFFERS; i++)
+    {
+        iovecs[i].iov_base = ring.fixed_buffers + (size_t)i * ASYNC_IO_FIXED_BUFFER_SIZE;
+        iovecs[i].iov_len = ASYNC_IO_FIXED_BUFFER_SIZE;
+        ring.free_slots[i] = i;
+    }
+    ring.free_slot_count = ASYNC_IO_FIXED_BUFFERS;
+    for (int i = 0; i < ASYNC_IO_QUEUE_DEPTH; i++)
+    {
+        ring.free_tags[i] = i;
+    }
+    ring.free_tag_count = ASYNC_IO_QUEUE_DEPTH;
+    if (io_uring_register_syscall(ring.ring_fd, IORING_REGISTER_BUFFERS, iovecs, ASYNC_IO_FIXED_BUFFERS) < 0)
+    {
+        teardown_io_uring();
+        return 0;
+    }
+
+    pthread_mutex_init(&ring.mutex, NULL);
+    pthread_cond_init(&ring.progress, NULL);
+    return 1;
+}
+
+// 요청 하나를 SQE로 채웁니다. 고정 버퍼 슬롯이 있으면 *_FIXED 연산을 사용합니다. ring.mutex를 잡은 채 호출합니다.
+static void prepare_sqe(struct io_uring_sqe *sqe, RingBatch *batch, uint32_t request_index, int tag)
+{
+    IoRequest *request = &batch->requests[request_index];
+    int slot = -1;
+    if (request->length <= ASYNC_IO_FIXED_BUFFER_SIZE && ring.free_slot_count > 0)
+    {
+        slot = ring.free_slots[--ring.free_slot_count];
+    }
+    ring.tags[tag].batch = batch;
+    ring.tags[tag].request_index = request_index;
+    ring.tags[tag].slot = slot;
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->fd = STORE_OFFSET_SHARD(request->offset); // 등록된 파일 배열의 인덱스
+    sqe->off = STORE_OFFSET_LOCAL(request->offset);
+    sqe->len = request->length;
+    sqe->user_data = (uint64_t)tag;
+
+    if (slot >= 0)
+    {
+        unsigned char *fixed = ring.fixed_buffers + (size_t)slot * ASYNC_IO_FIXED_BUFFER_SIZE;
+        if (request->opcode == ASYNC_IO_WRITE)
+        {
+            memcpy(fixed, request->buffer, request->length);
+        }
+        sqe->opcode = request->opcode == ASYNC_IO_READ ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+        sqe->addr = (uint64_t)(uintptr_t)fixed;
+        sqe->buf_index = slot;
+    }
+    else
+    {
+        sqe->opcode = request->opcode == ASYNC_IO_READ ? IORING_OP_READ : IORING_OP_WRITE;
+        sqe->addr = (uint64_t)(uintptr_t)request->buffer;
+    }
+}
+
+// 태그와 고정 버퍼 슬롯을 돌려주고 배치의 진행 중 수를 줄입니다. ring.mutex를 잡은 채 호출합니다.
+static void release_tag(int tag)
+{
+    if (ring.tags[tag].slot >= 0)
+    {
+        ring.free_slots[ring.free_slot_count++] = ring.tags[tag].slot;
+    }
+    ring.tags[tag].batch->inflight--;
+    ring.free_tags[ring.free_tag_count++] = tag;
+}
+
+// 완료된 CQE를 모두 수거해 어느 배치의 요청이든 결과를 적습니다. ring.mutex를 잡은 채 호출합니다.
+static void reap_completions()
+{
+    unsigned head = *ring.cq_head;
+    unsigned cq_tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+    while (head != cq_tail)
+    {
+        struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+        int tag = (int)cqe->user_data;
+        IoRequest *request = &ring.tags[tag].batch->requests[ring.tags[tag].request_index];
+
+        request->result = cqe->res;
+        if (ring.tags[tag].slot >= 0 && request->opcode == ASYNC_IO_READ && cqe->res > 0)
+        {
+            memcpy(request->buffer, ring.fixed_buffers + (size_t)ring.tags[tag].slot * ASYNC_IO_FIXED_BUFFER_SIZE, cqe->res);
+        }
+        release_tag(tag);
+        head++;
+    }
+    __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+}
+
+// 링을 더 쓰지 않도록 표시하고 이후 배치는 동기식으로 처리하게 합니다. ring.mutex를 잡은 채 호출합니다.
+// 커널이 아직 가져가지 않은 SQE는 되돌려 동기식으로 처리하고, 이미 가져간 요청은 호출자들이 CQE가 올 때까지 기다립니다
+// (커널이 버퍼를 쓰는 동안 같은 버퍼로 pread하지 않도록).
+static void fail_ring(int error)
+{
+    syslog(LOG_ERR, "io_uring_enter failed, falling back to synchronous I/O: %s", strerror(error));
+    ring.failed = 1;
+    __atomic_store_n(&backend, ASYNC_IO_BACKEND_NONE, __ATOMIC_RELEASE);
+
+    unsigned head = __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *ring.sq_tail;
+    for (; head != tail; head++)
+    {
+        release_tag((int)ring.sqes[ring.sq_array[head & *ring.sq_mask]].user_data);
+    }
+    __atomic_store_n(ring.sq_tail, head, __ATOMIC_RELEASE);
+}
+
+// SQ에 쌓였지만 커널이 아직 가져가지 않은 SQE를 모두 제출합니다. ring.mutex를 잡은 채 호출합니다.
+static int submit_pending()
+{
+    for (;;)
+    {
+        unsigned pending = *ring.sq_tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE);
+        if (pending == 0)
+        {
+            return 1;
+        }
+        int submitted = io_uring_enter_syscall(ring.ring_fd, pending, 0, 0);
+        if (submitted < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (submitted <= 0)
+        {
+            fail_ring(submitted < 0 ? errno : EIO);
+            return 0;
+        }
+    }
+}
+
+// 링은 모든 연결 스레드가 나눠 씁니다. ring.mutex는 SQ를 채우고 CQE를 수거하는 동안만 잡고,
+// 완료는 한 스레드만 락 밖에서 기다렸다가 모든 배치의 CQE를 수거해 나머지를 깨웁니다.
+static void submit_batch_io_uring(IoRequest *requests, uint32_t count)
+{
+    RingBatch batch = {.requests = requests, .count = count, .next = 0, .inflight = 0};
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        requests[i].result = -EINPROGRESS;
+    }
+
+    pthread_mutex_lock(&ring.mutex);
+    for (;;)
+    {
+        // 빈 태그만큼 이 배치의 요청을 큐에 채워 제출
+        unsigned tail = *ring.sq_tail;
+        unsigned queued = 0;
+        while (!ring.failed && batch.next < count && ring.free_tag_count > 0)
+        {
+            if (STORE_OFFSET_SHARD(requests[batch.next].offset) >= STORE_SHARD_COUNT)
+            {
+                batch.next++; // 등록하지 않은 예전 shard 파일은 아래에서 동기식으로 처리
+                continue;
+            }
+            unsigned index = tail & *ring.sq_mask;
+            prepare_sqe(&ring.sqes[index], &batch, batch.next, ring.free_tags[--ring.free_tag_count]);
+            ring.sq_array[index] = index;
+            tail++;
+            batch.next++;
+            batch.inflight++;
+            queued++;
+        }
+        if (queued > 0)
+        {
+            __atomic_store_n(ring.sq_tail, tail, __ATOMIC_RELEASE);
+            submit_pending();
+        }
+
+        if (batch.inflight == 0 && (batch.next == count || ring.failed))
+        {
+            break;
+        }
+        if (ring.reaping)
+        {
+            pthread_cond_wait(&ring.progress, &ring.mutex);
+            continue;
+        }
+
+        // 이 배치나 태그를 쥔 다른 배치의 요청이 커널에 있으므로 CQE가 적어도 하나는 옴
+        ring.reaping = 1;
+        pthread_mutex_unlock(&ring.mutex);
+        int waited = io_uring_enter_syscall(ring.ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+        int error = errno;
+        if (waited < 0 && error != EINTR)
+        {
+            // 기다릴 수도 없으면 잠깐씩 쉬며 커널이 올려 둔 CQE를 직접 수거
+            usleep(1000);
+        }
+        pthread_mutex_lock(&ring.mutex);
+        ring.reaping = 0;
+        if (waited < 0 && error != EINTR && !ring.failed)
+        {
+            fail_ring(error);
+        }
+        reap_completions();
+        pthread_cond_broadcast(&ring.progress);
+    }
+    pthread_mutex_unlock(&ring.mutex);
+
+    // 제출하지 못했거나 되돌린 요청은 동기식으로 처리 (커널에 올라간 요청은 위에서 모두 끝남)
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (requests[i].result == -EINPROGRESS)
+        {
+            perform_request(&requests[i]);
+        }
+    }
+}
+
+static void *pool_worker(void *arg)
+{
+    (void)arg;
+    for (;;)
+    {
+        pthread_mutex_lock(&pool_mutex);
+        while (!pool_shutdown && pool_head == NULL)
+        {
+            pthread_cond_wait(&pool_cond, &pool_mutex);
+        }
+        if (pool_head == NULL)
+        {
+            pthread_mutex_unlock(&pool_mutex);
+            return NULL;
+        }
+
+        PoolBatch *batch = pool_head;
+        IoRequest *request = &batch->requests[batch->next++];
+        if (batch->next == batch->count)
+        {
+            pool_head = batch->next_batch;
+            if (pool_head == NULL)
+                pool_tail = NULL;
+        }
+        pthread_mutex_unlock(&pool_mutex);
+
+        perform_request(request);
+
+        pthread_mutex_lock(&pool_mutex);
+        if (--batch->remaining == 0)
+        {
+            pthread_cond_signal(&batch->done);
+        }
+        pthread_mutex_unlock(&pool_mutex);
+    }
+}
+
+static int submit_batch_thread_pool(IoRequest *requests, uint32_t count)
+{
+    PoolBatch batch;
+    batch.requests = requests;
+    batch.count = count;
+    batch.next = 0;
+    batch.remaining = count;
+    batch.next_batch = NULL;
+    pthread_cond_init(&batch.done, NULL);
+
+    pthread_mutex_lock(&pool_mutex);
+    if (pool_tail != NULL)
+        pool_tail->next_batch = &batch;
+    else
+        pool_head = &batch;
+    pool_tail = &batch;
+    pthread_cond_broadcast(&pool_cond);
+
+    while (batch.remaining > 0)
+    {
+        pthread_cond_wait(&batch.done, &pool_mutex);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+
+    pthread_cond_destroy(&batch.done);
+    return 0;
+}
+
+// io_uring 백엔드를 초기화하고, 사용할 수 없으면 pread 스레드 풀로 대체합니다.
+// open_message_file() 이후에 호출해야 합니다.
+AsyncIoBackend async_io_init()
+{
+    if (setup_io_uring())
+    {
+        __atomic_store_n(&backend, ASYNC_IO_BACKEND_IO_URING, __ATOMIC_RELEASE);
+        syslog(LOG_INFO, "Async I/O: using io_uring (queue depth %u)", ring.sq_entries);
+        return ASYNC_IO_BACKEND_IO_URING;
+    }
+
+    pool_shutdown = 0;
+    for (int i = 0; i < ASYNC_IO_THREADS; i++)
+    {
+        if (pthread_create(&pool_threads[pool_thread_count], NULL, pool_worker, NULL) == 0)
+        {
+            pool_thread_count++;
+        }
+    }
+    AsyncIoBackend selected = pool_thread_count > 0 ? ASYNC_IO_BACKEND_THREAD_POOL : ASYNC_IO_BACKEND_NONE;
+    __atomic_store_n(&backend, selected, __ATOMIC_RELEASE);
+    syslog(LOG_INFO, "Async I/O: io_uring unavailable, using %d pread threads", pool_thread_count);
+    return selected;
+}
+
+void async_io_shutdown()
+{
+    __atomic_store_n(&backend, ASYNC_IO_BACKEND_NONE, __ATOMIC_RELEASE);
+    if (ring.ring_fd >= 0)
+    {
+        teardown_io_uring();
+    }
+    if (pool_thread_count > 0)
+    {
+        pthread_mutex_lock(&pool_mutex);
+        pool_shutdown = 1;
+        pthread_cond_broadcast(&pool_cond);
+        pthread_mutex_unlock(&pool_mutex);
+        for (int i = 0; i < pool_thread_count; i++)
+        {
+            pthread_join(pool_threads[i], NULL);
+        }
+        pool_thread_count = 0;
+    }
+}
+
+AsyncIoBackend async_io_backend()
+{
+    return __atomic_load_n(&backend, __ATOMIC_ACQUIRE);
+}
+
+const char *async_io_backend_name()
+{
+    switch (async_io_backend())
+    {
+    case ASYNC_IO_BACKEND_IO_URING:
+        return "io_uring";
+    case ASYNC_IO_BACKEND_THREAD_POOL:
+        return "thread_pool";
+    default:
+        return "sync";
+    }
+}
+
+// 요청 배치를 한꺼번에 제출하고 모두 끝날 때까지 기다립니다.
+// 각 요청의 result에 처리한 바이트 수(또는 -errno)가 기록되며, 길이만큼 모두 처리된 요청 수를 반환합니다.
+int async_io_submit_batch(IoRequest *requests, uint32_t count)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    AsyncIoBackend current = async_io_backend();
+    if (current == ASYNC_IO_BACKEND_IO_URING)
+    {
+        submit_batch_io_uring(requests, count);
+    }
+    else if (current == ASYNC_IO_BACKEND_THREAD_POOL && count > 1)
+    {
+        submit_batch_thread_pool(requests, count);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            perform_request(&requests[i]);
+        }
+    }
+
+    int completed = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (requests[i].result == (int)requests[i].length)
+        {
+            completed++;
+        }
+    }
+    return completed;
+}
@@ -0,0 +1,38 @@
+#ifndef ASYNC_IO_H
+#define ASYNC_IO_H
+
+#include <stdint.h>
+
+#define ASYNC_IO_QUEUE_DEPTH 64            // io_uring 제출 큐 크기
+#define ASYNC_IO_FIXED_BUFFERS 64          // io_uring에 등록하는 고정 버퍼 수
+#define ASYNC_IO_FIXED_BUFFER_SIZE 4096    // 고정 버퍼 하나의 크기
+#define ASYNC_IO_THREADS 4                 // io_uring을 쓸 수 없을 때의 pread 스레드 수
+
+typedef enum {
+    ASYNC_IO_READ,
+    ASYNC_IO_WRITE
+} AsyncIoOpcode;
+
+typedef enum {
+    ASYNC_IO_BACKEND_NONE,
+    ASYNC_IO_BACKEND_IO_URING,
+    ASYNC_IO_BACKEND_THREAD_POOL
+} AsyncIoBackend;
+
+// 메시지 데이터 파일에 대한 비동기 읽기/쓰기 요청 하나. offset은 shard가 붙은 offset (STORE_OFFSET)
+typedef struct {
+    AsyncIoOpcode opcode;
+    uint64_t offset;
+    uint32_t length;
+    void *buffer;
+    int result; // 처리한 바이트 수 또는 -errno
+} IoRequest;
+
+// Function declarations
+AsyncIoBackend async_io_init();
+void async_io_shutdown();
+AsyncIoBackend async_io_backend();
+const char *async_io_backend_name();
+int async_io_submit_batch(IoRequest *requests, uint32_t count);
+
+#endif // ASYNC_IO_H
@@ -0,0 +1,456 @@
+#include "compactor.h"
+#include "message_handler.h"
+#include "dedup.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <json-c/json.h>
+
+typedef struct {
+    uint64_t offset;
+    uint32_t pos; // index_table 내 위치 (index - 1)
+} RecordRef;
+
+static CompactionStats stats = {0};
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int compare_record_ref(const void *a, const void *b)
+{
+    const RecordRef *ra = a;
+    const RecordRef *rb = b;
+    if (ra->offset < rb->offset)
+        return -1;
+    if (ra->offset > rb->offset)
+        return 1;
+    return 0;
+}
+
+// 레코드 하나를 src에서 dest로 복사합니다. 겹치는 구간도 버퍼를 거치므로 안전합니다.
+static int copy_record(uint64_t src, uint64_t dest, uint32_t length, unsigned char **buffer, uint32_t *buffer_size)
+{
+    if (length > *buffer_size)
+    {
+        unsigned char *new_buffer = realloc(*buffer, length);
+        if (new_buffer == NULL)
+        {
+            return 0;
+        }
+        *buffer = new_buffer;
+        *buffer_size = length;
+    }
+
+    return read_message_data(src, *buffer, length) &&
+           write_message_data(dest, *buffer, length);
+}
+
+static void record_progress(uint32_t processed, uint32_t moved, uint64_t bytes_moved)
+{
+    pthread_mutex_lock(&stats_mutex);
+    stats.records_processed = processed;
+    stats.records_moved = moved;
+    stats.bytes_moved = bytes_moved;
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+static void finish_compaction(uint64_t reclaimed)
+{
+    pthread_mutex_lock(&stats_mutex);
+    stats.running = 0;
+    stats.runs++;
+    stats.last_reclaimed_bytes = reclaimed;
+    stats.total_reclaimed_bytes += reclaimed;
+    stats.last_finished = time(NULL);
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+// old_offset에서 new_offset으로 옮긴 슬롯을 함께 쓰던 다른 인덱스도 새 위치로 돌립니다.
+// 공유 슬롯은 같은 shard 안에만 있으므로 그 shard의 엔트리만 봅니다. write lock 아래에서 호출합니다.
+static void repoint_shared(uint32_t shard, uint64_t old_offset, uint64_t new_offset)
+{
+    dedup_relocate(old_offset, new_offset);
+    for (uint32_t p = shard; p < index_table_size; p += STORE_SHARD_COUNT)
+    {
+        if (index_table[p].offset == old_offset && index_table[p].length != 0)
+        {
+            index_table[p].offset = new_offset;
+            mark_index_dirty(p + 1);
+        }
+    }
+}
+
+// pos의 레코드를 dest로 옮기고 offset을 바꿉니다. 호출자는 shard의 writer를 잡고 있어야 하고, dest는 원본과 겹치지 않아야 합니다.
+// 대상 구간은 죽은 공간이므로 store_lock 없이 복사하고, offset 교체만 write lock 아래에서 합니다.
+static int move_record(uint32_t shard, uint32_t pos, uint64_t dest, unsigned char **buffer, uint32_t *buffer_size)
+{
+    uint64_t offset = index_table[pos].offset;
+    if (!copy_record(offset, dest, index_table[pos].length, buffer, buffer_size))
+    {
+        return 0;
+    }
+
+    pthread_rwlock_wrlock(&store_lock);
+    if (dedup_refcount(offset) > 1)
+    {
+        repoint_shared(shard, offset, dest);
+    }
+    else
+    {
+        dedup_relocate(offset, dest);
+        index_table[pos].offset = dest;
+        mark_index_dirty(pos + 1);
+    }
+    pthread_rwlock_unlock(&store_lock);
+    return 1;
+}
+
+// 지금까지 옮긴 레코드를 디스크에 남깁니다: 데이터를 fdatasync한 뒤 바뀐 인덱스 조각을 씁니다.
+// 이후로는 디스크의 인덱스도 옮겨 간 원본 구간을 가리키지 않으므로 그 구간을 덮어도 됩니다.
+// writer를 잡고 store_lock은 잡지 않은 채 부릅니다.
+static int sync_shard(uint32_t shard)
+{
+    if (fdatasync(store_shards[shard].fd) != 0)
+    {
+        syslog(LOG_ERR, "Compaction: error syncing message file of shard %u", shard);
+        return 0;
+    }
+    persist_store_shard(shard);
+    return 1;
+}
+
+// shard 하나의 살아있는 레코드를 offset 순서대로 파일 앞쪽으로 당기고 남은 꼬리를 잘라냅니다.
+// 그 shard의 엔트리와 데이터는 writer를 잡은 스레드만 바꾸므로 slice마다 writer만 잡고 복사하고,
+// offset 교체만 store_lock(쓰기)으로 잠깐 잡습니다. 다른 shard의 append는 그동안에도 진행됩니다.
+// 중간에 죽어도 레코드를 잃지 않도록, 디스크의 인덱스가 아직 가리키는 원본(pending 이상)을 덮기 전에 sync_shard()를 하고,
+// 자기 원본과 겹치는 자리로는 옮기지 않고 파일 끝으로 보냈다가 마지막 단계에서 당깁니다.
+// 스냅숏이 복사 중이면 -1, 실패하면 0, 끝나면 1을 반환합니다.
+static int compact_shard(uint32_t shard, uint32_t *processed, uint32_t *moved, uint64_t *bytes_moved, uint64_t *reclaimed,
+                         unsigned char **buffer, uint32_t *buffer_size)
+{
+    StoreShard *store = &store_shards[shard];
+    uint64_t cursor = STORE_OFFSET(shard, 0);
+    uint64_t pending = UINT64_MAX; // 옮겼지만 디스크의 인덱스가 아직 가리키는 원본 중 가장 앞의 offset
+    uint64_t bounced = 0;          // 파일 끝으로 보내느라 파일을 늘린 바이트 수 (회수량에서 뺌)
+
+    // 시작 시점의 파일 끝을 기록하고, 이후의 쓰기는 모두 그 뒤에 추가되도록 합니다.
+    lock_store_shard(shard);
+    if (store->frozen_end != 0)
+    {
+        // 스냅숏이 복사 중인 구간은 옮길 수 없음 (start_compaction 확인 뒤에 스냅숏이 시작된 경우)
+        unlock_store_shard(shard);
+        return -1;
+    }
+    pthread_rwlock_wrlock(&store_lock);
+    __atomic_store_n(&store->reuse_disabled, 1, __ATOMIC_RELEASE);
+    // 옮겨 온 레코드가 들어갈 죽은 구간이 디스크의 free space에 남아 있으면 재시작 뒤 재사용으로 덮일 수 있으므로 비움
+    store->free_space_size = 0;
+    store->free_space_dirty = 1;
+    pthread_rwlock_unlock(&store_lock);
+    persist_store_shard(shard);
+    uint64_t snapshot_end = STORE_OFFSET(shard, store->file_size);
+    uint32_t count = 0;
+    uint32_t size = __atomic_load_n(&index_table_size, __ATOMIC_ACQUIRE);
+    RecordRef *order = malloc(sizeof(RecordRef) * (size / STORE_SHARD_COUNT + 1));
+    if (order != NULL)
+    {
+        for (uint32_t i = shard; i < size; i += STORE_SHARD_COUNT)
+        {
+            if (index_table[i].length != 0 && STORE_OFFSET_SHARD(index_table[i].offset) == shard)
+            {
+                order[count].offset = index_table[i].offset;
+                order[count].pos = i;
+                count++;
+            }
+        }
+    }
+    unlock_store_shard(shard);
+    if (order == NULL)
+    {
+        syslog(LOG_ERR, "Compaction: memory allocation failed");
+        __atomic_store_n(&store->reuse_disabled, 0, __ATOMIC_RELEASE);
+        return 0;
+    }
+    qsort(order, count, sizeof(RecordRef), compare_record_ref);
+
+    int failed = 0;
+    uint32_t i = 0;
+    while (i < count && !failed)
+    {
+        lock_store_shard(shard);
+        for (uint32_t slice = 0; slice < COMPACTION_SLICE_RECORDS && i < count && !failed; i++)
+        {
+            uint32_t pos = order[i].pos;
+            (*processed)++;
+            // slice 사이에 수정·삭제되었을 수 있으므로 writer 아래에서 다시 읽음
+            uint64_t offset = index_table[pos].offset;
+            uint32_t length = index_table[pos].length;
+            if (length == 0 || offset >= snapshot_end || offset < cursor)
+            {
+                // 지워졌거나 compaction 도중 파일 끝으로 옮겨진 레코드는 마지막 단계에서 처리
+                continue;
+            }
+            if (offset == cursor)
+            {
+                cursor += length;
+                continue;
+            }
+            // 앞의 빈 틈이 레코드보다 작으면 옮기는 중에 원본을 덮으므로 파일 끝으로 보냄 (빈 틈은 다음 레코드 몫으로 커짐)
+            int bounce = offset < cursor + length;
+            uint64_t dest = bounce ? STORE_OFFSET(shard, store->file_size) : cursor;
+            if (!bounce && cursor + length > pending)
+            {
+                if (!sync_shard(shard))
+                {
+                    failed = 1;
+                    break;
+                }
+                pending = UINT64_MAX;
+            }
+            if (!move_record(shard, pos, dest, buffer, buffer_size))
+            {
+                syslog(LOG_ERR, "Compaction: error relocating record %u", pos + 1);
+                failed = 1;
+                break;
+            }
+            if (offset < pending)
+            {
+                pending = offset;
+            }
+            (*moved)++;
+            *bytes_moved += length;
+            slice++;
+            if (bounce)
+            {
+                bounced += length;
+            }
+            else
+            {
+                cursor += length;
+            }
+        }
+        if (!sync_shard(shard))
+        {
+            failed = 1;
+        }
+        pending = UINT64_MAX;
+        unlock_store_shard(shard);
+
+        record_progress(*processed, *moved, *bytes_moved);
+        usleep(COMPACTION_SLICE_SLEEP_US);
+    }
+    free(order);
+
+    lock_store_shard(shard);
+    if (!failed)
+    {
+        // compaction 중 파일 끝에 쓰인 레코드도 앞으로 당긴 뒤 꼬리를 잘라냅니다.
+        uint32_t tail_count = 0;
+        size = __atomic_load_n(&index_table_size, __ATOMIC_ACQUIRE);
+        RecordRef *tail = malloc(sizeof(RecordRef) * (size / STORE_SHARD_COUNT + 1));
+        if (tail == NULL)
+        {
+            failed = 1;
+        }
+        else
+        {
+            for (uint32_t p = shard; p < size; p += STORE_SHARD_COUNT)
+            {
+                if (index_table[p].length != 0 && index_table[p].offset >= snapshot_end &&
+                    STORE_OFFSET_SHARD(index_table[p].offset) == shard)
+                {
+                    tail[tail_count].offset = index_table[p].offset;
+                    tail[tail_count].pos = p;
+                    tail_count++;
+                }
+            }
+            qsort(tail, tail_count, sizeof(RecordRef), compare_record_ref);
+
+            for (uint32_t t = 0; t < tail_count && !failed; t++)
+            {
+                IndexEntry *entry = &index_table[tail[t].pos];
+                if (entry->offset < snapshot_end)
+                {
+                    continue; // 앞에서 옮긴 공유 슬롯을 함께 쓰던 엔트리
+                }
+                uint64_t offset = entry->offset;
+                uint32_t length = entry->length;
+                if (offset < cursor + length)
+                {
+                    // 원본과 겹치는 자리: 레코드보다 작은 빈 틈은 남기고 제자리에 둠 (다음 compaction에서 회수)
+                    cursor = offset + length;
+                    continue;
+                }
+                if (cursor + length > pending)
+                {
+                    if (!sync_shard(shard))
+                    {
+                        failed = 1;
+                        break;
+                    }
+                    pending = UINT64_MAX;
+                }
+                if (!move_record(shard, tail[t].pos, cursor, buffer, buffer_size))
+                {
+                    syslog(LOG_ERR, "Compaction: error relocating record %u", tail[t].pos + 1);
+                    failed = 1;
+                    break;
+                }
+                if (offset < pending)
+                {
+                    pending = offset;
+                }
+                (*moved)++;
+                *bytes_moved += length;
+                cursor += length;
+            }
+            free(tail);
+        }
+    }
+
+    // 꼬리를 자르기 전에 옮긴 레코드와 인덱스를 디스크에 남김. 꼬리는 이제 아무 엔트리도 가리키지 않으므로
+    // 파일 자르기도 store_lock 밖에서 하고, 크기와 free space만 write lock 아래에서 바꿉니다.
+    uint64_t new_size = STORE_OFFSET_LOCAL(cursor);
+    int truncated = sync_shard(shard) && !failed;
+    if (truncated && ftruncate(store->fd, new_size) != 0)
+    {
+        syslog(LOG_ERR, "Compaction: error truncating message file of shard %u", shard);
+        truncated = 0;
+    }
+    pthread_rwlock_wrlock(&store_lock);
+    if (truncated)
+    {
+        if (store->file_size > new_size + bounced)
+        {
+            *reclaimed += store->file_size - new_size - bounced;
+        }
+        store->file_size = new_size;
+    }
+    __atomic_store_n(&store->reuse_disabled, 0, __ATOMIC_RELEASE);
+    pthread_rwlock_unlock(&store_lock);
+    persist_store_shard(shard);
+    unlock_store_shard(shard);
+    return !failed;
+}
+
+// shard마다 차례로 compaction합니다.
+static void *compaction_thread(void *arg)
+{
+    (void)arg;
+    unsigned char *buffer = NULL;
+    uint32_t buffer_size = 0;
+    uint32_t processed = 0, moved = 0;
+    uint64_t bytes_moved = 0, reclaimed = 0;
+
+    uint32_t total = 0;
+    pthread_rwlock_rdlock(&store_lock);
+    for (uint32_t i = 0; i < index_table_size; i++)
+    {
+        total += index_table[i].length != 0;
+    }
+    pthread_rwlock_unlock(&store_lock);
+    pthread_mutex_lock(&stats_mutex);
+    stats.records_total = total;
+    pthread_mutex_unlock(&stats_mutex);
+
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        int result = compact_shard(shard, &processed, &moved, &bytes_moved, &reclaimed, &buffer, &buffer_size);
+        if (result < 0)
+        {
+            syslog(LOG_WARNING, "Compaction stopped at shard %u: a snapshot is being copied", shard);
+            break;
+        }
+        if (result == 0)
+        {
+            break;
+        }
+    }
+
+    free(buffer);
+    record_progress(processed, moved, bytes_moved);
+    finish_compaction(reclaimed);
+    syslog(LOG_INFO, "Compaction finished: moved %u records, reclaimed %lu bytes", moved, (unsigned long)reclaimed);
+    return NULL;
+}
+
+// 스냅숏이 데이터 파일을 복사 중인지 확인합니다 (얼린 shard가 하나라도 있으면 복사 중).
+static int snapshot_in_progress()
+{
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        if (__atomic_load_n(&store_shards[shard].frozen_end, __ATOMIC_RELAXED) != 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 백그라운드 compaction을 시작합니다. 이미 실행 중이거나 스냅숏을 복사 중이면 0을 반환합니다.
+int start_compaction()
+{
+    pthread_mutex_lock(&stats_mutex);
+    if (stats.running || snapshot_in_progress())
+    {
+        pthread_mutex_unlock(&stats_mutex);
+        return 0;
+    }
+    stats.running = 1;
+    stats.records_total = 0;
+    stats.records_processed = 0;
+    stats.records_moved = 0;
+    stats.bytes_moved = 0;
+    stats.last_started = time(NULL);
+    pthread_mutex_unlock(&stats_mutex);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, compaction_thread, NULL) != 0)
+    {
+        syslog(LOG_ERR, "Failed to create compaction thread");
+        pthread_mutex_lock(&stats_mutex);
+        stats.running = 0;
+        pthread_mutex_unlock(&stats_mutex);
+        return 0;
+    }
+    pthread_detach(thread);
+    return 1;
+}
+
+CompactionStats get_compaction_stats()
+{
+    pthread_mutex_lock(&stats_mutex);
+    CompactionStats copy = stats;
+    pthread_mutex_unlock(&stats_mutex);
+    return copy;
+}
+
+// compaction 진행 상황과 회수한 바이트 수를 JSON 형식으로 반환하는 함수
+char *get_compaction_stats_info()
+{
+    CompactionStats current = get_compaction_stats();
+
+    json_object *data = json_object_new_object();
+    json_object_object_add(data, "running", json_object_new_boolean(current.running));
+    json_object_object_add(data, "runs", json_object_new_int(current.runs));
+    json_object_object_add(data, "records_total", json_object_new_int(current.records_total));
+    json_object_object_add(data, "records_processed", json_object_new_int(current.records_processed));
+    json_object_object_add(data, "records_moved", json_object_new_int(current.records_moved));
+    json_object_object_add(data, "bytes_moved", json_object_new_int64(current.bytes_moved));
+    json_object_object_add(data, "progress", json_object_new_double(current.records_total > 0 ? (double)current.records_processed / current.records_total : 0.0));
+    json_object_object_add(data, "last_reclaimed_bytes", json_object_new_int64(current.last_reclaimed_bytes));
+    json_object_object_add(data, "total_reclaimed_bytes", json_object_new_int64(current.total_reclaimed_bytes));
+    json_object_object_add(data, "last_started", json_object_new_int64(current.last_started));
+    json_object_object_add(data, "last_finished", json_object_new_int64(current.last_finished));
+
+    json_object *result = json_object_new_object();
+    json_object_object_add(result, "action", json_object_new_string("compaction_stats"));
+    json_object_object_add(result, "data", data);
+
+    const char *json_string = json_object_to_json_string(result);
+    char *response = strdup(json_string);
+
+    json_object_put(result);
+    return response;
+}
@@ -0,0 +1,28 @@
+#ifndef COMPACTOR_H
+#define COMPACTOR_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define COMPACTION_SLICE_RECORDS 64     // 한 time slice에서 옮기는 최대 레코드 수
+#define COMPACTION_SLICE_SLEEP_US 2000  // slice 사이에 쉬는 시간 (마이크로초)
+
+typedef struct {
+    int running;
+    uint32_t runs;                // 완료된 compaction 횟수
+    uint32_t records_total;       // 현재 실행의 대상 레코드 수
+    uint32_t records_processed;   // 현재 실행에서 검사한 레코드 수
+    uint32_t records_moved;       // 현재 실행에서 옮긴 레코드 수
+    uint64_t bytes_moved;         // 현재 실행에서 옮긴 바이트 수
+    uint64_t last_reclaimed_bytes;  // 마지막 실행에서 줄어든 파일 크기
+    uint64_t total_reclaimed_bytes; // 누적 회수 바이트
+    time_t last_started;
+    time_t last_finished;
+} CompactionStats;
+
+// Function declarations
+int start_compaction();
+CompactionStats get_compaction_stats();
+char *get_compaction_stats_info();
+
+#endif // COMPACTOR_H
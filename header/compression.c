@@ -0,0 +1,719 @@
+#include "compression.h"
+#include "message_handler.h"
+#include "crc32c.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <zlib.h>
+#include <json-c/json.h>
+
+#define DICT_FILE_MAGIC 0x4349444D // "MDIC"
+
+// 사전, 학습용 샘플, 사전 deflate 스트림을 보호하는 락. store_lock을 잡은 채로 잡을 수 있지만 반대는 안 됩니다.
+// 사전은 한 번 정해지면 compression_stop()까지 바뀌지 않으므로 푸는 쪽은 포인터만 락 아래에서 가져갑니다.
+static pthread_mutex_t compression_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned char *dictionary = NULL;
+static uint32_t dictionary_length = 0;
+static uint32_t dictionary_id = 0;
+
+static unsigned char *samples = NULL;
+static uint32_t sample_bytes = 0;
+
+static z_stream primed_stream; // 사전을 넣어 둔 deflate 스트림, 레코드마다 복제해서 씀
+static int deflate_ready = 0;
+
+static CompressionStats stats = {0};
+
+static pthread_t train_thread;
+static int train_thread_started = 0;
+
+// ---- LZ4 블록 형식 ----
+// 배포 환경에 liblz4 헤더가 없어도 빌드되도록 블록 형식의 압축/해제를 직접 구현합니다.
+// 출력은 표준 LZ4 블록이므로 LZ4_decompress_safe()로도 풀 수 있습니다.
+
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5  // 블록의 마지막 5바이트는 항상 리터럴
+#define LZ4_MF_LIMIT 12      // 마지막 매치는 블록 끝에서 12바이트 전에 시작해야 함
+#define LZ4_HASH_LOG 12
+#define LZ4_MAX_DISTANCE 65535
+
+static inline uint32_t read32(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t lz4_hash(uint32_t sequence)
+{
+    return (sequence * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+// 15 이상인 리터럴/매치 길이의 나머지를 255 단위로 씁니다.
+static unsigned char *lz4_write_length(unsigned char *op, uint32_t length)
+{
+    while (length >= 255)
+    {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (unsigned char)length;
+    return op;
+}
+
+// src를 LZ4 블록으로 압축합니다. capacity 안에 들어가지 않으면 0을 반환합니다.
+uint32_t lz4_compress_block(const unsigned char *src, uint32_t src_length, unsigned char *dst, uint32_t capacity)
+{
+    uint32_t table[1 << LZ4_HASH_LOG]; // 위치 + 1 (0이면 비어 있음)
+    memset(table, 0, sizeof(table));
+    unsigned char *op = dst;
+    unsigned char *oend = dst + capacity;
+    uint32_t anchor = 0;
+
+    if (src_length >= LZ4_MF_LIMIT + 1)
+    {
+        uint32_t mflimit = src_length - LZ4_MF_LIMIT;
+        uint32_t matchlimit = src_length - LZ4_LAST_LITERALS;
+        uint32_t ip = 0;
+        uint32_t misses = 0;
+        while (ip < mflimit)
+        {
+            uint32_t sequence = read32(src + ip);
+            uint32_t h = lz4_hash(sequence);
+            uint32_t ref = table[h];
+            table[h] = ip + 1;
+            if (ref == 0 || ip - (ref - 1) > LZ4_MAX_DISTANCE || read32(src + ref - 1) != sequence)
+            {
+                ip += 1 + (misses++ >> 6); // 압축되지 않는 구간은 점점 건너뜀
+                continue;
+            }
+            misses = 0;
+
+            uint32_t match = ref - 1;
+            while (ip > anchor && match > 0 && src[ip - 1] == src[match - 1])
+            {
+                ip--;
+                match--;
+            }
+            uint32_t length = LZ4_MIN_MATCH;
+            while (ip + length < matchlimit && src[ip + length] == src[match + length])
+            {
+                length++;
+            }
+
+            uint32_t literals = ip - anchor;
+            uint32_t extra = length - LZ4_MIN_MATCH;
+            if ((size_t)(oend - op) < 1 + literals / 255 + 1 + literals + 2 + extra / 255 + 1)
+            {
+                return 0;
+            }
+            unsigned char *token = op++;
+            *token = (unsigned char)((literals >= 15 ? 15 : literals) << 4);
+            if (literals >= 15)
+            {
+                op = lz4_write_length(op, literals - 15);
+            }
+            memcpy(op, src + anchor, literals);
+            op += literals;
+            uint32_t distance = ip - match;
+            op[0] = distance & 0xFF;
+            op[1] = distance >> 8;
+            op += 2;
+            *token |= extra >= 15 ? 15 : extra;
+            if (extra >= 15)
+            {
+                op = lz4_write_length(op, extra - 15);
+            }
+
+            ip += length;
+            anchor = ip;
+            if (ip < mflimit)
+            {
+                table[lz4_hash(read32(src + ip - 2))] = ip - 2 + 1;
+            }
+        }
+    }
+
+    uint32_t literals = src_length - anchor;
+    if ((size_t)(oend - op) < 1 + literals / 255 + 1 + literals)
+    {
+        return 0;
+    }
+    *op++ = (unsigned char)((literals >= 15 ? 15 : literals) << 4);
+    if (literals >= 15)
+    {
+        op = lz4_write_length(op, literals - 15);
+    }
+    memcpy(op, src + anchor, literals);
+    op += literals;
+    return op - dst;
+}
+
+// LZ4 블록을 풉니다. 정확히 dst_length 바이트가 나와야 1을 반환하며, 입력이 손상되어도 범위 밖을 읽거나 쓰지 않습니다.
+int lz4_decompress_block(const unsigned char *src, uint32_t src_length, unsigned char *dst, uint32_t dst_length)
+{
+    const unsigned char *ip = src;
+    const unsigned char *iend = src + src_length;
+    unsigned char *op = dst;
+    unsigned char *oend = dst + dst_length;
+
+    while (ip < iend)
+    {
+        unsigned token = *ip++;
+        size_t literals = token >> 4;
+        if (literals == 15)
+        {
+            unsigned byte;
+            do
+            {
+                if (ip >= iend)
+                {
+                    return 0;
+                }
+                byte = *ip++;
+                literals += byte;
+            } while (byte == 255);
+        }
+        if (literals > (size_t)(iend - ip) || literals > (size_t)(oend - op))
+        {
+            return 0;
+        }
+        if (literals <= 16 && iend - ip >= 16 && oend - op >= 16)
+        {
+            memcpy(op, ip, 16); // 짧은 리터럴은 고정 길이로 복사 (넘친 바이트는 뒤에서 덮어씀)
+        }
+        else
+        {
+            memcpy(op, ip, literals);
+        }
+        op += literals;
+        ip += literals;
+        if (ip == iend)
+        {
+            break; // 마지막 시퀀스는 리터럴만 있음
+        }
+
+        if (iend - ip < 2)
+        {
+            return 0;
+        }
+        size_t distance = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (distance == 0 || distance > (size_t)(op - dst))
+        {
+            return 0;
+        }
+        size_t length = token & 15;
+        if (length == 15)
+        {
+            unsigned byte;
+            do
+            {
+                if (ip >= iend)
+                {
+                    return 0;
+                }
+                byte = *ip++;
+                length += byte;
+            } while (byte == 255);
+        }
+        length += LZ4_MIN_MATCH;
+        if (length > (size_t)(oend - op))
+        {
+            return 0;
+        }
+        const unsigned char *match = op - distance;
+        if (distance >= 8 && (size_t)(oend - op) >= length + 8)
+        {
+            // 8바이트씩 복사: 출력 끝에 여유가 있을 때만, 마지막 덩어리가 넘친 바이트는 다음 시퀀스가 덮어씀
+            for (size_t i = 0; i < length; i += 8)
+            {
+                memcpy(op + i, match + i, 8);
+            }
+        }
+        else if (distance >= length)
+        {
+            memcpy(op, match, length);
+        }
+        else
+        {
+            for (size_t i = 0; i < length; i++) // 겹치는 매치는 앞에서부터 한 바이트씩 (반복 패턴)
+            {
+                op[i] = match[i];
+            }
+        }
+        op += length;
+    }
+    return op == oend;
+}
+
+// ---- 공유 사전 ----
+
+#define SHINGLE_SIZE 8
+#define SHINGLE_TABLE_LOG 16
+
+static inline uint32_t shingle_hash(const unsigned char *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return (uint32_t)((v * 0x9E3779B185EBCA87ULL) >> (64 - SHINGLE_TABLE_LOG));
+}
+
+// 샘플에서 자주 나오는 8바이트 조각을 많이 담은 구간을 골라 사전을 만듭니다 (zstd COVER 방식을 단순화).
+// 샘플을 사전 조각 수만큼의 구간(epoch)으로 나눠 구간마다 점수가 가장 높은 조각 하나를 고르고,
+// 고른 조각의 8바이트 조각은 빈도를 0으로 만들어 같은 내용이 사전에 두 번 들어가지 않게 합니다.
+static uint32_t train_dictionary(const unsigned char *data, uint32_t length, unsigned char *dict, uint32_t capacity)
+{
+    if (length <= capacity)
+    {
+        memcpy(dict, data, length);
+        return length;
+    }
+
+    uint32_t *frequency = calloc(1 << SHINGLE_TABLE_LOG, sizeof(uint32_t));
+    uint32_t segment_count = capacity / COMPRESSION_DICT_SEGMENT;
+    typedef struct { uint32_t start; uint64_t score; } Segment;
+    Segment *chosen = malloc(sizeof(Segment) * segment_count);
+    if (frequency == NULL || chosen == NULL)
+    {
+        free(frequency);
+        free(chosen);
+        return 0;
+    }
+    for (uint32_t i = 0; i + SHINGLE_SIZE <= length; i++)
+    {
+        frequency[shingle_hash(data + i)]++;
+    }
+
+    const uint32_t window = COMPRESSION_DICT_SEGMENT - SHINGLE_SIZE + 1; // 조각 하나에 시작하는 8바이트 조각 수
+    uint32_t epoch = length / segment_count;
+    uint32_t picked = 0;
+    for (uint32_t e = 0; e < segment_count; e++)
+    {
+        uint32_t start = e * epoch;
+        uint32_t end = e + 1 == segment_count ? length : start + epoch;
+        if (end - start < COMPRESSION_DICT_SEGMENT)
+        {
+            continue;
+        }
+        uint64_t score = 0;
+        for (uint32_t j = 0; j < window; j++)
+        {
+            score += frequency[shingle_hash(data + start + j)];
+        }
+        uint64_t best_score = score;
+        uint32_t best = start;
+        for (uint32_t w = start + 1; w + COMPRESSION_DICT_SEGMENT <= end; w++)
+        {
+            score -= frequency[shingle_hash(data + w - 1)];
+            score += frequency[shingle_hash(data + w + window - 1)];
+            if (score > best_score)
+            {
+                best_score = score;
+                best = w;
+            }
+        }
+        if (best_score == 0)
+        {
+            continue;
+        }
+        for (uint32_t j = 0; j < window; j++)
+        {
+            frequency[shingle_hash(data + best + j)] = 0;
+        }
+        chosen[picked].start = best;
+        chosen[picked].score = best_score;
+        picked++;
+    }
+
+    // deflate는 가까운 거리를 더 짧게 부호화하므로 점수가 높은 조각을 사전 끝(본문 바로 앞)에 둠
+    for (uint32_t i = 1; i < picked; i++)
+    {
+        Segment s = chosen[i];
+        uint32_t j = i;
+        while (j > 0 && chosen[j - 1].score > s.score)
+        {
+            chosen[j] = chosen[j - 1];
+            j--;
+        }
+        chosen[j] = s;
+    }
+    for (uint32_t i = 0; i < picked; i++)
+    {
+        memcpy(dict + (size_t)i * COMPRESSION_DICT_SEGMENT, data + chosen[i].start, COMPRESSION_DICT_SEGMENT);
+    }
+
+    free(frequency);
+    free(chosen);
+    return picked * COMPRESSION_DICT_SEGMENT;
+}
+
+static uint32_t make_dictionary_id(const unsigned char *dict, uint32_t length)
+{
+    uint32_t id = crc32c(0, dict, length) & 0xFFFFFF;
+    return id != 0 ? id : 1;
+}
+
+// 사전 파일: magic, id, 길이, 사전 내용. 임시 파일에 쓰고 fsync한 뒤 rename으로 교체합니다.
+static int save_dictionary(const unsigned char *dict, uint32_t length, uint32_t id)
+{
+    char temp_path[256];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", COMPRESSION_DICT_FILE);
+    FILE *file = fopen(temp_path, "wb");
+    if (file == NULL)
+    {
+        syslog(LOG_ERR, "Error opening dictionary file for writing: %s", COMPRESSION_DICT_FILE);
+        return 0;
+    }
+    uint32_t header[3] = {DICT_FILE_MAGIC, id, length};
+    fwrite(header, sizeof(header), 1, file);
+    fwrite(dict, 1, length, file);
+    int ok = fflush(file) == 0 && !ferror(file) && fsync(fileno(file)) == 0;
+    if (fclose(file) != 0)
+    {
+        ok = 0;
+    }
+    if (!ok || rename(temp_path, COMPRESSION_DICT_FILE) != 0)
+    {
+        syslog(LOG_ERR, "Error saving dictionary file: %s", COMPRESSION_DICT_FILE);
+        unlink(temp_path);
+        return 0;
+    }
+    return 1;
+}
+
+static void load_dictionary()
+{
+    FILE *file = fopen(COMPRESSION_DICT_FILE, "rb");
+    if (file == NULL)
+    {
+        return;
+    }
+    uint32_t header[3];
+    unsigned char *dict = NULL;
+    if (fread(header, sizeof(header), 1, file) == 1 && header[0] == DICT_FILE_MAGIC &&
+        header[2] > 0 && header[2] <= COMPRESSION_DICT_SIZE && (dict = malloc(header[2])) != NULL &&
+        fread(dict, 1, header[2], file) == header[2] && make_dictionary_id(dict, header[2]) == header[1])
+    {
+        dictionary = dict;
+        dictionary_length = header[2];
+        dictionary_id = header[1];
+        syslog(LOG_INFO, "Loaded compression dictionary %06x (%u bytes)", dictionary_id, dictionary_length);
+    }
+    else
+    {
+        // 이 사전으로 압축된 레코드는 읽을 수 없게 되므로 크게 남김
+        syslog(LOG_ERR, "Compression dictionary is corrupt: %s", COMPRESSION_DICT_FILE);
+        free(dict);
+    }
+    fclose(file);
+}
+
+static double elapsed_ms_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+// 모인 샘플로 사전을 학습하고 파일에 저장한 뒤에야 공개합니다 (사전 없이 남는 압축 레코드가 없도록).
+static void *train_dictionary_thread(void *arg)
+{
+    (void)arg;
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    // 학습 중에는 샘플을 더 모으지 않으므로 락 없이 읽음
+    unsigned char *dict = malloc(COMPRESSION_DICT_SIZE);
+    uint32_t length = dict != NULL ? train_dictionary(samples, sample_bytes, dict, COMPRESSION_DICT_SIZE) : 0;
+    uint32_t id = length > 0 ? make_dictionary_id(dict, length) : 0;
+    int saved = length > 0 && save_dictionary(dict, length, id);
+
+    pthread_mutex_lock(&compression_lock);
+    if (saved)
+    {
+        dictionary = dict;
+        dictionary_length = length;
+        dictionary_id = id;
+        free(samples);
+        samples = NULL;
+        sample_bytes = 0;
+        syslog(LOG_INFO, "Trained compression dictionary %06x (%u bytes)", id, length);
+    }
+    else
+    {
+        syslog(LOG_ERR, "Compression dictionary training failed");
+        free(dict);
+        sample_bytes = 0; // 처음부터 다시 모음
+    }
+    stats.training = 0;
+    stats.train_ms = elapsed_ms_since(&started);
+    pthread_mutex_unlock(&compression_lock);
+    return NULL;
+}
+
+// compression_lock을 잡은 채 호출합니다. 짧은 메시지를 샘플로 모으고, 다 모이면 학습을 시작합니다.
+static void collect_sample(const char *message, uint32_t length)
+{
+    if (stats.training)
+    {
+        return;
+    }
+    if (train_thread_started)
+    {
+        // 이전 학습이 실패해 끝난 경우 (성공했다면 사전이 있어 여기까지 오지 않음)
+        pthread_join(train_thread, NULL);
+        train_thread_started = 0;
+    }
+    if (samples == NULL && (samples = malloc(COMPRESSION_DICT_SAMPLE_BYTES)) == NULL)
+    {
+        return;
+    }
+    uint32_t copy = COMPRESSION_DICT_SAMPLE_BYTES - sample_bytes;
+    if (copy > length)
+    {
+        copy = length;
+    }
+    memcpy(samples + sample_bytes, message, copy);
+    sample_bytes += copy;
+
+    if (sample_bytes == COMPRESSION_DICT_SAMPLE_BYTES)
+    {
+        stats.training = 1;
+        if (pthread_create(&train_thread, NULL, train_dictionary_thread, NULL) == 0)
+        {
+            train_thread_started = 1;
+        }
+        else
+        {
+            syslog(LOG_ERR, "Failed to start dictionary training thread");
+            stats.training = 0;
+            sample_bytes = 0;
+        }
+    }
+}
+
+// ---- 레코드 본문 ----
+
+// compression_lock을 잡은 채 호출합니다. 사전을 넣어 둔 스트림(primed_stream)을 한 번 만들고
+// 레코드마다 deflateCopy()로 복제합니다. 매번 deflateSetDictionary()를 부르면 사전 8KB를 다시 해시해야 해서
+// 짧은 메시지에서는 압축 자체보다 비싸므로, 복제할 상태가 작도록 창을 16KB(사전 + 최대 본문)로 줄였습니다.
+static uint32_t deflate_with_dictionary(const char *message, uint32_t length, unsigned char *out, uint32_t capacity)
+{
+    if (!deflate_ready)
+    {
+        memset(&primed_stream, 0, sizeof(primed_stream));
+        if (deflateInit2(&primed_stream, COMPRESSION_DICT_LEVEL, Z_DEFLATED, -COMPRESSION_DICT_WINDOW_BITS,
+                         COMPRESSION_DICT_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            return 0;
+        }
+        if (deflateSetDictionary(&primed_stream, dictionary, dictionary_length) != Z_OK)
+        {
+            deflateEnd(&primed_stream);
+            return 0;
+        }
+        deflate_ready = 1;
+    }
+
+    z_stream stream;
+    if (deflateCopy(&stream, &primed_stream) != Z_OK)
+    {
+        return 0;
+    }
+    stream.next_in = (unsigned char *)message;
+    stream.avail_in = length;
+    stream.next_out = out;
+    stream.avail_out = capacity;
+    int result = deflate(&stream, Z_FINISH);
+    uint32_t written = capacity - stream.avail_out;
+    deflateEnd(&stream);
+    return result == Z_STREAM_END ? written : 0;
+}
+
+// 메시지를 압축 레코드 본문(원래 길이 + 코덱 태그 + 압축 데이터)으로 out에 씁니다. out은 length 바이트 이상이어야 합니다.
+// 긴 메시지는 LZ4, 중간 길이는 학습된 공유 사전 deflate를 쓰며, 압축해도 더 작은 slab class에 들어가지 않으면
+// 0을 반환합니다 (호출자가 원본으로 저장). append/modify에서 store_lock을 쓰기로 잡은 채 호출됩니다.
+uint32_t compress_record_body(const char *message, uint32_t length, unsigned char *out)
+{
+    if (!COMPRESSION_ENABLED || length < COMPRESSION_DICT_MIN_LENGTH)
+    {
+        return 0;
+    }
+
+    uint32_t capacity = length - COMPRESSION_HEADER_SIZE;
+    uint32_t codec;
+    uint32_t compressed;
+    if (length >= COMPRESSION_LZ4_MIN_LENGTH)
+    {
+        codec = CODEC_LZ4;
+        compressed = lz4_compress_block((const unsigned char *)message, length, out + COMPRESSION_HEADER_SIZE, capacity);
+        pthread_mutex_lock(&compression_lock);
+    }
+    else
+    {
+        pthread_mutex_lock(&compression_lock);
+        if (dictionary == NULL)
+        {
+            collect_sample(message, length);
+            pthread_mutex_unlock(&compression_lock);
+            return 0;
+        }
+        codec = CODEC_DEFLATE_DICT | (dictionary_id << 8);
+        compressed = deflate_with_dictionary(message, length, out + COMPRESSION_HEADER_SIZE, capacity);
+    }
+
+    uint32_t stored = compressed > 0 ? COMPRESSION_HEADER_SIZE + compressed : 0;
+    if (stored == 0 || slab_class_size(RECORD_HEADER_SIZE + stored) >= slab_class_size(RECORD_HEADER_SIZE + length))
+    {
+        stats.not_worth++;
+        pthread_mutex_unlock(&compression_lock);
+        return 0;
+    }
+    if ((codec & 0xFF) == CODEC_LZ4)
+        stats.lz4_records++;
+    else
+        stats.dict_records++;
+    stats.raw_bytes += length;
+    stats.stored_bytes += stored;
+    pthread_mutex_unlock(&compression_lock);
+
+    memcpy(out, &length, sizeof(uint32_t));
+    memcpy(out + sizeof(uint32_t), &codec, sizeof(uint32_t));
+    return stored;
+}
+
+// 압축 레코드 본문이 풀렸을 때의 길이. 본문이 너무 짧으면 0을 반환합니다.
+uint32_t compressed_body_length(const unsigned char *body, uint32_t body_length)
+{
+    if (body_length < COMPRESSION_HEADER_SIZE)
+    {
+        return 0;
+    }
+    uint32_t length;
+    memcpy(&length, body, sizeof(uint32_t));
+    return length;
+}
+
+// 압축 레코드 본문을 out에 정확히 out_length 바이트로 풉니다. 실패하면 0을 반환합니다.
+int decompress_record_body(const unsigned char *body, uint32_t body_length, char *out, uint32_t out_length)
+{
+    uint32_t codec;
+    memcpy(&codec, body + sizeof(uint32_t), sizeof(uint32_t));
+    const unsigned char *data = body + COMPRESSION_HEADER_SIZE;
+    uint32_t data_length = body_length - COMPRESSION_HEADER_SIZE;
+    int ok = 0;
+
+    if ((codec & 0xFF) == CODEC_LZ4)
+    {
+        ok = lz4_decompress_block(data, data_length, (unsigned char *)out, out_length);
+    }
+    else if ((codec & 0xFF) == CODEC_DEFLATE_DICT)
+    {
+        pthread_mutex_lock(&compression_lock);
+        const unsigned char *dict = dictionary_id == codec >> 8 ? dictionary : NULL;
+        uint32_t dict_length = dictionary_length;
+        pthread_mutex_unlock(&compression_lock);
+
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        if (dict != NULL && inflateInit2(&stream, -15) == Z_OK)
+        {
+            stream.next_in = (unsigned char *)data;
+            stream.avail_in = data_length;
+            stream.next_out = (unsigned char *)out;
+            stream.avail_out = out_length;
+            ok = inflateSetDictionary(&stream, dict, dict_length) == Z_OK &&
+                 inflate(&stream, Z_FINISH) == Z_STREAM_END &&
+                 stream.total_out == out_length;
+            inflateEnd(&stream);
+        }
+        else if (dict == NULL)
+        {
+            syslog(LOG_ERR, "Compression dictionary %06x is not available", codec >> 8);
+        }
+    }
+
+    __atomic_fetch_add(ok ? &stats.decompressed : &stats.decompress_errors, 1, __ATOMIC_RELAXED);
+    return ok;
+}
+
+// 저장된 공유 사전을 읽습니다. 사전이 없으면 짧은 메시지를 모아 학습합니다.
+// 압축된 레코드를 읽기 전에 (recover_store() 뒤, 요청을 받기 전에) 호출해야 합니다.
+void compression_start()
+{
+    pthread_mutex_lock(&compression_lock);
+    load_dictionary();
+    pthread_mutex_unlock(&compression_lock);
+}
+
+void compression_stop()
+{
+    if (train_thread_started)
+    {
+        pthread_join(train_thread, NULL);
+        train_thread_started = 0;
+    }
+
+    pthread_mutex_lock(&compression_lock);
+    if (deflate_ready)
+    {
+        deflateEnd(&primed_stream);
+        deflate_ready = 0;
+    }
+    free(dictionary);
+    free(samples);
+    dictionary = NULL;
+    samples = NULL;
+    dictionary_length = dictionary_id = sample_bytes = 0;
+    pthread_mutex_unlock(&compression_lock);
+}
+
+CompressionStats compression_get_stats()
+{
+    pthread_mutex_lock(&compression_lock);
+    CompressionStats copy = stats;
+    copy.dictionary_id = dictionary_id;
+    copy.dictionary_size = dictionary_length;
+    copy.sample_bytes = sample_bytes;
+    pthread_mutex_unlock(&compression_lock);
+    copy.decompressed = __atomic_load_n(&stats.decompressed, __ATOMIC_RELAXED);
+    copy.decompress_errors = __atomic_load_n(&stats.decompress_errors, __ATOMIC_RELAXED);
+    return copy;
+}
+
+// 코덱별 압축 레코드 수, 압축률, 공유 사전 상태를 JSON 형식으로 반환하는 함수
+char *get_compression_stats_info()
+{
+    CompressionStats current = compression_get_stats();
+    char id[16];
+    snprintf(id, sizeof(id), "%06x", current.dictionary_id);
+
+    json_object *data = json_object_new_object();
+    json_object_object_add(data, "enabled", json_object_new_boolean(COMPRESSION_ENABLED));
+    json_object_object_add(data, "lz4_records", json_object_new_int64(current.lz4_records));
+    json_object_object_add(data, "dict_records", json_object_new_int64(current.dict_records));
+    json_object_object_add(data, "raw_bytes", json_object_new_int64(current.raw_bytes));
+    json_object_object_add(data, "stored_bytes", json_object_new_int64(current.stored_bytes));
+    json_object_object_add(data, "ratio", json_object_new_double(current.stored_bytes > 0 ? (double)current.raw_bytes / current.stored_bytes : 1.0));
+    json_object_object_add(data, "not_worth", json_object_new_int64(current.not_worth));
+    json_object_object_add(data, "decompressed", json_object_new_int64(current.decompressed));
+    json_object_object_add(data, "decompress_errors", json_object_new_int64(current.decompress_errors));
+    json_object_object_add(data, "dictionary_id", json_object_new_string(current.dictionary_id != 0 ? id : ""));
+    json_object_object_add(data, "dictionary_size", json_object_new_int64(current.dictionary_size));
+    json_object_object_add(data, "sample_bytes", json_object_new_int64(current.sample_bytes));
+    json_object_object_add(data, "training", json_object_new_boolean(current.training));
+    json_object_object_add(data, "train_ms", json_object_new_double(current.train_ms));
+
+    json_object *result = json_object_new_object();
+    json_object_object_add(result, "action", json_object_new_string("compression_stats"));
+    json_object_object_add(result, "data", data);
+
+    char *response = strdup(json_object_to_json_string(result));
+    json_object_put(result);
+    return response;
+}
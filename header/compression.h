@@ -0,0 +1,51 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <stdint.h>
+
+// 빌드할 때 -DCOMPRESSION_ENABLED=0으로 끌 수 있음 (.vscode/tasks.json의 "bench: compression (uncompressed)")
+#ifndef COMPRESSION_ENABLED
+#define COMPRESSION_ENABLED 1               // 0이면 모든 메시지를 원본 그대로 저장 (압축된 기존 레코드는 계속 읽음)
+#endif
+#define COMPRESSION_DICT_MIN_LENGTH 128     // 이 길이부터 공유 사전 deflate로 압축 (사전이 학습된 뒤)
+#define COMPRESSION_LZ4_MIN_LENGTH 1024     // 이 길이부터 LZ4로 압축 (긴 로그/코드 붙여넣기)
+#define COMPRESSION_DICT_FILE "binary file/compression.dict"
+#define COMPRESSION_DICT_SIZE 8192          // 학습할 공유 사전 크기
+#define COMPRESSION_DICT_SEGMENT 64         // 사전에 넣는 조각 하나의 크기
+#define COMPRESSION_DICT_SAMPLE_BYTES (512 * 1024) // 사전 학습을 시작하기 전에 모으는 짧은 메시지 바이트 수
+#define COMPRESSION_DICT_LEVEL 6            // 사전 deflate 압축 수준
+#define COMPRESSION_DICT_WINDOW_BITS 14     // 사전 deflate 창 (16KB, 사전 + LZ4 미만 본문이 들어감)
+#define COMPRESSION_DICT_MEM_LEVEL 6        // 사전 deflate 해시 테이블 크기 (작을수록 스트림 복제가 빠름)
+#define COMPRESSION_HEADER_SIZE 8           // 압축 레코드 본문 앞: 원래 길이 + 코덱 태그
+
+// 압축 레코드 본문의 코덱 (코덱 태그의 하위 8비트, 상위 24비트는 사전 id)
+#define CODEC_LZ4 1
+#define CODEC_DEFLATE_DICT 2
+
+typedef struct {
+    uint64_t lz4_records;       // LZ4로 압축해 쓴 레코드 수
+    uint64_t dict_records;      // 공유 사전 deflate로 압축해 쓴 레코드 수
+    uint64_t raw_bytes;         // 압축한 레코드들의 원래 크기 합
+    uint64_t stored_bytes;      // 압축한 레코드들의 저장 크기 합 (압축 헤더 포함)
+    uint64_t not_worth;         // 압축해도 슬롯이 줄지 않아 원본으로 저장한 수
+    uint64_t decompressed;      // 읽을 때 푼 레코드 수
+    uint64_t decompress_errors; // 풀지 못한 레코드 수 (사전 불일치 포함)
+    uint32_t dictionary_id;     // 0이면 아직 사전이 없음
+    uint32_t dictionary_size;
+    uint32_t sample_bytes;      // 사전 학습용으로 모은 바이트 수
+    int training;
+    double train_ms;
+} CompressionStats;
+
+// Function declarations
+void compression_start();
+void compression_stop();
+uint32_t compress_record_body(const char *message, uint32_t length, unsigned char *out);
+uint32_t compressed_body_length(const unsigned char *body, uint32_t body_length);
+int decompress_record_body(const unsigned char *body, uint32_t body_length, char *out, uint32_t out_length);
+uint32_t lz4_compress_block(const unsigned char *src, uint32_t src_length, unsigned char *dst, uint32_t capacity);
+int lz4_decompress_block(const unsigned char *src, uint32_t src_length, unsigned char *dst, uint32_t dst_length);
+CompressionStats compression_get_stats();
+char *get_compression_stats_info();
+
+#endif // COMPRESSION_H
@@ -0,0 +1,81 @@
+#include "crc32c.h"
+#include <string.h>
+#include <pthread.h>
+#ifdef __x86_64__
+#include <nmmintrin.h>
+#endif
+
+#define CRC32C_POLY 0x82F63B78 // Castagnoli 다항식 (reflected)
+
+static uint32_t crc32c_table[256];
+static int use_hardware = 0;
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+static void crc32c_init()
+{
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t crc = i;
+        for (int j = 0; j < 8; j++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        }
+        crc32c_table[i] = crc;
+    }
+#ifdef __x86_64__
+    __builtin_cpu_init();
+    use_hardware = __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+static uint32_t crc32c_software(uint32_t crc, const unsigned char *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        crc = crc32c_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef __x86_64__
+// SSE4.2 crc32 명령으로 8바이트씩 처리
+__attribute__((target("sse4.2"))) static uint32_t crc32c_hardware(uint32_t crc, const unsigned char *data, size_t length)
+{
+    uint64_t crc64 = crc;
+    while (length >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += 8;
+        length -= 8;
+    }
+    crc = (uint32_t)crc64;
+    while (length > 0)
+    {
+        crc = _mm_crc32_u8(crc, *data++);
+        length--;
+    }
+    return crc;
+}
+#endif
+
+// CRC32C를 계산합니다. 이전 결과를 crc로 넘기면 이어서 계산할 수 있습니다 (처음은 0).
+uint32_t crc32c(uint32_t crc, const void *data, size_t length)
+{
+    pthread_once(&crc32c_once, crc32c_init);
+    crc = ~crc;
+#ifdef __x86_64__
+    if (use_hardware)
+    {
+        return ~crc32c_hardware(crc, data, length);
+    }
+#endif
+    return ~crc32c_software(crc, data, length);
+}
+
+int crc32c_hardware_enabled()
+{
+    pthread_once(&crc32c_once, crc32c_init);
+    return use_hardware;
+}
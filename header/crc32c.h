@@ -0,0 +1,11 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Function declarations
+uint32_t crc32c(uint32_t crc, const void *data, size_t length);
+int crc32c_hardware_enabled();
+
+#endif // CRC32C_H
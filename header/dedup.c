@@ -0,0 +1,620 @@
+#include "dedup.h"
+#include "message_handler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <pthread.h>
+#include <json-c/json.h>
+
+// 슬롯 하나의 해시와 참조 수. 엔트리가 없는 슬롯은 참조가 1개인 것으로 봅니다.
+// 엔트리끼리는 배열 위치로 연결하며 0번은 "없음"으로 비워 둡니다.
+typedef struct {
+    uint64_t hash;
+    uint64_t offset;
+    uint32_t slot_length;
+    uint32_t message_length;
+    uint32_t refcount;
+    uint32_t hash_next;   // 같은 해시 버킷의 다음 엔트리
+    uint32_t offset_next; // 같은 오프셋 버킷의 다음 엔트리 (빈 엔트리에서는 free list)
+    int hashed;           // 해시 테이블에 들어 있는지 (공유만 알고 본문을 아직 해시하지 않았으면 0)
+} DedupEntry;
+
+// store_lock을 잡은 채로 이 락을 잡을 수 있지만 반대는 안 됩니다.
+static pthread_mutex_t dedup_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int dedup_ready = 0;
+
+static DedupEntry *dedup_entries = NULL;
+static uint32_t entry_count = 1;
+static uint32_t entry_capacity = 0;
+static uint32_t free_entries = 0;
+static uint32_t *hash_buckets = NULL;
+static uint32_t *offset_buckets = NULL;
+
+static DedupStats stats = {0};
+
+// 시작할 때 기존 본문을 해시하는 백그라운드 스레드
+static pthread_t build_thread;
+static int build_thread_started = 0;
+static volatile int build_stop = 0;
+static uint32_t build_target = 0;
+
+// ---- XXH64 ----
+// 배포 환경에 xxHash 헤더가 없어도 빌드되도록 XXH64를 그대로 옮겨 둡니다 (결과는 libxxhash의 XXH64와 같음).
+
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t xxh_rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t xxh_read64(const unsigned char *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t xxh_read32(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t xxh_round(uint64_t acc, uint64_t input)
+{
+    acc += input * XXH_PRIME64_2;
+    acc = xxh_rotl64(acc, 31);
+    return acc * XXH_PRIME64_1;
+}
+
+static inline uint64_t xxh_merge_round(uint64_t acc, uint64_t val)
+{
+    acc ^= xxh_round(0, val);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+uint64_t xxhash64(const void *data, size_t length, uint64_t seed)
+{
+    const unsigned char *p = data;
+    const unsigned char *end = p + length;
+    uint64_t h;
+
+    if (length >= 32)
+    {
+        const unsigned char *limit = end - 32;
+        uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+        uint64_t v2 = seed + XXH_PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH_PRIME64_1;
+        do
+        {
+            v1 = xxh_round(v1, xxh_read64(p));
+            v2 = xxh_round(v2, xxh_read64(p + 8));
+            v3 = xxh_round(v3, xxh_read64(p + 16));
+            v4 = xxh_round(v4, xxh_read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = xxh_rotl64(v1, 1) + xxh_rotl64(v2, 7) + xxh_rotl64(v3, 12) + xxh_rotl64(v4, 18);
+        h = xxh_merge_round(h, v1);
+        h = xxh_merge_round(h, v2);
+        h = xxh_merge_round(h, v3);
+        h = xxh_merge_round(h, v4);
+    }
+    else
+    {
+        h = seed + XXH_PRIME64_5;
+    }
+
+    h += (uint64_t)length;
+    while (p + 8 <= end)
+    {
+        h ^= xxh_round(0, xxh_read64(p));
+        h = xxh_rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+        p += 8;
+    }
+    if (p + 4 <= end)
+    {
+        h ^= (uint64_t)xxh_read32(p) * XXH_PRIME64_1;
+        h = xxh_rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+    }
+    while (p < end)
+    {
+        h ^= (*p) * XXH_PRIME64_5;
+        h = xxh_rotl64(h, 11) * XXH_PRIME64_1;
+        p++;
+    }
+
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+// ---- 해시/오프셋 테이블 (dedup_mutex 아래에서만 사용) ----
+
+static inline uint32_t hash_bucket(uint64_t hash)
+{
+    return (uint32_t)hash & (DEDUP_BUCKETS - 1);
+}
+
+static inline uint32_t offset_bucket(uint64_t offset)
+{
+    return (uint32_t)((offset * XXH_PRIME64_1) >> 40) & (DEDUP_BUCKETS - 1);
+}
+
+static uint32_t find_offset_entry(uint64_t offset)
+{
+    uint32_t e = offset_buckets[offset_bucket(offset)];
+    while (e != 0 && dedup_entries[e].offset != offset)
+    {
+        e = dedup_entries[e].offset_next;
+    }
+    return e;
+}
+
+static uint32_t new_entry(uint64_t offset, uint32_t slot_length)
+{
+    uint32_t e = free_entries;
+    if (e != 0)
+    {
+        free_entries = dedup_entries[e].offset_next;
+    }
+    else
+    {
+        if (entry_count >= entry_capacity)
+        {
+            uint32_t capacity = entry_capacity > 0 ? entry_capacity * 2 : 4096;
+            DedupEntry *grown = realloc(dedup_entries, sizeof(DedupEntry) * capacity);
+            if (grown == NULL)
+            {
+                syslog(LOG_ERR, "Memory allocation failed for dedup table");
+                return 0;
+            }
+            dedup_entries = grown;
+            entry_capacity = capacity;
+        }
+        e = entry_count++;
+    }
+
+    DedupEntry *entry = &dedup_entries[e];
+    memset(entry, 0, sizeof(DedupEntry));
+    entry->offset = offset;
+    entry->slot_length = slot_length;
+    entry->refcount = 1;
+    uint32_t bucket = offset_bucket(offset);
+    entry->offset_next = offset_buckets[bucket];
+    offset_buckets[bucket] = e;
+    return e;
+}
+
+static void unlink_offset(uint32_t e)
+{
+    uint32_t *link = &offset_buckets[offset_bucket(dedup_entries[e].offset)];
+    while (*link != e)
+    {
+        link = &dedup_entries[*link].offset_next;
+    }
+    *link = dedup_entries[e].offset_next;
+}
+
+static void link_hash(uint32_t e)
+{
+    uint32_t bucket = hash_bucket(dedup_entries[e].hash);
+    dedup_entries[e].hash_next = hash_buckets[bucket];
+    hash_buckets[bucket] = e;
+    dedup_entries[e].hashed = 1;
+    stats.hashed_records++;
+}
+
+static void unlink_hash(uint32_t e)
+{
+    if (!dedup_entries[e].hashed)
+    {
+        return;
+    }
+    uint32_t *link = &hash_buckets[hash_bucket(dedup_entries[e].hash)];
+    while (*link != e)
+    {
+        link = &dedup_entries[*link].hash_next;
+    }
+    *link = dedup_entries[e].hash_next;
+    dedup_entries[e].hashed = 0;
+    stats.hashed_records--;
+}
+
+static void delete_entry(uint32_t e)
+{
+    unlink_hash(e);
+    unlink_offset(e);
+    dedup_entries[e].offset_next = free_entries;
+    free_entries = e;
+}
+
+// 참조 수가 바뀔 때 공유 통계를 맞춥니다.
+static void account_refcount(const DedupEntry *entry, uint32_t old_refcount)
+{
+    if (old_refcount >= 2)
+    {
+        stats.shared_slots--;
+        stats.shared_refs -= old_refcount;
+        stats.bytes_saved -= (uint64_t)(old_refcount - 1) * entry->slot_length;
+    }
+    if (entry->refcount >= 2)
+    {
+        stats.shared_slots++;
+        stats.shared_refs += entry->refcount;
+        stats.bytes_saved += (uint64_t)(entry->refcount - 1) * entry->slot_length;
+    }
+}
+
+// ---- 시작 ----
+
+typedef struct {
+    uint64_t offset;
+    uint32_t slot_length;
+} SlotRef;
+
+static int compare_slot_ref(const void *a, const void *b)
+{
+    const SlotRef *x = a;
+    const SlotRef *y = b;
+    return x->offset < y->offset ? -1 : x->offset > y->offset ? 1 : 0;
+}
+
+// 같은 오프셋을 가리키는 인덱스 엔트리를 세어 참조 수를 되살립니다. store_lock을 읽기로 잡은 채 호출합니다.
+static void rebuild_refcounts()
+{
+    SlotRef *slots = malloc(sizeof(SlotRef) * (index_table_size > 0 ? index_table_size : 1));
+    if (slots == NULL)
+    {
+        syslog(LOG_ERR, "Memory allocation failed for dedup refcounts");
+        return;
+    }
+    uint32_t slot_count = 0;
+    for (uint32_t i = 0; i < index_table_size; i++)
+    {
+        if (index_table[i].length == 0)
+        {
+            continue; // 지워진 메시지는 슬롯이 없음
+        }
+        slots[slot_count].offset = index_table[i].offset;
+        slots[slot_count].slot_length = index_table[i].length;
+        slot_count++;
+    }
+    qsort(slots, slot_count, sizeof(SlotRef), compare_slot_ref);
+
+    for (uint32_t i = 0; i < slot_count;)
+    {
+        uint32_t run = 1;
+        while (i + run < slot_count && slots[i + run].offset == slots[i].offset)
+        {
+            run++;
+        }
+        if (run > 1)
+        {
+            uint32_t e = new_entry(slots[i].offset, slots[i].slot_length);
+            if (e != 0)
+            {
+                dedup_entries[e].refcount = run;
+                account_refcount(&dedup_entries[e], 1);
+            }
+        }
+        i += run;
+    }
+    free(slots);
+}
+
+// 시작할 때 있던 메시지 본문을 캐시를 거치지 않고 읽어 해시 테이블을 채웁니다.
+// 읽는 동안 수정이 있었던 묶음은 한 번 더 읽고, 그래도 바뀌면 건너뜁니다 (공유 기회만 놓침).
+static void *build_dedup_hashes(void *arg)
+{
+    (void)arg;
+    uint32_t indices[DEDUP_BUILD_BATCH];
+    uint64_t offsets[DEDUP_BUILD_BATCH];
+    uint32_t lengths[DEDUP_BUILD_BATCH];
+    uint64_t hashes[DEDUP_BUILD_BATCH];
+
+    for (uint32_t first = 1; first <= build_target && !build_stop; first += DEDUP_BUILD_BATCH)
+    {
+        uint32_t count = build_target - first + 1;
+        if (count > DEDUP_BUILD_BATCH)
+        {
+            count = DEDUP_BUILD_BATCH;
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+            indices[i] = first + i;
+        }
+
+        for (int attempt = 0; attempt < 2; attempt++)
+        {
+            pthread_rwlock_rdlock(&store_lock);
+            uint64_t seq = message_write_seq;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                offsets[i] = index_table[indices[i] - 1].offset;
+                lengths[i] = index_table[indices[i] - 1].length;
+            }
+            pthread_rwlock_unlock(&store_lock);
+
+            MessageBatch *batch = scan_messages_by_indices(indices, count);
+            if (batch == NULL)
+            {
+                break;
+            }
+            for (uint32_t i = 0; i < count; i++)
+            {
+                if (batch->texts[i] != NULL && batch->lengths[i] >= DEDUP_MIN_LENGTH)
+                {
+                    hashes[i] = xxhash64(batch->texts[i], batch->lengths[i], 0);
+                }
+            }
+
+            pthread_rwlock_rdlock(&store_lock);
+            int unchanged = message_write_seq == seq;
+            if (unchanged)
+            {
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    if (batch->texts[i] != NULL && batch->lengths[i] >= DEDUP_MIN_LENGTH)
+                    {
+                        dedup_insert(hashes[i], offsets[i], lengths[i], batch->lengths[i]);
+                    }
+                }
+            }
+            pthread_rwlock_unlock(&store_lock);
+            free_message_batch(batch);
+            if (unchanged)
+            {
+                break;
+            }
+        }
+    }
+
+    pthread_mutex_lock(&dedup_mutex);
+    stats.building = 0;
+    syslog(LOG_INFO, "Dedup table built: %llu hashed records, %llu shared slots",
+           (unsigned long long)stats.hashed_records, (unsigned long long)stats.shared_slots);
+    pthread_mutex_unlock(&dedup_mutex);
+    return NULL;
+}
+
+// 중복 제거를 켭니다. 공유 슬롯의 참조 수는 바로 되살리고 (해제 판단에 필요),
+// 기존 본문의 해시는 백그라운드로 채웁니다. recover_store() 뒤, 요청을 받기 전에 호출해야 합니다.
+void dedup_start()
+{
+    if (!DEDUP_ENABLED)
+    {
+        return;
+    }
+
+    pthread_rwlock_rdlock(&store_lock);
+    pthread_mutex_lock(&dedup_mutex);
+    hash_buckets = calloc(DEDUP_BUCKETS, sizeof(uint32_t));
+    offset_buckets = calloc(DEDUP_BUCKETS, sizeof(uint32_t));
+    if (hash_buckets == NULL || offset_buckets == NULL)
+    {
+        syslog(LOG_ERR, "Memory allocation failed for dedup table");
+        free(hash_buckets);
+        free(offset_buckets);
+        hash_buckets = offset_buckets = NULL;
+        pthread_mutex_unlock(&dedup_mutex);
+        pthread_rwlock_unlock(&store_lock);
+        return;
+    }
+    rebuild_refcounts();
+    build_target = index_table_size;
+    build_stop = 0;
+    stats.building = build_target > 0;
+    dedup_ready = 1;
+    pthread_mutex_unlock(&dedup_mutex);
+    pthread_rwlock_unlock(&store_lock);
+
+    if (build_target == 0)
+    {
+        return;
+    }
+    if (pthread_create(&build_thread, NULL, build_dedup_hashes, NULL) == 0)
+    {
+        build_thread_started = 1;
+    }
+    else
+    {
+        syslog(LOG_ERR, "Failed to start dedup thread, hashing in foreground");
+        build_dedup_hashes(NULL);
+    }
+}
+
+// 해시 스레드를 멈추고 테이블을 해제합니다.
+void dedup_stop()
+{
+    build_stop = 1;
+    if (build_thread_started)
+    {
+        pthread_join(build_thread, NULL);
+        build_thread_started = 0;
+    }
+
+    pthread_mutex_lock(&dedup_mutex);
+    dedup_ready = 0;
+    free(dedup_entries);
+    free(hash_buckets);
+    free(offset_buckets);
+    dedup_entries = NULL;
+    hash_buckets = offset_buckets = NULL;
+    entry_count = 1;
+    entry_capacity = 0;
+    free_entries = 0;
+    memset(&stats, 0, sizeof(stats));
+    pthread_mutex_unlock(&dedup_mutex);
+}
+
+// ---- 쓰기 경로에서 호출 (모두 store_lock을 잡은 채) ----
+
+// 같은 해시와 길이의 본문이 들어 있는 슬롯을 찾습니다. 호출자가 슬롯을 읽어 내용이 같은지 확인해야 합니다.
+int dedup_find(uint64_t hash, uint32_t message_length, uint64_t *offset, uint32_t *slot_length)
+{
+    int found = 0;
+    pthread_mutex_lock(&dedup_mutex);
+    if (dedup_ready)
+    {
+        for (uint32_t e = hash_buckets[hash_bucket(hash)]; e != 0; e = dedup_entries[e].hash_next)
+        {
+            if (dedup_entries[e].hash == hash && dedup_entries[e].message_length == message_length)
+            {
+                *offset = dedup_entries[e].offset;
+                *slot_length = dedup_entries[e].slot_length;
+                found = 1;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&dedup_mutex);
+    return found;
+}
+
+// 슬롯의 본문 해시를 기록합니다. 이미 해시가 있는 슬롯이면 그대로 둡니다.
+void dedup_insert(uint64_t hash, uint64_t offset, uint32_t slot_length, uint32_t message_length)
+{
+    pthread_mutex_lock(&dedup_mutex);
+    if (dedup_ready)
+    {
+        uint32_t e = find_offset_entry(offset);
+        if (e == 0)
+        {
+            e = new_entry(offset, slot_length);
+        }
+        if (e != 0 && !dedup_entries[e].hashed)
+        {
+            dedup_entries[e].hash = hash;
+            dedup_entries[e].message_length = message_length;
+            link_hash(e);
+        }
+    }
+    pthread_mutex_unlock(&dedup_mutex);
+}
+
+// 인덱스 하나가 기존 슬롯을 함께 쓰기 시작했습니다.
+void dedup_add_reference(uint64_t offset)
+{
+    pthread_mutex_lock(&dedup_mutex);
+    uint32_t e = dedup_ready ? find_offset_entry(offset) : 0;
+    if (e != 0)
+    {
+        uint32_t old_refcount = dedup_entries[e].refcount++;
+        account_refcount(&dedup_entries[e], old_refcount);
+        stats.hits++;
+    }
+    pthread_mutex_unlock(&dedup_mutex);
+}
+
+void dedup_record_verify_failure()
+{
+    pthread_mutex_lock(&dedup_mutex);
+    stats.verify_failures++;
+    pthread_mutex_unlock(&dedup_mutex);
+}
+
+uint32_t dedup_refcount(uint64_t offset)
+{
+    pthread_mutex_lock(&dedup_mutex);
+    uint32_t e = dedup_ready ? find_offset_entry(offset) : 0;
+    uint32_t refcount = e != 0 ? dedup_entries[e].refcount : 1;
+    pthread_mutex_unlock(&dedup_mutex);
+    return refcount;
+}
+
+// 인덱스 하나가 슬롯을 더 이상 쓰지 않습니다. 마지막 참조였으면 엔트리를 지우고 1을 반환하며,
+// 그때만 호출자가 슬롯을 free space로 돌려주거나 덮어쓸 수 있습니다.
+int dedup_release(uint64_t offset)
+{
+    int last = 1;
+    pthread_mutex_lock(&dedup_mutex);
+    uint32_t e = dedup_ready ? find_offset_entry(offset) : 0;
+    if (e != 0)
+    {
+        uint32_t old_refcount = dedup_entries[e].refcount--;
+        account_refcount(&dedup_entries[e], old_refcount);
+        if (dedup_entries[e].refcount == 0)
+        {
+            delete_entry(e);
+        }
+        else
+        {
+            last = 0;
+        }
+    }
+    pthread_mutex_unlock(&dedup_mutex);
+    return last;
+}
+
+// compaction이 슬롯을 옮겼습니다.
+void dedup_relocate(uint64_t old_offset, uint64_t new_offset)
+{
+    pthread_mutex_lock(&dedup_mutex);
+    uint32_t e = dedup_ready ? find_offset_entry(old_offset) : 0;
+    if (e != 0)
+    {
+        unlink_offset(e);
+        dedup_entries[e].offset = new_offset;
+        uint32_t bucket = offset_bucket(new_offset);
+        dedup_entries[e].offset_next = offset_buckets[bucket];
+        offset_buckets[bucket] = e;
+    }
+    pthread_mutex_unlock(&dedup_mutex);
+}
+
+DedupStats dedup_get_stats()
+{
+    pthread_mutex_lock(&dedup_mutex);
+    DedupStats copy = stats;
+    pthread_mutex_unlock(&dedup_mutex);
+    return copy;
+}
+
+// 중복 제거 비율과 절약한 저장 공간을 JSON 형식으로 반환하는 함수
+char *get_dedup_stats_info()
+{
+    // 논리 크기: 공유가 없었다면 슬롯들이 차지했을 바이트
+    pthread_rwlock_rdlock(&store_lock);
+    uint64_t logical_bytes = 0;
+    for (uint32_t i = 0; i < index_table_size; i++)
+    {
+        logical_bytes += index_table[i].length;
+    }
+    DedupStats current = dedup_get_stats();
+    pthread_rwlock_unlock(&store_lock);
+    uint64_t physical_bytes = logical_bytes - current.bytes_saved;
+
+    json_object *data = json_object_new_object();
+    json_object_object_add(data, "enabled", json_object_new_boolean(dedup_ready));
+    json_object_object_add(data, "building", json_object_new_boolean(current.building));
+    json_object_object_add(data, "hashed_records", json_object_new_int64(current.hashed_records));
+    json_object_object_add(data, "shared_slots", json_object_new_int64(current.shared_slots));
+    json_object_object_add(data, "shared_references", json_object_new_int64(current.shared_refs));
+    json_object_object_add(data, "hits", json_object_new_int64(current.hits));
+    json_object_object_add(data, "verify_failures", json_object_new_int64(current.verify_failures));
+    json_object_object_add(data, "logical_bytes", json_object_new_int64(logical_bytes));
+    json_object_object_add(data, "physical_bytes", json_object_new_int64(physical_bytes));
+    json_object_object_add(data, "bytes_saved", json_object_new_int64(current.bytes_saved));
+    json_object_object_add(data, "dedup_ratio", json_object_new_double(physical_bytes > 0 ? (double)logical_bytes / physical_bytes : 1.0));
+
+    json_object *result = json_object_new_object();
+    json_object_object_add(result, "action", json_object_new_string("dedup_stats"));
+    json_object_object_add(result, "data", data);
+
+    char *response = strdup(json_object_to_json_string(result));
+    json_object_put(result);
+    return response;
+}
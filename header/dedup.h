@@ -0,0 +1,36 @@
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DEDUP_ENABLED 1             // 0이면 같은 본문의 append도 각자 슬롯을 가짐
+#define DEDUP_MIN_LENGTH 64         // 이보다 짧은 메시지는 해시하지 않음 (엔트리 메모리가 절약분보다 큼)
+#define DEDUP_BUCKETS 262144        // 해시/오프셋 테이블 각각의 버킷 수 (2의 거듭제곱)
+#define DEDUP_BUILD_BATCH 1024      // 시작할 때 본문을 해시하며 한 번에 읽는 메시지 수
+
+typedef struct {
+    uint64_t hashed_records;  // 해시 테이블에 든 슬롯 수
+    uint64_t shared_slots;    // 둘 이상의 인덱스가 가리키는 슬롯 수
+    uint64_t shared_refs;     // 공유 슬롯을 가리키는 인덱스 수
+    uint64_t bytes_saved;     // 공유로 아끼고 있는 슬롯 바이트
+    uint64_t hits;            // 기존 슬롯을 공유한 append 수
+    uint64_t verify_failures; // 해시는 같았지만 내용이 달라 공유하지 않은 수
+    int building;             // 시작 시 해시 구축이 진행 중인지
+} DedupStats;
+
+// Function declarations
+uint64_t xxhash64(const void *data, size_t length, uint64_t seed);
+void dedup_start();
+void dedup_stop();
+int dedup_find(uint64_t hash, uint32_t message_length, uint64_t *offset, uint32_t *slot_length);
+void dedup_insert(uint64_t hash, uint64_t offset, uint32_t slot_length, uint32_t message_length);
+void dedup_add_reference(uint64_t offset);
+void dedup_record_verify_failure();
+uint32_t dedup_refcount(uint64_t offset);
+int dedup_release(uint64_t offset);
+void dedup_relocate(uint64_t old_offset, uint64_t new_offset);
+DedupStats dedup_get_stats();
+char *get_dedup_stats_info();
+
+#endif // DEDUP_H
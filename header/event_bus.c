@@ -0,0 +1,196 @@
+#include "event_bus.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <sched.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+
+// 저장소 쓰기 스레드(생산자)에서 디스패처(소비자)로 변경을 넘기는 유한 MPMC 링 (Dmitry Vyukov 방식).
+// 슬롯마다 sequence가 있어 생산자/소비자는 위치 카운터 하나만 CAS로 차지하고, 락이나 공유 통계 카운터를 건드리지 않습니다.
+//  - sequence == pos          : 비어 있어 pos 위치의 생산자가 쓸 수 있음
+//  - sequence == pos + 1      : pos 위치의 변경이 다 써져 소비자가 읽을 수 있음
+//  - 읽은 뒤 pos + CAPACITY로 바꿔 다음 바퀴의 생산자에게 넘김
+#define EVENT_BUS_MASK (EVENT_BUS_CAPACITY - 1)
+
+typedef struct {
+    uint64_t sequence;
+    ChangeEvent event;
+} BusCell;
+
+static BusCell *cells = NULL;
+// 생산자와 소비자가 서로의 캐시 라인을 무효화하지 않도록 위치 카운터를 떼어 둠
+static uint64_t enqueue_pos __attribute__((aligned(64))) = 0;
+static uint64_t dequeue_pos __attribute__((aligned(64))) = 0;
+static int consumer_sleeping __attribute__((aligned(64))) = 0;
+static uint64_t dropped = 0;
+static int wake_fd = -1;
+
+// 소비자 쪽 통계 (디스패처 하나만 갱신)
+static uint64_t batches = 0;
+static uint64_t wakeups = 0;
+static uint32_t max_batch = 0;
+
+int event_bus_init()
+{
+    cells = aligned_alloc(64, sizeof(BusCell) * EVENT_BUS_CAPACITY);
+    if (cells == NULL)
+    {
+        syslog(LOG_ERR, "Failed to allocate event bus");
+        return 0;
+    }
+    for (uint64_t i = 0; i < EVENT_BUS_CAPACITY; i++)
+    {
+        cells[i].sequence = i;
+    }
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0)
+    {
+        syslog(LOG_ERR, "Failed to create event bus eventfd");
+        free(cells);
+        cells = NULL;
+        return 0;
+    }
+    enqueue_pos = dequeue_pos = 0;
+    dropped = batches = wakeups = 0;
+    max_batch = 0;
+    return 1;
+}
+
+void event_bus_destroy()
+{
+    if (wake_fd >= 0)
+    {
+        close(wake_fd);
+        wake_fd = -1;
+    }
+    free(cells);
+    cells = NULL;
+}
+
+// 생산자 쪽. 링이 가득 차면 변경을 버리고 0을 반환합니다 (디스패처가 dropped를 보고 구독자에게 알림).
+int event_bus_push(const ChangeEvent *event)
+{
+    uint64_t pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+    BusCell *cell;
+    for (;;)
+    {
+        cell = &cells[pos & EVENT_BUS_MASK];
+        uint64_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t)(sequence - pos);
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&enqueue_pos, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+            return 0;
+        }
+        else
+        {
+            pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+    cell->event = *event;
+    __atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_RELEASE);
+
+    // 디스패처가 잠들려는 중이면 깨움. event_bus_wait의 (sleeping 쓰기 -> 위치 읽기)와 짝을 이루는 펜스로
+    // 둘 중 하나는 반드시 상대를 보게 되어 신호를 놓치지 않습니다. 깨어 있을 때는 syscall이 없습니다.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&consumer_sleeping, __ATOMIC_RELAXED) && __atomic_exchange_n(&consumer_sleeping, 0, __ATOMIC_ACQ_REL))
+    {
+        event_bus_wake();
+        __atomic_fetch_add(&wakeups, 1, __ATOMIC_RELAXED);
+    }
+    return 1;
+}
+
+// 소비자 쪽. 다 써진 변경을 최대 max개까지 꺼내고 그 수를 반환합니다.
+uint32_t event_bus_pop_batch(ChangeEvent *events, uint32_t max)
+{
+    uint32_t count = 0;
+    uint64_t pos = __atomic_load_n(&dequeue_pos, __ATOMIC_RELAXED);
+    while (count < max)
+    {
+        BusCell *cell = &cells[pos & EVENT_BUS_MASK];
+        uint64_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t)(sequence - (pos + 1));
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&dequeue_pos, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                events[count++] = cell->event;
+                __atomic_store_n(&cell->sequence, pos + EVENT_BUS_CAPACITY, __ATOMIC_RELEASE);
+                pos++;
+            }
+        }
+        else if (diff < 0)
+        {
+            break; // 비었거나 생산자가 아직 쓰는 중
+        }
+        else
+        {
+            pos = __atomic_load_n(&dequeue_pos, __ATOMIC_RELAXED);
+        }
+    }
+    if (count > 0)
+    {
+        __atomic_fetch_add(&batches, 1, __ATOMIC_RELAXED);
+        if (count > __atomic_load_n(&max_batch, __ATOMIC_RELAXED))
+        {
+            __atomic_store_n(&max_batch, count, __ATOMIC_RELAXED);
+        }
+    }
+    return count;
+}
+
+// 링이 비어 있으면 생산자가 깨우거나 timeout_ms가 지날 때까지 잡니다. 자지 않고 돌아오면 1을 반환합니다.
+int event_bus_wait(int timeout_ms)
+{
+    __atomic_store_n(&consumer_sleeping, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&enqueue_pos, __ATOMIC_SEQ_CST) != __atomic_load_n(&dequeue_pos, __ATOMIC_SEQ_CST))
+    {
+        // 자리는 차지했지만 아직 쓰는 중인 생산자가 있음. CPU를 넘겨 마저 쓰게 함
+        __atomic_store_n(&consumer_sleeping, 0, __ATOMIC_RELAXED);
+        sched_yield();
+        return 1;
+    }
+
+    struct pollfd fd = {wake_fd, POLLIN, 0};
+    poll(&fd, 1, timeout_ms);
+    uint64_t signal;
+    if (read(wake_fd, &signal, sizeof(signal)) < 0)
+    {
+        // EAGAIN: 시간이 다 되어 깨어남
+    }
+    __atomic_store_n(&consumer_sleeping, 0, __ATOMIC_RELAXED);
+    return 0;
+}
+
+// 잠든 디스패처를 깨웁니다 (종료할 때도 씀).
+void event_bus_wake()
+{
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) < 0)
+    {
+        // 카운터가 가득 찬 경우뿐이며 이미 깨울 신호가 있음
+    }
+}
+
+EventBusStats event_bus_get_stats()
+{
+    EventBusStats stats;
+    stats.pushed = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+    stats.popped = __atomic_load_n(&dequeue_pos, __ATOMIC_RELAXED);
+    stats.dropped = __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+    stats.batches = __atomic_load_n(&batches, __ATOMIC_RELAXED);
+    stats.wakeups = __atomic_load_n(&wakeups, __ATOMIC_RELAXED);
+    stats.max_batch = __atomic_load_n(&max_batch, __ATOMIC_RELAXED);
+    return stats;
+}
@@ -0,0 +1,30 @@
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <stdint.h>
+#include "subscription.h"
+
+#define EVENT_BUS_CAPACITY 8192     // 링 슬롯 수 (2의 거듭제곱). 디스패처가 밀리면 이보다 많은 변경은 버림
+#define EVENT_BUS_BATCH 256         // 디스패처가 한 번에 꺼내 처리하는 최대 변경 수
+#define EVENT_BUS_IDLE_MS 100       // 깨우는 신호를 놓쳐도 디스패처가 링을 다시 보는 간격
+#define EVENT_BUS_SPIN_YIELDS 16    // 링이 비어도 잠들기 전에 CPU를 양보하며 다시 보는 횟수 (깨우기 syscall을 배치로 줄임)
+
+typedef struct {
+    uint64_t pushed;            // 링에 넣은 변경 수
+    uint64_t dropped;           // 링이 가득 차 버린 변경 수
+    uint64_t popped;            // 디스패처가 꺼낸 변경 수
+    uint64_t batches;           // 디스패처가 꺼낸 배치 수
+    uint64_t wakeups;           // 잠든 디스패처를 eventfd로 깨운 수
+    uint32_t max_batch;         // 가장 컸던 배치
+} EventBusStats;
+
+// Function declarations
+int event_bus_init();
+void event_bus_destroy();
+int event_bus_push(const ChangeEvent *event);
+uint32_t event_bus_pop_batch(ChangeEvent *events, uint32_t max);
+int event_bus_wait(int timeout_ms);
+void event_bus_wake();
+EventBusStats event_bus_get_stats();
+
+#endif // EVENT_BUS_H
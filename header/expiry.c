@@ -0,0 +1,293 @@
+#include "expiry.h"
+#include "message_handler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <time.h>
+#include <pthread.h>
+#include <json-c/json.h>
+
+// 만료 예정 하나. TTL을 다시 걸면 새 항목을 넣고 옛 항목은 꺼낼 때 expires_at이 달라 버립니다.
+typedef struct {
+    int64_t expires_at;
+    uint32_t index;
+} ExpiryItem;
+
+// store_lock을 잡은 채로 이 락을 잡을 수 있지만 반대는 안 됩니다.
+static pthread_mutex_t expiry_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t expiry_cond = PTHREAD_COND_INITIALIZER;
+static ExpiryItem *heap = NULL;
+static uint32_t heap_count = 0;
+static uint32_t heap_capacity = 0;
+static int running = 0;
+static pthread_t expiry_thread;
+static ExpiryStats stats;
+
+static double elapsed_ms_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+static double realtime_ms()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1e6;
+}
+
+static inline int item_less(const ExpiryItem *a, const ExpiryItem *b)
+{
+    return a->expires_at < b->expires_at || (a->expires_at == b->expires_at && a->index < b->index);
+}
+
+static void sift_down(uint32_t position)
+{
+    ExpiryItem item = heap[position];
+    for (;;)
+    {
+        uint32_t child = 2 * position + 1;
+        if (child >= heap_count)
+        {
+            break;
+        }
+        if (child + 1 < heap_count && item_less(&heap[child + 1], &heap[child]))
+        {
+            child++;
+        }
+        if (!item_less(&heap[child], &item))
+        {
+            break;
+        }
+        heap[position] = heap[child];
+        position = child;
+    }
+    heap[position] = item;
+}
+
+// 힙에 항목 하나를 넣습니다. expiry_lock을 잡은 채 호출합니다. 메모리가 모자라면 0을 반환합니다.
+static int heap_push(uint32_t index, int64_t expires_at)
+{
+    if (heap_count == heap_capacity)
+    {
+        uint32_t new_capacity = heap_capacity > 0 ? heap_capacity * 2 : EXPIRY_INITIAL_CAPACITY;
+        ExpiryItem *grown = realloc(heap, sizeof(ExpiryItem) * new_capacity);
+        if (grown == NULL)
+        {
+            return 0;
+        }
+        heap = grown;
+        heap_capacity = new_capacity;
+    }
+    ExpiryItem item = {expires_at, index};
+    uint32_t position = heap_count++;
+    while (position > 0 && item_less(&item, &heap[(position - 1) / 2]))
+    {
+        heap[position] = heap[(position - 1) / 2];
+        position = (position - 1) / 2;
+    }
+    heap[position] = item;
+    return 1;
+}
+
+static ExpiryItem heap_pop()
+{
+    ExpiryItem top = heap[0];
+    heap[0] = heap[--heap_count];
+    if (heap_count > 0)
+    {
+        sift_down(0);
+    }
+    return top;
+}
+
+// set_message_ttl()에서 store_lock을 쓰기로 잡은 채 호출됩니다.
+void expiry_on_set(uint32_t index, int64_t expires_at)
+{
+    pthread_mutex_lock(&expiry_lock);
+    if (!running)
+    {
+        pthread_mutex_unlock(&expiry_lock);
+        return;
+    }
+    if (!heap_push(index, expires_at))
+    {
+        syslog(LOG_ERR, "Memory allocation failed for expiry heap, message %u will expire after restart", index);
+    }
+    else if (heap[0].index == index && heap[0].expires_at == expires_at)
+    {
+        // 가장 이른 만료가 바뀌었으면 기다리던 스레드를 깨워 대기 시간을 다시 잡게 함
+        pthread_cond_signal(&expiry_cond);
+    }
+    pthread_mutex_unlock(&expiry_lock);
+}
+
+// 만료 시각이 지난 항목을 EXPIRY_BATCH개씩 꺼내 store_lock 한 번으로 지웁니다.
+// 다음 만료까지는 조건 변수에서 잠들고, 더 이른 TTL이 걸리면 expiry_on_set()이 깨웁니다.
+static void *expiry_main(void *arg)
+{
+    (void)arg;
+    ExpiryItem *due = malloc(sizeof(ExpiryItem) * EXPIRY_BATCH);
+    if (due == NULL)
+    {
+        syslog(LOG_ERR, "Memory allocation failed for expiry batch");
+        return NULL;
+    }
+
+    pthread_mutex_lock(&expiry_lock);
+    while (running)
+    {
+        if (heap_count == 0)
+        {
+            pthread_cond_wait(&expiry_cond, &expiry_lock);
+            continue;
+        }
+        int64_t now = time(NULL);
+        if (heap[0].expires_at > now)
+        {
+            struct timespec deadline = {(time_t)heap[0].expires_at, 0};
+            pthread_cond_timedwait(&expiry_cond, &expiry_lock, &deadline);
+            continue;
+        }
+        pthread_mutex_unlock(&expiry_lock);
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        lock_all_store_shards();
+        pthread_rwlock_wrlock(&store_lock);
+        pthread_mutex_lock(&expiry_lock);
+        uint32_t count = 0;
+        while (count < EXPIRY_BATCH && heap_count > 0 && heap[0].expires_at <= now)
+        {
+            due[count++] = heap_pop();
+        }
+        pthread_mutex_unlock(&expiry_lock);
+
+        DeleteBatch batch;
+        memset(&batch, 0, sizeof(batch));
+        uint32_t stale = 0;
+        double lag_ms = 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint32_t index = due[i].index;
+            // TTL이 바뀌었거나 (다른 expires_at) 이미 지워진 메시지의 낡은 항목은 버림
+            if (index == 0 || index > index_table_size || index_table[index - 1].expires_at != due[i].expires_at ||
+                !delete_message_locked(index, &batch))
+            {
+                stale++;
+                continue;
+            }
+            if (lag_ms == 0)
+            {
+                lag_ms = realtime_ms() - due[i].expires_at * 1000.0;
+            }
+        }
+        pthread_rwlock_unlock(&store_lock);
+        finish_delete_batch(&batch);
+        unlock_all_store_shards();
+        double batch_ms = elapsed_ms_since(&start);
+
+        pthread_mutex_lock(&expiry_lock);
+        stats.expired += batch.deleted;
+        stats.stale_skipped += stale;
+        stats.batches++;
+        stats.last_batch = batch.deleted;
+        stats.last_batch_ms = batch_ms;
+        stats.expire_ms += batch_ms;
+        if (lag_ms > stats.max_lag_ms)
+        {
+            stats.max_lag_ms = lag_ms;
+        }
+    }
+    pthread_mutex_unlock(&expiry_lock);
+    free(due);
+    return NULL;
+}
+
+// index_table에 남아 있는 TTL로 힙을 만들고 만료 스레드를 시작합니다. 재시작 사이에 지난 TTL은 바로 처리됩니다.
+void expiry_start()
+{
+    pthread_rwlock_rdlock(&store_lock);
+    pthread_mutex_lock(&expiry_lock);
+    for (uint32_t i = 0; i < index_table_size; i++)
+    {
+        if (index_table[i].length != 0 && index_table[i].expires_at != 0 && !heap_push(i + 1, index_table[i].expires_at))
+        {
+            syslog(LOG_ERR, "Memory allocation failed for expiry heap");
+            break;
+        }
+    }
+    uint32_t pending = heap_count;
+    memset(&stats, 0, sizeof(stats));
+    running = 1;
+    pthread_mutex_unlock(&expiry_lock);
+    pthread_rwlock_unlock(&store_lock);
+
+    if (pthread_create(&expiry_thread, NULL, expiry_main, NULL) != 0)
+    {
+        syslog(LOG_ERR, "Failed to start expiry thread");
+        pthread_mutex_lock(&expiry_lock);
+        running = 0;
+        pthread_mutex_unlock(&expiry_lock);
+        return;
+    }
+    printf("Expiry started with %u pending TTLs\n", pending);
+}
+
+void expiry_stop()
+{
+    pthread_mutex_lock(&expiry_lock);
+    int was_running = running;
+    running = 0;
+    pthread_cond_signal(&expiry_cond);
+    pthread_mutex_unlock(&expiry_lock);
+    if (was_running)
+    {
+        pthread_join(expiry_thread, NULL);
+    }
+
+    pthread_mutex_lock(&expiry_lock);
+    free(heap);
+    heap = NULL;
+    heap_count = heap_capacity = 0;
+    pthread_mutex_unlock(&expiry_lock);
+}
+
+ExpiryStats expiry_get_stats()
+{
+    pthread_mutex_lock(&expiry_lock);
+    ExpiryStats current = stats;
+    current.running = running;
+    current.pending = heap_count;
+    current.next_expiry = heap_count > 0 ? heap[0].expires_at : 0;
+    pthread_mutex_unlock(&expiry_lock);
+    return current;
+}
+
+// 만료 대기 수와 처리 속도를 JSON 형식으로 반환하는 함수
+char *get_expiry_stats_info()
+{
+    ExpiryStats current = expiry_get_stats();
+
+    json_object *data = json_object_new_object();
+    json_object_object_add(data, "running", json_object_new_boolean(current.running));
+    json_object_object_add(data, "pending", json_object_new_int(current.pending));
+    json_object_object_add(data, "next_expiry", json_object_new_int64(current.next_expiry));
+    json_object_object_add(data, "expired", json_object_new_int64(current.expired));
+    json_object_object_add(data, "stale_skipped", json_object_new_int64(current.stale_skipped));
+    json_object_object_add(data, "batches", json_object_new_int64(current.batches));
+    json_object_object_add(data, "last_batch", json_object_new_int(current.last_batch));
+    json_object_object_add(data, "last_batch_ms", json_object_new_double(current.last_batch_ms));
+    json_object_object_add(data, "expired_per_sec", json_object_new_double(current.expire_ms > 0 ? current.expired * 1000.0 / current.expire_ms : 0.0));
+    json_object_object_add(data, "max_lag_ms", json_object_new_double(current.max_lag_ms));
+
+    json_object *result = json_object_new_object();
+    json_object_object_add(result, "action", json_object_new_string("expiry_stats"));
+    json_object_object_add(result, "data", data);
+
+    char *response = strdup(json_object_to_json_string(result));
+    json_object_put(result);
+    return response;
+}
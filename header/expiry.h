@@ -0,0 +1,29 @@
+#ifndef EXPIRY_H
+#define EXPIRY_H
+
+#include <stdint.h>
+
+#define EXPIRY_BATCH 4096           // store_lock을 한 번 잡고 지우는 최대 만료 메시지 수 (쓰기 요청이 기다리는 시간의 상한)
+#define EXPIRY_INITIAL_CAPACITY 1024 // 만료 힙의 처음 크기
+
+typedef struct {
+    int running;                // 만료 스레드가 돌고 있는지 (복제본에서는 주 서버의 delete를 따르므로 꺼 둠)
+    uint32_t pending;           // 힙에 남은 만료 예정 (TTL이 바뀌어 낡은 항목 포함)
+    int64_t next_expiry;        // 힙에서 가장 이른 만료 시각 (없으면 0)
+    uint64_t expired;           // 만료로 지운 메시지 수
+    uint64_t stale_skipped;     // TTL이 바뀌었거나 이미 지워져 버린 힙 항목 수
+    uint64_t batches;           // store_lock을 잡고 지운 묶음 수
+    uint32_t last_batch;        // 마지막 묶음에서 지운 수
+    double last_batch_ms;       // 마지막 묶음이 store_lock을 잡고 있던 시간
+    double expire_ms;           // 지우는 데 쓴 시간의 합 (expired / expire_ms가 처리 속도)
+    double max_lag_ms;          // 만료 시각부터 실제로 지워질 때까지 가장 오래 걸린 시간
+} ExpiryStats;
+
+// Function declarations
+void expiry_start();
+void expiry_stop();
+void expiry_on_set(uint32_t index, int64_t expires_at);
+ExpiryStats expiry_get_stats();
+char *get_expiry_stats_info();
+
+#endif // EXPIRY_H
@@ -0,0 +1,710 @@
+#include "graph.h"
+#include "message_handler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <pthread.h>
+#include <json-c/json.h>
+
+static inline int bitmap_test_and_set(uint64_t *bitmap, uint32_t index)
+{
+    uint64_t bit = (uint64_t)1 << (index & 63);
+    if (bitmap[index >> 6] & bit)
+    {
+        return 1;
+    }
+    bitmap[index >> 6] |= bit;
+    return 0;
+}
+
+// 살아 있는 메시지인지 확인합니다. store_lock을 잡은 채 호출합니다.
+// 반대쪽 목록이 가득 차 한쪽에만 남은 링크는 대상이 지워져도 남으므로 순회는 링크 배열을 그대로 믿지 않고 이것으로 거름
+static inline int is_live_node(uint32_t index)
+{
+    return index > 0 && index <= index_table_size && index_table[index - 1].length != 0;
+}
+
+int parse_graph_direction(const char *direction)
+{
+    if (strcmp(direction, "forward") == 0)
+        return GRAPH_FORWARD;
+    if (strcmp(direction, "backward") == 0)
+        return GRAPH_BACKWARD;
+    if (strcmp(direction, "both") == 0)
+        return GRAPH_FORWARD | GRAPH_BACKWARD;
+    return 0;
+}
+
+// 너비 우선: nodes 배열 자체를 큐로 쓰고, [level_start, level_end) 구간이 현재 깊이의 frontier입니다.
+static void traverse_bfs(const TraversalOptions *options, uint64_t *visited, TraversalResult *result)
+{
+    uint32_t level_start = 0;
+    uint32_t depth = 0;
+
+    while (level_start < result->count && depth < options->max_depth)
+    {
+        uint32_t level_end = result->count;
+        for (uint32_t i = level_start; i < level_end; i++)
+        {
+            const IndexEntry *entry = &index_table[result->nodes[i].index - 1];
+            for (int pass = 0; pass < 2; pass++)
+            {
+                if (!(options->directions & (pass == 0 ? GRAPH_FORWARD : GRAPH_BACKWARD)))
+                {
+                    continue;
+                }
+                const uint32_t *links = pass == 0 ? entry->forward_links : entry->backward_links;
+                uint32_t link_count = pass == 0 ? entry->forward_link_count : entry->backward_link_count;
+
+                for (uint32_t j = 0; j < link_count; j++)
+                {
+                    uint32_t next = links[j];
+                    result->edges_examined++;
+                    if (!is_live_node(next) || bitmap_test_and_set(visited, next))
+                    {
+                        continue;
+                    }
+                    if (result->count >= options->max_nodes)
+                    {
+                        result->truncated = 1;
+                        return;
+                    }
+                    TraversalNode *node = &result->nodes[result->count++];
+                    node->index = next;
+                    node->parent = result->nodes[i].index;
+                    node->depth = depth + 1;
+                    result->max_depth_reached = depth + 1;
+                }
+            }
+        }
+        level_start = level_end;
+        depth++;
+    }
+}
+
+// 깊이 우선 (전위 순서): 명시적 스택을 쓰며, 스택에서 꺼낼 때 방문으로 표시합니다.
+static void traverse_dfs(const TraversalOptions *options, uint64_t *visited, TraversalResult *result)
+{
+    uint32_t stack_capacity = 64;
+    uint32_t stack_size = 0;
+    TraversalNode *stack = malloc(sizeof(TraversalNode) * stack_capacity);
+    if (stack == NULL)
+    {
+        return;
+    }
+
+    stack[stack_size].index = options->start;
+    stack[stack_size].parent = 0;
+    stack[stack_size].depth = 0;
+    stack_size++;
+
+    while (stack_size > 0)
+    {
+        TraversalNode current = stack[--stack_size];
+        if (bitmap_test_and_set(visited, current.index))
+        {
+            continue;
+        }
+        if (result->count >= options->max_nodes)
+        {
+            result->truncated = 1;
+            break;
+        }
+        result->nodes[result->count++] = current;
+        if (current.depth > result->max_depth_reached)
+        {
+            result->max_depth_reached = current.depth;
+        }
+        if (current.depth >= options->max_depth)
+        {
+            continue;
+        }
+
+        const IndexEntry *entry = &index_table[current.index - 1];
+        // 역방향을 먼저 쌓고 링크 순서를 뒤집어 쌓아야 첫 번째 순방향 링크부터 내려갑니다.
+        for (int pass = 1; pass >= 0; pass--)
+        {
+            if (!(options->directions & (pass == 0 ? GRAPH_FORWARD : GRAPH_BACKWARD)))
+            {
+                continue;
+            }
+            const uint32_t *links = pass == 0 ? entry->forward_links : entry->backward_links;
+            uint32_t link_count = pass == 0 ? entry->forward_link_count : entry->backward_link_count;
+
+            for (uint32_t j = link_count; j-- > 0;)
+            {
+                uint32_t next = links[j];
+                result->edges_examined++;
+                if (!is_live_node(next) || (visited[next >> 6] & ((uint64_t)1 << (next & 63))))
+                {
+                    continue;
+                }
+                if (stack_size == stack_capacity)
+                {
+                    TraversalNode *grown = realloc(stack, sizeof(TraversalNode) * stack_capacity * 2);
+                    if (grown == NULL)
+                    {
+                        result->truncated = 1;
+                        free(stack);
+                        return;
+                    }
+                    stack = grown;
+                    stack_capacity *= 2;
+                }
+                stack[stack_size].index = next;
+                stack[stack_size].parent = current.index;
+                stack[stack_size].depth = current.depth + 1;
+                stack_size++;
+            }
+        }
+    }
+    free(stack);
+}
+
+// graph_traverse()와 같지만 store_lock을 호출자가 잡고 있습니다 (읽기든 쓰기든).
+static int traverse_locked(const TraversalOptions *options, TraversalResult *result)
+{
+    memset(result, 0, sizeof(TraversalResult));
+
+    if (!is_live_node(options->start))
+    {
+        return 0;
+    }
+
+    uint64_t *visited = calloc(index_table_size / 64 + 1, sizeof(uint64_t));
+    result->nodes = malloc(sizeof(TraversalNode) * options->max_nodes);
+    if (visited == NULL || result->nodes == NULL)
+    {
+        syslog(LOG_ERR, "Memory allocation failed for graph traversal");
+        free(visited);
+        free(result->nodes);
+        result->nodes = NULL;
+        return 0;
+    }
+
+    if (options->mode == GRAPH_DFS)
+    {
+        traverse_dfs(options, visited, result);
+    }
+    else
+    {
+        bitmap_test_and_set(visited, options->start);
+        result->nodes[0].index = options->start;
+        result->nodes[0].parent = 0;
+        result->nodes[0].depth = 0;
+        result->count = 1;
+        traverse_bfs(options, visited, result);
+    }
+
+    free(visited);
+    return 1;
+}
+
+// start에서 링크를 따라 도달하는 노드를 방문 순서대로 모읍니다.
+// 인덱스 테이블의 링크 배열을 그대로 인접 리스트로 쓰며, 순회하는 동안 read lock을 잡습니다.
+// 성공하면 1, 시작 인덱스가 유효하지 않거나 메모리가 부족하면 0을 반환합니다.
+int graph_traverse(const TraversalOptions *options, TraversalResult *result)
+{
+    pthread_rwlock_rdlock(&store_lock);
+    int ok = traverse_locked(options, result);
+    pthread_rwlock_unlock(&store_lock);
+    return ok;
+}
+
+void free_traversal_result(TraversalResult *result)
+{
+    free(result->nodes);
+    result->nodes = NULL;
+    result->count = 0;
+}
+
+// 프레임 하나를 JSON으로 만들어 writer로 보냅니다.
+static int send_traversal_frame(const TraversalOptions *options, uint32_t seq, json_object *nodes,
+                                GraphFrameWriter writer, void *context)
+{
+    json_object *frame = json_object_new_object();
+    json_object_object_add(frame, "action", json_object_new_string("traverse_result"));
+    json_object_object_add(frame, "root", json_object_new_int(options->start));
+    json_object_object_add(frame, "seq", json_object_new_int(seq));
+    json_object_object_add(frame, "nodes", nodes);
+
+    int ok = writer(context, json_object_to_json_string(frame));
+    json_object_put(frame);
+    return ok;
+}
+
+// 순회 결과를 여러 프레임으로 나누어 보내고, 요약 JSON을 반환합니다 (호출자가 해제).
+// 본문은 프레임 단위로 get_messages_by_indices()로 한꺼번에 읽으므로 캐시와 배치 I/O를 그대로 씁니다.
+char *stream_traversal(const TraversalOptions *options, GraphFrameWriter writer, void *context)
+{
+    TraversalResult result;
+    json_object *summary = json_object_new_object();
+    json_object_object_add(summary, "action", json_object_new_string("traverse_done"));
+    json_object_object_add(summary, "root", json_object_new_int(options->start));
+
+    if (!graph_traverse(options, &result))
+    {
+        json_object_object_add(summary, "error", json_object_new_string("Invalid start index"));
+        char *response = strdup(json_object_to_json_string(summary));
+        json_object_put(summary);
+        return response;
+    }
+
+    uint32_t frames = 0;
+    int aborted = 0;
+    uint32_t position = 0;
+    while (position < result.count && !aborted)
+    {
+        uint32_t batch = result.count - position < GRAPH_STREAM_BATCH ? result.count - position : GRAPH_STREAM_BATCH;
+        MessageBatch *bodies = NULL;
+        if (options->include_bodies)
+        {
+            uint32_t indices[GRAPH_STREAM_BATCH];
+            for (uint32_t i = 0; i < batch; i++)
+            {
+                indices[i] = result.nodes[position + i].index;
+            }
+            bodies = get_messages_by_indices(indices, batch);
+        }
+
+        json_object *nodes = json_object_new_array();
+        size_t bytes = 0;
+        uint32_t used = 0;
+        for (uint32_t i = 0; i < batch; i++)
+        {
+            const TraversalNode *node = &result.nodes[position + i];
+            json_object *node_obj = json_object_new_object();
+            json_object_object_add(node_obj, "index", json_object_new_int(node->index));
+            json_object_object_add(node_obj, "parent", json_object_new_int(node->parent));
+            json_object_object_add(node_obj, "depth", json_object_new_int(node->depth));
+            if (bodies != NULL)
+            {
+                const char *body = bodies->texts[i];
+                json_object_object_add(node_obj, "content", json_object_new_string_len(body != NULL ? body : "", body != NULL ? bodies->lengths[i] : 0));
+                bytes += body != NULL ? bodies->lengths[i] : 0;
+            }
+            json_object_array_add(nodes, node_obj);
+            used++;
+
+            // 본문이 크면 배치를 채우기 전에 프레임을 끊습니다.
+            if (bytes >= GRAPH_STREAM_MAX_BYTES || i + 1 == batch)
+            {
+                int sent = send_traversal_frame(options, frames++, nodes, writer, context);
+                nodes = sent && i + 1 < batch ? json_object_new_array() : NULL;
+                bytes = 0;
+                if (!sent)
+                {
+                    aborted = 1;
+                    break;
+                }
+            }
+        }
+
+        free_message_batch(bodies);
+        position += used;
+    }
+
+    json_object_object_add(summary, "mode", json_object_new_string(options->mode == GRAPH_DFS ? "dfs" : "bfs"));
+    json_object_object_add(summary, "nodes", json_object_new_int(result.count));
+    json_object_object_add(summary, "frames", json_object_new_int(frames));
+    json_object_object_add(summary, "depth", json_object_new_int(result.max_depth_reached));
+    json_object_object_add(summary, "edges_examined", json_object_new_int64(result.edges_examined));
+    json_object_object_add(summary, "truncated", json_object_new_boolean(result.truncated));
+    if (aborted)
+    {
+        json_object_object_add(summary, "error", json_object_new_string("Stream aborted"));
+    }
+
+    char *response = strdup(json_object_to_json_string(summary));
+    json_object_put(summary);
+    free_traversal_result(&result);
+    return response;
+}
+
+// 양방향 BFS에서 한쪽 탐색의 상태. nodes[].parent에는 부모의 인덱스 대신 nodes 안의 위치를 넣습니다.
+typedef struct {
+    TraversalNode *nodes;
+    uint32_t count;
+    uint32_t level_start;
+    uint32_t depth;
+    int directions;
+    uint32_t *slots; // 인덱스 -> nodes 위치 + 1 (0은 빈 칸), 선형 탐사 해시
+    uint32_t mask;
+} SearchSide;
+
+#define SEARCH_NOT_FOUND UINT32_MAX
+
+static uint32_t side_lookup(const SearchSide *side, uint32_t index)
+{
+    uint32_t slot = (index * 2654435761u) & side->mask;
+    while (side->slots[slot] != 0)
+    {
+        uint32_t position = side->slots[slot] - 1;
+        if (side->nodes[position].index == index)
+        {
+            return position;
+        }
+        slot = (slot + 1) & side->mask;
+    }
+    return SEARCH_NOT_FOUND;
+}
+
+static uint32_t side_insert(SearchSide *side, uint32_t index, uint32_t parent, uint32_t depth)
+{
+    uint32_t position = side->count++;
+    side->nodes[position].index = index;
+    side->nodes[position].parent = parent;
+    side->nodes[position].depth = depth;
+
+    uint32_t slot = (index * 2654435761u) & side->mask;
+    while (side->slots[slot] != 0)
+    {
+        slot = (slot + 1) & side->mask;
+    }
+    side->slots[slot] = position + 1;
+    return position;
+}
+
+static int init_side(SearchSide *side, uint32_t start, int directions, uint32_t capacity)
+{
+    uint32_t slot_count = 16;
+    while (slot_count < capacity * 2)
+    {
+        slot_count <<= 1;
+    }
+    memset(side, 0, sizeof(SearchSide));
+    side->nodes = malloc(sizeof(TraversalNode) * capacity);
+    side->slots = calloc(slot_count, sizeof(uint32_t));
+    side->mask = slot_count - 1;
+    side->directions = directions;
+    if (side->nodes == NULL || side->slots == NULL)
+    {
+        return 0;
+    }
+    side_insert(side, start, SEARCH_NOT_FOUND, 0);
+    return 1;
+}
+
+static void free_side(SearchSide *side)
+{
+    free(side->nodes);
+    free(side->slots);
+}
+
+// side의 현재 frontier 한 단계를 모두 펼칩니다. 이 단계에서 상대편과 만난 노드 중 전체 길이가 가장 짧은 쌍을 고릅니다.
+// 작업 한도를 넘으면 0을 반환합니다.
+static int expand_level(SearchSide *side, const SearchSide *other, uint32_t max_visited, PathResult *result,
+                        uint32_t *best_length, uint32_t *meet_side, uint32_t *meet_other)
+{
+    uint32_t level_end = side->count;
+    for (uint32_t i = side->level_start; i < level_end; i++)
+    {
+        const IndexEntry *entry = &index_table[side->nodes[i].index - 1];
+        for (int pass = 0; pass < 2; pass++)
+        {
+            if (!(side->directions & (pass == 0 ? GRAPH_FORWARD : GRAPH_BACKWARD)))
+            {
+                continue;
+            }
+            const uint32_t *links = pass == 0 ? entry->forward_links : entry->backward_links;
+            uint32_t link_count = pass == 0 ? entry->forward_link_count : entry->backward_link_count;
+
+            for (uint32_t j = 0; j < link_count; j++)
+            {
+                uint32_t next = links[j];
+                result->edges_examined++;
+                if (!is_live_node(next) || side_lookup(side, next) != SEARCH_NOT_FOUND)
+                {
+                    continue;
+                }
+                if (side->count + other->count >= max_visited)
+                {
+                    return 0;
+                }
+                uint32_t position = side_insert(side, next, i, side->depth + 1);
+                uint32_t other_position = side_lookup(other, next);
+                if (other_position != SEARCH_NOT_FOUND &&
+                    side->depth + 1 + other->nodes[other_position].depth < *best_length)
+                {
+                    *best_length = side->depth + 1 + other->nodes[other_position].depth;
+                    *meet_side = position;
+                    *meet_other = other_position;
+                }
+            }
+        }
+    }
+    side->level_start = level_end;
+    side->depth++;
+    return 1;
+}
+
+// from에서 to로 가는 최단 경로를 양쪽 끝에서 동시에 너비 우선으로 찾습니다.
+// from 쪽은 directions 방향의 링크를, to 쪽은 반대 방향의 링크를 따라가며 매번 frontier가 작은 쪽을 한 단계 펼칩니다.
+// 방문 노드 수가 max_visited를 넘거나 경로 길이가 max_depth를 넘으면 found = -1로 멈춥니다.
+int graph_shortest_path(uint32_t from, uint32_t to, int directions, uint32_t max_depth, uint32_t max_visited, PathResult *result)
+{
+    memset(result, 0, sizeof(PathResult));
+
+    pthread_rwlock_rdlock(&store_lock);
+
+    if (!is_live_node(from) || !is_live_node(to))
+    {
+        pthread_rwlock_unlock(&store_lock);
+        return 0;
+    }
+
+    if (from == to)
+    {
+        pthread_rwlock_unlock(&store_lock);
+        result->path = malloc(sizeof(uint32_t));
+        if (result->path == NULL)
+        {
+            return 0;
+        }
+        result->path[0] = from;
+        result->length = 1;
+        result->found = 1;
+        result->visited = 1;
+        return 1;
+    }
+
+    int reversed = ((directions & GRAPH_FORWARD) ? GRAPH_BACKWARD : 0) | ((directions & GRAPH_BACKWARD) ? GRAPH_FORWARD : 0);
+    SearchSide sides[2];
+    int ok = init_side(&sides[0], from, directions, max_visited);
+    ok = init_side(&sides[1], to, reversed, max_visited) && ok;
+    if (!ok)
+    {
+        syslog(LOG_ERR, "Memory allocation failed for path search");
+        free_side(&sides[0]);
+        free_side(&sides[1]);
+        pthread_rwlock_unlock(&store_lock);
+        return 0;
+    }
+
+    uint32_t best_length = UINT32_MAX;
+    uint32_t meet[2] = {0, 0};
+    result->found = -1;
+    while (1)
+    {
+        uint32_t frontier0 = sides[0].count - sides[0].level_start;
+        uint32_t frontier1 = sides[1].count - sides[1].level_start;
+        if (frontier0 == 0 || frontier1 == 0)
+        {
+            result->found = 0; // 한쪽이 더 갈 곳이 없으면 경로가 없음
+            break;
+        }
+        if (sides[0].depth + sides[1].depth >= max_depth)
+        {
+            break;
+        }
+
+        int s = frontier0 <= frontier1 ? 0 : 1;
+        uint32_t meet_side = 0, meet_other = 0;
+        if (!expand_level(&sides[s], &sides[1 - s], max_visited, result, &best_length, &meet_side, &meet_other))
+        {
+            break;
+        }
+        if (best_length != UINT32_MAX)
+        {
+            meet[s] = meet_side;
+            meet[1 - s] = meet_other;
+            result->found = 1;
+            break;
+        }
+    }
+    result->visited = sides[0].count + sides[1].count;
+
+    if (result->found == 1)
+    {
+        result->length = best_length + 1;
+        result->path = malloc(sizeof(uint32_t) * result->length);
+        if (result->path == NULL)
+        {
+            result->found = -1;
+            result->length = 0;
+        }
+        else
+        {
+            // from 쪽은 만난 노드에서 부모를 거슬러 올라가며 뒤에서부터 채우고, to 쪽은 만난 노드의 부모부터 앞으로 채웁니다.
+            uint32_t position = meet[0];
+            uint32_t k = sides[0].nodes[meet[0]].depth;
+            while (position != SEARCH_NOT_FOUND)
+            {
+                result->path[k--] = sides[0].nodes[position].index;
+                position = sides[0].nodes[position].parent;
+            }
+            k = sides[0].nodes[meet[0]].depth + 1;
+            position = sides[1].nodes[meet[1]].parent;
+            while (position != SEARCH_NOT_FOUND)
+            {
+                result->path[k++] = sides[1].nodes[position].index;
+                position = sides[1].nodes[position].parent;
+            }
+        }
+    }
+
+    free_side(&sides[0]);
+    free_side(&sides[1]);
+    pthread_rwlock_unlock(&store_lock);
+    return 1;
+}
+
+void free_path_result(PathResult *result)
+{
+    free(result->path);
+    result->path = NULL;
+    result->length = 0;
+}
+
+// 최단 경로 (reach_only면 도달 가능 여부와 거리만)를 JSON 형식으로 반환하는 함수
+char *get_path_info(uint32_t from, uint32_t to, int directions, uint32_t max_depth, uint32_t max_visited, int reach_only)
+{
+    PathResult path;
+    json_object *result = json_object_new_object();
+    json_object_object_add(result, "action", json_object_new_string(reach_only ? "reach_result" : "path_result"));
+    json_object_object_add(result, "from", json_object_new_int(from));
+    json_object_object_add(result, "to", json_object_new_int(to));
+
+    if (!graph_shortest_path(from, to, directions, max_depth, max_visited, &path))
+    {
+        json_object_object_add(result, "error", json_object_new_string("Invalid index"));
+    }
+    else
+    {
+        // found가 -1이면 한도 안에서는 답을 알 수 없다는 뜻이므로 reachable을 null로 둡니다.
+        json_object_object_add(result, "reachable", path.found < 0 ? NULL : json_object_new_boolean(path.found));
+        json_object_object_add(result, "bounded", json_object_new_boolean(path.found < 0));
+        if (path.found == 1)
+        {
+            json_object_object_add(result, "distance", json_object_new_int(path.length - 1));
+            if (!reach_only)
+            {
+                json_object *path_array = json_object_new_array();
+                for (uint32_t i = 0; i < path.length; i++)
+                {
+                    json_object_array_add(path_array, json_object_new_int(path.path[i]));
+                }
+                json_object_object_add(result, "path", path_array);
+            }
+        }
+        json_object_object_add(result, "visited", json_object_new_int(path.visited));
+        json_object_object_add(result, "edges_examined", json_object_new_int64(path.edges_examined));
+        free_path_result(&path);
+    }
+
+    char *response = strdup(json_object_to_json_string(result));
+    json_object_put(result);
+    return response;
+}
+
+// 조상 (역방향) 또는 자손 (순방향) 집합을 JSON 형식으로 반환하는 함수. 시작 노드는 포함하지 않습니다.
+char *get_related_set_info(uint32_t index, int directions, uint32_t max_depth, uint32_t max_nodes)
+{
+    TraversalOptions options;
+    options.start = index;
+    options.mode = GRAPH_BFS;
+    options.directions = directions;
+    options.max_depth = max_depth;
+    options.max_nodes = max_nodes + 1; // 시작 노드 몫
+    options.include_bodies = 0;
+
+    json_object *result = json_object_new_object();
+    json_object_object_add(result, "action", json_object_new_string(directions == GRAPH_BACKWARD ? "ancestors_result" : "descendants_result"));
+    json_object_object_add(result, "index", json_object_new_int(index));
+
+    TraversalResult traversal;
+    if (!graph_traverse(&options, &traversal))
+    {
+        json_object_object_add(result, "error", json_object_new_string("Invalid index"));
+    }
+    else
+    {
+        json_object *indices = json_object_new_array();
+        json_object *depths = json_object_new_array();
+        for (uint32_t i = 1; i < traversal.count; i++)
+        {
+            json_object_array_add(indices, json_object_new_int(traversal.nodes[i].index));
+            json_object_array_add(depths, json_object_new_int(traversal.nodes[i].depth));
+        }
+        json_object_object_add(result, "indices", indices);
+        json_object_object_add(result, "depths", depths);
+        json_object_object_add(result, "count", json_object_new_int(traversal.count - 1));
+        json_object_object_add(result, "truncated", json_object_new_boolean(traversal.truncated));
+        free_traversal_result(&traversal);
+    }
+
+    char *response = strdup(json_object_to_json_string(result));
+    json_object_put(result);
+    return response;
+}
+
+// root와 root에서 순방향 링크로 닿는 모든 메시지를 write lock 한 번 아래에서 지웁니다.
+// 다른 메시지도 링크하고 있는 자손도 함께 지워집니다. 순회와 삭제 사이에 링크가 바뀌지 않도록 순회도 같은 lock 안에서 합니다.
+// 자손이 max_nodes를 넘으면 아무것도 지우지 않고 -1, root가 없거나 이미 지워졌으면 0, 지웠으면 1을 반환합니다.
+int graph_delete_subtree(uint32_t root, uint32_t max_nodes, DeleteBatch *batch)
+{
+    TraversalOptions options;
+    options.start = root;
+    options.mode = GRAPH_BFS;
+    options.directions = GRAPH_FORWARD;
+    options.max_depth = UINT32_MAX;
+    options.max_nodes = max_nodes + 1; // 시작 노드 몫
+    options.include_bodies = 0;
+
+    memset(batch, 0, sizeof(DeleteBatch));
+    lock_all_store_shards();
+    pthread_rwlock_wrlock(&store_lock);
+    TraversalResult traversal;
+    if (!traverse_locked(&options, &traversal))
+    {
+        pthread_rwlock_unlock(&store_lock);
+        unlock_all_store_shards();
+        return 0;
+    }
+    int result = 1;
+    if (traversal.truncated)
+    {
+        result = -1;
+    }
+    else
+    {
+        for (uint32_t i = 0; i < traversal.count; i++)
+        {
+            delete_message_locked(traversal.nodes[i].index, batch);
+        }
+    }
+    pthread_rwlock_unlock(&store_lock);
+    finish_delete_batch(batch);
+    unlock_all_store_shards();
+    free_traversal_result(&traversal);
+    return result;
+}
+
+char *delete_subtree_info(uint32_t root, uint32_t max_nodes)
+{
+    DeleteBatch batch;
+    int deleted = graph_delete_subtree(root, max_nodes, &batch);
+
+    json_object *result = json_object_new_object();
+    json_object_object_add(result, "action", json_object_new_string("delete_result"));
+    json_object_object_add(result, "index", json_object_new_int(root));
+    if (deleted == 0)
+    {
+        json_object_object_add(result, "error", json_object_new_string("Invalid index"));
+    }
+    else if (deleted < 0)
+    {
+        json_object_object_add(result, "error", json_object_new_string("Subtree is larger than max_nodes"));
+        json_object_object_add(result, "max_nodes", json_object_new_int(max_nodes));
+    }
+    else
+    {
+        json_object_object_add(result, "deleted", json_object_new_int(batch.deleted));
+        json_object_object_add(result, "links_removed", json_object_new_int(batch.links_removed));
+    }
+
+    char *response = strdup(json_object_to_json_string(result));
+    json_object_put(result);
+    return response;
+}
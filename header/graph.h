@@ -0,0 +1,72 @@
+#ifndef GRAPH_H
+#define GRAPH_H
+
+#include <stdint.h>
+#include "message_handler.h"
+
+#define GRAPH_FORWARD 1                // 순방향 링크를 따라감
+#define GRAPH_BACKWARD 2               // 역방향 링크를 따라감
+#define GRAPH_MAX_DEPTH 64             // 요청할 수 있는 최대 깊이
+#define GRAPH_MAX_NODES 100000         // 한 번의 순회가 방문할 수 있는 최대 노드 수
+#define GRAPH_DEFAULT_DEPTH 8          // 깊이를 지정하지 않았을 때
+#define GRAPH_DEFAULT_NODES 1000       // 노드 수를 지정하지 않았을 때
+#define GRAPH_STREAM_BATCH 128         // 한 프레임에 담는 최대 노드 수
+#define GRAPH_STREAM_MAX_BYTES 32768   // 한 프레임에 담는 본문 크기 상한
+#define GRAPH_PATH_MAX_VISITED 200000  // 경로 탐색에서 양쪽을 합쳐 방문할 수 있는 최대 노드 수
+#define GRAPH_PATH_DEFAULT_VISITED 50000 // 경로 탐색 작업량을 지정하지 않았을 때
+#define GRAPH_DELETE_DEFAULT_NODES 10000 // delete_subtree에서 노드 수를 지정하지 않았을 때 지울 수 있는 최대 자손 수
+
+typedef enum {
+    GRAPH_BFS,
+    GRAPH_DFS
+} TraversalMode;
+
+typedef struct {
+    uint32_t start;
+    TraversalMode mode;
+    int directions;         // GRAPH_FORWARD | GRAPH_BACKWARD
+    uint32_t max_depth;
+    uint32_t max_nodes;
+    int include_bodies;
+} TraversalOptions;
+
+// 방문한 노드 하나. parent는 처음 발견한 경로의 부모 (시작 노드는 0)
+typedef struct {
+    uint32_t index;
+    uint32_t parent;
+    uint32_t depth;
+} TraversalNode;
+
+typedef struct {
+    TraversalNode *nodes;   // 방문 순서
+    uint32_t count;
+    uint32_t max_depth_reached;
+    uint64_t edges_examined;
+    int truncated;          // max_nodes에 걸려 멈췄는지
+} TraversalResult;
+
+// 두 메시지 사이의 최단 경로 탐색 결과
+typedef struct {
+    int found;              // 1: 경로 있음, 0: 경로 없음, -1: 작업 한도에 걸려 알 수 없음
+    uint32_t *path;         // from부터 to까지의 인덱스 (found == 1일 때)
+    uint32_t length;        // path의 노드 수
+    uint32_t visited;       // 양쪽에서 방문한 노드 수
+    uint64_t edges_examined;
+} PathResult;
+
+// 스트리밍할 JSON 프레임 하나를 보냅니다. 실패하면 0을 반환해 순회 전송을 멈춥니다.
+typedef int (*GraphFrameWriter)(void *context, const char *frame);
+
+// Function declarations
+int parse_graph_direction(const char *direction);
+int graph_traverse(const TraversalOptions *options, TraversalResult *result);
+void free_traversal_result(TraversalResult *result);
+char *stream_traversal(const TraversalOptions *options, GraphFrameWriter writer, void *context);
+int graph_shortest_path(uint32_t from, uint32_t to, int directions, uint32_t max_depth, uint32_t max_visited, PathResult *result);
+void free_path_result(PathResult *result);
+char *get_path_info(uint32_t from, uint32_t to, int directions, uint32_t max_depth, uint32_t max_visited, int reach_only);
+char *get_related_set_info(uint32_t index, int directions, uint32_t max_depth, uint32_t max_nodes);
+int graph_delete_subtree(uint32_t root, uint32_t max_nodes, DeleteBatch *batch);
+char *delete_subtree_info(uint32_t root, uint32_t max_nodes);
+
+#endif // GRAPH_H
@@ -0,0 +1,164 @@
+#include "hex.h"
+#include <string.h>
+#include <pthread.h>
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static uint16_t encode_table[256];  // 바이트 -> 두 글자 (메모리 순서 그대로)
+static int8_t decode_table[256];    // 글자 -> 0~15, 잘못된 글자는 -1
+static int hex_kernel = 0;          // 0: 테이블, 1: SSSE3, 2: AVX2
+static pthread_once_t hex_once = PTHREAD_ONCE_INIT;
+
+static void hex_init()
+{
+    for (int i = 0; i < 256; i++)
+    {
+        char pair[2] = {hex_digits[i >> 4], hex_digits[i & 0x0F]};
+        memcpy(&encode_table[i], pair, sizeof(pair));
+        decode_table[i] = -1;
+    }
+    for (int i = 0; i < 10; i++)
+    {
+        decode_table['0' + i] = i;
+    }
+    for (int i = 0; i < 6; i++)
+    {
+        decode_table['a' + i] = 10 + i;
+        decode_table['A' + i] = 10 + i;
+    }
+#ifdef __x86_64__
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        hex_kernel = 2;
+    }
+    else if (__builtin_cpu_supports("ssse3"))
+    {
+        hex_kernel = 1;
+    }
+#endif
+}
+
+static void hex_encode_table(char *out, const unsigned char *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        memcpy(out + i * 2, &encode_table[data[i]], 2);
+    }
+}
+
+#ifdef __x86_64__
+// pshufb로 니블 16개를 한 번에 글자로 바꾸고, 상위/하위 니블을 교차시켜 32글자를 만듭니다.
+__attribute__((target("ssse3"))) static size_t hex_encode_ssse3(char *out, const unsigned char *data, size_t length)
+{
+    const __m128i digits = _mm_loadu_si128((const __m128i *)hex_digits);
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+        __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, mask));
+        _mm_storeu_si128((__m128i *)(out + i * 2), _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128((__m128i *)(out + i * 2 + 16), _mm_unpackhi_epi8(high, low));
+    }
+    return i;
+}
+
+// AVX2 unpack은 128비트 레인 안에서만 섞이므로 마지막에 레인을 다시 맞춰 줍니다.
+__attribute__((target("avx2"))) static size_t hex_encode_avx2(char *out, const unsigned char *data, size_t length)
+{
+    const __m256i digits = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)hex_digits));
+    const __m256i mask = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i high = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), mask));
+        __m256i low = _mm256_shuffle_epi8(digits, _mm256_and_si256(bytes, mask));
+        __m256i first = _mm256_unpacklo_epi8(high, low);
+        __m256i second = _mm256_unpackhi_epi8(high, low);
+        _mm256_storeu_si256((__m256i *)(out + i * 2), _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256((__m256i *)(out + i * 2 + 32), _mm256_permute2x128_si256(first, second, 0x31));
+    }
+    return i;
+}
+#endif
+
+// data를 소문자 16진수 문자열로 바꿉니다. out에는 length * 2 + 1 바이트가 필요합니다.
+void hex_encode(char *out, const void *data, size_t length)
+{
+    pthread_once(&hex_once, hex_init);
+    const unsigned char *bytes = data;
+    size_t done = 0;
+#ifdef __x86_64__
+    if (hex_kernel == 2)
+    {
+        done = hex_encode_avx2(out, bytes, length);
+    }
+    else if (hex_kernel == 1)
+    {
+        done = hex_encode_ssse3(out, bytes, length);
+    }
+#endif
+    hex_encode_table(out + done * 2, bytes + done, length - done);
+    out[length * 2] = '\0';
+}
+
+// 16진수 문자열(대소문자 무관)을 바이트로 되돌립니다. 디코딩한 바이트 수, 형식이 잘못되면 -1을 반환합니다.
+long hex_decode(void *out, const char *hex, size_t hex_length)
+{
+    pthread_once(&hex_once, hex_init);
+    if (hex_length % 2 != 0)
+    {
+        return -1;
+    }
+
+    unsigned char *bytes = out;
+    const unsigned char *text = (const unsigned char *)hex;
+    for (size_t i = 0; i < hex_length / 2; i++)
+    {
+        int high = decode_table[text[i * 2]];
+        int low = decode_table[text[i * 2 + 1]];
+        if ((high | low) < 0)
+        {
+            return -1;
+        }
+        bytes[i] = (unsigned char)((high << 4) | low);
+    }
+    return (long)(hex_length / 2);
+}
+
+const char *hex_kernel_name()
+{
+    pthread_once(&hex_once, hex_init);
+    return hex_kernel == 2 ? "avx2" : hex_kernel == 1 ? "ssse3" : "table";
+}
+
+// 인코딩 커널을 "table", "ssse3", "avx2" 중 하나로 바꿉니다 (벤치마크용). CPU가 지원하지 않으면 바꾸지 않고 0을 반환합니다.
+// 다른 스레드가 인코딩하는 중에 부르지 않습니다.
+int hex_select_kernel(const char *name)
+{
+    pthread_once(&hex_once, hex_init);
+    if (strcmp(name, "table") == 0)
+    {
+        hex_kernel = 0;
+        return 1;
+    }
+#ifdef __x86_64__
+    if (strcmp(name, "ssse3") == 0 && __builtin_cpu_supports("ssse3"))
+    {
+        hex_kernel = 1;
+        return 1;
+    }
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2"))
+    {
+        hex_kernel = 2;
+        return 1;
+    }
+#endif
+    return 0;
+}
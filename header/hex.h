@@ -0,0 +1,13 @@
+#ifndef HEX_H
+#define HEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Function declarations
+void hex_encode(char *out, const void *data, size_t length);
+long hex_decode(void *out, const char *hex, size_t hex_length);
+const char *hex_kernel_name();
+int hex_select_kernel(const char *name);
+
+#endif // HEX_H
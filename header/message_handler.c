@@ -3,744 +3,2742 @@
 #include <stdlib.h>
 #include <string.h>
 #include <syslog.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stddef.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include <json-c/json.h>
+#include "async_io.h"
+#include "record_cache.h"
+#include "crc32c.h"
+#include "hex.h"
+#include "text_index.h"
+#include "time_index.h"
+#include "dedup.h"
+#include "compression.h"
+#include "subscription.h"
+#include "replication.h"
+#include "expiry.h"
 
 // Global variables
 IndexEntry *index_table = NULL;
 uint32_t index_table_size = 0;
-FreeSpaceEntry *free_space_table = NULL;
-uint32_t free_space_table_size = 0;
 
-// 인덱스 테이블을 초기화하는 함수
-void initialize_index_table()
+// 인덱스 테이블과 데이터 파일 읽기를 보호하는 락
+// 읽기 경로는 read lock, 수정 경로는 해당 shard의 writer를 먼저 잡은 뒤 write lock을 잡습니다.
+pthread_rwlock_t store_lock = PTHREAD_RWLOCK_INITIALIZER;
+// 앞의 STORE_SHARD_COUNT개가 쓰는 shard이고, 그 뒤는 다른 shard 수로 빌드했던 데이터 파일 (읽기만 하고 시작할 때 옮김)
+StoreShard store_shards[STORE_SHARD_MAX];
+// 메시지 데이터가 쓰일 때마다 증가하는 카운터 (dedup 해시 구축이 읽는 도중의 수정을 감지하는 데 사용)
+uint64_t message_write_seq = 0;
+
+// 시작할 때 index.bin / free_space.bin을 온전히 읽지 못했는지 (복구 보고서에 사용)
+int index_load_truncated = 0;
+int free_space_load_failed = 0;
+
+// append는 인덱스를 예약한 순서대로 index_table에 올립니다 (복제 로그와 index_table_size가 번호 순서를 따르도록).
+// 예약과 shard writer 획득은 append_lock 아래에서 함께 하므로 같은 shard의 append는 번호 순서대로 writer를 잡습니다.
+static pthread_mutex_t append_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t append_reserved = 0;
+static pthread_mutex_t publish_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t publish_cond = PTHREAD_COND_INITIALIZER;
+
+// 짧은 레코드를 읽고 쓸 때 재사용하는 버퍼 풀
+static unsigned char *read_buffer_pool[READ_BUFFER_POOL_SIZE];
+static int read_buffer_pool_count = 0;
+static pthread_mutex_t read_buffer_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int open_store_shard(uint32_t shard, int create)
 {
-    FILE *file = fopen(INDEX_FILE, "rb");
-    if (file == NULL)
+    char path[256];
+    snprintf(path, sizeof(path), STORE_SHARD_FILE, shard);
+    StoreShard *store = &store_shards[shard];
+    store->fd = open(path, create ? O_RDWR | O_CREAT : O_RDWR, 0644);
+    if (store->fd < 0)
     {
-        // 인덱스 파일이 존재하지 않는 경우, 새로운 파일을 생성합니다.
-        file = fopen(INDEX_FILE, "wb");
-        if (file == NULL)
-        {
-            fprintf(stderr, "Error creating index file: %s\n", INDEX_FILE);
-            exit(EXIT_FAILURE);
-        }
-        // 새 파일에 초기 인덱스 테이블 크기(0)를 쓰고 닫습니다.
-        uint32_t initial_size = 0;
-        fwrite(&initial_size, sizeof(uint32_t), 1, file);
-        fclose(file);
-
-        // 인덱스 테이블 초기화
-        index_table = malloc(sizeof(IndexEntry) * MAX_MESSAGES);
-        if (index_table == NULL)
+        if (create)
         {
-            fprintf(stderr, "Error allocating memory for index table\n");
-            exit(EXIT_FAILURE);
+            syslog(LOG_ERR, "Error opening message file: %s", path);
         }
-        index_table_size = 0;
-        printf("Created new index file and initialized index table\n");
-        return;
-    }
-
-    // 기존 파일에서 인덱스 테이블 크기를 읽습니다.
-    if (fread(&index_table_size, sizeof(uint32_t), 1, file) != 1)
-    {
-        fprintf(stderr, "Error reading index table size from file\n");
-        fclose(file);
-        exit(EXIT_FAILURE);
+        return 0;
     }
 
-    // 인덱스 테이블 메모리 할당
-    index_table = malloc(sizeof(IndexEntry) * MAX_MESSAGES);
-    if (index_table == NULL)
+    struct stat st;
+    if (fstat(store->fd, &st) != 0)
     {
-        fprintf(stderr, "Error allocating memory for index table\n");
-        fclose(file);
-        exit(EXIT_FAILURE);
+        syslog(LOG_ERR, "Error reading message file size: %s", path);
+        close(store->fd);
+        store->fd = -1;
+        return 0;
     }
+    store->file_size = st.st_size;
+    return 1;
+}
 
-    // 인덱스 테이블 데이터 읽기
-    for (uint32_t i = 0; i < index_table_size; i++)
+// shard 데이터 파일들을 열고 (없으면 생성) 크기를 기록합니다.
+// 예전 단일 messages.bin은 shard 0의 파일로 이름만 바꿉니다. 예전 offset은 shard 번호가 0이므로 그대로 맞습니다.
+// 레코드를 맡은 shard로 옮기는 일은 인덱스를 읽은 뒤 relocate_foreign_records()가 합니다.
+int open_message_file()
+{
+    char path[256];
+    snprintf(path, sizeof(path), STORE_SHARD_FILE, 0);
+    if (access(path, F_OK) != 0 && access(MESSAGE_FILE, F_OK) == 0)
     {
-        if (fread(&index_table[i].index, sizeof(uint32_t), 1, file) != 1 ||
-            fread(&index_table[i].offset, sizeof(uint64_t), 1, file) != 1 ||
-            fread(&index_table[i].length, sizeof(uint32_t), 1, file) != 1 ||
-            fread(&index_table[i].forward_link_count, sizeof(uint32_t), 1, file) != 1 ||
-            fread(&index_table[i].backward_link_count, sizeof(uint32_t), 1, file) != 1)
-        {
-            fprintf(stderr, "Error reading index table entry from file\n");
-            fclose(file);
-            free(index_table);
-            exit(EXIT_FAILURE);
-        }
-
-        // 순방향 링크 배열 읽기
-        if (fread(index_table[i].forward_links, sizeof(uint32_t), index_table[i].forward_link_count, file) != index_table[i].forward_link_count)
+        if (rename(MESSAGE_FILE, path) != 0)
         {
-            fprintf(stderr, "Error reading forward links for index table entry\n");
-            fclose(file);
-            free(index_table);
-            exit(EXIT_FAILURE);
+            syslog(LOG_ERR, "Error renaming %s to %s", MESSAGE_FILE, path);
+            return 0;
         }
+        printf("Moved %s to %s\n", MESSAGE_FILE, path);
+    }
 
-        // 역방향 링크 배열 읽기
-        if (fread(index_table[i].backward_links, sizeof(uint32_t), index_table[i].backward_link_count, file) != index_table[i].backward_link_count)
+    for (uint32_t shard = 0; shard < STORE_SHARD_MAX; shard++)
+    {
+        StoreShard *store = &store_shards[shard];
+        pthread_mutex_init(&store->writer, NULL);
+        store->fd = -1;
+        if (!open_store_shard(shard, shard < STORE_SHARD_COUNT) && shard < STORE_SHARD_COUNT)
         {
-            fprintf(stderr, "Error reading backward links for index table entry\n");
-            fclose(file);
-            free(index_table);
-            exit(EXIT_FAILURE);
+            return 0;
         }
     }
-
-    fclose(file);
-    printf("Loaded index table with %u entries\n", index_table_size);
+    return 1;
 }
 
-// 인덱스 테이블을 파일에 저장하는 함수
-void save_index_table()
+void close_message_file()
 {
-    FILE *file = fopen(INDEX_FILE, "wb");
-    if (file == NULL)
+    for (uint32_t shard = 0; shard < STORE_SHARD_MAX; shard++)
     {
-        fprintf(stderr, "Error opening index file for writing: %s\n", INDEX_FILE);
-        return;
+        StoreShard *store = &store_shards[shard];
+        if (store->fd >= 0)
+        {
+            close(store->fd);
+            store->fd = -1;
+        }
+        free(store->free_space);
+        store->free_space = NULL;
     }
 
-    // 인덱스 테이블 크기를 씁니다.
-    fwrite(&index_table_size, sizeof(uint32_t), 1, file);
-
-    // 인덱스 테이블 데이터를 씁니다.
-    for (uint32_t i = 0; i < index_table_size; i++)
+    pthread_mutex_lock(&read_buffer_pool_mutex);
+    while (read_buffer_pool_count > 0)
     {
-        fwrite(&index_table[i].index, sizeof(uint32_t), 1, file);
-        fwrite(&index_table[i].offset, sizeof(uint64_t), 1, file);
-        fwrite(&index_table[i].length, sizeof(uint32_t), 1, file);
-        fwrite(&index_table[i].forward_link_count, sizeof(uint32_t), 1, file);
-        fwrite(&index_table[i].backward_link_count, sizeof(uint32_t), 1, file);
-        fwrite(index_table[i].forward_links, sizeof(uint32_t), index_table[i].forward_link_count, file);
-        fwrite(index_table[i].backward_links, sizeof(uint32_t), index_table[i].backward_link_count, file);
+        free(read_buffer_pool[--read_buffer_pool_count]);
     }
+    pthread_mutex_unlock(&read_buffer_pool_mutex);
+}
 
-    fclose(file);
-    printf("Saved index table with %u entries\n", index_table_size);
+// offset이 가리키는 shard 파일 안에 [offset, offset + length)가 들어가는지 확인합니다.
+int store_extent_valid(uint64_t offset, uint32_t length)
+{
+    uint32_t shard = STORE_OFFSET_SHARD(offset);
+    return shard < STORE_SHARD_MAX && store_shards[shard].fd >= 0 &&
+           STORE_OFFSET_LOCAL(offset) + length <= store_shards[shard].file_size;
 }
-void initialize_free_space_table()
+
+void lock_store_shard(uint32_t shard)
 {
-    FILE *file = fopen(FREE_SPACE_FILE, "rb");
-    if (file == NULL)
-    {
-        file = fopen(FREE_SPACE_FILE, "wb");
-        if (file == NULL)
-        {
-            syslog(LOG_ERR, "Error creating free space file: %s", FREE_SPACE_FILE);
-            exit(EXIT_FAILURE);
-        }
-        uint32_t initial_size = 0;
-        fwrite(&initial_size, sizeof(uint32_t), 1, file);
-        fclose(file);
+    pthread_mutex_lock(&store_shards[shard].writer);
+}
 
-        free_space_table = malloc(sizeof(FreeSpaceEntry) * MAX_MESSAGES);
-        if (free_space_table == NULL)
-        {
-            syslog(LOG_ERR, "Error allocating memory for free space table");
-            exit(EXIT_FAILURE);
-        }
-        free_space_table_size = 0;
-        syslog(LOG_INFO, "Created new free space file and initialized free space table");
-        return;
+void unlock_store_shard(uint32_t shard)
+{
+    pthread_mutex_unlock(&store_shards[shard].writer);
+}
+
+// 지우기, 스냅숏처럼 여러 shard의 엔트리를 한꺼번에 바꾸거나 읽는 쪽은 모든 writer를 번호 순으로 잡습니다.
+void lock_all_store_shards()
+{
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        pthread_mutex_lock(&store_shards[shard].writer);
     }
+}
 
-    if (fread(&free_space_table_size, sizeof(uint32_t), 1, file) != 1)
+void unlock_all_store_shards()
+{
+    for (uint32_t shard = STORE_SHARD_COUNT; shard > 0; shard--)
     {
-        syslog(LOG_ERR, "Error reading free space table size from file");
-        fclose(file);
-        exit(EXIT_FAILURE);
+        pthread_mutex_unlock(&store_shards[shard - 1].writer);
     }
+}
 
-    free_space_table = malloc(sizeof(FreeSpaceEntry) * MAX_MESSAGES);
-    if (free_space_table == NULL)
+unsigned char *acquire_read_buffer(uint32_t length)
+{
+    if (length > READ_BUFFER_SIZE)
     {
-        syslog(LOG_ERR, "Error allocating memory for free space table");
-        fclose(file);
-        exit(EXIT_FAILURE);
+        return malloc(length);
     }
 
-    if (fread(free_space_table, sizeof(FreeSpaceEntry), free_space_table_size, file) != free_space_table_size)
+    unsigned char *buffer = NULL;
+    pthread_mutex_lock(&read_buffer_pool_mutex);
+    if (read_buffer_pool_count > 0)
     {
-        syslog(LOG_ERR, "Error reading free space table from file");
-        fclose(file);
-        free(free_space_table);
-        exit(EXIT_FAILURE);
+        buffer = read_buffer_pool[--read_buffer_pool_count];
     }
+    pthread_mutex_unlock(&read_buffer_pool_mutex);
 
-    fclose(file);
-    syslog(LOG_INFO, "Loaded free space table with %u entries", free_space_table_size);
+    return buffer != NULL ? buffer : malloc(READ_BUFFER_SIZE);
 }
-// 인덱스 테이블을 파일에 저장하는 함수
-// void save_index_table()
-// {
-//     FILE *file = fopen(INDEX_FILE, "wb");
-//     if (file == NULL)
-//     {
-//         syslog(LOG_ERR, "Error opening index file for writing: %s", INDEX_FILE);
-//         return;
-//     }
 
-//     // 인덱스 테이블 크기를 씁니다.
-//     fwrite(&index_table_size, sizeof(uint32_t), 1, file);
-
-//     // 인덱스 테이블 데이터를 씁니다.
-//     fwrite(index_table, sizeof(IndexEntry), index_table_size, file);
-
-//     fclose(file);
-//     syslog(LOG_INFO, "Saved index table with %u entries", index_table_size);
-// }
-void save_free_space_table()
+void release_read_buffer(unsigned char *buffer, uint32_t length)
 {
-    FILE *file = fopen(FREE_SPACE_FILE, "wb");
-    if (file == NULL)
+    if (buffer == NULL)
     {
-        syslog(LOG_ERR, "Error opening free space file for writing: %s", FREE_SPACE_FILE);
         return;
     }
-
-    fwrite(&free_space_table_size, sizeof(uint32_t), 1, file);
-    fwrite(free_space_table, sizeof(FreeSpaceEntry), free_space_table_size, file);
-
-    fclose(file);
-    syslog(LOG_INFO, "Saved free space table with %u entries", free_space_table_size);
+    if (length <= READ_BUFFER_SIZE)
+    {
+        pthread_mutex_lock(&read_buffer_pool_mutex);
+        if (read_buffer_pool_count < READ_BUFFER_POOL_SIZE)
+        {
+            read_buffer_pool[read_buffer_pool_count++] = buffer;
+            buffer = NULL;
+        }
+        pthread_mutex_unlock(&read_buffer_pool_mutex);
+    }
+    free(buffer);
 }
-uint64_t find_free_space(uint32_t required_length)
+
+// offset 위치에서 length 바이트를 읽습니다. offset의 shard 번호로 데이터 파일을 고릅니다. 모두 읽으면 1, 실패하면 0을 반환합니다.
+int read_message_data(uint64_t offset, void *buffer, uint32_t length)
 {
-    for (uint32_t i = 0; i < free_space_table_size; i++)
+    uint32_t shard = STORE_OFFSET_SHARD(offset);
+    if (shard >= STORE_SHARD_MAX || store_shards[shard].fd < 0)
+    {
+        return 0;
+    }
+    int fd = store_shards[shard].fd;
+    uint64_t local = STORE_OFFSET_LOCAL(offset);
+    uint32_t done = 0;
+    while (done < length)
     {
-        if (free_space_table[i].length >= required_length)
+        ssize_t n = pread(fd, (char *)buffer + done, length - done, local + done);
+        if (n <= 0)
         {
-            uint64_t offset = free_space_table[i].offset;
-
-            if (free_space_table[i].length > required_length)
-            {
-                // 남은 공간을 다시 free space table에 추가
-                free_space_table[i].offset += required_length;
-                free_space_table[i].length -= required_length;
-            }
-            else
-            {
-                // 정확히 맞는 공간이면 해당 entry를 제거
-                memmove(&free_space_table[i], &free_space_table[i + 1],
-                        (free_space_table_size - i - 1) * sizeof(FreeSpaceEntry));
-                free_space_table_size--;
-            }
-
-            save_free_space_table();
-            return offset;
+            return 0;
         }
+        done += n;
     }
-    return 0; // 적절한 free space를 찾지 못함
+    return 1;
 }
-void add_free_space(uint64_t offset, uint32_t length)
+
+// offset 위치에 length 바이트를 씁니다. 호출자는 offset이 속한 shard의 writer를 잡고 있어야 합니다.
+int write_message_data(uint64_t offset, const void *buffer, uint32_t length)
 {
-    if (free_space_table_size >= MAX_MESSAGES)
+    uint32_t shard = STORE_OFFSET_SHARD(offset);
+    if (shard >= STORE_SHARD_MAX || store_shards[shard].fd < 0)
     {
-        syslog(LOG_ERR, "Free space table is full");
-        return;
+        return 0;
     }
-
-    // 간단한 구현: 새로운 free space를 테이블 끝에 추가
-    free_space_table[free_space_table_size].offset = offset;
-    free_space_table[free_space_table_size].length = length;
-    free_space_table_size++;
-
-    save_free_space_table();
+    StoreShard *store = &store_shards[shard];
+    uint64_t local = STORE_OFFSET_LOCAL(offset);
+    uint32_t done = 0;
+    while (done < length)
+    {
+        ssize_t n = pwrite(store->fd, (const char *)buffer + done, length - done, local + done);
+        if (n <= 0)
+        {
+            return 0;
+        }
+        done += n;
+    }
+    if (local + length > store->file_size)
+    {
+        store->file_size = local + length;
+    }
+    return 1;
 }
-// 새로운 함수: 파일의 마지막 인덱스를 읽어오는 함수
-uint32_t get_last_index()
+
+// CRC 헤더와 메시지로 구성된 레코드를 한 번의 pwrite로 씁니다.
+// compressed이면 message는 compress_record_body()가 만든 압축 본문입니다.
+// 슬롯의 남은 공간은 0으로 채우지 않고, 파일 끝의 슬롯이면 파일 크기만 늘립니다 (sparse).
+int write_message_record(uint64_t offset, uint32_t allocated_len, uint32_t index, const char *message, uint32_t message_len, int64_t timestamp, int compressed)
 {
-    FILE *file = fopen(MESSAGE_FILE, "rb");
-    if (file == NULL)
+    uint32_t record_len = RECORD_HEADER_SIZE + message_len;
+    unsigned char *record = acquire_read_buffer(record_len);
+    if (record == NULL)
     {
-        // 파일이 없으면 인덱스 0부터 시작
         return 0;
     }
 
-    uint32_t last_index = 0;
-    uint32_t current_index;
-    time_t timestamp;
-    uint32_t message_len;
-
-    // 파일의 끝까지 읽어가며 마지막 인덱스를 찾음
-    while (fread(&current_index, sizeof(uint32_t), 1, file) == 1)
+    RecordHeader header;
+    header.magic = compressed ? RECORD_MAGIC_COMPRESSED : RECORD_MAGIC;
+    header.index = index;
+    header.length = message_len;
+    header.timestamp = timestamp;
+    memcpy(record, &header, RECORD_HEADER_SIZE);
+    memcpy(record + RECORD_HEADER_SIZE, message, message_len);
+    header.crc = crc32c(0, record + RECORD_CRC_OFFSET, record_len - RECORD_CRC_OFFSET);
+    memcpy(record + offsetof(RecordHeader, crc), &header.crc, sizeof(uint32_t));
+
+    int result = write_message_data(offset, record, record_len);
+    release_read_buffer(record, record_len);
+
+    StoreShard *store = &store_shards[STORE_OFFSET_SHARD(offset)];
+    uint64_t end = STORE_OFFSET_LOCAL(offset) + allocated_len;
+    if (result && end > store->file_size)
     {
-        last_index = current_index;
-
-        // 타임스탬프와 메시지 길이를 읽고 건너뜀
-        fread(&timestamp, sizeof(time_t), 1, file);
-        fread(&message_len, sizeof(uint32_t), 1, file);
-        fseek(file, message_len, SEEK_CUR);
+        if (ftruncate(store->fd, end) != 0)
+        {
+            return 0;
+        }
+        store->file_size = end;
     }
-
-    fclose(file);
-    return last_index;
-}
-// 새로운 함수: 2의 거듭제곱 중 주어진 크기보다 크거나 같은 최소값을 반환
-uint32_t next_power_of_two(uint32_t v)
-{
-    v--;
-    v |= v >> 1;
-    v |= v >> 2;
-    v |= v >> 4;
-    v |= v >> 8;
-    v |= v >> 16;
-    v++;
-    return v < 16 ? 16 : v; // 최소 크기를 16으로 설정
+    return result;
 }
-int add_forward_link(uint32_t source_index, uint32_t target_index)
+
+// 슬롯 앞부분의 레코드 헤더를 해석합니다. magic이 없으면 이전 형식(타임스탬프 + 길이)으로 읽습니다.
+// 메시지 길이가 슬롯 안에 들어가면 1, 헤더가 손상되었으면 0을 반환합니다.
+int parse_record_header(const unsigned char *buffer, uint32_t slot_length, RecordInfo *info)
 {
-    if (source_index == 0 || source_index > index_table_size ||
-        target_index == 0 || target_index > index_table_size)
+    memset(info, 0, sizeof(RecordInfo));
+
+    uint32_t magic = 0;
+    if (slot_length >= RECORD_HEADER_SIZE)
     {
-        return 0; // 유효하지 않은 인덱스
+        memcpy(&magic, buffer, sizeof(uint32_t));
     }
 
-    IndexEntry *source_entry = &index_table[source_index - 1];
-    IndexEntry *target_entry = &index_table[target_index - 1];
-
-    if (source_entry->forward_link_count >= MAX_LINKS)
+    if (magic == RECORD_MAGIC || magic == RECORD_MAGIC_COMPRESSED)
     {
-        return 0; // 더 이상 링크를 추가할 수 없음
+        RecordHeader header;
+        memcpy(&header, buffer, RECORD_HEADER_SIZE);
+        info->compressed = magic == RECORD_MAGIC_COMPRESSED;
+        info->index = header.index;
+        info->crc = header.crc;
+        info->timestamp = header.timestamp;
+        info->header_length = RECORD_HEADER_SIZE;
+        info->message_length = header.length;
     }
-
-    // 이미 존재하는 링크인지 확인
-    for (uint32_t i = 0; i < source_entry->forward_link_count; i++)
+    else
     {
-        if (source_entry->forward_links[i] == target_index)
+        if (slot_length < LEGACY_RECORD_HEADER_SIZE)
         {
-            return 1; // 이미 존재하는 링크
+            return 0;
         }
+        time_t timestamp;
+        memcpy(&timestamp, buffer, sizeof(time_t));
+        memcpy(&info->message_length, buffer + sizeof(time_t), sizeof(uint32_t));
+        info->legacy = 1;
+        info->timestamp = timestamp;
+        info->header_length = LEGACY_RECORD_HEADER_SIZE;
     }
+    info->text_length = info->message_length; // 압축 레코드는 본문을 읽은 뒤 resolve_text_length()가 채움
 
-    // 새 순방향 링크 추가
-    source_entry->forward_links[source_entry->forward_link_count++] = target_index;
+    return info->message_length <= slot_length - info->header_length;
+}
 
-    // 대상 메시지의 역방향 링크 추가
-    if (target_entry->backward_link_count < MAX_LINKS)
+// 레코드 전체가 buffer에 있을 때 CRC32C를 확인합니다. legacy 레코드는 검사할 수 없으므로 항상 1입니다.
+int verify_record_checksum(const unsigned char *buffer, const RecordInfo *info)
+{
+    if (info->legacy)
     {
-        target_entry->backward_links[target_entry->backward_link_count++] = source_index;
+        return 1;
     }
-
-    save_index_table();
-    return 1; // 성공
+    uint32_t length = info->header_length + info->message_length - RECORD_CRC_OFFSET;
+    return crc32c(0, buffer + RECORD_CRC_OFFSET, length) == info->crc;
 }
 
-int add_backward_link(uint32_t source_index, uint32_t target_index)
+// 레코드 헤더에 기록된 실제 사용 길이 (헤더 + 메시지)를 반환합니다.
+uint32_t record_used_length(const unsigned char *buffer, uint32_t slot_length)
 {
-    if (source_index == 0 || source_index > index_table_size ||
-        target_index == 0 || target_index > index_table_size)
+    RecordInfo info;
+    if (!parse_record_header(buffer, slot_length, &info))
     {
-        return 0; // 유효하지 않은 인덱스
+        return slot_length;
     }
+    return info.header_length + info.message_length;
+}
 
-    IndexEntry *source_entry = &index_table[source_index - 1];
-    IndexEntry *target_entry = &index_table[target_index - 1];
+// 압축 레코드이면 본문 앞의 압축 헤더에서 풀었을 때의 길이를 읽어 text_length에 넣습니다.
+static int resolve_text_length(const unsigned char *buffer, RecordInfo *info)
+{
+    if (!info->compressed)
+    {
+        return 1;
+    }
+    info->text_length = compressed_body_length(buffer + info->header_length, info->message_length);
+    return info->text_length > 0;
+}
 
-    if (source_entry->backward_link_count >= MAX_LINKS)
+// 슬롯 버퍼의 레코드 헤더, 인덱스, CRC를 확인합니다. 손상되었으면 0을 반환합니다.
+// 공유 레코드는 헤더에 특정 인덱스 대신 RECORD_SHARED_INDEX가 기록되어 있습니다.
+static int check_record(const unsigned char *buffer, uint32_t slot_length, uint32_t index, RecordInfo *info)
+{
+    if (!parse_record_header(buffer, slot_length, info) ||
+        (!info->legacy && info->index != index && info->index != RECORD_SHARED_INDEX) ||
+        !verify_record_checksum(buffer, info) ||
+        !resolve_text_length(buffer, info))
     {
-        return 0; // 더 이상 링크를 추가할 수 없음
+        syslog(LOG_ERR, "Corrupt record for index %u", index);
+        return 0;
     }
+    return 1;
+}
 
-    // 이미 존재하는 링크인지 확인
-    for (uint32_t i = 0; i < source_entry->backward_link_count; i++)
+// 확인된 레코드의 메시지를 out에 text_length 바이트와 NUL로 꺼냅니다 (압축 레코드는 풉니다).
+static int copy_record_text(const unsigned char *buffer, const RecordInfo *info, char *out)
+{
+    if (info->compressed)
     {
-        if (source_entry->backward_links[i] == target_index)
+        if (!decompress_record_body(buffer + info->header_length, info->message_length, out, info->text_length))
         {
-            return 1; // 이미 존재하는 링크
+            syslog(LOG_ERR, "Error decompressing record");
+            return 0;
         }
     }
-
-    // 새 역방향 링크 추가
-    source_entry->backward_links[source_entry->backward_link_count++] = target_index;
-
-    // 대상 메시지의 순방향 링크 추가
-    if (target_entry->forward_link_count < MAX_LINKS)
+    else
     {
-        target_entry->forward_links[target_entry->forward_link_count++] = source_index;
+        memcpy(out, buffer + info->header_length, info->message_length);
     }
-
-    save_index_table();
-    return 1; // 성공
+    out[info->text_length] = '\0';
+    return 1;
 }
-int remove_forward_link(uint32_t source_index, uint32_t target_index)
+
+// 슬롯 버퍼에서 메시지 텍스트를 꺼냅니다. 헤더나 CRC가 맞지 않으면 손상된 데이터를 돌려주지 않고 NULL을 반환합니다.
+static char *decode_record_text(const unsigned char *buffer, uint32_t slot_length, uint32_t index, ResultAllocator alloc)
 {
-    if (source_index == 0 || source_index > index_table_size ||
-        target_index == 0 || target_index > index_table_size)
+    RecordInfo info;
+    if (!check_record(buffer, slot_length, index, &info))
     {
-        return 0; // 유효하지 않은 인덱스
+        return NULL;
     }
 
-    IndexEntry *source_entry = &index_table[source_index - 1];
-    IndexEntry *target_entry = &index_table[target_index - 1];
+    char *text = alloc != NULL ? alloc((size_t)info.text_length + 1) : malloc((size_t)info.text_length + 1);
+    if (text == NULL)
+    {
+        syslog(LOG_ERR, "Memory allocation failed for text result");
+        return NULL;
+    }
+    if (!copy_record_text(buffer, &info, text))
+    {
+        if (alloc == NULL)
+        {
+            free(text);
+        }
+        return NULL;
+    }
+    return text;
+}
 
-    int found = 0;
+// index.bin을 병렬로 풀 때 스레드 하나가 한 번에 맡는 구간
+typedef struct {
+    const unsigned char *data;
+    size_t position; // 구간 첫 엔트리의 파일 내 위치
+    uint32_t first;  // 구간 첫 엔트리의 테이블 위치
+    uint32_t stride; // 파일 안 이웃 엔트리의 테이블 위치 차이 (shard 조각 파일은 STORE_SHARD_COUNT)
+    uint32_t count;
+    uint32_t format; // 파일의 magic (INDEX_FILE_MAGIC / INDEX_FILE_MAGIC_V2), 버전 필드 없는 예전 형식이면 0
+} IndexLoadChunk;
+
+typedef struct {
+    IndexLoadChunk *chunks;
+    uint32_t chunk_count;
+    uint32_t next_chunk; // 다음에 가져갈 구간 (원자적으로 증가)
+} IndexLoadJob;
+
+// 형식별 엔트리 고정 부분 크기
+static size_t index_entry_fixed_size(uint32_t format)
+{
+    if (format == INDEX_FILE_MAGIC)
+        return INDEX_ENTRY_FIXED_SIZE;
+    if (format == INDEX_FILE_MAGIC_V2)
+        return V2_INDEX_ENTRY_FIXED_SIZE;
+    return LEGACY_INDEX_ENTRY_FIXED_SIZE;
+}
 
-    // 순방향 링크 제거
-    for (uint32_t i = 0; i < source_entry->forward_link_count; i++)
+static void *decode_index_chunks(void *arg)
+{
+    IndexLoadJob *job = arg;
+    uint32_t c;
+    while ((c = __atomic_fetch_add(&job->next_chunk, 1, __ATOMIC_RELAXED)) < job->chunk_count)
     {
-        if (source_entry->forward_links[i] == target_index)
+        const IndexLoadChunk *chunk = &job->chunks[c];
+        const unsigned char *p = chunk->data + chunk->position;
+        for (uint32_t k = 0; k < chunk->count; k++)
         {
-            // 링크 제거 및 배열 정리
-            for (uint32_t j = i; j < source_entry->forward_link_count - 1; j++)
+            IndexEntry *entry = &index_table[chunk->first + k * chunk->stride];
+            memcpy(&entry->index, p, sizeof(uint32_t));
+            memcpy(&entry->offset, p + 4, sizeof(uint64_t));
+            memcpy(&entry->length, p + 12, sizeof(uint32_t));
+            entry->version = 1;
+            entry->expires_at = 0;
+            if (chunk->format != 0)
             {
-                source_entry->forward_links[j] = source_entry->forward_links[j + 1];
+                memcpy(&entry->version, p + 16, sizeof(uint32_t));
             }
-            source_entry->forward_link_count--;
-            found = 1;
-            break;
+            if (chunk->format == INDEX_FILE_MAGIC)
+            {
+                memcpy(&entry->expires_at, p + 20, sizeof(int64_t));
+            }
+            size_t fixed_size = index_entry_fixed_size(chunk->format);
+            memcpy(&entry->forward_link_count, p + fixed_size - 8, sizeof(uint32_t));
+            memcpy(&entry->backward_link_count, p + fixed_size - 4, sizeof(uint32_t));
+            p += fixed_size;
+            memcpy(entry->forward_links, p, sizeof(uint32_t) * entry->forward_link_count);
+            p += sizeof(uint32_t) * entry->forward_link_count;
+            memcpy(entry->backward_links, p, sizeof(uint32_t) * entry->backward_link_count);
+            p += sizeof(uint32_t) * entry->backward_link_count;
         }
     }
+    return NULL;
+}
 
-    if (found)
+// 임시 파일에 쓰고 fsync한 뒤 rename으로 교체합니다. 중간에 죽어도 이전 파일이나 새 파일 중 하나가 온전히 남습니다.
+static FILE *open_table_for_save(const char *path, char *temp_path, size_t temp_path_size)
+{
+    snprintf(temp_path, temp_path_size, "%s.tmp", path);
+    return fopen(temp_path, "wb");
+}
+
+static int commit_table_file(FILE *file, const char *temp_path, const char *path)
+{
+    int ok = fflush(file) == 0 && !ferror(file) && fsync(fileno(file)) == 0;
+    if (fclose(file) != 0)
     {
-        // 대상 메시지의 역방향 링크 제거
-        for (uint32_t i = 0; i < target_entry->backward_link_count; i++)
+        ok = 0;
+    }
+    if (!ok || rename(temp_path, path) != 0)
+    {
+        syslog(LOG_ERR, "Error saving table file: %s", path);
+        unlink(temp_path);
+        return 0;
+    }
+    return 1;
+}
+
+// index 파일 하나를 통째로 mmap합니다. 파일이 없으면 MAP_FAILED를 돌려주고 *missing을 1로 둡니다.
+static const unsigned char *map_index_file(const char *path, size_t *file_size, int *missing)
+{
+    *file_size = 0;
+    *missing = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        *missing = 1;
+        return MAP_FAILED;
+    }
+
+    struct stat st;
+    const unsigned char *data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(uint32_t))
+    {
+        *file_size = st.st_size;
+        data = mmap(NULL, *file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (data != MAP_FAILED)
+    {
+        madvise((void *)data, *file_size, MADV_SEQUENTIAL);
+    }
+    return data;
+}
+
+// mmap한 index 파일 하나에서 엔트리 경계만 훑어 디코딩 구간을 job에 더합니다.
+// 파일의 k번째 엔트리는 테이블의 first + k * stride 자리에 들어가고, 온전히 읽힌 엔트리 수를 반환합니다.
+// 저장 도중 중단되어 잘린 파일이면 온전히 읽힌 엔트리까지만 사용하고, 나머지는 복구 단계에서 레코드로부터 되살립니다.
+static uint32_t scan_index_entries(IndexLoadJob *job, const unsigned char *data, size_t file_size, uint32_t format,
+                                   size_t header_size, uint32_t first, uint32_t stride, uint32_t stored_count)
+{
+    size_t fixed_size = index_entry_fixed_size(format);
+    size_t counts_offset = fixed_size - 2 * sizeof(uint32_t); // 두 링크 개수는 고정 부분의 마지막 8바이트
+    size_t position = header_size;
+    uint32_t loaded = 0;
+    while (loaded < stored_count)
+    {
+        if (position + fixed_size > file_size)
         {
-            if (target_entry->backward_links[i] == source_index)
-            {
-                for (uint32_t j = i; j < target_entry->backward_link_count - 1; j++)
-                {
-                    target_entry->backward_links[j] = target_entry->backward_links[j + 1];
-                }
-                target_entry->backward_link_count--;
-                break;
-            }
+            break;
         }
-        save_index_table();
-        return 1; // 성공
+        uint32_t index, forward_count, backward_count;
+        memcpy(&index, data + position, sizeof(uint32_t));
+        memcpy(&forward_count, data + position + counts_offset, sizeof(uint32_t));
+        memcpy(&backward_count, data + position + counts_offset + 4, sizeof(uint32_t));
+        if (index != first + loaded * stride + 1 || forward_count > MAX_LINKS || backward_count > MAX_LINKS)
+        {
+            break;
+        }
+        size_t next = position + fixed_size + sizeof(uint32_t) * (forward_count + backward_count);
+        if (next > file_size)
+        {
+            break;
+        }
+
+        if (loaded % INDEX_LOAD_CHUNK_ENTRIES == 0)
+        {
+            IndexLoadChunk *chunk = &job->chunks[job->chunk_count++];
+            chunk->data = data;
+            chunk->position = position;
+            chunk->first = first + loaded * stride;
+            chunk->stride = stride;
+            chunk->count = 0;
+            chunk->format = format;
+        }
+        job->chunks[job->chunk_count - 1].count++;
+        position = next;
+        loaded++;
     }
+    return loaded;
+}
 
-    return 0; // 링크를 찾지 못함
+// 구간 디코딩을 스레드들에 나눕니다. 현재 스레드도 함께 일합니다.
+static void decode_index_job(IndexLoadJob *job)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t threads = job->chunk_count;
+    if (cpus > 0 && threads > (uint32_t)cpus)
+        threads = cpus;
+    if (threads > INDEX_LOAD_MAX_THREADS)
+        threads = INDEX_LOAD_MAX_THREADS;
+
+    pthread_t workers[INDEX_LOAD_MAX_THREADS];
+    uint32_t started = 0;
+    for (uint32_t t = 1; t < threads; t++)
+    {
+        if (pthread_create(&workers[started], NULL, decode_index_chunks, job) == 0)
+        {
+            started++;
+        }
+    }
+    decode_index_chunks(job);
+    for (uint32_t t = 0; t < started; t++)
+    {
+        pthread_join(workers[t], NULL);
+    }
 }
 
-int remove_backward_link(uint32_t source_index, uint32_t target_index)
+// 단일 index.bin (예전 형식이거나 스냅숏의 index.bin)을 읽습니다.
+static void load_single_index_file(const unsigned char *data, size_t file_size)
 {
-    if (source_index == 0 || source_index > index_table_size ||
-        target_index == 0 || target_index > index_table_size)
+    // 가장 예전 형식은 엔트리 수로 바로 시작하고 엔트리에 버전 필드가 없습니다.
+    uint32_t first_word;
+    memcpy(&first_word, data, sizeof(uint32_t));
+    int legacy = first_word != INDEX_FILE_MAGIC && first_word != INDEX_FILE_MAGIC_V2;
+    size_t header_size = legacy ? sizeof(uint32_t) : INDEX_FILE_HEADER_SIZE;
+    if (legacy)
     {
-        return 0; // 유효하지 않은 인덱스
+        index_table_size = first_word;
+    }
+    else if (file_size >= INDEX_FILE_HEADER_SIZE)
+    {
+        memcpy(&index_table_size, data + sizeof(uint32_t), sizeof(uint32_t));
+    }
+    else
+    {
+        index_table_size = 0;
+        index_load_truncated = 1;
     }
 
-    IndexEntry *source_entry = &index_table[source_index - 1];
-    IndexEntry *target_entry = &index_table[target_index - 1];
+    uint32_t stored_size = index_table_size;
+    if (stored_size > MAX_MESSAGES)
+    {
+        stored_size = MAX_MESSAGES;
+        index_load_truncated = 1;
+    }
 
-    int found = 0;
+    IndexLoadJob job = {0};
+    job.chunks = malloc(sizeof(IndexLoadChunk) * (stored_size / INDEX_LOAD_CHUNK_ENTRIES + 1));
+    if (job.chunks == NULL)
+    {
+        fprintf(stderr, "Error allocating memory for index load\n");
+        exit(EXIT_FAILURE);
+    }
 
-    // 역방향 링크 제거
-    for (uint32_t i = 0; i < source_entry->backward_link_count; i++)
+    uint32_t loaded = scan_index_entries(&job, data, file_size, legacy ? 0 : first_word, header_size, 0, 1, stored_size);
+    decode_index_job(&job);
+    free(job.chunks);
+
+    if (loaded < index_table_size)
     {
-        if (source_entry->backward_links[i] == target_index)
+        syslog(LOG_ERR, "Index file truncated: loaded %u of %u entries", loaded, index_table_size);
+        index_load_truncated = 1;
+    }
+    index_table_size = loaded;
+}
+
+// 조각 파일 경로. legacy이면 이전 배치의 구간 shard 파일 (shard는 항상 0, 조각 번호가 구간 번호)
+static void index_chunk_path(char *path, size_t size, uint32_t shard, uint32_t chunk, int legacy)
+{
+    if (legacy)
+    {
+        snprintf(path, size, LEGACY_INDEX_SHARD_FILE, chunk);
+    }
+    else
+    {
+        snprintf(path, size, INDEX_CHUNK_FILE, shard, chunk);
+    }
+}
+
+static int index_chunk_exists(uint32_t shard, uint32_t chunk, int legacy)
+{
+    char path[256];
+    index_chunk_path(path, sizeof(path), shard, chunk, legacy);
+    return access(path, F_OK) == 0;
+}
+
+// shard 번호 shard (shard_count개 중)의 조각 파일들을 0번부터 차례로 훑어 구간을 job에 더합니다.
+// shard 안 k번째 엔트리는 인덱스 k * shard_count + shard + 1입니다. 마지막이 아닌 조각은 가득 차 있어야 하고,
+// 모자라거나 잘린 조각이 나오면 거기까지만 쓰고 나머지는 복구 단계에 맡깁니다. 읽은 shard 안 엔트리 수를 반환합니다.
+static uint32_t scan_index_chunks(IndexLoadJob *job, const unsigned char **maps, size_t *map_sizes, uint32_t *map_count,
+                                  uint32_t shard, uint32_t shard_count, uint32_t chunk_entries, int legacy)
+{
+    uint32_t max_local = (MAX_MESSAGES - shard + shard_count - 1) / shard_count;
+    uint32_t loaded = 0;
+    for (uint32_t chunk = 0; loaded < max_local; chunk++)
+    {
+        char path[256];
+        index_chunk_path(path, sizeof(path), shard, chunk, legacy);
+        int missing;
+        size_t map_size;
+        const unsigned char *data = map_index_file(path, &map_size, &missing);
+        if (missing)
         {
-            // 링크 제거 및 배열 정리
-            for (uint32_t j = i; j < source_entry->backward_link_count - 1; j++)
+            // 중간 조각이 없으면 그 뒤 엔트리는 복구 단계에서 레코드로부터 되살림
+            if (index_chunk_exists(shard, chunk + 1, legacy))
             {
-                source_entry->backward_links[j] = source_entry->backward_links[j + 1];
+                syslog(LOG_ERR, "Index chunk missing: %s", path);
+                index_load_truncated = 1;
             }
-            source_entry->backward_link_count--;
-            found = 1;
             break;
         }
-    }
+        if (data != MAP_FAILED)
+        {
+            maps[*map_count] = data;
+            map_sizes[(*map_count)++] = map_size;
+        }
 
-    if (found)
-    {
-        // 대상 메시지의 순방향 링크 제거
-        for (uint32_t i = 0; i < target_entry->forward_link_count; i++)
+        uint32_t header[2] = {0, 0};
+        if (data != MAP_FAILED && map_size >= INDEX_FILE_HEADER_SIZE)
         {
-            if (target_entry->forward_links[i] == source_index)
+            memcpy(header, data, sizeof(header));
+        }
+        if ((header[0] != INDEX_FILE_MAGIC && header[0] != INDEX_FILE_MAGIC_V2) || header[1] > chunk_entries || loaded + header[1] > max_local)
+        {
+            syslog(LOG_ERR, "Index chunk unreadable: %s", path);
+            index_load_truncated = 1;
+            break;
+        }
+
+        uint32_t first = loaded * shard_count + shard;
+        uint32_t count = scan_index_entries(job, data, map_size, header[0], INDEX_FILE_HEADER_SIZE, first, shard_count, header[1]);
+        loaded += count;
+        if (count < header[1])
+        {
+            syslog(LOG_ERR, "Index chunk truncated: %s loaded %u of %u entries", path, count, header[1]);
+            index_load_truncated = 1;
+            break;
+        }
+        if (count < chunk_entries)
+        {
+            // 마지막 조각. 뒤에 다른 조각 파일이 더 있으면 저장이 어긋난 것이므로 복구 단계에서 다시 맞춤
+            if (index_chunk_exists(shard, chunk + 1, legacy))
             {
-                for (uint32_t j = i; j < target_entry->forward_link_count - 1; j++)
-                {
-                    target_entry->forward_links[j] = target_entry->forward_links[j + 1];
-                }
-                target_entry->forward_link_count--;
-                break;
+                syslog(LOG_ERR, "Index chunk after a partial chunk: %s", path);
+                index_load_truncated = 1;
             }
+            break;
         }
-        save_index_table();
-        return 1; // 성공
     }
+    return loaded;
+}
 
-    return 0; // 링크를 찾지 못함
+// 저장소 shard들의 조각 파일을 읽습니다 (legacy이면 이전 배치의 구간 shard 파일을 shard 하나로 읽음).
+// 엔트리 경계 찾기는 파일 순서대로, 디코딩은 모든 조각의 구간을 모아 한꺼번에 나눕니다.
+// 테이블에는 모든 shard가 빠짐없이 가진 번호까지만 올리고, 그 뒤에 먼저 저장된 엔트리는 복구 단계에서 레코드로부터 되살립니다.
+static void load_index_chunks(uint32_t chunk_entries, uint32_t shard_count, int legacy)
+{
+    uint32_t max_maps = MAX_MESSAGES / chunk_entries + shard_count + 1;
+    const unsigned char **maps = calloc(max_maps, sizeof(*maps));
+    size_t *map_sizes = calloc(max_maps, sizeof(*map_sizes));
+    IndexLoadJob job = {0};
+    job.chunks = malloc(sizeof(IndexLoadChunk) * (MAX_MESSAGES / INDEX_LOAD_CHUNK_ENTRIES + max_maps + 1));
+    if (maps == NULL || map_sizes == NULL || job.chunks == NULL)
+    {
+        fprintf(stderr, "Error allocating memory for index load\n");
+        exit(EXIT_FAILURE);
+    }
+
+    uint32_t map_count = 0;
+    uint32_t size = MAX_MESSAGES;
+    uint32_t loaded_total = 0;
+    for (uint32_t shard = 0; shard < shard_count; shard++)
+    {
+        uint32_t loaded = scan_index_chunks(&job, maps, map_sizes, &map_count, shard, shard_count, chunk_entries, legacy);
+        loaded_total += loaded;
+        // 이 shard의 다음 엔트리 번호 - 1 = 이 shard 때문에 끊기는 지점
+        if (loaded * shard_count + shard < size)
+        {
+            size = loaded * shard_count + shard;
+        }
+    }
+
+    decode_index_job(&job);
+    for (uint32_t i = 0; i < map_count; i++)
+    {
+        munmap((void *)maps[i], map_sizes[i]);
+    }
+    free(job.chunks);
+    free(maps);
+    free(map_sizes);
+    if (loaded_total > size)
+    {
+        syslog(LOG_ERR, "Index chunks out of step: using %u of %u saved entries", size, loaded_total);
+        index_load_truncated = 1;
+    }
+    index_table_size = size;
 }
-uint32_t *get_forward_links(uint32_t index, uint32_t *count)
+
+// index.bin을 저장소 목록 머리로 씁니다. 조각 파일을 모두 쓴 뒤에 불러야 합니다.
+static int save_index_manifest()
 {
-    if (index == 0 || index > index_table_size)
+    char temp_path[256];
+    FILE *file = open_table_for_save(INDEX_FILE, temp_path, sizeof(temp_path));
+    if (file == NULL)
     {
-        *count = 0;
-        return NULL; // 유효하지 않은 인덱스
+        fprintf(stderr, "Error opening index file for writing: %s\n", INDEX_FILE);
+        return 0;
     }
+    uint32_t header[3] = {INDEX_STORE_MAGIC, INDEX_CHUNK_ENTRIES, STORE_SHARD_COUNT};
+    fwrite(header, sizeof(uint32_t), 3, file);
+    return commit_table_file(file, temp_path, INDEX_FILE);
+}
 
-    IndexEntry *entry = &index_table[index - 1];
-    *count = entry->forward_link_count;
+// 이전 배치의 구간 shard 파일을 지웁니다. 새 배치의 조각과 머리를 모두 쓴 뒤에 부릅니다.
+static void remove_legacy_index_shards()
+{
+    char path[256];
+    for (uint32_t chunk = 0; chunk <= MAX_MESSAGES / INDEX_CHUNK_MIN_ENTRIES; chunk++)
+    {
+        index_chunk_path(path, sizeof(path), 0, chunk, 1);
+        unlink(path);
+    }
+}
 
-    if (entry->forward_link_count == 0)
+// 인덱스 테이블을 초기화하는 함수
+// index.bin은 저장소 목록 머리이고 엔트리는 shard마다 INDEX_CHUNK_ENTRIES개씩 조각 파일에 나뉘어 있습니다.
+// 각 파일을 mmap한 뒤, 엔트리 경계만 훑는 순차 패스로 구간을 나누고 구간별 디코딩은 여러 스레드가 나누어 합니다.
+// index.bin이 예전 단일 파일(스냅숏에서 되돌린 경우 포함)이거나 이전 배치면 읽은 뒤 새 배치로 나누어 씁니다.
+void initialize_index_table()
+{
+    // 인덱스 테이블 메모리 할당
+    index_table = malloc(sizeof(IndexEntry) * MAX_MESSAGES);
+    if (index_table == NULL)
     {
-        return NULL;
+        fprintf(stderr, "Error allocating memory for index table\n");
+        exit(EXIT_FAILURE);
     }
+    index_table_size = 0;
 
-    uint32_t *links = malloc(sizeof(uint32_t) * entry->forward_link_count);
-    if (links == NULL)
+    size_t file_size;
+    int missing;
+    const unsigned char *data = map_index_file(INDEX_FILE, &file_size, &missing);
+    if (missing)
     {
-        *count = 0;
-        return NULL; // 메모리 할당 실패
+        // 인덱스 파일이 존재하지 않는 경우, 빈 저장소 목록 머리를 만듭니다.
+        if (!save_index_manifest())
+        {
+            exit(EXIT_FAILURE);
+        }
+        printf("Created new index file and initialized index table\n");
+        return;
     }
 
-    memcpy(links, entry->forward_links, sizeof(uint32_t) * entry->forward_link_count);
-    return links;
+    // 기존 파일에서 인덱스 테이블 크기를 읽습니다.
+    if (data == MAP_FAILED)
+    {
+        fprintf(stderr, "Error reading index table size from file\n");
+        index_load_truncated = 1;
+        return;
+    }
+
+    uint32_t header[3] = {0, 0, 0};
+    memcpy(header, data, file_size < sizeof(header) ? file_size : sizeof(header));
+    if (header[0] == INDEX_STORE_MAGIC || header[0] == INDEX_SHARD_MAGIC)
+    {
+        munmap((void *)data, file_size);
+        int legacy = header[0] == INDEX_SHARD_MAGIC;
+        uint32_t shard_count = legacy ? 1 : header[2];
+        if (header[1] < INDEX_CHUNK_MIN_ENTRIES || header[1] > MAX_MESSAGES || shard_count == 0 || shard_count > STORE_SHARD_MAX)
+        {
+            syslog(LOG_ERR, "Index file has an invalid layout: %u entries per chunk, %u shards", header[1], shard_count);
+            index_load_truncated = 1;
+            return;
+        }
+        load_index_chunks(header[1], shard_count, legacy);
+        printf("Loaded index table with %u entries from %u shards\n", index_table_size, shard_count);
+        if (legacy || header[1] != INDEX_CHUNK_ENTRIES || shard_count != STORE_SHARD_COUNT)
+        {
+            // 배치를 바꿔 빌드한 경우: 새 배치로 모두 다시 쓰고 머리를 마지막에 바꿈
+            // (옛 조각 파일 이름이 겹칠 수 있으므로 이전 배치의 파일은 머리를 바꾼 뒤에 지움)
+            save_index_table();
+            if (legacy)
+            {
+                remove_legacy_index_shards();
+            }
+        }
+        return;
+    }
+
+    load_single_index_file(data, file_size);
+    munmap((void *)data, file_size);
+    printf("Loaded index table with %u entries\n", index_table_size);
+    // 조각 파일을 모두 쓴 뒤 머리를 바꾸므로, 중간에 죽으면 다음 시작에서 단일 파일을 다시 나눔
+    save_index_table();
 }
 
-uint32_t *get_backward_links(uint32_t index, uint32_t *count)
+// 테이블의 first, first + stride, ... 자리의 엔트리 count개를 index.bin 형식으로 씁니다.
+// 호출자는 그 엔트리들을 바꾸는 쪽을 막고 있어야 합니다 (store_lock 또는 엔트리들의 shard writer).
+static int write_index_entries(FILE *file, uint32_t first, uint32_t stride, uint32_t count)
 {
-    if (index == 0 || index > index_table_size)
+    // magic과 엔트리 수를 씁니다.
+    uint32_t magic = INDEX_FILE_MAGIC;
+    fwrite(&magic, sizeof(uint32_t), 1, file);
+    fwrite(&count, sizeof(uint32_t), 1, file);
+
+    // 인덱스 테이블 데이터를 씁니다.
+    for (uint32_t k = 0; k < count; k++)
     {
-        *count = 0;
-        return NULL; // 유효하지 않은 인덱스
+        const IndexEntry *entry = &index_table[first + k * stride];
+        fwrite(&entry->index, sizeof(uint32_t), 1, file);
+        fwrite(&entry->offset, sizeof(uint64_t), 1, file);
+        fwrite(&entry->length, sizeof(uint32_t), 1, file);
+        fwrite(&entry->version, sizeof(uint32_t), 1, file);
+        fwrite(&entry->expires_at, sizeof(int64_t), 1, file);
+        fwrite(&entry->forward_link_count, sizeof(uint32_t), 1, file);
+        fwrite(&entry->backward_link_count, sizeof(uint32_t), 1, file);
+        fwrite(entry->forward_links, sizeof(uint32_t), entry->forward_link_count, file);
+        fwrite(entry->backward_links, sizeof(uint32_t), entry->backward_link_count, file);
     }
+    return !ferror(file);
+}
 
-    IndexEntry *entry = &index_table[index - 1];
-    *count = entry->backward_link_count;
+// 인덱스 테이블 전체를 단일 index.bin 형식으로 씁니다 (스냅숏). 호출자는 모든 shard writer를 잡고 있어야 합니다. 쓰기에 실패하면 0을 반환합니다.
+int write_index_table(FILE *file)
+{
+    return write_index_entries(file, 0, 1, index_table_size);
+}
+
+// shard 안 엔트리 수. 이 shard의 엔트리는 writer를 잡은 append만 올리므로 writer를 잡은 동안은 바뀌지 않습니다.
+static uint32_t shard_entry_count(uint32_t shard)
+{
+    uint32_t size = __atomic_load_n(&index_table_size, __ATOMIC_ACQUIRE);
+    return size > shard ? (size - shard - 1) / STORE_SHARD_COUNT + 1 : 0;
+}
+
+static uint32_t shard_chunk_count(uint32_t shard)
+{
+    return (shard_entry_count(shard) + INDEX_CHUNK_ENTRIES - 1) / INDEX_CHUNK_ENTRIES;
+}
 
-    if (entry->backward_link_count == 0)
+// 모든 shard의 조각 파일 수
+uint32_t index_chunk_count()
+{
+    uint32_t chunks = 0;
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
     {
-        return NULL;
+        chunks += shard_chunk_count(shard);
     }
+    return chunks;
+}
 
-    uint32_t *links = malloc(sizeof(uint32_t) * entry->backward_link_count);
-    if (links == NULL)
+// 조각 하나를 파일에 씁니다. 호출자는 shard의 writer를 잡고 있어야 합니다.
+static int save_index_chunk(uint32_t shard, uint32_t chunk)
+{
+    char path[256];
+    char temp_path[272];
+    index_chunk_path(path, sizeof(path), shard, chunk, 0);
+    FILE *file = open_table_for_save(path, temp_path, sizeof(temp_path));
+    if (file == NULL)
     {
-        *count = 0;
-        return NULL; // 메모리 할당 실패
+        fprintf(stderr, "Error opening index file for writing: %s\n", path);
+        return 0;
     }
 
-    memcpy(links, entry->backward_links, sizeof(uint32_t) * entry->backward_link_count);
-    return links;
+    uint32_t first_local = chunk * INDEX_CHUNK_ENTRIES;
+    uint32_t entries = shard_entry_count(shard);
+    uint32_t count = entries - first_local < INDEX_CHUNK_ENTRIES ? entries - first_local : INDEX_CHUNK_ENTRIES;
+    write_index_entries(file, first_local * STORE_SHARD_COUNT + shard, STORE_SHARD_COUNT, count);
+    return commit_table_file(file, temp_path, path);
 }
 
-// append_message_to_file 함수 수정
-uint32_t append_message_to_file(const char *message)
+// 인덱스 테이블 전체를 조각 파일들에 저장하고 머리를 씁니다 (시작할 때 복구나 배치 변경처럼 여러 엔트리를 한꺼번에 바꾼 뒤).
+// 다른 스레드가 쓰기를 시작하기 전에만 부릅니다.
+void save_index_table()
+{
+    int ok = 1;
+    char path[256];
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        uint32_t chunks = shard_chunk_count(shard);
+        for (uint32_t chunk = 0; chunk < chunks; chunk++)
+        {
+            ok &= save_index_chunk(shard, chunk);
+        }
+        memset(store_shards[shard].dirty_chunks, 0, sizeof(store_shards[shard].dirty_chunks));
+        // 테이블이 줄었거나 단일 index.bin에서 되돌린 경우 뒤에 남은 조각 파일을 지움
+        for (uint32_t chunk = chunks; chunk < INDEX_CHUNK_COUNT; chunk++)
+        {
+            index_chunk_path(path, sizeof(path), shard, chunk, 0);
+            unlink(path);
+        }
+    }
+    // 다른 shard 수로 빌드했을 때의 조각 파일
+    for (uint32_t shard = STORE_SHARD_COUNT; shard < STORE_SHARD_MAX; shard++)
+    {
+        for (uint32_t chunk = 0; index_chunk_exists(shard, chunk, 0); chunk++)
+        {
+            index_chunk_path(path, sizeof(path), shard, chunk, 0);
+            unlink(path);
+        }
+    }
+    if (ok && save_index_manifest())
+    {
+        printf("Saved index table with %u entries\n", index_table_size);
+    }
+}
+
+// index 엔트리가 바뀌었다고 표시합니다. 그 shard의 writer를 놓기 전에 persist_store_shard()가 조각 파일을 다시 씁니다.
+// 엔트리 하나를 바꾸는 쓰기 경로는 테이블 크기와 상관없이 INDEX_CHUNK_ENTRIES개만 씁니다.
+void mark_index_dirty(uint32_t index)
+{
+    if (index == 0 || index > MAX_MESSAGES)
+    {
+        return;
+    }
+    uint32_t local = (index - 1) / STORE_SHARD_COUNT;
+    store_shards[STORE_SHARD_OF(index)].dirty_chunks[local / INDEX_CHUNK_ENTRIES] = 1;
+}
+
+static int save_free_space_shard(uint32_t shard);
+
+// shard에서 바뀐 인덱스 조각과 free space 테이블을 파일에 씁니다. writer를 잡고 store_lock은 잡지 않은 채 부릅니다.
+// 조각을 먼저 쓰므로, 사이에 죽어도 free space가 살아 있는 슬롯을 가리키는 일은 복구 단계가 걸러 냅니다.
+void persist_store_shard(uint32_t shard)
+{
+    StoreShard *store = &store_shards[shard];
+    uint32_t chunks = shard_chunk_count(shard);
+    for (uint32_t chunk = 0; chunk < INDEX_CHUNK_COUNT; chunk++)
+    {
+        if (store->dirty_chunks[chunk])
+        {
+            store->dirty_chunks[chunk] = 0;
+            if (chunk < chunks)
+            {
+                save_index_chunk(shard, chunk);
+            }
+        }
+    }
+    if (store->free_space_dirty)
+    {
+        store->free_space_dirty = 0;
+        save_free_space_shard(shard);
+    }
+}
+// free space 파일 하나를 읽어 table에 담습니다. 파일이 없으면 -1, 읽지 못했으면 0을 반환합니다.
+static int load_free_space_file(const char *path, FreeSpaceEntry *table, uint32_t *size)
+{
+    *size = 0;
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return -1;
+    }
+    uint32_t stored = UINT32_MAX; // 아래에서 빈 테이블로 처리
+    if (fread(&stored, sizeof(uint32_t), 1, file) != 1 ||
+        stored > MAX_MESSAGES ||
+        fread(table, sizeof(FreeSpaceEntry), stored, file) != stored)
+    {
+        fclose(file);
+        return 0;
+    }
+    fclose(file);
+    *size = stored;
+    return 1;
+}
+
+// shard마다 free space 테이블을 읽습니다. 예전 단일 free_space.bin (스냅숏에서 되돌린 경우 포함)이 있으면
+// 그 엔트리를 offset의 shard로 나누어 shard 파일을 새로 쓴 뒤 지웁니다.
+// free space 테이블은 잃어도 데이터는 안전하므로 (공간만 새고 compaction이 회수) 읽지 못하면 비우고 시작합니다.
+void initialize_free_space_table()
+{
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        store_shards[shard].free_space = malloc(sizeof(FreeSpaceEntry) * MAX_MESSAGES);
+        if (store_shards[shard].free_space == NULL)
+        {
+            syslog(LOG_ERR, "Error allocating memory for free space table");
+            exit(EXIT_FAILURE);
+        }
+        store_shards[shard].free_space_size = 0;
+    }
+
+    FreeSpaceEntry *legacy = malloc(sizeof(FreeSpaceEntry) * MAX_MESSAGES);
+    if (legacy == NULL)
+    {
+        syslog(LOG_ERR, "Error allocating memory for free space table");
+        exit(EXIT_FAILURE);
+    }
+    uint32_t legacy_size;
+    int legacy_loaded = load_free_space_file(FREE_SPACE_FILE, legacy, &legacy_size);
+    if (legacy_loaded >= 0)
+    {
+        for (uint32_t i = 0; i < legacy_size; i++)
+        {
+            // 지금 쓰지 않는 shard의 빈 공간은 버림 (그 파일의 레코드는 relocate_foreign_records()가 옮김)
+            uint32_t shard = STORE_OFFSET_SHARD(legacy[i].offset);
+            if (shard < STORE_SHARD_COUNT)
+            {
+                StoreShard *store = &store_shards[shard];
+                store->free_space[store->free_space_size++] = legacy[i];
+            }
+        }
+        if (!legacy_loaded)
+        {
+            syslog(LOG_ERR, "Error reading free space table from file, starting with an empty table");
+            free_space_load_failed = 1;
+        }
+        save_free_space_table();
+        unlink(FREE_SPACE_FILE);
+        syslog(LOG_INFO, "Split %s into %u shard free space tables", FREE_SPACE_FILE, STORE_SHARD_COUNT);
+    }
+    free(legacy);
+    if (legacy_loaded >= 0)
+    {
+        return;
+    }
+
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        StoreShard *store = &store_shards[shard];
+        char path[256];
+        snprintf(path, sizeof(path), STORE_FREE_SPACE_FILE, shard);
+        int loaded = load_free_space_file(path, store->free_space, &store->free_space_size);
+        if (loaded < 0)
+        {
+            save_free_space_shard(shard);
+            syslog(LOG_INFO, "Created new free space file: %s", path);
+        }
+        else if (!loaded)
+        {
+            syslog(LOG_ERR, "Error reading free space table from file: %s, starting with an empty table", path);
+            free_space_load_failed = 1;
+        }
+        else
+        {
+            syslog(LOG_INFO, "Loaded free space table %s with %u entries", path, store->free_space_size);
+        }
+    }
+}
+// 인덱스 테이블을 파일에 저장하는 함수
+// void save_index_table()
+// {
+//     FILE *file = fopen(INDEX_FILE, "wb");
+//     if (file == NULL)
+//     {
+//         syslog(LOG_ERR, "Error opening index file for writing: %s", INDEX_FILE);
+//         return;
+//     }
+
+//     // 인덱스 테이블 크기를 씁니다.
+//     fwrite(&index_table_size, sizeof(uint32_t), 1, file);
+
+//     // 인덱스 테이블 데이터를 씁니다.
+//     fwrite(index_table, sizeof(IndexEntry), index_table_size, file);
+
+//     fclose(file);
+//     syslog(LOG_INFO, "Saved index table with %u entries", index_table_size);
+// }
+// 모든 shard의 free space 테이블을 하나의 free_space.bin 형식으로 씁니다 (스냅숏). 호출자는 모든 shard writer를 잡고 있어야 합니다.
+int write_free_space_table(FILE *file)
+{
+    uint32_t size = 0;
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        size += store_shards[shard].free_space_size;
+    }
+    fwrite(&size, sizeof(uint32_t), 1, file);
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        fwrite(store_shards[shard].free_space, sizeof(FreeSpaceEntry), store_shards[shard].free_space_size, file);
+    }
+    return !ferror(file);
+}
+// shard 하나의 free space 테이블을 저장합니다. 호출자는 shard의 writer를 잡고 있어야 합니다.
+static int save_free_space_shard(uint32_t shard)
+{
+    StoreShard *store = &store_shards[shard];
+    char path[256];
+    char temp_path[272];
+    snprintf(path, sizeof(path), STORE_FREE_SPACE_FILE, shard);
+    FILE *file = open_table_for_save(path, temp_path, sizeof(temp_path));
+    if (file == NULL)
+    {
+        syslog(LOG_ERR, "Error opening free space file for writing: %s", path);
+        return 0;
+    }
+
+    fwrite(&store->free_space_size, sizeof(uint32_t), 1, file);
+    fwrite(store->free_space, sizeof(FreeSpaceEntry), store->free_space_size, file);
+    if (!commit_table_file(file, temp_path, path))
+    {
+        return 0;
+    }
+    syslog(LOG_INFO, "Saved free space table %s with %u entries", path, store->free_space_size);
+    return 1;
+}
+// 모든 shard의 free space 테이블을 저장합니다 (시작할 때 복구처럼 다른 스레드가 쓰지 않을 때).
+void save_free_space_table()
+{
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        save_free_space_shard(shard);
+        store_shards[shard].free_space_dirty = 0;
+    }
+}
+// shard의 free space에서 required_length가 들어가는 구간을 떼어 그 offset을 반환합니다. 없으면 0을 반환합니다.
+// 호출자는 shard의 writer와 store_lock(쓰기)을 잡고 있어야 하고, 테이블 저장은 persist_store_shard()에 맡깁니다.
+uint64_t find_free_space(uint32_t shard, uint32_t required_length)
+{
+    StoreShard *store = &store_shards[shard];
+    if (store->reuse_disabled)
+    {
+        return 0; // compaction 중에는 항상 파일 끝에 추가
+    }
+
+    for (uint32_t i = 0; i < store->free_space_size; i++)
+    {
+        FreeSpaceEntry *entry = &store->free_space[i];
+        if (entry->length >= required_length && STORE_OFFSET_LOCAL(entry->offset) >= store->frozen_end)
+        {
+            uint64_t offset = entry->offset;
+
+            if (entry->length > required_length)
+            {
+                // 남은 공간을 다시 free space table에 추가
+                entry->offset += required_length;
+                entry->length -= required_length;
+            }
+            else
+            {
+                // 정확히 맞는 공간이면 해당 entry를 제거
+                memmove(entry, entry + 1, (store->free_space_size - i - 1) * sizeof(FreeSpaceEntry));
+                store->free_space_size--;
+            }
+
+            store->free_space_dirty = 1;
+            return offset;
+        }
+    }
+    return 0; // 적절한 free space를 찾지 못함
+}
+// offset이 속한 shard의 free space 테이블에 구간을 더합니다. 호출자는 그 shard의 writer와 store_lock(쓰기)을 잡고 있어야 하고,
+// 테이블 저장은 persist_store_shard()에 맡깁니다 (인덱스 조각을 먼저 저장해야 하므로).
+void add_free_space(uint64_t offset, uint32_t length)
+{
+    StoreShard *store = &store_shards[STORE_OFFSET_SHARD(offset)];
+    if (STORE_OFFSET_SHARD(offset) >= STORE_SHARD_COUNT)
+    {
+        return; // 옮겨 가는 중인 예전 shard 파일의 공간은 회수하지 않음
+    }
+    if (store->reuse_disabled)
+    {
+        // compaction 중인 shard: 이 구간은 곧 옮겨 온 레코드로 덮일 수 있고, 끝나면 꼬리와 함께 회수됨
+        return;
+    }
+    if (store->free_space_size >= MAX_MESSAGES)
+    {
+        syslog(LOG_ERR, "Free space table is full");
+        return;
+    }
+
+    // 간단한 구현: 새로운 free space를 테이블 끝에 추가
+    store->free_space[store->free_space_size].offset = offset;
+    store->free_space[store->free_space_size].length = length;
+    store->free_space_size++;
+    store->free_space_dirty = 1;
+}
+typedef struct {
+    uint64_t offset;
+    uint32_t owner;
+    uint32_t pos; // index_table 내 위치
+} ForeignRecord;
+
+static int compare_foreign_record(const void *a, const void *b)
+{
+    const ForeignRecord *fa = a;
+    const ForeignRecord *fb = b;
+    if (fa->offset != fb->offset)
+        return fa->offset < fb->offset ? -1 : 1;
+    if (fa->owner != fb->owner)
+        return fa->owner < fb->owner ? -1 : 1;
+    return 0;
+}
+
+// 예전 단일 messages.bin이나 다른 shard 수로 빌드했을 때의 데이터 파일처럼, 맡은 shard가 아닌 파일에 있는 레코드를
+// 맡은 shard 파일 끝으로 복사하고 offset을 바꾼 뒤 인덱스를 저장합니다. 시작할 때 복구 단계에서 부릅니다.
+// 옛 슬롯은 그대로 두므로 인덱스를 저장하기 전에 죽어도 옛 인덱스가 온전한 레코드를 가리키고, 남은 옛 슬롯은 compaction이 회수합니다.
+// 여러 인덱스가 함께 쓰던 슬롯은 맡은 shard마다 한 번만 복사합니다. 옮긴 레코드 수를 반환합니다.
+// compaction은 맡지 않은 shard 파일의 레코드를 모르므로, 하나라도 옮기지 못하면 서버를 시작하지 않습니다.
+int relocate_foreign_records()
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < index_table_size; i++)
+    {
+        if (index_table[i].length > 0 && STORE_OFFSET_SHARD(index_table[i].offset) != STORE_SHARD_OF(i + 1))
+        {
+            count++;
+        }
+    }
+
+    uint32_t moved = 0;
+    int failed = 0;
+    if (count > 0)
+    {
+        ForeignRecord *records = malloc(sizeof(ForeignRecord) * count);
+        unsigned char *buffer = NULL;
+        uint32_t buffer_size = 0;
+        if (records == NULL)
+        {
+            syslog(LOG_ERR, "Memory allocation failed for record relocation");
+            exit(EXIT_FAILURE);
+        }
+        uint32_t n = 0;
+        for (uint32_t i = 0; i < index_table_size; i++)
+        {
+            if (index_table[i].length > 0 && STORE_OFFSET_SHARD(index_table[i].offset) != STORE_SHARD_OF(i + 1))
+            {
+                records[n].offset = index_table[i].offset;
+                records[n].owner = STORE_SHARD_OF(i + 1);
+                records[n].pos = i;
+                n++;
+            }
+        }
+        qsort(records, count, sizeof(ForeignRecord), compare_foreign_record);
+
+        uint64_t last_source = UINT64_MAX, last_target = 0;
+        uint32_t last_owner = 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            IndexEntry *entry = &index_table[records[i].pos];
+            if (records[i].offset == last_source && records[i].owner == last_owner)
+            {
+                entry->offset = last_target; // 바로 앞에서 같은 shard로 옮긴 공유 슬롯
+                continue;
+            }
+            if (entry->length > buffer_size)
+            {
+                unsigned char *grown = realloc(buffer, entry->length);
+                if (grown == NULL)
+                {
+                    failed = 1;
+                    break;
+                }
+                buffer = grown;
+                buffer_size = entry->length;
+            }
+            uint64_t target = STORE_OFFSET(records[i].owner, store_shards[records[i].owner].file_size);
+            if (!store_extent_valid(entry->offset, entry->length) ||
+                !read_message_data(entry->offset, buffer, entry->length) ||
+                !write_message_data(target, buffer, entry->length))
+            {
+                syslog(LOG_ERR, "Error relocating record %u to shard %u", entry->index, records[i].owner);
+                failed = 1;
+                continue;
+            }
+            last_source = entry->offset;
+            last_owner = records[i].owner;
+            last_target = target;
+            entry->offset = target;
+            moved++;
+        }
+        free(buffer);
+        free(records);
+
+        // 새 자리를 디스크에 남긴 뒤에 인덱스가 그 자리를 가리키게 함
+        for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+        {
+            fdatasync(store_shards[shard].fd);
+        }
+        save_index_table();
+        printf("Relocated %u records to their store shards\n", moved);
+        if (failed)
+        {
+            // 옮기지 못한 레코드가 남은 파일에 compaction이 다른 레코드를 덮어쓰지 않도록 여기서 멈춤 (옮긴 것은 저장됨)
+            syslog(LOG_ERR, "Record relocation failed; refusing to start with records outside their store shards");
+            fprintf(stderr, "Error relocating records to their store shards\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // 더 이상 어떤 엔트리도 가리키지 않는 예전 shard 파일을 지움
+    for (uint32_t shard = STORE_SHARD_COUNT; shard < STORE_SHARD_MAX; shard++)
+    {
+        if (store_shards[shard].fd >= 0)
+        {
+            char path[256];
+            snprintf(path, sizeof(path), STORE_SHARD_FILE, shard);
+            close(store_shards[shard].fd);
+            store_shards[shard].fd = -1;
+            unlink(path);
+            syslog(LOG_INFO, "Removed retired store shard file: %s", path);
+        }
+    }
+    return moved;
+}
+// 새로운 함수: 파일의 마지막 인덱스를 읽어오는 함수
+uint32_t get_last_index()
+{
+    FILE *file = fopen(MESSAGE_FILE, "rb");
+    if (file == NULL)
+    {
+        // 파일이 없으면 인덱스 0부터 시작
+        return 0;
+    }
+
+    uint32_t last_index = 0;
+    uint32_t current_index;
+    time_t timestamp;
+    uint32_t message_len;
+
+    // 파일의 끝까지 읽어가며 마지막 인덱스를 찾음
+    while (fread(&current_index, sizeof(uint32_t), 1, file) == 1)
+    {
+        last_index = current_index;
+
+        // 타임스탬프와 메시지 길이를 읽고 건너뜀
+        fread(&timestamp, sizeof(time_t), 1, file);
+        fread(&message_len, sizeof(uint32_t), 1, file);
+        fseek(file, message_len, SEEK_CUR);
+    }
+
+    fclose(file);
+    return last_index;
+}
+// 새로운 함수: 2의 거듭제곱 중 주어진 크기보다 크거나 같은 최소값을 반환
+uint32_t next_power_of_two(uint32_t v)
+{
+    v--;
+    v |= v >> 1;
+    v |= v >> 2;
+    v |= v >> 4;
+    v |= v >> 8;
+    v |= v >> 16;
+    v++;
+    return v < 16 ? 16 : v; // 최소 크기를 16으로 설정
+}
+// 새로운 함수: 약 1.25배씩 커지는 slab class 중 주어진 크기보다 크거나 같은 최소값을 반환
+// 2의 거듭제곱 대신 사용하면 레코드당 낭비가 최대 50%에서 25% 이하로 줄어듭니다.
+uint32_t slab_class_size(uint32_t v)
+{
+    uint64_t size = SLAB_MIN_SIZE;
+    while (size < v)
+    {
+        uint64_t next = (uint64_t)(size * SLAB_GROWTH_FACTOR);
+        next = (next + SLAB_ALIGNMENT - 1) & ~(uint64_t)(SLAB_ALIGNMENT - 1);
+        size = next > size ? next : size + SLAB_ALIGNMENT;
+    }
+    return size > UINT32_MAX ? UINT32_MAX : (uint32_t)size;
+}
+// 링크는 양쪽 엔트리를 함께 바꾸므로 두 엔트리의 조각을 모두 표시합니다 (다른 shard면 각 shard의 조각).
+static void mark_link_dirty(uint32_t source_index, uint32_t target_index)
+{
+    mark_index_dirty(source_index);
+    mark_index_dirty(target_index);
+}
+// 지워진 메시지를 가리키는 링크를 목록에서 빼고 앞으로 당깁니다. store_lock(쓰기)을 잡은 채 호출합니다.
+// 반대쪽 목록이 가득 차 한쪽에만 만든 링크는 대상을 지워도 남으므로, 링크를 더할 때마다 여기서 MAX_LINKS 자리를 되찾습니다.
+static void purge_dead_links(uint32_t *links, uint32_t *link_count)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < *link_count; i++)
+    {
+        uint32_t target = links[i];
+        if (target > 0 && target <= index_table_size && index_table[target - 1].length > 0)
+        {
+            links[count++] = target;
+        }
+    }
+    *link_count = count;
+}
+static int change_add_forward_link(uint32_t source_index, uint32_t target_index)
+{
+    pthread_rwlock_wrlock(&store_lock);
+
+    if (source_index == 0 || source_index > index_table_size ||
+        target_index == 0 || target_index > index_table_size)
+    {
+        pthread_rwlock_unlock(&store_lock);
+        return 0; // 유효하지 않은 인덱스
+    }
+
+    IndexEntry *source_entry = &index_table[source_index - 1];
+    IndexEntry *target_entry = &index_table[target_index - 1];
+
+    if (source_entry->length == 0 || target_entry->length == 0)
+    {
+        pthread_rwlock_unlock(&store_lock);
+        return 0; // 지워진 메시지
+    }
+
+    // 지워진 대상을 가리키던 자리를 먼저 비움. 링크를 더하면 두 엔트리를 저장할 때 함께 기록됨 (못 더해도 읽을 때 걸러지므로 무방)
+    purge_dead_links(source_entry->forward_links, &source_entry->forward_link_count);
+    purge_dead_links(target_entry->backward_links, &target_entry->backward_link_count);
+    if (source_entry->forward_link_count >= MAX_LINKS)
+    {
+        pthread_rwlock_unlock(&store_lock);
+        return 0; // 더 이상 링크를 추가할 수 없음
+    }
+
+    // 이미 존재하는 링크인지 확인
+    for (uint32_t i = 0; i < source_entry->forward_link_count; i++)
+    {
+        if (source_entry->forward_links[i] == target_index)
+        {
+            pthread_rwlock_unlock(&store_lock);
+            return 1; // 이미 존재하는 링크
+        }
+    }
+
+    // 새 순방향 링크 추가
+    source_entry->forward_links[source_entry->forward_link_count++] = target_index;
+
+    // 대상 메시지의 역방향 링크 추가
+    if (target_entry->backward_link_count < MAX_LINKS)
+    {
+        target_entry->backward_links[target_entry->backward_link_count++] = source_index;
+    }
+
+    subscription_on_link(source_index, target_index, 1);
+    replication_on_link(REPLICATION_ADD_FORWARD_LINK, source_index, target_index);
+    mark_link_dirty(source_index, target_index);
+    pthread_rwlock_unlock(&store_lock);
+    return 1; // 성공
+}
+
+static int change_add_backward_link(uint32_t source_index, uint32_t target_index)
+{
+    pthread_rwlock_wrlock(&store_lock);
+
+    if (source_index == 0 || source_index > index_table_size ||
+        target_index == 0 || target_index > index_table_size)
+    {
+        pthread_rwlock_unlock(&store_lock);
+        return 0; // 유효하지 않은 인덱스
+    }
+
+    IndexEntry *source_entry = &index_table[source_index - 1];
+    IndexEntry *target_entry = &index_table[target_index - 1];
+
+    if (source_entry->length == 0 || target_entry->length == 0)
+    {
+        pthread_rwlock_unlock(&store_lock);
+        return 0; // 지워진 메시지
+    }
+
+    purge_dead_links(source_entry->backward_links, &source_entry->backward_link_count);
+    purge_dead_links(target_entry->forward_links, &target_entry->forward_link_count);
+    if (source_entry->backward_link_count >= MAX_LINKS)
+    {
+        pthread_rwlock_unlock(&store_lock);
+        return 0; // 더 이상 링크를 추가할 수 없음
+    }
+
+    // 이미 존재하는 링크인지 확인
+    for (uint32_t i = 0; i < source_entry->backward_link_count; i++)
+    {
+        if (source_entry->backward_links[i] == target_index)
+        {
+            pthread_rwlock_unlock(&store_lock);
+            return 1; // 이미 존재하는 링크
+        }
+    }
+
+    // 새 역방향 링크 추가
+    source_entry->backward_links[source_entry->backward_link_count++] = target_index;
+
+    // 대상 메시지의 순방향 링크 추가
+    if (target_entry->forward_link_count < MAX_LINKS)
+    {
+        target_entry->forward_links[target_entry->forward_link_count++] = source_index;
+    }
+
+    subscription_on_link(target_index, source_index, 1); // 역방향 링크 source <- target은 target -> source 순방향 링크
+    replication_on_link(REPLICATION_ADD_BACKWARD_LINK, source_index, target_index);
+    mark_link_dirty(source_index, target_index);
+    pthread_rwlock_unlock(&store_lock);
+    return 1; // 성공
+}
+static int change_remove_forward_link(uint32_t source_index, uint32_t target_index)
+{
+    pthread_rwlock_wrlock(&store_lock);
+
+    if (source_index == 0 || source_index > index_table_size ||
+        target_index == 0 || target_index > index_table_size)
+    {
+        pthread_rwlock_unlock(&store_lock);
+        return 0; // 유효하지 않은 인덱스
+    }
+
+    IndexEntry *source_entry = &index_table[source_index - 1];
+    IndexEntry *target_entry = &index_table[target_index - 1];
+
+    int found = 0;
+
+    // 순방향 링크 제거
+    for (uint32_t i = 0; i < source_entry->forward_link_count; i++)
+    {
+        if (source_entry->forward_links[i] == target_index)
+        {
+            // 링크 제거 및 배열 정리
+            for (uint32_t j = i; j < source_entry->forward_link_count - 1; j++)
+            {
+                source_entry->forward_links[j] = source_entry->forward_links[j + 1];
+            }
+            source_entry->forward_link_count--;
+            found = 1;
+            break;
+        }
+    }
+
+    if (found)
+    {
+        // 대상 메시지의 역방향 링크 제거
+        for (uint32_t i = 0; i < target_entry->backward_link_count; i++)
+        {
+            if (target_entry->backward_links[i] == source_index)
+            {
+                for (uint32_t j = i; j < target_entry->backward_link_count - 1; j++)
+                {
+                    target_entry->backward_links[j] = target_entry->backward_links[j + 1];
+                }
+                target_entry->backward_link_count--;
+                break;
+            }
+        }
+        subscription_on_link(source_index, target_index, 0);
+        replication_on_link(REPLICATION_REMOVE_FORWARD_LINK, source_index, target_index);
+        mark_link_dirty(source_index, target_index);
+        pthread_rwlock_unlock(&store_lock);
+        return 1; // 성공
+    }
+
+    pthread_rwlock_unlock(&store_lock);
+    return 0; // 링크를 찾지 못함
+}
+
+static int change_remove_backward_link(uint32_t source_index, uint32_t target_index)
+{
+    pthread_rwlock_wrlock(&store_lock);
+
+    if (source_index == 0 || source_index > index_table_size ||
+        target_index == 0 || target_index > index_table_size)
+    {
+        pthread_rwlock_unlock(&store_lock);
+        return 0; // 유효하지 않은 인덱스
+    }
+
+    IndexEntry *source_entry = &index_table[source_index - 1];
+    IndexEntry *target_entry = &index_table[target_index - 1];
+
+    int found = 0;
+
+    // 역방향 링크 제거
+    for (uint32_t i = 0; i < source_entry->backward_link_count; i++)
+    {
+        if (source_entry->backward_links[i] == target_index)
+        {
+            // 링크 제거 및 배열 정리
+            for (uint32_t j = i; j < source_entry->backward_link_count - 1; j++)
+            {
+                source_entry->backward_links[j] = source_entry->backward_links[j + 1];
+            }
+            source_entry->backward_link_count--;
+            found = 1;
+            break;
+        }
+    }
+
+    if (found)
+    {
+        // 대상 메시지의 순방향 링크 제거
+        for (uint32_t i = 0; i < target_entry->forward_link_count; i++)
+        {
+            if (target_entry->forward_links[i] == source_index)
+            {
+                for (uint32_t j = i; j < target_entry->forward_link_count - 1; j++)
+                {
+                    target_entry->forward_links[j] = target_entry->forward_links[j + 1];
+                }
+                target_entry->forward_link_count--;
+                break;
+            }
+        }
+        subscription_on_link(target_index, source_index, 0);
+        replication_on_link(REPLICATION_REMOVE_BACKWARD_LINK, source_index, target_index);
+        mark_link_dirty(source_index, target_index);
+        pthread_rwlock_unlock(&store_lock);
+        return 1; // 성공
+    }
+
+    pthread_rwlock_unlock(&store_lock);
+    return 0; // 링크를 찾지 못함
+}
+// 링크를 바꾸는 쪽은 양쪽 엔트리의 shard writer를 번호 순으로 잡습니다 (같은 shard면 한 번).
+// change는 store_lock을 직접 잡고 풀며, 바뀐 조각은 store_lock을 푼 뒤 writer를 놓기 전에 저장합니다.
+static int change_links(uint32_t source_index, uint32_t target_index, int (*change)(uint32_t, uint32_t))
+{
+    if (source_index == 0 || source_index > MAX_MESSAGES || target_index == 0 || target_index > MAX_MESSAGES)
+    {
+        return 0; // 유효하지 않은 인덱스
+    }
+    uint32_t first = STORE_SHARD_OF(source_index);
+    uint32_t second = STORE_SHARD_OF(target_index);
+    if (first > second)
+    {
+        uint32_t shard = first;
+        first = second;
+        second = shard;
+    }
+    lock_store_shard(first);
+    if (second != first)
+    {
+        lock_store_shard(second);
+    }
+    int result = change(source_index, target_index);
+    persist_store_shard(first);
+    if (second != first)
+    {
+        persist_store_shard(second);
+        unlock_store_shard(second);
+    }
+    unlock_store_shard(first);
+    return result;
+}
+int add_forward_link(uint32_t source_index, uint32_t target_index)
+{
+    return change_links(source_index, target_index, change_add_forward_link);
+}
+int add_backward_link(uint32_t source_index, uint32_t target_index)
+{
+    return change_links(source_index, target_index, change_add_backward_link);
+}
+int remove_forward_link(uint32_t source_index, uint32_t target_index)
+{
+    return change_links(source_index, target_index, change_remove_forward_link);
+}
+int remove_backward_link(uint32_t source_index, uint32_t target_index)
+{
+    return change_links(source_index, target_index, change_remove_backward_link);
+}
+// 링크 배열에서 살아 있는 대상만 out에 복사합니다. store_lock을 잡은 채 호출합니다.
+// 대상의 반대 방향 목록이 가득 차 한쪽에만 남은 링크는 대상이 지워져도 남으므로 여기서 거름
+static uint32_t copy_live_links(const uint32_t *links, uint32_t link_count, uint32_t *out)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < link_count; i++)
+    {
+        uint32_t target = links[i];
+        if (target > 0 && target <= index_table_size && index_table[target - 1].length > 0)
+        {
+            out[count++] = target;
+        }
+    }
+    return count;
+}
+// 순방향(backward가 0) 또는 역방향 링크를 호출자의 배열에 복사합니다. links는 MAX_LINKS개를 담을 수 있어야 합니다.
+static uint32_t read_links(uint32_t index, int backward, uint32_t *links)
+{
+    pthread_rwlock_rdlock(&store_lock);
+    uint32_t count = 0;
+    if (index > 0 && index <= index_table_size)
+    {
+        const IndexEntry *entry = &index_table[index - 1];
+        count = backward ? copy_live_links(entry->backward_links, entry->backward_link_count, links)
+                         : copy_live_links(entry->forward_links, entry->forward_link_count, links);
+    }
+    pthread_rwlock_unlock(&store_lock);
+    return count;
+}
+uint32_t read_forward_links(uint32_t index, uint32_t *links)
+{
+    return read_links(index, 0, links);
+}
+uint32_t read_backward_links(uint32_t index, uint32_t *links)
+{
+    return read_links(index, 1, links);
+}
+// 링크 목록을 새로 잡은 배열로 반환합니다 (호출자가 free). 링크가 없거나 유효하지 않은 인덱스면 NULL입니다.
+static uint32_t *get_links(uint32_t index, int backward, uint32_t *count)
+{
+    *count = 0;
+    uint32_t buffer[MAX_LINKS];
+    uint32_t found = read_links(index, backward, buffer);
+    if (found == 0)
+    {
+        return NULL;
+    }
+    uint32_t *links = malloc(sizeof(uint32_t) * found);
+    if (links == NULL)
+    {
+        return NULL; // 메모리 할당 실패
+    }
+    memcpy(links, buffer, sizeof(uint32_t) * found);
+    *count = found;
+    return links;
+}
+uint32_t *get_forward_links(uint32_t index, uint32_t *count)
+{
+    return get_links(index, 0, count);
+}
+
+uint32_t *get_backward_links(uint32_t index, uint32_t *count)
+{
+    return get_links(index, 1, count);
+}
+
+// 같은 본문이 이미 들어 있는 슬롯을 찾아 내용을 직접 비교합니다. 공유할 수 있으면 슬롯 위치와 함께 1을 반환합니다.
+// 처음 공유되는 레코드는 헤더 인덱스를 RECORD_SHARED_INDEX로 바꿔 다시 씁니다 (본문과 타임스탬프는 그대로).
+// 슬롯은 writer를 잡은 shard 안에서만 공유합니다 (다른 shard의 슬롯은 그 shard의 writer 없이 바꾸거나 돌려줄 수 없음).
+static int share_existing_record(uint32_t shard, uint64_t hash, const char *message, uint32_t message_len, uint64_t *offset, uint32_t *slot_length)
+{
+    uint64_t candidate;
+    uint32_t length;
+    if (!dedup_find(hash, message_len, &candidate, &length) || STORE_OFFSET_SHARD(candidate) != shard)
+    {
+        return 0;
+    }
+    unsigned char *buffer = acquire_read_buffer(length);
+    char *text = malloc((size_t)message_len + 1);
+    if (buffer == NULL || text == NULL)
+    {
+        release_read_buffer(buffer, length);
+        free(text);
+        return 0;
+    }
+
+    RecordInfo info;
+    int same = read_message_data(candidate, buffer, length) &&
+               parse_record_header(buffer, length, &info) &&
+               !info.legacy &&
+               verify_record_checksum(buffer, &info) &&
+               resolve_text_length(buffer, &info) &&
+               info.text_length == message_len &&
+               copy_record_text(buffer, &info, text) &&
+               memcmp(text, message, message_len) == 0;
+    free(text);
+
+    int shared = same;
+    if (same && info.index != RECORD_SHARED_INDEX && STORE_OFFSET_LOCAL(candidate) < store_shards[shard].frozen_end)
+    {
+        shared = 0; // 스냅숏이 복사 중인 헤더는 바꾸지 않고 새 레코드로 씀
+    }
+    else if (same && info.index != RECORD_SHARED_INDEX)
+    {
+        shared = write_message_record(candidate, length, RECORD_SHARED_INDEX, (const char *)buffer + info.header_length,
+                                      info.message_length, info.timestamp, info.compressed);
+        if (!shared)
+        {
+            syslog(LOG_ERR, "Error marking shared record at offset %llu", (unsigned long long)candidate);
+        }
+        message_write_seq++; // 헤더를 바꾸는 도중에 읽었을 수 있는 dedup 해시 구축 스레드가 그 묶음을 다시 읽도록
+    }
+    release_read_buffer(buffer, length);
+    if (!same)
+    {
+        dedup_record_verify_failure();
+    }
+    if (!shared)
+    {
+        return 0;
+    }
+
+    dedup_add_reference(candidate);
+    *offset = candidate;
+    *slot_length = length;
+    return 1;
+}
+// 압축하면 더 작은 슬롯에 들어가는 메시지는 압축 본문을 *packed에 담아 그 길이를 반환합니다 (호출자가 해제).
+// 압축하지 않을 때는 0을 반환하고 *packed는 NULL입니다.
+static uint32_t pack_message(const char *message, uint32_t message_len, unsigned char **packed)
+{
+    *packed = NULL;
+    if (!COMPRESSION_ENABLED || message_len < COMPRESSION_DICT_MIN_LENGTH || (*packed = malloc(message_len)) == NULL)
+    {
+        return 0;
+    }
+    uint32_t packed_len = compress_record_body(message, message_len, *packed);
+    if (packed_len == 0)
+    {
+        free(*packed);
+        *packed = NULL;
+    }
+    return packed_len;
+}
+// 예약한 인덱스를 index_table에 올립니다. 앞 번호가 모두 올라가 있어야 하므로 append_turn()을 기다린 뒤 store_lock(쓰기) 아래에서 부릅니다.
+static void publish_entry(uint32_t index, uint64_t offset, uint32_t length, uint32_t version)
+{
+    IndexEntry *entry = &index_table[index - 1];
+    entry->index = index;
+    entry->offset = offset;
+    entry->length = length;
+    entry->version = version;
+    entry->expires_at = 0;
+    entry->forward_link_count = 0; // 새 메시지는 링크가 없음
+    entry->backward_link_count = 0;
+    memset(entry->forward_links, 0, sizeof(uint32_t) * MAX_LINKS);  // 링크 배열 초기화
+    memset(entry->backward_links, 0, sizeof(uint32_t) * MAX_LINKS); // 링크 배열 초기화
+    __atomic_store_n(&index_table_size, index, __ATOMIC_RELEASE); // get_message_version이 락 없이 읽음
+    mark_index_dirty(index);
+}
+// store_lock을 쓰기로 잡은 채 메시지를 예약한 인덱스에 추가합니다. 락은 호출자가 풉니다.
+// 쓰기에 실패해도 뒤 번호가 기다리지 않도록 tombstone을 올리고 (복제본도 같은 자리를 지움) 0을 반환합니다.
+static uint32_t append_message_locked(uint32_t index, const char *message, int64_t timestamp)
+{
+    uint32_t shard = STORE_SHARD_OF(index);
+    uint32_t message_len = strlen(message);
+    uint32_t allocated_len = 0;
+    int dedup = DEDUP_ENABLED && message_len >= DEDUP_MIN_LENGTH;
+    uint64_t hash = dedup ? xxhash64(message, message_len, 0) : 0;
+    uint64_t offset = 0;
+
+    if (!dedup || !share_existing_record(shard, hash, message, message_len, &offset, &allocated_len))
+    {
+        unsigned char *packed;
+        uint32_t packed_len = pack_message(message, message_len, &packed);
+        const char *body = packed != NULL ? (const char *)packed : message;
+        uint32_t body_len = packed != NULL ? packed_len : message_len;
+        uint32_t total_len = RECORD_HEADER_SIZE + body_len;
+        allocated_len = slab_class_size(total_len); // slab class 크기로 할당
+        offset = find_free_space(shard, allocated_len);
+        if (offset == 0)
+        {
+            offset = STORE_OFFSET(shard, store_shards[shard].file_size); // 파일 끝에 추가
+        }
+
+        int written = write_message_record(offset, allocated_len, index, body, body_len, timestamp, packed != NULL);
+        free(packed);
+        if (!written)
+        {
+            syslog(LOG_ERR, "Error writing to message file of shard %u", shard);
+            publish_entry(index, 0, 0, 0);
+            replication_on_append(index, "", 0, timestamp);
+            replication_on_delete(index);
+            return 0;
+        }
+        if (dedup)
+        {
+            dedup_insert(hash, offset, allocated_len, message_len);
+        }
+    }
+
+    record_cache_put(index, message, message_len); // 방금 추가된 메시지는 곧 다시 읽힘
+    text_index_on_append(index, message, message_len);
+    time_index_on_write(index, timestamp);
+    publish_entry(index, offset, allocated_len, 1);
+    subscription_on_append(index);
+    replication_on_append(index, message, message_len, timestamp);
+
+    syslog(LOG_INFO, "Message appended to shard %u (Index: %u, Allocated Length: %u)", shard, index, allocated_len);
+    return index;
+}
+// 다음 인덱스를 예약하고 그 shard의 writer를 잡습니다. expected가 0이 아니면 그 번호일 때만 예약합니다 (복제본).
+// 같은 shard의 append가 번호 순서대로 writer를 잡도록 예약과 writer 획득을 append_lock 아래에서 함께 합니다.
+// 가득 찼거나 번호가 맞지 않으면 0을 반환합니다.
+static uint32_t reserve_append_index(uint32_t expected)
+{
+    pthread_mutex_lock(&append_lock);
+    uint32_t size = __atomic_load_n(&index_table_size, __ATOMIC_ACQUIRE);
+    if (append_reserved < size)
+    {
+        append_reserved = size; // 시작할 때 복구가 올린 엔트리
+    }
+    if (append_reserved >= MAX_MESSAGES || (expected != 0 && expected != append_reserved + 1))
+    {
+        pthread_mutex_unlock(&append_lock);
+        if (expected == 0)
+        {
+            syslog(LOG_ERR, "Error: Maximum number of messages reached");
+        }
+        return 0;
+    }
+    uint32_t index = ++append_reserved;
+    lock_store_shard(STORE_SHARD_OF(index));
+    pthread_mutex_unlock(&append_lock);
+    return index;
+}
+// 예약한 인덱스 바로 앞 번호까지 index_table에 올라갈 때까지 기다립니다. 앞 번호는 다른 shard의 writer를 잡고 있으므로
+// 그 append는 store_lock만 얻으면 끝납니다.
+static void wait_append_turn(uint32_t index)
+{
+    pthread_mutex_lock(&publish_lock);
+    while (__atomic_load_n(&index_table_size, __ATOMIC_ACQUIRE) != index - 1)
+    {
+        pthread_cond_wait(&publish_cond, &publish_lock);
+    }
+    pthread_mutex_unlock(&publish_lock);
+}
+// 예약한 인덱스에 메시지를 씁니다. 데이터 쓰기와 테이블 반영은 store_lock 아래에서 번호 순서대로 하고,
+// 인덱스 조각과 free space 저장(fsync)은 store_lock을 푼 뒤 이 shard의 writer만 잡고 하므로 다른 shard의 append와 겹칩니다.
+static uint32_t append_reserved_message(uint32_t index, const char *message, int64_t timestamp)
+{
+    uint32_t shard = STORE_SHARD_OF(index);
+    wait_append_turn(index);
+    pthread_rwlock_wrlock(&store_lock);
+    uint32_t result = append_message_locked(index, message, timestamp);
+    pthread_rwlock_unlock(&store_lock);
+
+    pthread_mutex_lock(&publish_lock);
+    pthread_cond_broadcast(&publish_cond);
+    pthread_mutex_unlock(&publish_lock);
+
+    persist_store_shard(shard);
+    unlock_store_shard(shard);
+    return result;
+}
+// append_message_to_file 함수 수정
+uint32_t append_message_to_file(const char *message)
+{
+    uint32_t index = reserve_append_index(0);
+    if (index == 0)
+    {
+        return 0;
+    }
+    return append_reserved_message(index, message, time(NULL));
+}
+// store_lock을 잡은 상태에서 메시지 본문을 읽어 옵니다 (캐시 우선). 읽지 못하면 NULL, 호출자가 해제합니다.
+char *read_message_text_locked(uint32_t index)
+{
+    char *text = record_cache_get(index);
+    if (text != NULL)
+    {
+        return text;
+    }
+
+    uint32_t length = index_table[index - 1].length;
+    if (length == 0)
+    {
+        return NULL; // 지워진 메시지
+    }
+    unsigned char *buffer = acquire_read_buffer(length);
+    if (buffer == NULL)
+    {
+        return NULL;
+    }
+    if (read_message_data(index_table[index - 1].offset, buffer, length))
+    {
+        text = decode_record_text(buffer, length, index, NULL);
+    }
+    release_read_buffer(buffer, length);
+    return text;
+}
+// store_lock을 쓰기로 잡은 채 메시지를 바꾸고 버전을 올립니다. 락은 호출자가 풉니다.
+static int modify_message_locked(uint32_t target_index, const char *new_message, int64_t timestamp)
+{
+    if (target_index == 0 || target_index > index_table_size || index_table[target_index - 1].length == 0)
+    {
+        return 0;
+    }
+
+    uint32_t new_message_len = strlen(new_message);
+    unsigned char *packed;
+    uint32_t packed_len = pack_message(new_message, new_message_len, &packed);
+    const char *body = packed != NULL ? (const char *)packed : new_message;
+    uint32_t body_len = packed != NULL ? packed_len : new_message_len;
+    uint32_t new_total_len = RECORD_HEADER_SIZE + body_len;
+    uint32_t new_allocated_len = slab_class_size(new_total_len);
+    // 검색 인덱스에서 옛 단어를 빼려면 덮어쓰기 전의 본문이 필요
+    char *old_message = TEXT_INDEX_ENABLED ? read_message_text_locked(target_index) : NULL;
+
+    uint32_t shard = STORE_SHARD_OF(target_index);
+    uint64_t old_offset = index_table[target_index - 1].offset;
+    uint32_t old_length = index_table[target_index - 1].length;
+    // 다른 인덱스와 함께 쓰는 슬롯이나 스냅숏이 복사 중인 슬롯은 덮어쓰지 않고 새 슬롯에 씀 (copy-on-write)
+    int copy_on_write = dedup_refcount(old_offset) > 1 || STORE_OFFSET_SHARD(old_offset) != shard ||
+                        STORE_OFFSET_LOCAL(old_offset) < store_shards[shard].frozen_end;
+
+    if (!copy_on_write && new_allocated_len <= old_length)
+    {
+        // 새 메시지가 기존 공간에 맞는 경우
+        dedup_release(old_offset); // 본문이 바뀌므로 옛 해시를 버림
+        if (!write_message_record(index_table[target_index - 1].offset, index_table[target_index - 1].length, target_index, body, body_len, timestamp, packed != NULL))
+        {
+            syslog(LOG_ERR, "Error writing modified message to shard %u", shard);
+            record_cache_invalidate(target_index);
+            free(old_message);
+            free(packed);
+            return 0;
+        }
+    }
+    else
+    {
+        // 새 메시지가 기존 공간보다 큰 경우
+        uint64_t new_offset = find_free_space(shard, new_allocated_len);
+        if (new_offset == 0)
+        {
+            new_offset = STORE_OFFSET(shard, store_shards[shard].file_size);
+        }
+
+        if (!write_message_record(new_offset, new_allocated_len, target_index, body, body_len, timestamp, packed != NULL))
+        {
+            syslog(LOG_ERR, "Error writing modified message to shard %u", shard);
+            record_cache_invalidate(target_index);
+            free(old_message);
+            free(packed);
+            return 0;
+        }
+
+        // 기존 공간을 free space로 추가 (다른 인덱스가 아직 쓰고 있으면 참조만 줄임)
+        if (dedup_release(old_offset))
+        {
+            add_free_space(old_offset, old_length);
+        }
+
+        // 인덱스 테이블 업데이트
+        index_table[target_index - 1].offset = new_offset;
+        index_table[target_index - 1].length = new_allocated_len;
+    }
+
+    free(packed);
+    message_write_seq++;
+    if (DEDUP_ENABLED && new_message_len >= DEDUP_MIN_LENGTH)
+    {
+        dedup_insert(xxhash64(new_message, new_message_len, 0), index_table[target_index - 1].offset,
+                     index_table[target_index - 1].length, new_message_len);
+    }
+    record_cache_put(target_index, new_message, new_message_len); // write-through
+    text_index_on_modify(target_index, old_message, new_message);
+    time_index_on_write(target_index, timestamp);
+    subscription_on_modify(target_index);
+    free(old_message);
+    // 버전은 락 없이 읽히므로 원자적으로 올림 (get_message_version 참고)
+    __atomic_store_n(&index_table[target_index - 1].version, index_table[target_index - 1].version + 1, __ATOMIC_RELEASE);
+    replication_on_modify(target_index, index_table[target_index - 1].version, new_message, new_message_len, timestamp);
+    mark_index_dirty(target_index);
+    return 1; // 수정 성공
+}
+// modify_message_by_index 함수 수정
+int modify_message_by_index(uint32_t target_index, const char *new_message)
+{
+    if (target_index == 0 || target_index > MAX_MESSAGES)
+    {
+        return 0;
+    }
+    uint32_t shard = STORE_SHARD_OF(target_index);
+    lock_store_shard(shard);
+    pthread_rwlock_wrlock(&store_lock);
+    int result = modify_message_locked(target_index, new_message, time(NULL));
+    pthread_rwlock_unlock(&store_lock);
+    persist_store_shard(shard);
+    unlock_store_shard(shard);
+    return result;
+}
+// 메시지 버전이 expected_version일 때만 바꿉니다 (compare-and-set). 성공하면 1, 다른 수정이 먼저 들어갔으면 -1,
+// 인덱스가 없거나 쓰기에 실패하면 0을 반환합니다. current_version에는 호출이 끝난 시점의 버전을 돌려줍니다.
+// 버전이 이미 다르면 쓰기 락을 기다리지 않고 바로 실패하므로, 충돌하는 편집이 다른 쓰기 뒤에 줄을 서지 않습니다.
+int modify_message_if_version(uint32_t target_index, uint32_t expected_version, const char *new_message, uint32_t *current_version)
+{
+    uint32_t version = get_message_version(target_index);
+    *current_version = version;
+    if (version == 0)
+    {
+        return 0;
+    }
+    if (version != expected_version)
+    {
+        return -1;
+    }
+
+    uint32_t shard = STORE_SHARD_OF(target_index);
+    lock_store_shard(shard);
+    pthread_rwlock_wrlock(&store_lock);
+    // 락을 기다리는 동안 다른 수정이 먼저 끝났을 수 있으므로 락 아래에서 다시 확인
+    version = index_table[target_index - 1].version;
+    int result = version == expected_version ? modify_message_locked(target_index, new_message, time(NULL)) : -1;
+    *current_version = index_table[target_index - 1].version;
+    pthread_rwlock_unlock(&store_lock);
+    persist_store_shard(shard);
+    unlock_store_shard(shard);
+    return result;
+}
+// 메시지의 현재 버전을 store_lock 없이 읽습니다. 없는 인덱스면 0을 반환합니다.
+// index_table은 MAX_MESSAGES 크기로 한 번 할당되어 옮겨지지 않고, append는 엔트리를 채운 뒤 release로
+// index_table_size를 늘리므로 여기서 보이는 엔트리는 항상 초기화되어 있습니다. 읽는 쪽은 쓰기를 막지 않습니다.
+uint32_t get_message_version(uint32_t index)
+{
+    uint32_t size = __atomic_load_n(&index_table_size, __ATOMIC_ACQUIRE);
+    if (index == 0 || index > size)
+    {
+        return 0;
+    }
+    return __atomic_load_n(&index_table[index - 1].version, __ATOMIC_ACQUIRE);
+}
+// 메시지에 TTL을 겁니다. ttl_seconds가 지나면 expiry 스레드가 메시지를 지웁니다. 0이면 TTL을 없앱니다.
+// 없는 인덱스거나 이미 지워진 메시지면 0을 반환합니다.
+int set_message_ttl(uint32_t index, uint32_t ttl_seconds)
+{
+    if (index == 0 || index > MAX_MESSAGES)
+    {
+        return 0;
+    }
+    uint32_t shard = STORE_SHARD_OF(index);
+    lock_store_shard(shard);
+    pthread_rwlock_wrlock(&store_lock);
+    if (index > index_table_size || index_table[index - 1].length == 0)
+    {
+        pthread_rwlock_unlock(&store_lock);
+        unlock_store_shard(shard);
+        return 0;
+    }
+    int64_t expires_at = ttl_seconds > 0 ? (int64_t)time(NULL) + ttl_seconds : 0;
+    index_table[index - 1].expires_at = expires_at;
+    if (expires_at != 0)
+    {
+        expiry_on_set(index, expires_at);
+    }
+    mark_index_dirty(index);
+    pthread_rwlock_unlock(&store_lock);
+    persist_store_shard(shard);
+    unlock_store_shard(shard);
+    return 1;
+}
+// links 배열에서 value 하나를 빼고 뒤를 당깁니다. 없으면 0을 반환합니다.
+static int remove_link_value(uint32_t *links, uint32_t *count, uint32_t value)
+{
+    for (uint32_t i = 0; i < *count; i++)
+    {
+        if (links[i] == value)
+        {
+            memmove(&links[i], &links[i + 1], sizeof(uint32_t) * (*count - i - 1));
+            (*count)--;
+            return 1;
+        }
+    }
+    return 0;
+}
+// 모든 shard writer와 store_lock(쓰기)을 잡은 채 메시지 하나를 지웁니다. 테이블 저장은 finish_delete_batch()에 모아 둡니다.
+// 엔트리는 tombstone으로 남기고 (length 0, 버전 0), 이웃의 링크는 이 메시지의 반대 방향 목록을 따라가
+// 그 엔트리들에서만 지우므로 테이블을 훑지 않습니다. 슬롯은 다른 인덱스가 공유하지 않으면 free space로 돌려줍니다.
+// 없는 인덱스거나 이미 지워졌으면 0을 반환합니다.
+int delete_message_locked(uint32_t index, DeleteBatch *batch)
+{
+    if (index == 0 || index > index_table_size || index_table[index - 1].length == 0)
+    {
+        return 0;
+    }
+    IndexEntry *entry = &index_table[index - 1];
+    // 검색 인덱스에서 단어를 빼려면 지우기 전의 본문이 필요
+    char *old_message = TEXT_INDEX_ENABLED ? read_message_text_locked(index) : NULL;
+
+    // index -> target 순방향 링크: target의 역방향 목록에서 index를 지움
+    for (uint32_t i = 0; i < entry->forward_link_count; i++)
+    {
+        uint32_t target = entry->forward_links[i];
+        if (target == 0 || target > index_table_size || target == index)
+        {
+            continue;
+        }
+        IndexEntry *neighbor = &index_table[target - 1];
+        if (remove_link_value(neighbor->backward_links, &neighbor->backward_link_count, index))
+        {
+            mark_index_dirty(target);
+            batch->links_removed++;
+        }
+        subscription_on_link(index, target, 0);
+    }
+    // source -> index 순방향 링크: source의 순방향 목록에서 index를 지움
+    for (uint32_t i = 0; i < entry->backward_link_count; i++)
+    {
+        uint32_t source = entry->backward_links[i];
+        if (source == 0 || source > index_table_size || source == index)
+        {
+            continue;
+        }
+        IndexEntry *neighbor = &index_table[source - 1];
+        if (remove_link_value(neighbor->forward_links, &neighbor->forward_link_count, index))
+        {
+            mark_index_dirty(source);
+            batch->links_removed++;
+        }
+        subscription_on_link(source, index, 0);
+    }
+
+    // 다른 인덱스가 아직 쓰고 있는 공유 슬롯은 참조만 줄임
+    if (dedup_release(entry->offset))
+    {
+        add_free_space(entry->offset, entry->length);
+    }
+    record_cache_invalidate(index);
+    text_index_on_delete(index, old_message);
+    time_index_on_delete(index);
+    free(old_message);
+
+    entry->length = 0;
+    entry->offset = 0;
+    entry->expires_at = 0;
+    entry->forward_link_count = 0;
+    entry->backward_link_count = 0;
+    // 버전 0은 get_message_version()에서 없는 메시지와 같음
+    __atomic_store_n(&entry->version, 0, __ATOMIC_RELEASE);
+    message_write_seq++;
+    subscription_on_delete(index);
+    replication_on_delete(index);
+
+    mark_index_dirty(index);
+    batch->deleted++;
+    return 1;
+}
+// delete_message_locked()로 바꾼 인덱스 조각과 free space 테이블을 shard마다 한 번씩만 저장합니다.
+// store_lock을 푼 뒤, 모든 shard writer를 놓기 전에 호출합니다.
+void finish_delete_batch(DeleteBatch *batch)
+{
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        persist_store_shard(shard);
+    }
+    if (batch->deleted > 0)
+    {
+        printf("Deleted %u messages (%u links removed)\n", batch->deleted, batch->links_removed);
+    }
+}
+// 메시지 하나를 지웁니다. 이웃의 링크가 어느 shard에 있을지 모르므로 모든 writer를 잡습니다.
+// 없는 인덱스거나 이미 지워졌으면 0을 반환합니다.
+int delete_message(uint32_t index)
+{
+    DeleteBatch batch = {0};
+    lock_all_store_shards();
+    pthread_rwlock_wrlock(&store_lock);
+    int result = delete_message_locked(index, &batch);
+    pthread_rwlock_unlock(&store_lock);
+    finish_delete_batch(&batch);
+    unlock_all_store_shards();
+    return result;
+}
+// 복제본이 주 서버의 메시지를 index 자리에 그대로 씁니다. index가 다음 인덱스면 추가하고, 이미 있으면 바꿉니다.
+// 버전과 타임스탬프는 주 서버의 값을 따릅니다. 건너뛴 인덱스가 있어 쓸 수 없으면 0을 반환합니다.
+int apply_replicated_message(uint32_t index, uint32_t version, const char *message, int64_t timestamp)
+{
+    if (index == 0 || index > MAX_MESSAGES)
+    {
+        return 0;
+    }
+    uint32_t size = __atomic_load_n(&index_table_size, __ATOMIC_ACQUIRE);
+    if (version == 0)
+    {
+        // 주 서버에서 지워진 메시지 (전체 동기화의 tombstone): 인덱스 자리를 맞춘 뒤 지움
+        if (index == size + 1 && (reserve_append_index(index) == 0 || append_reserved_message(index, "", timestamp) != index))
+        {
+            return 0;
+        }
+        if (index > size + 1)
+        {
+            return 0;
+        }
+        delete_message(index);
+        return 1;
+    }
+    if (index == size + 1)
+    {
+        if (reserve_append_index(index) == 0 || append_reserved_message(index, message, timestamp) != index)
+        {
+            return 0;
+        }
+        if (version == 1)
+        {
+            return 1;
+        }
+        // 주 서버에서 수정된 적이 있는 메시지: 새로 붙이면 버전이 1이므로 아래에서 버전만 맞춤
+    }
+    else if (index > size)
+    {
+        return 0;
+    }
+
+    uint32_t shard = STORE_SHARD_OF(index);
+    lock_store_shard(shard);
+    pthread_rwlock_wrlock(&store_lock);
+    if (index_table[index - 1].length == 0)
+    {
+        // 이미 지워진 메시지: 인덱스는 다시 쓰지 않으므로 주 서버에서도 지워졌고, 동기화 뒤 로그를 이어 받을 때
+        // 지우기 전의 modify가 다시 오는 경우임. 뒤따르는 delete와 결과가 같으므로 건너뜀
+        pthread_rwlock_unlock(&store_lock);
+        unlock_store_shard(shard);
+        return 1;
+    }
+    // 다시 동기화할 때 대부분의 메시지는 그대로이므로 같은 본문이면 다시 쓰지 않음
+    char *current = read_message_text_locked(index);
+    int result = current != NULL && strcmp(current, message) == 0;
+    free(current);
+    if (!result)
+    {
+        result = modify_message_locked(index, message, timestamp);
+    }
+    // 같은 이력을 따라왔다면 modify가 올린 버전이 이미 주 서버와 같음
+    if (result && index_table[index - 1].version != version)
+    {
+        __atomic_store_n(&index_table[index - 1].version, version, __ATOMIC_RELEASE);
+        mark_index_dirty(index);
+    }
+    pthread_rwlock_unlock(&store_lock);
+    persist_store_shard(shard);
+    unlock_store_shard(shard);
+    return result;
+}
+// 복제본의 링크 목록을 주 서버의 목록으로 통째로 바꿉니다 (전체 동기화). 없는 인덱스면 0을 반환합니다.
+int apply_replicated_links(uint32_t index, const uint32_t *forward, uint32_t forward_count, const uint32_t *backward, uint32_t backward_count)
+{
+    if (forward_count > MAX_LINKS || backward_count > MAX_LINKS || index == 0 || index > MAX_MESSAGES)
+    {
+        return 0;
+    }
+    uint32_t shard = STORE_SHARD_OF(index);
+    lock_store_shard(shard);
+    pthread_rwlock_wrlock(&store_lock);
+    if (index > index_table_size)
+    {
+        pthread_rwlock_unlock(&store_lock);
+        unlock_store_shard(shard);
+        return 0;
+    }
+    IndexEntry *entry = &index_table[index - 1];
+    int changed = entry->forward_link_count != forward_count || entry->backward_link_count != backward_count ||
+                  memcmp(entry->forward_links, forward, sizeof(uint32_t) * forward_count) != 0 ||
+                  memcmp(entry->backward_links, backward, sizeof(uint32_t) * backward_count) != 0;
+    if (changed)
+    {
+        memcpy(entry->forward_links, forward, sizeof(uint32_t) * forward_count);
+        memcpy(entry->backward_links, backward, sizeof(uint32_t) * backward_count);
+        entry->forward_link_count = forward_count;
+        entry->backward_link_count = backward_count;
+        mark_index_dirty(index);
+    }
+    pthread_rwlock_unlock(&store_lock);
+    persist_store_shard(shard);
+    unlock_store_shard(shard);
+    return 1;
+}
+// 고정 크기 버퍼에 JSON 조각을 모았다가 가득 차면 writer로 내보냅니다.
+typedef struct {
+    char buffer[TABLE_STREAM_BUFFER_SIZE];
+    size_t used;
+    StreamChunkWriter writer;
+    void *context;
+    int failed;
+} TableStream;
+
+static void table_stream_flush(TableStream *stream, int final)
+{
+    if (!stream->failed && !stream->writer(stream->context, stream->buffer, stream->used, final))
+    {
+        stream->failed = 1;
+    }
+    stream->used = 0;
+}
+
+// 조각 하나를 버퍼에 붙입니다. 남은 공간이 모자라면 먼저 flush하고, flush가 필요했으면 1을 반환합니다.
+static int table_stream_append(TableStream *stream, const char *data, size_t length)
+{
+    int flushed = 0;
+    if (stream->used + length > sizeof(stream->buffer))
+    {
+        table_stream_flush(stream, 0);
+        flushed = 1;
+    }
+    memcpy(stream->buffer + stream->used, data, length);
+    stream->used += length;
+    return flushed;
+}
+
+// "index,offset,links" 같은 필드 목록을 INDEX_FIELD_* 비트로 바꿉니다. NULL이나 빈 문자열이면 모든 필드입니다.
+int parse_index_fields(const char *fields)
+{
+    if (fields == NULL || fields[0] == '\0')
+    {
+        return INDEX_FIELD_ALL;
+    }
+
+    int mask = 0;
+    const char *p = fields;
+    while (*p != '\0')
+    {
+        size_t length = strcspn(p, ",");
+        if (length == 5 && strncmp(p, "index", 5) == 0)
+            mask |= INDEX_FIELD_INDEX;
+        else if (length == 6 && strncmp(p, "offset", 6) == 0)
+            mask |= INDEX_FIELD_OFFSET;
+        else if (length == 6 && strncmp(p, "length", 6) == 0)
+            mask |= INDEX_FIELD_LENGTH;
+        else if (length == 13 && strncmp(p, "forward_links", 13) == 0)
+            mask |= INDEX_FIELD_FORWARD;
+        else if (length == 14 && strncmp(p, "backward_links", 14) == 0)
+            mask |= INDEX_FIELD_BACKWARD;
+        else if (length == 5 && strncmp(p, "links", 5) == 0)
+            mask |= INDEX_FIELD_FORWARD | INDEX_FIELD_BACKWARD;
+        p += length;
+        if (*p == ',')
+        {
+            p++;
+        }
+    }
+    return mask != 0 ? mask : INDEX_FIELD_ALL;
+}
+
+static size_t format_link_array(char *out, const char *name, const uint32_t *links, uint32_t count, int first)
+{
+    size_t n = sprintf(out, "%s\"%s\":[", first ? "" : ",", name);
+    for (uint32_t j = 0; j < count; j++)
+    {
+        n += sprintf(out + n, "%s%u", j == 0 ? "" : ",", links[j]);
+    }
+    out[n++] = ']';
+    return n;
+}
+
+// 인덱스 테이블을 JSON으로 스트리밍합니다. [start, start + limit) 구간의 엔트리를 fields에 든 필드만 담아 보냅니다.
+// json-c 객체를 만들지 않고 고정 크기 버퍼에 직접 쓰며, 버퍼가 찰 때마다 read lock을 풀고 writer로 내보내므로
+// 느린 클라이언트가 수정 요청을 막지 않습니다 (따라서 여러 조각에 걸친 결과는 한 시점의 스냅샷이 아닙니다).
+// paginated면 다음 페이지의 시작 위치(next)와 전체 수(total)를 함께 보냅니다. 전송에 성공하면 1을 반환합니다.
+int stream_index_table_info(uint32_t start, uint32_t limit, int fields, int paginated, StreamChunkWriter writer, void *context)
 {
-    if (index_table_size >= MAX_MESSAGES)
+    TableStream *stream = malloc(sizeof(TableStream));
+    if (stream == NULL)
     {
-        syslog(LOG_ERR, "Error: Maximum number of messages reached");
+        syslog(LOG_ERR, "Memory allocation failed for table stream");
         return 0;
     }
-
-    uint32_t message_len = strlen(message);
-    uint32_t total_len = sizeof(time_t) + sizeof(uint32_t) + message_len;
-    uint32_t allocated_len = next_power_of_two(total_len); // 2의 거듭제곱 크기로 할당
-    uint64_t offset = find_free_space(allocated_len);
-
-    FILE *file;
-    if (offset == 0)
+    stream->used = 0;
+    stream->writer = writer;
+    stream->context = context;
+    stream->failed = 0;
+
+    char entry_json[96 + 2 * MAX_LINKS * 12 + 64];
+    size_t n = sprintf(entry_json, "{\"action\":\"index_table_info\",\"data\":[");
+    table_stream_append(stream, entry_json, n);
+
+    uint32_t position = start;
+    uint32_t end = UINT32_MAX;
+    pthread_rwlock_rdlock(&store_lock);
+    if (limit < UINT32_MAX - start)
     {
-        file = fopen(MESSAGE_FILE, "ab");
-        if (file == NULL)
-        {
-            syslog(LOG_ERR, "Error opening message file for appending: %s", MESSAGE_FILE);
-            return 0;
-        }
-        fseek(file, 0, SEEK_END);
-        offset = ftell(file);
+        end = start + limit;
     }
-    else
+    while (position < index_table_size && position < end && !stream->failed)
     {
-        file = fopen(MESSAGE_FILE, "r+b");
-        if (file == NULL)
+        const IndexEntry *entry = &index_table[position];
+        int first = 1;
+        n = 0;
+        if (position != start)
         {
-            syslog(LOG_ERR, "Error opening message file for writing: %s", MESSAGE_FILE);
-            return 0;
+            entry_json[n++] = ',';
         }
-        fseek(file, offset, SEEK_SET);
-    }
-
-    uint32_t index = index_table_size + 1;
-    time_t now = time(NULL);
-
-    fwrite(&now, sizeof(time_t), 1, file);
-    fwrite(&message_len, sizeof(uint32_t), 1, file);
-    fwrite(message, 1, message_len, file);
+        entry_json[n++] = '{';
+        if (fields & INDEX_FIELD_INDEX)
+        {
+            n += sprintf(entry_json + n, "\"index\":%u", entry->index);
+            first = 0;
+        }
+        if (fields & INDEX_FIELD_OFFSET)
+        {
+            n += sprintf(entry_json + n, "%s\"shard\":%u,\"offset\":%llu", first ? "" : ",", STORE_OFFSET_SHARD(entry->offset),
+                         (unsigned long long)STORE_OFFSET_LOCAL(entry->offset));
+            first = 0;
+        }
+        if (fields & INDEX_FIELD_LENGTH)
+        {
+            n += sprintf(entry_json + n, "%s\"length\":%u", first ? "" : ",", entry->length);
+            first = 0;
+        }
+        if (fields & INDEX_FIELD_FORWARD)
+        {
+            n += format_link_array(entry_json + n, "forward_links", entry->forward_links, entry->forward_link_count, first);
+            first = 0;
+        }
+        if (fields & INDEX_FIELD_BACKWARD)
+        {
+            n += format_link_array(entry_json + n, "backward_links", entry->backward_links, entry->backward_link_count, first);
+        }
+        entry_json[n++] = '}';
+        position++;
 
-    // 남은 공간을 0으로 채움
-    uint32_t padding = allocated_len - total_len;
-    char *zero_pad = calloc(padding, 1);
-    fwrite(zero_pad, 1, padding, file);
-    free(zero_pad);
+        // 버퍼를 내보낼 때는 lock을 풀어 둡니다. 그 사이 index_table_size가 달라질 수 있으므로 다시 확인합니다.
+        if (stream->used + n > sizeof(stream->buffer))
+        {
+            pthread_rwlock_unlock(&store_lock);
+            table_stream_append(stream, entry_json, n);
+            pthread_rwlock_rdlock(&store_lock);
+        }
+        else
+        {
+            table_stream_append(stream, entry_json, n);
+        }
+    }
+    uint32_t total = index_table_size;
+    pthread_rwlock_unlock(&store_lock);
 
-    if (ferror(file))
+    if (paginated)
     {
-        syslog(LOG_ERR, "Error writing to message file: %s", MESSAGE_FILE);
-        fclose(file);
-        return 0;
+        if (position < total)
+            n = sprintf(entry_json, "],\"start\":%u,\"next\":%u,\"total\":%u}", start, position, total);
+        else
+            n = sprintf(entry_json, "],\"start\":%u,\"next\":null,\"total\":%u}", start, total);
     }
+    else
+    {
+        n = sprintf(entry_json, "]}");
+    }
+    table_stream_append(stream, entry_json, n);
+    table_stream_flush(stream, 1);
 
-    fclose(file);
-
-    index_table[index_table_size].index = index;
-    index_table[index_table_size].offset = offset;
-    index_table[index_table_size].length = allocated_len;
-    index_table[index_table_size].forward_link_count = 0; // 새 메시지는 링크가 없음
-    index_table[index_table_size].backward_link_count = 0;
-    memset(index_table[index_table_size].forward_links, 0, sizeof(uint32_t) * MAX_LINKS);  // 링크 배열 초기화
-    memset(index_table[index_table_size].backward_links, 0, sizeof(uint32_t) * MAX_LINKS); // 링크 배열 초기화
-    index_table_size++;
-
-    save_index_table();
-
-    syslog(LOG_INFO, "Message appended to file: %s (Index: %u, Allocated Length: %u)", MESSAGE_FILE, index, allocated_len);
-    return index;
+    int ok = !stream->failed;
+    free(stream);
+    return ok;
 }
-// modify_message_by_index 함수 수정
-int modify_message_by_index(uint32_t target_index, const char *new_message)
+
+// Free space 테이블을 JSON으로 스트리밍합니다. stream_index_table_info()와 같은 방식입니다.
+int stream_free_space_table_info(uint32_t start, uint32_t limit, int paginated, StreamChunkWriter writer, void *context)
 {
-    if (target_index == 0 || target_index > index_table_size)
+    TableStream *stream = malloc(sizeof(TableStream));
+    if (stream == NULL)
     {
+        syslog(LOG_ERR, "Memory allocation failed for table stream");
         return 0;
     }
-
-    uint32_t new_message_len = strlen(new_message);
-    uint32_t new_total_len = sizeof(time_t) + sizeof(uint32_t) + new_message_len;
-    uint32_t new_allocated_len = next_power_of_two(new_total_len);
-
-    if (new_allocated_len <= index_table[target_index - 1].length)
+    stream->used = 0;
+    stream->writer = writer;
+    stream->context = context;
+    stream->failed = 0;
+
+    char entry_json[128];
+    size_t n = sprintf(entry_json, "{\"action\":\"free_space_table_info\",\"data\":[");
+    table_stream_append(stream, entry_json, n);
+
+    uint32_t position = start;
+    uint32_t end = limit < UINT32_MAX - start ? start + limit : UINT32_MAX;
+    // shard의 테이블을 shard 순서대로 이어 붙인 위치로 페이지를 나눔
+    pthread_rwlock_rdlock(&store_lock);
+    uint32_t shard = 0, base = 0;
+    while (position < end && !stream->failed)
     {
-        // 새 메시지가 기존 공간에 맞는 경우
-        FILE *file = fopen(MESSAGE_FILE, "r+b");
-        if (file == NULL)
+        while (shard < STORE_SHARD_COUNT && position >= base + store_shards[shard].free_space_size)
         {
-            syslog(LOG_ERR, "Error opening file for modification: %s", MESSAGE_FILE);
-            return 0;
+            base += store_shards[shard].free_space_size;
+            shard++;
         }
-
-        uint64_t offset = index_table[target_index - 1].offset;
-        fseek(file, offset, SEEK_SET);
-
-        time_t now = time(NULL);
-        fwrite(&now, sizeof(time_t), 1, file);
-        fwrite(&new_message_len, sizeof(uint32_t), 1, file);
-        fwrite(new_message, 1, new_message_len, file);
-
-        // 남은 공간을 0으로 채움
-        uint32_t padding = index_table[target_index - 1].length - new_total_len;
-        char *zero_pad = calloc(padding, 1);
-        fwrite(zero_pad, 1, padding, file);
-        free(zero_pad);
-
-        fclose(file);
-    }
-    else
-    {
-        // 새 메시지가 기존 공간보다 큰 경우
-        uint64_t new_offset = find_free_space(new_allocated_len);
-        if (new_offset == 0)
+        if (shard >= STORE_SHARD_COUNT)
         {
-            FILE *file = fopen(MESSAGE_FILE, "ab");
-            if (file == NULL)
-            {
-                syslog(LOG_ERR, "Error opening message file for appending: %s", MESSAGE_FILE);
-                return 0;
-            }
-            fseek(file, 0, SEEK_END);
-            new_offset = ftell(file);
-            fclose(file);
+            break;
         }
-
-        FILE *file = fopen(MESSAGE_FILE, "r+b");
-        if (file == NULL)
+        FreeSpaceEntry *entry = &store_shards[shard].free_space[position - base];
+        n = sprintf(entry_json, "%s{\"shard\":%u,\"offset\":%llu,\"length\":%u}", position == start ? "" : ",",
+                    shard, (unsigned long long)STORE_OFFSET_LOCAL(entry->offset), entry->length);
+        position++;
+        if (stream->used + n > sizeof(stream->buffer))
         {
-            syslog(LOG_ERR, "Error opening file for modification: %s", MESSAGE_FILE);
-            return 0;
+            pthread_rwlock_unlock(&store_lock);
+            table_stream_append(stream, entry_json, n);
+            pthread_rwlock_rdlock(&store_lock);
+            shard = 0; // 락을 푼 사이 테이블이 바뀌었을 수 있으므로 처음부터 다시 셈
+            base = 0;
         }
+        else
+        {
+            table_stream_append(stream, entry_json, n);
+        }
+    }
+    uint32_t total = 0;
+    for (shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        total += store_shards[shard].free_space_size;
+    }
+    pthread_rwlock_unlock(&store_lock);
 
-        fseek(file, new_offset, SEEK_SET);
-
-        time_t now = time(NULL);
-        fwrite(&now, sizeof(time_t), 1, file);
-        fwrite(&new_message_len, sizeof(uint32_t), 1, file);
-        fwrite(new_message, 1, new_message_len, file);
-
-        // 남은 공간을 0으로 채움
-        uint32_t padding = new_allocated_len - new_total_len;
-        char *zero_pad = calloc(padding, 1);
-        fwrite(zero_pad, 1, padding, file);
-        free(zero_pad);
-
-        fclose(file);
-
-        // 기존 공간을 free space로 추가
-        add_free_space(index_table[target_index - 1].offset, index_table[target_index - 1].length);
-
-        // 인덱스 테이블 업데이트
-        index_table[target_index - 1].offset = new_offset;
-        index_table[target_index - 1].length = new_allocated_len;
+    if (paginated)
+    {
+        if (position < total)
+            n = sprintf(entry_json, "],\"start\":%u,\"next\":%u,\"total\":%u}", start, position, total);
+        else
+            n = sprintf(entry_json, "],\"start\":%u,\"next\":null,\"total\":%u}", start, total);
+    }
+    else
+    {
+        n = sprintf(entry_json, "]}");
     }
+    table_stream_append(stream, entry_json, n);
+    table_stream_flush(stream, 1);
 
-    save_index_table();
-    return 1; // 수정 성공
+    int ok = !stream->failed;
+    free(stream);
+    return ok;
 }
-// 인덱스 테이블 정보를 JSON 형식으로 반환하는 함수
-// get_index_table_info 함수 수정
-char *get_index_table_info()
+// 저장 공간 사용량을 JSON 형식으로 반환하는 함수
+// 같은 레코드를 2의 거듭제곱 크기로 저장했을 때의 크기도 함께 계산해 비교할 수 있게 합니다.
+char *get_storage_stats_info()
 {
-    json_object *index_array = json_object_new_array();
+    pthread_rwlock_rdlock(&store_lock);
 
+    uint64_t allocated_bytes = 0, used_bytes = 0, pow2_bytes = 0, free_bytes = 0;
+    uint32_t deleted = 0;
+    unsigned char header[RECORD_HEADER_SIZE];
     for (uint32_t i = 0; i < index_table_size; i++)
     {
-        json_object *entry = json_object_new_object();
-        json_object_object_add(entry, "index", json_object_new_int(index_table[i].index));
-        json_object_object_add(entry, "offset", json_object_new_int64(index_table[i].offset));
-        json_object_object_add(entry, "length", json_object_new_int(index_table[i].length));
-
-        json_object *forward_links_array = json_object_new_array();
-        for (uint32_t j = 0; j < index_table[i].forward_link_count; j++)
+        if (index_table[i].length == 0)
         {
-            json_object_array_add(forward_links_array, json_object_new_int(index_table[i].forward_links[j]));
+            deleted++;
+            continue;
         }
-        json_object_object_add(entry, "forward_links", forward_links_array);
-
-        json_object *backward_links_array = json_object_new_array();
-        for (uint32_t j = 0; j < index_table[i].backward_link_count; j++)
+        allocated_bytes += index_table[i].length;
+        // 이전 형식의 작은 슬롯은 RECORD_HEADER_SIZE보다 짧을 수 있음
+        uint32_t header_length = index_table[i].length < RECORD_HEADER_SIZE ? index_table[i].length : RECORD_HEADER_SIZE;
+        if (read_message_data(index_table[i].offset, header, header_length))
         {
-            json_object_array_add(backward_links_array, json_object_new_int(index_table[i].backward_links[j]));
+            uint32_t used = record_used_length(header, index_table[i].length);
+            used_bytes += used;
+            pow2_bytes += next_power_of_two(used);
         }
-        json_object_object_add(entry, "backward_links", backward_links_array);
-
-        json_object_array_add(index_array, entry);
     }
-
-    json_object *result = json_object_new_object();
-    json_object_object_add(result, "action", json_object_new_string("index_table_info"));
-    json_object_object_add(result, "data", index_array);
-
-    const char *json_string = json_object_to_json_string(result);
-    char *response = strdup(json_string);
-
-    json_object_put(result);
-    return response;
-}
-// Free space 테이블 정보를 JSON 형식으로 반환하는 함수
-char *get_free_space_table_info()
-{
-    json_object *free_space_array = json_object_new_array();
-
-    for (uint32_t i = 0; i < free_space_table_size; i++)
+    uint64_t file_size = 0;
+    json_object *shards = json_object_new_array();
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
     {
-        json_object *entry = json_object_new_object();
-        json_object_object_add(entry, "offset", json_object_new_int64(free_space_table[i].offset));
-        json_object_object_add(entry, "length", json_object_new_int(free_space_table[i].length));
-        json_object_array_add(free_space_array, entry);
+        uint64_t shard_free_bytes = 0;
+        for (uint32_t i = 0; i < store_shards[shard].free_space_size; i++)
+        {
+            shard_free_bytes += store_shards[shard].free_space[i].length;
+        }
+        free_bytes += shard_free_bytes;
+        file_size += store_shards[shard].file_size;
+
+        json_object *shard_info = json_object_new_object();
+        json_object_object_add(shard_info, "file_size", json_object_new_int64(store_shards[shard].file_size));
+        json_object_object_add(shard_info, "free_bytes", json_object_new_int64(shard_free_bytes));
+        json_object_object_add(shard_info, "free_space_entries", json_object_new_int(store_shards[shard].free_space_size));
+        json_object_array_add(shards, shard_info);
     }
+    uint32_t count = index_table_size - deleted; // 평균은 살아 있는 메시지 기준
+    uint32_t chunks = index_chunk_count();
+
+    pthread_rwlock_unlock(&store_lock);
+
+    json_object *data = json_object_new_object();
+    json_object_object_add(data, "messages", json_object_new_int(count));
+    json_object_object_add(data, "deleted_messages", json_object_new_int(deleted));
+    json_object_object_add(data, "store_shards", shards);
+    json_object_object_add(data, "index_chunks", json_object_new_int(chunks));
+    json_object_object_add(data, "index_chunk_entries", json_object_new_int(INDEX_CHUNK_ENTRIES));
+    json_object_object_add(data, "file_size", json_object_new_int64(file_size));
+    json_object_object_add(data, "allocated_bytes", json_object_new_int64(allocated_bytes));
+    json_object_object_add(data, "used_bytes", json_object_new_int64(used_bytes));
+    json_object_object_add(data, "free_bytes", json_object_new_int64(free_bytes));
+    json_object_object_add(data, "pow2_allocated_bytes", json_object_new_int64(pow2_bytes));
+    json_object_object_add(data, "bytes_per_message", json_object_new_double(count > 0 ? (double)file_size / count : 0.0));
+    json_object_object_add(data, "allocated_per_message", json_object_new_double(count > 0 ? (double)allocated_bytes / count : 0.0));
+    json_object_object_add(data, "pow2_per_message", json_object_new_double(count > 0 ? (double)pow2_bytes / count : 0.0));
+    json_object_object_add(data, "used_per_message", json_object_new_double(count > 0 ? (double)used_bytes / count : 0.0));
 
     json_object *result = json_object_new_object();
-    json_object_object_add(result, "action", json_object_new_string("free_space_table_info"));
-    json_object_object_add(result, "data", free_space_array);
+    json_object_object_add(result, "action", json_object_new_string("storage_stats"));
+    json_object_object_add(result, "data", data);
 
     const char *json_string = json_object_to_json_string(result);
     char *response = strdup(json_string);
@@ -751,139 +2749,459 @@ char *get_free_space_table_info()
 // 새로운 함수: 특정 인덱스의 바이너리 데이터를 16진수 문자열로 반환
 char *get_binary_data_by_index(uint32_t target_index)
 {
-    if (target_index == 0 || target_index > index_table_size)
-    {
-        return NULL;
-    }
+    pthread_rwlock_rdlock(&store_lock);
 
-    FILE *file = fopen(MESSAGE_FILE, "rb");
-    if (file == NULL)
+    if (target_index == 0 || target_index > index_table_size || index_table[target_index - 1].length == 0)
     {
-        syslog(LOG_ERR, "Error opening file for reading: %s", MESSAGE_FILE);
+        pthread_rwlock_unlock(&store_lock);
         return NULL;
     }
 
     uint64_t offset = index_table[target_index - 1].offset;
     uint32_t length = index_table[target_index - 1].length;
-    fseek(file, offset, SEEK_SET);
 
-    unsigned char *buffer = malloc(length);
+    unsigned char *buffer = acquire_read_buffer(length);
     if (buffer == NULL)
     {
         syslog(LOG_ERR, "Memory allocation failed");
-        fclose(file);
+        pthread_rwlock_unlock(&store_lock);
         return NULL;
     }
 
-    size_t read_size = fread(buffer, 1, length, file);
-    fclose(file);
-
-    if (read_size != length)
+    if (!read_message_data(offset, buffer, length))
     {
         syslog(LOG_ERR, "Error reading full message data");
-        free(buffer);
+        release_read_buffer(buffer, length);
+        pthread_rwlock_unlock(&store_lock);
         return NULL;
     }
 
-    char *hex_string = malloc(length * 2 + 1);
+    // 슬롯의 남은 공간은 이전 레코드의 잔여 데이터일 수 있으므로 사용 중인 부분만 보여 줍니다.
+    uint32_t used = record_used_length(buffer, length);
+    char *hex_string = malloc((size_t)used * 2 + 1);
     if (hex_string == NULL)
     {
         syslog(LOG_ERR, "Memory allocation failed for hex string");
-        free(buffer);
+        release_read_buffer(buffer, length);
+        pthread_rwlock_unlock(&store_lock);
         return NULL;
     }
 
-    for (uint32_t i = 0; i < length; i++)
-    {
-        sprintf(hex_string + (i * 2), "%02x", buffer[i]);
-    }
-    hex_string[length * 2] = '\0';
+    hex_encode(hex_string, buffer, used);
 
-    free(buffer);
+    release_read_buffer(buffer, length);
+    pthread_rwlock_unlock(&store_lock);
     return hex_string;
 }
-// 수정된 함수: 특정 인덱스의 메시지를 지정된 형식으로 반환
-char *get_message_by_index_and_format(uint32_t target_index, const char *format)
+// 결과 문자열을 alloc으로 잡아 읽습니다 (NULL이면 malloc).
+static char *read_message_with(uint32_t target_index, const char *format, ResultAllocator alloc)
 {
-    if (target_index == 0 || target_index > index_table_size)
+    // 자주 읽히는 메시지는 캐시에서 바로 반환
+    if (strcmp(format, "text") == 0)
     {
-        return NULL;
+        char *cached = record_cache_get_with(target_index, alloc);
+        if (cached != NULL)
+        {
+            return cached;
+        }
     }
 
-    FILE *file = fopen(MESSAGE_FILE, "rb");
-    if (file == NULL)
+    pthread_rwlock_rdlock(&store_lock);
+
+    if (target_index == 0 || target_index > index_table_size || index_table[target_index - 1].length == 0)
     {
-        syslog(LOG_ERR, "Error opening file for reading: %s", MESSAGE_FILE);
+        pthread_rwlock_unlock(&store_lock);
         return NULL;
     }
 
     uint64_t offset = index_table[target_index - 1].offset;
     uint32_t length = index_table[target_index - 1].length;
-    fseek(file, offset, SEEK_SET);
 
-    unsigned char *buffer = malloc(length);
+    unsigned char *buffer = acquire_read_buffer(length);
     if (buffer == NULL)
     {
         syslog(LOG_ERR, "Memory allocation failed");
-        fclose(file);
+        pthread_rwlock_unlock(&store_lock);
         return NULL;
     }
 
-    size_t read_size = fread(buffer, 1, length, file);
-    fclose(file);
-
-    if (read_size != length)
+    if (!read_message_data(offset, buffer, length))
     {
         syslog(LOG_ERR, "Error reading full message data");
-        free(buffer);
+        release_read_buffer(buffer, length);
+        pthread_rwlock_unlock(&store_lock);
         return NULL;
     }
 
     char *result;
     if (strcmp(format, "text") == 0)
     {
-        time_t timestamp;
-        uint32_t message_length;
-        memcpy(&timestamp, buffer, sizeof(time_t));
-        memcpy(&message_length, buffer + sizeof(time_t), sizeof(uint32_t));
-
-        result = malloc(message_length + 1);
+        result = decode_record_text(buffer, length, target_index, alloc);
         if (result == NULL)
         {
-            syslog(LOG_ERR, "Memory allocation failed for text result");
-            free(buffer);
+            release_read_buffer(buffer, length);
+            pthread_rwlock_unlock(&store_lock);
             return NULL;
         }
-        memcpy(result, buffer + sizeof(time_t) + sizeof(uint32_t), message_length);
-        result[message_length] = '\0';
+
+        // read lock을 잡은 상태에서 넣으므로 동시에 수정된 내용이 덮어써지지 않습니다.
+        record_cache_put(target_index, result, strlen(result));
     }
     else if (strcmp(format, "binary") == 0 || strcmp(format, "hex") == 0)
     {
-        result = malloc(length * 2 + 1);
+        uint32_t used = record_used_length(buffer, length);
+        result = alloc != NULL ? alloc((size_t)used * 2 + 1) : malloc((size_t)used * 2 + 1);
         if (result == NULL)
         {
             syslog(LOG_ERR, "Memory allocation failed for hex result");
-            free(buffer);
+            release_read_buffer(buffer, length);
+            pthread_rwlock_unlock(&store_lock);
             return NULL;
         }
-        for (uint32_t i = 0; i < length; i++)
-        {
-            sprintf(result + (i * 2), "%02x", buffer[i]);
-        }
-        result[length * 2] = '\0';
+        hex_encode(result, buffer, used);
     }
     else
     {
         syslog(LOG_ERR, "Unknown format requested");
-        free(buffer);
+        release_read_buffer(buffer, length);
+        pthread_rwlock_unlock(&store_lock);
         return NULL;
     }
 
-    free(buffer);
+    release_read_buffer(buffer, length);
+    pthread_rwlock_unlock(&store_lock);
     return result;
 }
+// 수정된 함수: 특정 인덱스의 메시지를 지정된 형식으로 반환
+char *get_message_by_index_and_format(uint32_t target_index, const char *format)
+{
+    return read_message_with(target_index, format, NULL);
+}
+// 본문과 그 본문의 버전을 함께 읽습니다 (modify_if에 넘길 버전). 버전은 본문 앞뒤로 락 없이 읽어 같을 때 돌려줍니다.
+// 수정은 본문을 쓴 뒤에 버전을 올리므로 새 본문에 옛 버전이 붙을 수는 있어도 (modify_if가 충돌로 거절하고 다시 읽게 함)
+// 옛 본문에 새 버전이 붙지는 않습니다. 그래서 계속 바뀌는 중이면 앞에서 읽은 버전을 돌려줘도 안전합니다.
+char *get_versioned_message(uint32_t target_index, const char *format, uint32_t *version)
+{
+    return get_versioned_message_with(target_index, format, version, NULL);
+}
+// get_versioned_message()와 같지만 결과를 alloc으로 잡습니다. alloc이 NULL이 아니면 다시 읽을 때 앞의 결과를 해제하지 않습니다 (arena).
+char *get_versioned_message_with(uint32_t target_index, const char *format, uint32_t *version, ResultAllocator alloc)
+{
+    char *content = NULL;
+    uint32_t before = 0;
+    for (int attempt = 0; attempt < VERSIONED_READ_ATTEMPTS; attempt++)
+    {
+        if (alloc == NULL)
+        {
+            free(content);
+        }
+        before = get_message_version(target_index);
+        content = read_message_with(target_index, format, alloc);
+        if (content == NULL || get_message_version(target_index) == before)
+        {
+            break;
+        }
+    }
+    *version = before;
+    return content;
+}
+// 여러 레코드의 헤더만 읽어 타임스탬프를 가져옵니다 (legacy 레코드 포함).
+// 읽지 못했거나 헤더가 다른 인덱스의 것이면 timestamps[i]는 0입니다.
+void read_record_timestamps(const uint32_t *indices, uint32_t count, int64_t *timestamps)
+{
+    uint32_t slots_needed = count > 0 ? count : 1;
+    IoRequest *requests = calloc(slots_needed, sizeof(IoRequest));
+    uint32_t *owners = malloc(sizeof(uint32_t) * slots_needed);
+    unsigned char *headers = malloc((size_t)slots_needed * RECORD_HEADER_SIZE);
+    memset(timestamps, 0, sizeof(int64_t) * count);
+    if (requests == NULL || owners == NULL || headers == NULL)
+    {
+        syslog(LOG_ERR, "Memory allocation failed");
+        free(requests);
+        free(owners);
+        free(headers);
+        return;
+    }
+
+    pthread_rwlock_rdlock(&store_lock);
+
+    uint32_t request_count = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (indices[i] == 0 || indices[i] > index_table_size || index_table[indices[i] - 1].length == 0)
+        {
+            continue;
+        }
+        uint32_t slot_length = index_table[indices[i] - 1].length;
+        IoRequest *request = &requests[request_count];
+        request->opcode = ASYNC_IO_READ;
+        request->offset = index_table[indices[i] - 1].offset;
+        request->length = slot_length < RECORD_HEADER_SIZE ? slot_length : RECORD_HEADER_SIZE;
+        request->buffer = headers + (size_t)i * RECORD_HEADER_SIZE;
+        owners[request_count++] = i;
+    }
+
+    async_io_submit_batch(requests, request_count);
+
+    for (uint32_t r = 0; r < request_count; r++)
+    {
+        uint32_t owner = owners[r];
+        RecordInfo info;
+        if (requests[r].result == (int)requests[r].length &&
+            parse_record_header(requests[r].buffer, index_table[indices[owner] - 1].length, &info) &&
+            (info.legacy || info.index == indices[owner] || info.index == RECORD_SHARED_INDEX))
+        {
+            timestamps[owner] = info.timestamp;
+        }
+    }
+
+    pthread_rwlock_unlock(&store_lock);
+
+    free(requests);
+    free(owners);
+    free(headers);
+}
+// 배치 읽기에서 디스크를 읽어야 하는 메시지 하나
+typedef struct {
+    uint64_t offset;
+    uint32_t length;
+    uint32_t owner;  // indices 안의 위치
+    uint32_t span;   // 이 슬롯을 담은 구간 (IoRequest 번호)
+    int valid;       // 헤더와 CRC를 확인했는지
+    RecordInfo info;
+} BatchSlot;
+
+static int compare_batch_slot(const void *a, const void *b)
+{
+    const BatchSlot *sa = a;
+    const BatchSlot *sb = b;
+    if (sa->offset < sb->offset)
+        return -1;
+    if (sa->offset > sb->offset)
+        return 1;
+    return 0;
+}
+
+// 여러 인덱스의 메시지를 텍스트로 한꺼번에 읽어 옵니다.
+// 캐시에 없는 메시지는 파일 오프셋 순으로 정렬해 가까운 슬롯끼리 하나의 큰 순차 읽기로 합치고,
+// 합친 구간들을 한 배치로 비동기 I/O 백엔드에 제출합니다. 본문은 모두 하나의 arena에 담깁니다.
+// alloc으로 잡은 뒤 0으로 채웁니다 (NULL이면 calloc).
+static void *result_calloc(ResultAllocator alloc, size_t count, size_t size)
+{
+    if (alloc == NULL)
+    {
+        return calloc(count, size);
+    }
+    void *memory = alloc(count * size);
+    if (memory != NULL)
+    {
+        memset(memory, 0, count * size);
+    }
+    return memory;
+}
+// alloc으로 잡은 메모리는 arena가 한꺼번에 돌려받으므로 malloc으로 잡은 경우에만 해제합니다.
+static void result_free(ResultAllocator alloc, void *memory)
+{
+    if (alloc == NULL)
+    {
+        free(memory);
+    }
+}
+
+// use_cache가 0이면 캐시를 보지도 채우지도 않습니다 (전체를 훑는 작업용).
+// alloc이 NULL이 아니면 결과와 작업용 배열을 모두 alloc으로 잡으며, 결과를 free_message_batch()로 해제하지 않습니다.
+static MessageBatch *read_message_batch(const uint32_t *indices, uint32_t count, int use_cache, ResultAllocator alloc)
+{
+    uint32_t slots_needed = count > 0 ? count : 1;
+    MessageBatch *batch = result_calloc(alloc, 1, sizeof(MessageBatch));
+    char **cached = result_calloc(alloc, slots_needed, sizeof(char *));
+    BatchSlot *slots = alloc != NULL ? alloc(sizeof(BatchSlot) * slots_needed) : malloc(sizeof(BatchSlot) * slots_needed);
+    IoRequest *requests = result_calloc(alloc, slots_needed, sizeof(IoRequest));
+    if (batch != NULL)
+    {
+        batch->count = count;
+        batch->texts = result_calloc(alloc, slots_needed, sizeof(char *));
+        batch->lengths = result_calloc(alloc, slots_needed, sizeof(uint32_t));
+    }
+    if (batch == NULL || batch->texts == NULL || batch->lengths == NULL || cached == NULL || slots == NULL || requests == NULL)
+    {
+        syslog(LOG_ERR, "Memory allocation failed");
+        if (alloc == NULL)
+        {
+            free_message_batch(batch);
+        }
+        result_free(alloc, cached);
+        result_free(alloc, slots);
+        result_free(alloc, requests);
+        return NULL;
+    }
+
+    // 캐시에 있는 메시지는 디스크를 읽지 않음
+    size_t arena_size = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        cached[i] = use_cache ? record_cache_get_with(indices[i], alloc) : NULL;
+        if (cached[i] != NULL)
+        {
+            batch->lengths[i] = strlen(cached[i]);
+            arena_size += batch->lengths[i] + 1;
+        }
+    }
+
+    pthread_rwlock_rdlock(&store_lock);
+
+    uint32_t slot_count = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (cached[i] != NULL || indices[i] == 0 || indices[i] > index_table_size || index_table[indices[i] - 1].length == 0)
+        {
+            continue;
+        }
+        slots[slot_count].offset = index_table[indices[i] - 1].offset;
+        slots[slot_count].length = index_table[indices[i] - 1].length;
+        slots[slot_count].owner = i;
+        slot_count++;
+    }
+    qsort(slots, slot_count, sizeof(BatchSlot), compare_batch_slot);
+
+    // 사이 간격이 BATCH_COALESCE_GAP 이하인 슬롯들을 BATCH_COALESCE_MAX_SPAN까지 한 구간으로 합칩니다.
+    uint32_t request_count = 0;
+    for (uint32_t k = 0; k < slot_count; k++)
+    {
+        uint64_t slot_end = slots[k].offset + slots[k].length;
+        if (request_count > 0)
+        {
+            IoRequest *span = &requests[request_count - 1];
+            uint64_t span_end = span->offset + span->length;
+            if (slots[k].offset <= span_end + BATCH_COALESCE_GAP &&
+                (slot_end > span_end ? slot_end : span_end) - span->offset <= BATCH_COALESCE_MAX_SPAN)
+            {
+                if (slot_end > span_end)
+                {
+                    span->length = slot_end - span->offset;
+                }
+                slots[k].span = request_count - 1;
+                continue;
+            }
+        }
+        IoRequest *span = &requests[request_count];
+        span->opcode = ASYNC_IO_READ;
+        span->offset = slots[k].offset;
+        span->length = slots[k].length;
+        slots[k].span = request_count++;
+    }
+    for (uint32_t r = 0; r < request_count; r++)
+    {
+        requests[r].buffer = acquire_read_buffer(requests[r].length);
+        if (requests[r].buffer == NULL)
+        {
+            requests[r].length = 0; // 아래에서 buffer가 NULL인 구간은 건너뜀
+        }
+    }
+
+    async_io_submit_batch(requests, request_count);
+
+    // 압축 레코드는 슬롯보다 길게 풀릴 수 있으므로 헤더를 먼저 확인해 arena 크기를 정함
+    for (uint32_t k = 0; k < slot_count; k++)
+    {
+        const IoRequest *span = &requests[slots[k].span];
+        slots[k].valid = 0;
+        if (span->buffer == NULL || span->result != (int)span->length)
+        {
+            continue;
+        }
+        const unsigned char *slot = (const unsigned char *)span->buffer + (slots[k].offset - span->offset);
+        if (check_record(slot, slots[k].length, indices[slots[k].owner], &slots[k].info))
+        {
+            slots[k].valid = 1;
+            arena_size += slots[k].info.text_length + 1;
+        }
+    }
+
+    batch->arena = alloc != NULL ? alloc(arena_size > 0 ? arena_size : 1) : malloc(arena_size > 0 ? arena_size : 1);
+    char *cursor = batch->arena;
+    if (batch->arena != NULL)
+    {
+        for (uint32_t k = 0; k < slot_count; k++)
+        {
+            const IoRequest *span = &requests[slots[k].span];
+            uint32_t owner = slots[k].owner;
+            const RecordInfo *info = &slots[k].info;
+            if (!slots[k].valid)
+            {
+                continue;
+            }
+            const unsigned char *slot = (const unsigned char *)span->buffer + (slots[k].offset - span->offset);
+            if (!copy_record_text(slot, info, cursor))
+            {
+                continue;
+            }
+            batch->texts[owner] = cursor;
+            batch->lengths[owner] = info->text_length;
+            cursor += info->text_length + 1;
+            // read lock을 잡은 상태에서 넣으므로 동시에 수정된 내용이 덮어써지지 않습니다.
+            if (use_cache)
+            {
+                record_cache_put(indices[owner], batch->texts[owner], info->text_length);
+            }
+        }
+    }
+
+    pthread_rwlock_unlock(&store_lock);
+
+    for (uint32_t r = 0; r < request_count; r++)
+    {
+        release_read_buffer(requests[r].buffer, requests[r].length);
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (cached[i] != NULL && batch->arena != NULL)
+        {
+            memcpy(cursor, cached[i], batch->lengths[i] + 1);
+            batch->texts[i] = cursor;
+            cursor += batch->lengths[i] + 1;
+        }
+        result_free(alloc, cached[i]);
+    }
+    batch->reads = request_count;
+
+    result_free(alloc, cached);
+    result_free(alloc, slots);
+    result_free(alloc, requests);
+    return batch;
+}
+
+// 읽지 못한 항목은 texts[i]가 NULL이며, 결과는 free_message_batch()로 해제합니다.
+MessageBatch *get_messages_by_indices(const uint32_t *indices, uint32_t count)
+{
+    return read_message_batch(indices, count, 1, NULL);
+}
+
+// get_messages_by_indices()와 같지만 결과를 alloc으로 잡습니다. 결과는 free_message_batch()로 해제하지 않습니다.
+MessageBatch *get_messages_by_indices_with(const uint32_t *indices, uint32_t count, ResultAllocator alloc)
+{
+    return read_message_batch(indices, count, 1, alloc);
+}
+
+// get_messages_by_indices()와 같지만 레코드 캐시를 거치지 않습니다 (인덱스 구축처럼 한 번씩만 읽는 경우).
+MessageBatch *scan_messages_by_indices(const uint32_t *indices, uint32_t count)
+{
+    return read_message_batch(indices, count, 0, NULL);
+}
+
+void free_message_batch(MessageBatch *batch)
+{
+    if (batch == NULL)
+    {
+        return;
+    }
+    free(batch->texts);
+    free(batch->lengths);
+    free(batch->arena);
+    free(batch);
+}
 // 새로운 함수: 최대 인덱스 반환
 uint32_t get_max_index()
 {
-    return index_table_size;
+    return __atomic_load_n(&index_table_size, __ATOMIC_ACQUIRE); // append가 store_lock 아래에서 올림
 }
\ No newline at end of file
@@ -3,17 +3,72 @@
 
 #include <stdint.h>
 #include <time.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
 
-#define MESSAGE_FILE "binary file/messages.bin"
-#define INDEX_FILE "binary file/index.bin"
-#define FREE_SPACE_FILE "binary file/free_space.bin"
+#define MESSAGE_FILE "binary file/messages.bin" // 예전 단일 데이터 파일. 시작할 때 shard 0의 데이터 파일로 이름을 바꿈
+#define STORE_SHARD_FILE "binary file/messages.%u.bin" // 저장소 shard s의 데이터 파일
+#define INDEX_FILE "binary file/index.bin" // 저장소 목록 머리 (INDEX_STORE_MAGIC). 예전 단일 파일이나 구간 shard 목록이면 읽은 뒤 새 배치로 나눔
+#define INDEX_CHUNK_FILE "binary file/index.%u.%u.bin" // shard s의 인덱스 조각 c: shard 안 순번 c*INDEX_CHUNK_ENTRIES부터의 엔트리 (index.bin과 같은 형식)
+#define LEGACY_INDEX_SHARD_FILE "binary file/index.%u.bin" // 이전 배치 (INDEX_SHARD_MAGIC): 인덱스 구간 k*엔트리 수+1 부터의 엔트리
+#define FREE_SPACE_FILE "binary file/free_space.bin" // 예전 단일 free space 파일이자 스냅숏 형식. 있으면 읽어 shard별 파일로 나눔
+#define STORE_FREE_SPACE_FILE "binary file/free_space.%u.bin" // shard s의 free space 테이블
+// 빌드할 때 -DSTORE_SHARD_COUNT=n (STORE_SHARD_MAX 이하)으로 바꿀 수 있음 (.vscode/tasks.json의 "bench: shard_writes (shards=n)")
+#ifndef STORE_SHARD_COUNT
+#define STORE_SHARD_COUNT 4       // 저장소 shard 수. 인덱스 i는 shard (i - 1) % STORE_SHARD_COUNT의 데이터 파일, 인덱스 조각, free space에 들어감
+#endif
+#define STORE_SHARD_MAX 64        // 다른 shard 수로 빌드했던 데이터 파일까지 열어 읽는 최대 shard 수
+#define STORE_OFFSET_SHIFT 48     // 엔트리 offset의 위 16비트는 데이터 파일(shard) 번호, 아래 48비트는 그 파일 안의 위치
 #define MAX_MESSAGES 1000000
 #define MAX_LINKS 20  // 각 메시지당 최대 링크 수
+#define RECORD_MAGIC 0x4345524D   // "MREC": CRC 헤더가 있는 레코드 표시
+#define RECORD_MAGIC_COMPRESSED 0x5A43524D // "MRCZ": 본문이 압축된 레코드 (헤더 형식은 같음)
+#define RECORD_HEADER_SIZE 24     // magic + crc + 인덱스 + 메시지 길이 + 타임스탬프
+#define RECORD_CRC_OFFSET 8       // CRC 계산을 시작하는 위치 (인덱스 필드부터 메시지 끝까지)
+#define RECORD_SHARED_INDEX 0     // 여러 인덱스가 함께 쓰는 (중복 제거된) 레코드의 헤더 인덱스
+#define LEGACY_RECORD_HEADER_SIZE (sizeof(time_t) + sizeof(uint32_t)) // 이전 형식: 타임스탬프 + 메시지 길이
+#define SLAB_MIN_SIZE 16          // 가장 작은 slab class 크기
+#define SLAB_GROWTH_FACTOR 1.25   // slab class 사이의 증가 비율
+#define SLAB_ALIGNMENT 8          // slab class 크기 정렬 단위
+#define READ_BUFFER_SIZE 4096     // 버퍼 풀에서 재사용하는 읽기 버퍼 크기
+#define READ_BUFFER_POOL_SIZE 64  // 버퍼 풀에 보관하는 최대 버퍼 수
+#define BATCH_COALESCE_GAP 4096   // 배치 읽기에서 이 간격 이하로 떨어진 슬롯은 한 번에 읽음
+#define BATCH_COALESCE_MAX_SPAN (256 * 1024) // 합친 읽기 하나의 최대 크기
+#define TABLE_STREAM_BUFFER_SIZE 16384 // 테이블 정보를 스트리밍할 때 한 조각의 최대 크기
+#define INDEX_FIELD_INDEX 0x01    // get_index_table_info 필드 선택
+#define INDEX_FIELD_OFFSET 0x02
+#define INDEX_FIELD_LENGTH 0x04
+#define INDEX_FIELD_FORWARD 0x08
+#define INDEX_FIELD_BACKWARD 0x10
+#define INDEX_FIELD_ALL 0x1F
+#define INDEX_FILE_MAGIC 0x54444E49 // "INDT": 버전과 만료 시각 필드가 있는 index.bin / 조각 파일
+#define INDEX_FILE_MAGIC_V2 0x58444E49 // "INDX": 만료 시각 필드가 없던 형식 (읽을 때 expires_at은 0). 그 전 파일은 엔트리 수(MAX_MESSAGES 이하)로 시작함
+#define INDEX_FILE_HEADER_SIZE 8  // magic + 엔트리 수
+#define INDEX_SHARD_MAGIC 0x53444E49 // "INDS": 이전 배치의 index.bin (magic + 구간 shard당 엔트리 수). 읽은 뒤 새 배치로 다시 씀
+#define INDEX_STORE_MAGIC 0x50444E49 // "INDP": index.bin이 저장소 목록 머리임 (magic + 조각당 엔트리 수 + 저장소 shard 수)
+#define INDEX_CHUNK_ENTRIES 16384 // 조각 파일 하나가 맡는 shard 안 엔트리 수. 쓰기는 바뀐 엔트리의 조각 파일만 다시 씀
+#define INDEX_CHUNK_MIN_ENTRIES 1024 // index.bin에 적힌 조각 크기가 이보다 작으면 손상으로 봄
+#define INDEX_CHUNK_COUNT (MAX_MESSAGES / STORE_SHARD_COUNT / INDEX_CHUNK_ENTRIES + 1) // shard 하나의 최대 조각 수
+#define INDEX_ENTRY_FIXED_SIZE 36 // index.bin 엔트리에서 링크 배열을 뺀 크기 (index, offset, length, version, expires_at, 링크 개수 2개)
+#define V2_INDEX_ENTRY_FIXED_SIZE 28 // 만료 시각 필드가 없던 index.bin 엔트리
+#define LEGACY_INDEX_ENTRY_FIXED_SIZE 24 // 버전 필드가 없던 index.bin 엔트리 (읽을 때 version은 1)
+#define INDEX_LOAD_CHUNK_ENTRIES 65536 // 시작할 때 index.bin을 풀면서 스레드 하나가 한 번에 맡는 엔트리 수
+#define INDEX_LOAD_MAX_THREADS 8  // index.bin 디코딩에 쓰는 최대 스레드 수
+#define VERSIONED_READ_ATTEMPTS 3 // 본문을 읽는 동안 버전이 바뀌었을 때 다시 읽는 최대 횟수
 
+#define STORE_OFFSET(shard, local) (((uint64_t)(shard) << STORE_OFFSET_SHIFT) | (uint64_t)(local))
+#define STORE_OFFSET_SHARD(offset) ((uint32_t)((offset) >> STORE_OFFSET_SHIFT))
+#define STORE_OFFSET_LOCAL(offset) ((offset) & ((1ULL << STORE_OFFSET_SHIFT) - 1))
+#define STORE_SHARD_OF(index) (((index) - 1) % STORE_SHARD_COUNT) // 인덱스를 맡는 저장소 shard (router)
+
+// length가 0인 엔트리는 지워진 메시지 (tombstone)입니다. 인덱스 번호는 다시 쓰지 않으므로 자리만 남습니다.
 typedef struct {
     uint32_t index;
     uint64_t offset;
     uint32_t length;
+    uint32_t version;   // append하면 1, modify할 때마다 1씩 증가, 지우면 0. store_lock 없이 __atomic으로 읽을 수 있음
+    int64_t expires_at; // 이 시각(unix 초)이 지나면 expiry 스레드가 지움. 0이면 만료 없음
     uint32_t forward_link_count;
     uint32_t backward_link_count;
     uint32_t forward_links[MAX_LINKS];
@@ -24,26 +79,131 @@ typedef struct {
     uint64_t offset;
     uint32_t length;
 } FreeSpaceEntry;
+
+// shard 데이터 파일에 기록되는 레코드 헤더 (RECORD_HEADER_SIZE 바이트), 뒤에 메시지가 이어집니다.
+typedef struct {
+    uint32_t magic;
+    uint32_t crc;
+    uint32_t index;
+    uint32_t length;
+    int64_t timestamp;
+} RecordHeader;
+
+// parse_record_header()가 해석한 레코드 정보. legacy 레코드는 index와 crc가 없습니다.
+// 압축 레코드의 message_length는 저장된 본문 길이이고, 풀었을 때의 길이는 text_length입니다.
+typedef struct {
+    int legacy;
+    int compressed;
+    uint32_t index;
+    uint32_t crc;
+    int64_t timestamp;
+    uint32_t header_length;
+    uint32_t message_length;
+    uint32_t text_length;
+} RecordInfo;
+// get_messages_by_indices()의 결과. texts[i]는 arena 안의 NUL로 끝나는 문자열이거나 NULL입니다.
+typedef struct {
+    uint32_t count;
+    char **texts;
+    uint32_t *lengths;
+    char *arena;
+    uint32_t reads;  // 디스크에 실제로 제출한 읽기 수 (합친 뒤)
+} MessageBatch;
+
+// 저장소 shard 하나. 데이터 파일, free space 테이블, 인덱스 조각 파일을 따로 두고 writer로 쓰기를 나눕니다.
+// 엔트리 자체는 index_table 하나에 있고, shard s의 엔트리는 writer를 잡은 쪽만 바꿉니다 (store_lock 쓰기와 함께).
+// 파일 저장(fsync)은 store_lock을 푼 뒤 writer만 잡고 하므로 서로 다른 shard의 쓰기는 디스크를 기다리는 동안 겹칩니다.
+// 락 순서: append_lock -> writer (여러 개면 번호 순) -> store_lock -> 각 모듈의 락
+typedef struct {
+    pthread_mutex_t writer;
+    int fd;                     // 데이터 파일. pread/pwrite만 사용하므로 seek 위치를 공유하지 않음
+    uint64_t file_size;
+    FreeSpaceEntry *free_space; // offset은 이 shard 번호가 붙은 STORE_OFFSET 값
+    uint32_t free_space_size;
+    int free_space_dirty;       // 메모리의 free space가 파일보다 새로움
+    uint8_t dirty_chunks[INDEX_CHUNK_COUNT]; // 파일보다 새로운 인덱스 조각
+    // 0이 아니면 find_free_space()가 빈 공간을 재사용하지 않고 항상 파일 끝에 씁니다 (이 shard의 compaction 중).
+    int reuse_disabled;
+    // 0이 아니면 스냅숏이 복사 중인 파일 앞부분 [0, frozen_end)을 덮어쓰지 않습니다 (snapshot.c 참고).
+    // 이 구간의 free space는 재사용하지 않고, 이 구간에 있는 레코드의 수정은 제자리가 아닌 새 슬롯에 씁니다.
+    uint64_t frozen_end;
+} StoreShard;
+
+// 여러 메시지를 store_lock 한 번 아래에서 지운 결과. 바뀐 조각과 free space는 shard마다 표시되어 finish_delete_batch()가 저장합니다.
+typedef struct {
+    uint32_t deleted;
+    uint32_t links_removed;     // 이웃 엔트리에서 지운 링크 수
+} DeleteBatch;
+
+// 읽은 본문을 담을 메모리를 잡습니다 (요청 arena 등). 이 형식의 인자에 NULL을 넘기면 malloc을 씁니다.
+typedef void *(*ResultAllocator)(size_t size);
+
+// 스트리밍 응답의 한 조각을 보냅니다. final이면 마지막 조각입니다. 실패하면 0을 반환합니다.
+typedef int (*StreamChunkWriter)(void *context, const char *data, size_t length, int final);
+
 extern IndexEntry *index_table;
 extern uint32_t index_table_size;
-extern FreeSpaceEntry *free_space_table;
-extern uint32_t free_space_table_size;
+extern pthread_rwlock_t store_lock;
+extern StoreShard store_shards[STORE_SHARD_MAX];
+extern uint64_t message_write_seq;
+extern int index_load_truncated;
+extern int free_space_load_failed;
 
 // Function declarations
+int open_message_file();
+void close_message_file();
+unsigned char *acquire_read_buffer(uint32_t length);
+void release_read_buffer(unsigned char *buffer, uint32_t length);
+int read_message_data(uint64_t offset, void *buffer, uint32_t length);
+int write_message_data(uint64_t offset, const void *buffer, uint32_t length);
+int write_message_record(uint64_t offset, uint32_t allocated_len, uint32_t index, const char *message, uint32_t message_len, int64_t timestamp, int compressed);
+int parse_record_header(const unsigned char *buffer, uint32_t slot_length, RecordInfo *info);
+int verify_record_checksum(const unsigned char *buffer, const RecordInfo *info);
+int store_extent_valid(uint64_t offset, uint32_t length);
+void lock_store_shard(uint32_t shard);
+void unlock_store_shard(uint32_t shard);
+void lock_all_store_shards();
+void unlock_all_store_shards();
 void initialize_index_table();
 void initialize_free_space_table();
+int write_index_table(FILE *file);
+uint32_t index_chunk_count();
+int write_free_space_table(FILE *file);
 void save_index_table();
+void mark_index_dirty(uint32_t index);
+void persist_store_shard(uint32_t shard);
 void save_free_space_table();
-uint64_t find_free_space(uint32_t required_length);
+int relocate_foreign_records();
+uint64_t find_free_space(uint32_t shard, uint32_t required_length);
 void add_free_space(uint64_t offset, uint32_t length);
 uint32_t get_last_index();
 uint32_t next_power_of_two(uint32_t v);
+uint32_t slab_class_size(uint32_t v);
+uint32_t record_used_length(const unsigned char *buffer, uint32_t slot_length);
+char *get_storage_stats_info();
 uint32_t append_message_to_file(const char *message);
 int modify_message_by_index(uint32_t target_index, const char *new_message);
-char* get_index_table_info();
-char* get_free_space_table_info();
+int modify_message_if_version(uint32_t target_index, uint32_t expected_version, const char *new_message, uint32_t *current_version);
+uint32_t get_message_version(uint32_t index);
+int set_message_ttl(uint32_t index, uint32_t ttl_seconds);
+int delete_message_locked(uint32_t index, DeleteBatch *batch);
+void finish_delete_batch(DeleteBatch *batch);
+int delete_message(uint32_t index);
+int apply_replicated_message(uint32_t index, uint32_t version, const char *message, int64_t timestamp);
+int apply_replicated_links(uint32_t index, const uint32_t *forward, uint32_t forward_count, const uint32_t *backward, uint32_t backward_count);
+char *read_message_text_locked(uint32_t index);
+int parse_index_fields(const char *fields);
+int stream_index_table_info(uint32_t start, uint32_t limit, int fields, int paginated, StreamChunkWriter writer, void *context);
+int stream_free_space_table_info(uint32_t start, uint32_t limit, int paginated, StreamChunkWriter writer, void *context);
 char* get_binary_data_by_index(uint32_t target_index);
 char* get_message_by_index_and_format(uint32_t target_index, const char* format);
+char *get_versioned_message(uint32_t target_index, const char *format, uint32_t *version);
+char *get_versioned_message_with(uint32_t target_index, const char *format, uint32_t *version, ResultAllocator alloc);
+MessageBatch* get_messages_by_indices(const uint32_t* indices, uint32_t count);
+MessageBatch *get_messages_by_indices_with(const uint32_t *indices, uint32_t count, ResultAllocator alloc);
+MessageBatch* scan_messages_by_indices(const uint32_t* indices, uint32_t count);
+void read_record_timestamps(const uint32_t* indices, uint32_t count, int64_t* timestamps);
+void free_message_batch(MessageBatch* batch);
 uint32_t get_max_index();
 // 수정된 함수 선언
 int add_forward_link(uint32_t source_index, uint32_t target_index);
@@ -52,5 +212,7 @@ int remove_forward_link(uint32_t source_index, uint32_t target_index);
 int remove_backward_link(uint32_t source_index, uint32_t target_index);
 uint32_t* get_forward_links(uint32_t index, uint32_t* count);
 uint32_t* get_backward_links(uint32_t index, uint32_t* count);
+uint32_t read_forward_links(uint32_t index, uint32_t *links);
+uint32_t read_backward_links(uint32_t index, uint32_t *links);
 
 #endif // MESSAGE_HANDLER_H
\ No newline at end of file
@@ -0,0 +1,297 @@
+#include "record_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <json-c/json.h>
+
+// 캐시 항목 하나. 해시 체인과 CLOCK 원형 리스트에 동시에 연결됩니다.
+typedef struct CacheEntry {
+    uint32_t index;
+    uint32_t length;
+    int referenced; // CLOCK 참조 비트
+    char *text;
+    struct CacheEntry *bucket_next;
+    struct CacheEntry *clock_prev;
+    struct CacheEntry *clock_next;
+} CacheEntry;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    CacheEntry *buckets[RECORD_CACHE_BUCKETS];
+    CacheEntry *hand; // CLOCK 바늘
+    size_t bytes;
+    uint64_t entries;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t insertions;
+    uint64_t evictions;
+    uint64_t invalidations;
+} CacheShard;
+
+static CacheShard shards[RECORD_CACHE_SHARDS];
+static size_t shard_budget = 0; // 0이면 캐시 비활성화
+
+static inline CacheShard *shard_for(uint32_t index)
+{
+    return &shards[index & (RECORD_CACHE_SHARDS - 1)];
+}
+
+static inline CacheEntry **bucket_for(CacheShard *shard, uint32_t index)
+{
+    return &shard->buckets[(index / RECORD_CACHE_SHARDS) & (RECORD_CACHE_BUCKETS - 1)];
+}
+
+static inline size_t entry_cost(uint32_t length)
+{
+    return sizeof(CacheEntry) + length + 1;
+}
+
+static CacheEntry *find_entry(CacheShard *shard, uint32_t index)
+{
+    for (CacheEntry *entry = *bucket_for(shard, index); entry != NULL; entry = entry->bucket_next)
+    {
+        if (entry->index == index)
+        {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// 항목을 해시 체인과 CLOCK 리스트에서 떼어내고 해제합니다. shard 락을 잡은 상태여야 합니다.
+static void remove_entry(CacheShard *shard, CacheEntry *entry)
+{
+    CacheEntry **link = bucket_for(shard, entry->index);
+    while (*link != entry)
+    {
+        link = &(*link)->bucket_next;
+    }
+    *link = entry->bucket_next;
+
+    if (entry->clock_next == entry)
+    {
+        shard->hand = NULL;
+    }
+    else
+    {
+        entry->clock_prev->clock_next = entry->clock_next;
+        entry->clock_next->clock_prev = entry->clock_prev;
+        if (shard->hand == entry)
+        {
+            shard->hand = entry->clock_next;
+        }
+    }
+
+    shard->bytes -= entry_cost(entry->length);
+    shard->entries--;
+    free(entry->text);
+    free(entry);
+}
+
+// 예산 안에 들어올 때까지 CLOCK 바늘을 돌리며 참조 비트가 꺼진 항목을 내보냅니다.
+static void evict_for(CacheShard *shard, size_t needed)
+{
+    while (shard->hand != NULL && shard->bytes + needed > shard_budget)
+    {
+        CacheEntry *candidate = shard->hand;
+        if (candidate->referenced)
+        {
+            candidate->referenced = 0;
+            shard->hand = candidate->clock_next;
+        }
+        else
+        {
+            remove_entry(shard, candidate);
+            shard->evictions++;
+        }
+    }
+}
+
+void record_cache_init(size_t budget_bytes)
+{
+    for (int i = 0; i < RECORD_CACHE_SHARDS; i++)
+    {
+        memset(&shards[i], 0, sizeof(CacheShard));
+        pthread_mutex_init(&shards[i].mutex, NULL);
+    }
+    shard_budget = budget_bytes / RECORD_CACHE_SHARDS;
+}
+
+void record_cache_destroy()
+{
+    for (int i = 0; i < RECORD_CACHE_SHARDS; i++)
+    {
+        pthread_mutex_lock(&shards[i].mutex);
+        while (shards[i].hand != NULL)
+        {
+            remove_entry(&shards[i], shards[i].hand);
+        }
+        pthread_mutex_unlock(&shards[i].mutex);
+    }
+    shard_budget = 0;
+}
+
+// 캐시된 메시지의 복사본을 반환합니다. 없으면 NULL (호출자가 해제).
+char *record_cache_get(uint32_t index)
+{
+    return record_cache_get_with(index, NULL);
+}
+
+// record_cache_get()과 같지만 복사본을 alloc으로 잡습니다 (NULL이면 malloc). 요청 arena에 바로 복사할 때 씁니다.
+char *record_cache_get_with(uint32_t index, void *(*alloc)(size_t size))
+{
+    if (shard_budget == 0)
+    {
+        return NULL;
+    }
+
+    CacheShard *shard = shard_for(index);
+    char *copy = NULL;
+
+    pthread_mutex_lock(&shard->mutex);
+    CacheEntry *entry = find_entry(shard, index);
+    if (entry != NULL)
+    {
+        entry->referenced = 1;
+        copy = alloc != NULL ? alloc(entry->length + 1) : malloc(entry->length + 1);
+        if (copy != NULL)
+        {
+            memcpy(copy, entry->text, entry->length + 1);
+        }
+        shard->hits++;
+    }
+    else
+    {
+        shard->misses++;
+    }
+    pthread_mutex_unlock(&shard->mutex);
+    return copy;
+}
+
+// 메시지를 캐시에 넣습니다. 같은 인덱스가 있으면 새 내용으로 바꿉니다.
+void record_cache_put(uint32_t index, const char *text, uint32_t length)
+{
+    size_t cost = entry_cost(length);
+    if (shard_budget == 0 || cost > shard_budget)
+    {
+        return;
+    }
+
+    CacheEntry *entry = malloc(sizeof(CacheEntry));
+    char *copy = malloc(length + 1);
+    if (entry == NULL || copy == NULL)
+    {
+        free(entry);
+        free(copy);
+        return;
+    }
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+
+    entry->index = index;
+    entry->length = length;
+    entry->referenced = 0;
+    entry->text = copy;
+
+    CacheShard *shard = shard_for(index);
+    pthread_mutex_lock(&shard->mutex);
+
+    CacheEntry *existing = find_entry(shard, index);
+    if (existing != NULL)
+    {
+        remove_entry(shard, existing);
+    }
+    evict_for(shard, cost);
+
+    CacheEntry **bucket = bucket_for(shard, index);
+    entry->bucket_next = *bucket;
+    *bucket = entry;
+
+    // 새 항목은 바늘 바로 뒤에 넣어 한 바퀴를 다 돌아야 후보가 되도록 합니다.
+    if (shard->hand == NULL)
+    {
+        entry->clock_prev = entry;
+        entry->clock_next = entry;
+        shard->hand = entry;
+    }
+    else
+    {
+        entry->clock_next = shard->hand;
+        entry->clock_prev = shard->hand->clock_prev;
+        shard->hand->clock_prev->clock_next = entry;
+        shard->hand->clock_prev = entry;
+    }
+
+    shard->bytes += cost;
+    shard->entries++;
+    shard->insertions++;
+    pthread_mutex_unlock(&shard->mutex);
+}
+
+void record_cache_invalidate(uint32_t index)
+{
+    if (shard_budget == 0)
+    {
+        return;
+    }
+
+    CacheShard *shard = shard_for(index);
+    pthread_mutex_lock(&shard->mutex);
+    CacheEntry *entry = find_entry(shard, index);
+    if (entry != NULL)
+    {
+        remove_entry(shard, entry);
+        shard->invalidations++;
+    }
+    pthread_mutex_unlock(&shard->mutex);
+}
+
+RecordCacheStats record_cache_get_stats()
+{
+    RecordCacheStats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    for (int i = 0; i < RECORD_CACHE_SHARDS; i++)
+    {
+        pthread_mutex_lock(&shards[i].mutex);
+        stats.hits += shards[i].hits;
+        stats.misses += shards[i].misses;
+        stats.insertions += shards[i].insertions;
+        stats.evictions += shards[i].evictions;
+        stats.invalidations += shards[i].invalidations;
+        stats.entries += shards[i].entries;
+        stats.bytes += shards[i].bytes;
+        pthread_mutex_unlock(&shards[i].mutex);
+    }
+    stats.budget = (uint64_t)shard_budget * RECORD_CACHE_SHARDS;
+    return stats;
+}
+
+// 캐시 적중/실패/축출 카운터를 JSON 형식으로 반환하는 함수
+char *get_record_cache_stats_info()
+{
+    RecordCacheStats stats = record_cache_get_stats();
+    uint64_t lookups = stats.hits + stats.misses;
+
+    json_object *data = json_object_new_object();
+    json_object_object_add(data, "hits", json_object_new_int64(stats.hits));
+    json_object_object_add(data, "misses", json_object_new_int64(stats.misses));
+    json_object_object_add(data, "hit_ratio", json_object_new_double(lookups > 0 ? (double)stats.hits / lookups : 0.0));
+    json_object_object_add(data, "insertions", json_object_new_int64(stats.insertions));
+    json_object_object_add(data, "evictions", json_object_new_int64(stats.evictions));
+    json_object_object_add(data, "invalidations", json_object_new_int64(stats.invalidations));
+    json_object_object_add(data, "entries", json_object_new_int64(stats.entries));
+    json_object_object_add(data, "bytes", json_object_new_int64(stats.bytes));
+    json_object_object_add(data, "budget", json_object_new_int64(stats.budget));
+
+    json_object *result = json_object_new_object();
+    json_object_object_add(result, "action", json_object_new_string("record_cache_stats"));
+    json_object_object_add(result, "data", data);
+
+    const char *json_string = json_object_to_json_string(result);
+    char *response = strdup(json_string);
+
+    json_object_put(result);
+    return response;
+}
@@ -0,0 +1,32 @@
+#ifndef RECORD_CACHE_H
+#define RECORD_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define RECORD_CACHE_BUDGET (64 * 1024 * 1024) // 기본 메모리 예산 (바이트)
+#define RECORD_CACHE_SHARDS 16                 // 락 경합을 줄이기 위한 shard 수 (2의 거듭제곱)
+#define RECORD_CACHE_BUCKETS 4096              // shard당 해시 버킷 수 (2의 거듭제곱)
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t insertions;
+    uint64_t evictions;
+    uint64_t invalidations;
+    uint64_t entries;
+    uint64_t bytes;
+    uint64_t budget;
+} RecordCacheStats;
+
+// Function declarations
+void record_cache_init(size_t budget_bytes);
+void record_cache_destroy();
+char *record_cache_get(uint32_t index);
+char *record_cache_get_with(uint32_t index, void *(*alloc)(size_t size));
+void record_cache_put(uint32_t index, const char *text, uint32_t length);
+void record_cache_invalidate(uint32_t index);
+RecordCacheStats record_cache_get_stats();
+char *get_record_cache_stats_info();
+
+#endif // RECORD_CACHE_H
@@ -0,0 +1,644 @@
+#include "recovery.h"
+#include "message_handler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <json-c/json.h>
+
+_Static_assert(sizeof(RecordHeader) == RECORD_HEADER_SIZE, "RecordHeader layout must match RECORD_HEADER_SIZE");
+
+typedef enum {
+    RECORD_STATUS_OK,
+    RECORD_STATUS_LEGACY,
+    RECORD_STATUS_CORRUPT,
+    RECORD_STATUS_DELETED
+} RecordStatus;
+
+// 검증 스레드 하나가 맡는 index_table 구간
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+    uint32_t base;   // status[0]에 해당하는 엔트리 위치
+    uint8_t *status;
+} ValidationTask;
+
+// 파일의 한 구간 [start, end)
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+} Extent;
+
+// 인덱스에 없지만 헤더와 CRC가 온전한 레코드
+typedef struct {
+    uint32_t index;
+    int64_t timestamp;
+    uint64_t offset;
+    uint32_t slot_length;
+} ReplayCandidate;
+
+static RecoveryReport report = {0};
+static pthread_mutex_t report_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int compare_extent(const void *a, const void *b)
+{
+    const Extent *ea = a;
+    const Extent *eb = b;
+    if (ea->start < eb->start)
+        return -1;
+    if (ea->start > eb->start)
+        return 1;
+    return 0;
+}
+
+static int compare_candidate(const void *a, const void *b)
+{
+    const ReplayCandidate *ca = a;
+    const ReplayCandidate *cb = b;
+    if (ca->index != cb->index)
+        return ca->index < cb->index ? -1 : 1;
+    if (ca->timestamp != cb->timestamp)
+        return ca->timestamp < cb->timestamp ? -1 : 1;
+    if (ca->offset != cb->offset)
+        return ca->offset < cb->offset ? -1 : 1;
+    return 0;
+}
+
+static double elapsed_ms_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+// 슬롯 하나를 읽어 헤더의 인덱스와 CRC를 확인합니다.
+static RecordStatus validate_entry(const IndexEntry *entry, unsigned char **buffer, uint32_t *buffer_size)
+{
+    if (entry->length == 0)
+    {
+        return RECORD_STATUS_DELETED; // 지워진 메시지는 슬롯이 없음
+    }
+    if (!store_extent_valid(entry->offset, entry->length))
+    {
+        return RECORD_STATUS_CORRUPT;
+    }
+    if (entry->length > *buffer_size)
+    {
+        unsigned char *new_buffer = realloc(*buffer, entry->length);
+        if (new_buffer == NULL)
+        {
+            return RECORD_STATUS_CORRUPT;
+        }
+        *buffer = new_buffer;
+        *buffer_size = entry->length;
+    }
+    if (!read_message_data(entry->offset, *buffer, entry->length))
+    {
+        return RECORD_STATUS_CORRUPT;
+    }
+
+    RecordInfo info;
+    if (!parse_record_header(*buffer, entry->length, &info))
+    {
+        return RECORD_STATUS_CORRUPT;
+    }
+    if (info.legacy)
+    {
+        return RECORD_STATUS_LEGACY;
+    }
+    if ((info.index != entry->index && info.index != RECORD_SHARED_INDEX) || !verify_record_checksum(*buffer, &info))
+    {
+        return RECORD_STATUS_CORRUPT;
+    }
+    return RECORD_STATUS_OK;
+}
+
+static void *validation_worker(void *arg)
+{
+    ValidationTask *task = arg;
+    unsigned char *buffer = NULL;
+    uint32_t buffer_size = 0;
+
+    for (uint32_t i = task->start; i < task->end; i++)
+    {
+        task->status[i - task->base] = validate_entry(&index_table[i], &buffer, &buffer_size);
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+// index_table의 [start, end) 구간을 여러 스레드로 나누어 검증하고 결과를 보고서에 더합니다.
+// pread만 쓰므로 스레드끼리 파일 위치를 공유하지 않습니다.
+static void validate_index_range(uint32_t start, uint32_t end)
+{
+    uint32_t count = end - start;
+    uint8_t *status = malloc(count > 0 ? count : 1);
+    if (status == NULL)
+    {
+        syslog(LOG_ERR, "Memory allocation failed for recovery status");
+        return;
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t threads = count / RECOVERY_MIN_ENTRIES_PER_THREAD;
+    if (cpus > 0 && threads > (uint32_t)cpus)
+        threads = cpus;
+    if (threads > RECOVERY_MAX_THREADS)
+        threads = RECOVERY_MAX_THREADS;
+    if (threads == 0)
+        threads = 1;
+
+    ValidationTask tasks[RECOVERY_MAX_THREADS];
+    pthread_t workers[RECOVERY_MAX_THREADS];
+    int started[RECOVERY_MAX_THREADS] = {0};
+    uint32_t chunk = (count + threads - 1) / threads;
+
+    for (uint32_t t = 0; t < threads; t++)
+    {
+        tasks[t].start = start + (t * chunk < count ? t * chunk : count);
+        tasks[t].end = tasks[t].start + chunk < end ? tasks[t].start + chunk : end;
+        tasks[t].base = start;
+        tasks[t].status = status;
+        // 마지막 구간은 현재 스레드가 직접 처리하고, 스레드를 만들지 못한 구간도 여기서 처리합니다.
+        if (t + 1 < threads && pthread_create(&workers[t], NULL, validation_worker, &tasks[t]) == 0)
+        {
+            started[t] = 1;
+        }
+    }
+    for (uint32_t t = 0; t < threads; t++)
+    {
+        if (!started[t])
+        {
+            validation_worker(&tasks[t]);
+        }
+    }
+    for (uint32_t t = 0; t < threads; t++)
+    {
+        if (started[t])
+        {
+            pthread_join(workers[t], NULL);
+        }
+    }
+
+    pthread_mutex_lock(&report_mutex);
+    if (threads > report.threads)
+    {
+        report.threads = threads;
+    }
+    for (uint32_t i = start; i < end; i++)
+    {
+        if (status[i - start] == RECORD_STATUS_OK)
+        {
+            report.records_verified++;
+        }
+        else if (status[i - start] == RECORD_STATUS_LEGACY)
+        {
+            report.legacy_records++;
+        }
+        else if (status[i - start] == RECORD_STATUS_DELETED)
+        {
+            report.deleted_entries++;
+        }
+        else
+        {
+            if (report.corrupt_records < RECOVERY_MAX_REPORTED)
+            {
+                report.corrupt_indices[report.corrupt_records] = index_table[i].index;
+            }
+            report.corrupt_records++;
+            syslog(LOG_ERR, "Recovery: record %u failed validation (offset %llu, length %u)",
+                   index_table[i].index, (unsigned long long)index_table[i].offset, index_table[i].length);
+        }
+    }
+    pthread_mutex_unlock(&report_mutex);
+    free(status);
+}
+
+static void finish_validation(const struct timespec *start)
+{
+    pthread_mutex_lock(&report_mutex);
+    report.validation_running = 0;
+    report.validation_ms = elapsed_ms_since(start);
+    RecoveryReport result = report;
+    pthread_mutex_unlock(&report_mutex);
+
+    syslog(result.corrupt_records > 0 ? LOG_WARNING : LOG_INFO,
+           "Record validation: %u verified, %u legacy, %u corrupt, %.1f ms on %u threads",
+           result.records_verified, result.legacy_records, result.corrupt_records, result.validation_ms, result.threads);
+}
+
+static pthread_t validation_thread;
+static int validation_thread_started = 0;
+static uint32_t records_to_validate = 0;
+
+// 요청을 처리하면서 레코드를 검증합니다. 라운드마다 read lock을 잡으므로 compaction이나 수정으로
+// 옮겨지는 중인 레코드를 손상으로 잘못 보고하지 않고, 라운드 사이에는 쓰기 요청이 끼어들 수 있습니다.
+static void *background_validation(void *arg)
+{
+    uint32_t count = *(uint32_t *)arg;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (uint32_t round = 0; round < count; round += RECOVERY_VALIDATION_ROUND)
+    {
+        uint32_t end = round + RECOVERY_VALIDATION_ROUND < count ? round + RECOVERY_VALIDATION_ROUND : count;
+        pthread_rwlock_rdlock(&store_lock);
+        validate_index_range(round, end);
+        pthread_rwlock_unlock(&store_lock);
+    }
+
+    finish_validation(&start);
+    return NULL;
+}
+
+// recover_store()가 미뤄 둔 레코드 검증을 시작합니다. main()이 포트를 열고 listen한 뒤에 부릅니다.
+// 스레드를 만들지 못하면 여기서 끝까지 검증합니다.
+void start_recovery_validation()
+{
+    if (!RECOVERY_BACKGROUND_VALIDATION || validation_thread_started)
+    {
+        return;
+    }
+    if (pthread_create(&validation_thread, NULL, background_validation, &records_to_validate) == 0)
+    {
+        validation_thread_started = 1;
+        return;
+    }
+    syslog(LOG_WARNING, "Failed to start background record validation; validating now");
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    validate_index_range(0, records_to_validate);
+    finish_validation(&start);
+}
+
+// 백그라운드 검증이 끝날 때까지 기다립니다 (종료 시 또는 보고서가 완성되어야 할 때).
+void wait_for_recovery_validation()
+{
+    if (validation_thread_started)
+    {
+        pthread_join(validation_thread, NULL);
+        validation_thread_started = 0;
+    }
+}
+
+// 살아 있는 슬롯과 겹치거나 파일 밖을 가리키는 free space 엔트리를 버립니다.
+// modify가 옛 슬롯을 free space에 넣은 뒤 인덱스 조각을 저장하기 전에 죽으면 이런 엔트리가 남습니다.
+// live는 shard가 붙은 offset 순서로 정렬되어 있으므로 shard마다 따로 찾을 필요가 없습니다.
+static int drop_invalid_free_space(const Extent *live, uint32_t live_count)
+{
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        StoreShard *store = &store_shards[shard];
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < store->free_space_size; i++)
+        {
+            uint64_t start = store->free_space[i].offset;
+            uint64_t end = start + store->free_space[i].length;
+            int valid = store->free_space[i].length > 0 && STORE_OFFSET_SHARD(start) == shard &&
+                        store_extent_valid(start, store->free_space[i].length);
+
+            if (valid)
+            {
+                // end > start인 첫 살아 있는 슬롯을 이진 탐색으로 찾아 겹치는지 확인
+                uint32_t lo = 0, hi = live_count;
+                while (lo < hi)
+                {
+                    uint32_t mid = lo + (hi - lo) / 2;
+                    if (live[mid].end <= start)
+                        lo = mid + 1;
+                    else
+                        hi = mid;
+                }
+                for (uint32_t j = lo; j < live_count && live[j].start < end; j++)
+                {
+                    if (live[j].end > start)
+                    {
+                        valid = 0;
+                        break;
+                    }
+                }
+            }
+
+            if (valid)
+            {
+                store->free_space[kept++] = store->free_space[i];
+            }
+            else
+            {
+                report.free_space_dropped++;
+            }
+        }
+        if (kept != store->free_space_size)
+        {
+            store->free_space_size = kept;
+            store->free_space_dirty = 1;
+        }
+    }
+    return report.free_space_dropped > 0;
+}
+
+// 빈틈 [start, end)를 앞에서부터 레코드 단위로 걸으며 인덱스에 없는 레코드를 찾습니다.
+// 헤더가 온전하지 않은 위치를 만나면 그 빈틈의 나머지는 알 수 없는 데이터로 보고 멈춥니다.
+static void scan_gap(uint64_t start, uint64_t end, uint32_t known_entries,
+                     ReplayCandidate **candidates, uint32_t *candidate_count, uint32_t *candidate_capacity)
+{
+    unsigned char header[RECORD_HEADER_SIZE];
+    unsigned char *buffer = NULL;
+    uint64_t pos = start;
+
+    while (pos + RECORD_HEADER_SIZE <= end)
+    {
+        RecordInfo info;
+        if (!read_message_data(pos, header, RECORD_HEADER_SIZE) ||
+            !parse_record_header(header, end - pos > UINT32_MAX ? UINT32_MAX : (uint32_t)(end - pos), &info) ||
+            info.legacy)
+        {
+            break;
+        }
+
+        uint32_t record_length = RECORD_HEADER_SIZE + info.message_length;
+        uint32_t slot_length = slab_class_size(record_length);
+        if (pos + slot_length > end)
+        {
+            break;
+        }
+
+        unsigned char *new_buffer = realloc(buffer, record_length);
+        if (new_buffer == NULL)
+        {
+            break;
+        }
+        buffer = new_buffer;
+        if (!read_message_data(pos, buffer, record_length) || !verify_record_checksum(buffer, &info))
+        {
+            break;
+        }
+
+        // 인덱스에 이미 있는 번호는 옮겨지기 전의 옛 사본이므로 건너뜁니다.
+        if (info.index > known_entries && info.index <= MAX_MESSAGES)
+        {
+            if (*candidate_count == *candidate_capacity)
+            {
+                uint32_t capacity = *candidate_capacity > 0 ? *candidate_capacity * 2 : 64;
+                ReplayCandidate *grown = realloc(*candidates, sizeof(ReplayCandidate) * capacity);
+                if (grown == NULL)
+                {
+                    break;
+                }
+                *candidates = grown;
+                *candidate_capacity = capacity;
+            }
+            ReplayCandidate *candidate = &(*candidates)[(*candidate_count)++];
+            candidate->index = info.index;
+            candidate->timestamp = info.timestamp;
+            candidate->offset = pos;
+            candidate->slot_length = slot_length;
+        }
+        pos += slot_length;
+    }
+
+    free(buffer);
+}
+
+// 인덱스와 free space 어디에도 속하지 않는 구간에서 index.bin 저장 전에 중단된 append를 되살립니다.
+// 되살린 레코드는 링크 없이 인덱스 끝에 번호 순서대로 붙이며, 번호가 끊기면 거기서 멈춥니다.
+static int replay_unindexed_records(Extent *live, uint32_t live_count)
+{
+    uint32_t extent_count = live_count;
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        extent_count += store_shards[shard].free_space_size;
+    }
+    Extent *extents = malloc(sizeof(Extent) * (extent_count > 0 ? extent_count : 1));
+    if (extents == NULL)
+    {
+        syslog(LOG_ERR, "Memory allocation failed for recovery extents");
+        return 0;
+    }
+    memcpy(extents, live, sizeof(Extent) * live_count);
+    uint32_t position = live_count;
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        for (uint32_t i = 0; i < store_shards[shard].free_space_size; i++)
+        {
+            extents[position].start = store_shards[shard].free_space[i].offset;
+            extents[position].end = store_shards[shard].free_space[i].offset + store_shards[shard].free_space[i].length;
+            position++;
+        }
+    }
+    qsort(extents, extent_count, sizeof(Extent), compare_extent);
+
+    ReplayCandidate *candidates = NULL;
+    uint32_t candidate_count = 0, candidate_capacity = 0;
+    uint32_t known_entries = index_table_size;
+    uint64_t gap_bytes = 0;
+    uint64_t covered = 0;
+
+    // shard 파일마다 (옮기기 전의 예전 shard 파일 포함) 빈틈을 훑음. extents는 shard 순서로 모여 있음
+    uint32_t i = 0;
+    for (uint32_t shard = 0; shard < STORE_SHARD_MAX; shard++)
+    {
+        if (store_shards[shard].fd < 0)
+        {
+            continue;
+        }
+        uint64_t shard_end = STORE_OFFSET(shard, store_shards[shard].file_size);
+        covered = STORE_OFFSET(shard, 0);
+        while (i < extent_count && STORE_OFFSET_SHARD(extents[i].start) < shard)
+        {
+            i++;
+        }
+        for (;; i++)
+        {
+            int in_shard = i < extent_count && STORE_OFFSET_SHARD(extents[i].start) == shard;
+            uint64_t next = in_shard && extents[i].start < shard_end ? extents[i].start : shard_end;
+            if (next > covered)
+            {
+                gap_bytes += next - covered;
+                scan_gap(covered, next, known_entries, &candidates, &candidate_count, &candidate_capacity);
+            }
+            if (!in_shard)
+            {
+                break;
+            }
+            if (extents[i].end > covered)
+            {
+                covered = extents[i].end;
+            }
+        }
+    }
+    free(extents);
+
+    // 같은 번호가 여러 개면 가장 나중에 쓰인 사본을 사용
+    qsort(candidates, candidate_count, sizeof(ReplayCandidate), compare_candidate);
+    uint64_t replayed_bytes = 0;
+    for (uint32_t i = 0; i < candidate_count; i++)
+    {
+        if (i + 1 < candidate_count && candidates[i + 1].index == candidates[i].index)
+        {
+            continue;
+        }
+        if (candidates[i].index != index_table_size + 1)
+        {
+            break;
+        }
+
+        IndexEntry *entry = &index_table[index_table_size];
+        memset(entry, 0, sizeof(IndexEntry));
+        entry->index = candidates[i].index;
+        entry->offset = candidates[i].offset;
+        entry->length = candidates[i].slot_length;
+        entry->version = 1;
+        index_table_size++;
+
+        replayed_bytes += candidates[i].slot_length;
+        report.records_replayed++;
+        syslog(LOG_INFO, "Recovery: replayed record %u from offset %llu", entry->index, (unsigned long long)entry->offset);
+    }
+    free(candidates);
+
+    report.unreferenced_bytes = gap_bytes - replayed_bytes;
+    return report.records_replayed > 0;
+}
+
+// 시작할 때 인덱스와 free space 테이블을 읽고 shard 데이터 파일들과 맞춰 봅니다.
+// open_message_file() 다음, 클라이언트를 받기 전에 호출해야 합니다.
+// 인덱스/free space 복구와 재생은 여기서 끝내고, 레코드 CRC 검증은 RECOVERY_BACKGROUND_VALIDATION이면
+// 요청을 받기 시작한 뒤 백그라운드에서 진행합니다 (읽기 경로가 이미 CRC를 확인하므로 검증 결과는 보고용입니다).
+RecoveryReport recover_store()
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    pthread_mutex_lock(&report_mutex);
+    memset(&report, 0, sizeof(report));
+    pthread_mutex_unlock(&report_mutex);
+
+    initialize_index_table();
+    initialize_free_space_table();
+
+    pthread_mutex_lock(&report_mutex);
+    report.index_load_ms = elapsed_ms_since(&start);
+    report.entries_loaded = index_table_size;
+    report.index_truncated = index_load_truncated;
+    report.free_space_reset = free_space_load_failed;
+    pthread_mutex_unlock(&report_mutex);
+
+    Extent *live = malloc(sizeof(Extent) * (index_table_size > 0 ? index_table_size : 1));
+    int index_changed = index_load_truncated;
+    int free_space_changed = free_space_load_failed;
+    if (live != NULL)
+    {
+        for (uint32_t i = 0; i < index_table_size; i++)
+        {
+            live[i].start = index_table[i].offset;
+            live[i].end = index_table[i].offset + index_table[i].length;
+        }
+        qsort(live, index_table_size, sizeof(Extent), compare_extent);
+
+        free_space_changed |= drop_invalid_free_space(live, index_table_size);
+        index_changed |= replay_unindexed_records(live, index_table_size);
+        free(live);
+    }
+    else
+    {
+        syslog(LOG_ERR, "Memory allocation failed for recovery extents");
+    }
+
+    if (index_changed)
+    {
+        save_index_table();
+    }
+    if (free_space_changed)
+    {
+        save_free_space_table();
+    }
+    // 예전 단일 messages.bin이나 다른 shard 수로 쓴 레코드를 맡은 shard 파일로 옮김 (옮기면 인덱스도 저장됨)
+    report.records_relocated = relocate_foreign_records();
+
+    records_to_validate = index_table_size;
+
+    pthread_mutex_lock(&report_mutex);
+    report.records_to_validate = records_to_validate;
+    report.validation_running = 1;
+    pthread_mutex_unlock(&report_mutex);
+
+    // 백그라운드 검증은 포트를 연 뒤 start_recovery_validation()이 시작함
+    int background = RECOVERY_BACKGROUND_VALIDATION;
+    if (!background)
+    {
+        struct timespec validation_start;
+        clock_gettime(CLOCK_MONOTONIC, &validation_start);
+        validate_index_range(0, records_to_validate);
+        finish_validation(&validation_start);
+    }
+
+    pthread_mutex_lock(&report_mutex);
+    report.elapsed_ms = elapsed_ms_since(&start);
+    RecoveryReport result = report;
+    pthread_mutex_unlock(&report_mutex);
+
+    printf("Startup recovery: %u entries loaded in %.1f ms, %u replayed, %u relocated, %u free space entries dropped, ready in %.1f ms (record validation %s)\n",
+           result.entries_loaded, result.index_load_ms, result.records_replayed, result.records_relocated, result.free_space_dropped,
+           result.elapsed_ms, background ? "deferred to background" : "done");
+    syslog(result.index_truncated ? LOG_WARNING : LOG_INFO,
+           "Startup recovery: %u entries loaded in %.1f ms, %u replayed, %u free space entries dropped, ready in %.1f ms",
+           result.entries_loaded, result.index_load_ms, result.records_replayed, result.free_space_dropped, result.elapsed_ms);
+    return result;
+}
+
+RecoveryReport get_recovery_report()
+{
+    pthread_mutex_lock(&report_mutex);
+    RecoveryReport current = report;
+    pthread_mutex_unlock(&report_mutex);
+    return current;
+}
+
+// 마지막 시작 시 복구 결과를 JSON 형식으로 반환하는 함수
+char *get_recovery_report_info()
+{
+    RecoveryReport current = get_recovery_report();
+
+    json_object *data = json_object_new_object();
+    json_object_object_add(data, "entries_loaded", json_object_new_int(current.entries_loaded));
+    json_object_object_add(data, "index_truncated", json_object_new_boolean(current.index_truncated));
+    json_object_object_add(data, "free_space_reset", json_object_new_boolean(current.free_space_reset));
+    json_object_object_add(data, "index_load_ms", json_object_new_double(current.index_load_ms));
+    json_object_object_add(data, "validation_running", json_object_new_boolean(current.validation_running));
+    json_object_object_add(data, "threads", json_object_new_int(current.threads));
+    json_object_object_add(data, "records_to_validate", json_object_new_int(current.records_to_validate));
+    json_object_object_add(data, "records_verified", json_object_new_int(current.records_verified));
+    json_object_object_add(data, "legacy_records", json_object_new_int(current.legacy_records));
+    json_object_object_add(data, "corrupt_records", json_object_new_int(current.corrupt_records));
+    json_object_object_add(data, "deleted_entries", json_object_new_int(current.deleted_entries));
+
+    json_object *corrupt_array = json_object_new_array();
+    uint32_t listed = current.corrupt_records < RECOVERY_MAX_REPORTED ? current.corrupt_records : RECOVERY_MAX_REPORTED;
+    for (uint32_t i = 0; i < listed; i++)
+    {
+        json_object_array_add(corrupt_array, json_object_new_int(current.corrupt_indices[i]));
+    }
+    json_object_object_add(data, "corrupt_indices", corrupt_array);
+
+    json_object_object_add(data, "free_space_dropped", json_object_new_int(current.free_space_dropped));
+    json_object_object_add(data, "records_replayed", json_object_new_int(current.records_replayed));
+    json_object_object_add(data, "records_relocated", json_object_new_int(current.records_relocated));
+    json_object_object_add(data, "unreferenced_bytes", json_object_new_int64(current.unreferenced_bytes));
+    json_object_object_add(data, "elapsed_ms", json_object_new_double(current.elapsed_ms));
+    json_object_object_add(data, "validation_ms", json_object_new_double(current.validation_ms));
+
+    json_object *result = json_object_new_object();
+    json_object_object_add(result, "action", json_object_new_string("recovery_report"));
+    json_object_object_add(result, "data", data);
+
+    const char *json_string = json_object_to_json_string(result);
+    char *response = strdup(json_string);
+
+    json_object_put(result);
+    return response;
+}
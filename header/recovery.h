@@ -0,0 +1,40 @@
+#ifndef RECOVERY_H
+#define RECOVERY_H
+
+#include <stdint.h>
+
+#define RECOVERY_MAX_THREADS 8               // 인덱스 검증에 쓰는 최대 스레드 수
+#define RECOVERY_MIN_ENTRIES_PER_THREAD 4096 // 스레드 하나가 맡는 최소 엔트리 수
+#define RECOVERY_MAX_REPORTED 64             // 보고서에 담는 손상 레코드 인덱스 수
+#define RECOVERY_BACKGROUND_VALIDATION 1     // 1이면 레코드 CRC 검증을 포트를 연 뒤 백그라운드에서 진행
+#define RECOVERY_VALIDATION_ROUND 16384      // 백그라운드 검증에서 read lock 한 번에 검사하는 엔트리 수
+
+typedef struct {
+    uint32_t entries_loaded;      // index.bin에서 읽은 엔트리 수
+    int index_truncated;          // index.bin이 잘려 있었는지
+    int free_space_reset;         // free_space.bin을 읽지 못해 비웠는지
+    double index_load_ms;         // index.bin / free_space.bin을 읽는 데 걸린 시간
+    int validation_running;       // 백그라운드 검증이 진행 중인지
+    uint32_t threads;             // 검증에 사용한 스레드 수
+    uint32_t records_to_validate; // 검증 대상 레코드 수
+    uint32_t records_verified;    // CRC가 맞는 레코드 수
+    uint32_t legacy_records;      // CRC 헤더가 없는 이전 형식 레코드 수
+    uint32_t corrupt_records;     // 헤더/CRC가 맞지 않거나 읽을 수 없는 레코드 수
+    uint32_t deleted_entries;     // 지워진 메시지 (검증할 슬롯이 없음)
+    uint32_t corrupt_indices[RECOVERY_MAX_REPORTED];
+    uint32_t free_space_dropped;  // 살아 있는 레코드와 겹쳐 버린 free space 엔트리 수
+    uint32_t records_replayed;    // 인덱스에 없던 레코드를 데이터 파일에서 되살린 수
+    uint32_t records_relocated;   // 맡은 shard가 아닌 데이터 파일에 있어 그 shard 파일로 옮긴 레코드 수
+    uint64_t unreferenced_bytes;  // 인덱스와 free space 어디에도 속하지 않는 바이트 (compaction이 회수)
+    double elapsed_ms;            // 요청을 받기 전까지 걸린 시간
+    double validation_ms;         // 레코드 검증에 걸린 시간
+} RecoveryReport;
+
+// Function declarations
+RecoveryReport recover_store();
+void start_recovery_validation();
+void wait_for_recovery_validation();
+RecoveryReport get_recovery_report();
+char *get_recovery_report_info();
+
+#endif // RECOVERY_H
@@ -0,0 +1,910 @@
+#include "replication.h"
+#include "message_handler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <json-c/json.h>
+
+// 주 서버: 저장소를 바꾸는 쪽(store_lock 쓰기)이 변경을 프레임으로 만들어 메모리 로그 링에 쌓고,
+// 복제본마다 하나인 송신 스레드가 링을 따라가며 Unix 소켓으로 보냅니다. 처음 붙은 복제본 (또는 링보다
+// 뒤처진 복제본)에는 먼저 저장소 전체를 보내고 (전체 동기화) 그 시작 시점의 로그 위치부터 이어 보냅니다.
+// 복제본: 받은 프레임을 저장소 함수로 그대로 적용하며 읽기 요청만 받습니다. 적용한 위치를 ACK로 돌려줍니다.
+//
+// 전체 동기화는 덩어리마다 read lock을 잡고 읽으므로 그사이의 쓰기가 동기화 결과에 섞일 수 있지만,
+// 그 쓰기들은 모두 시작 위치 뒤의 로그에 있고 적용이 멱등(같은 인덱스에 덮어쓰기, 있는 링크는 건너뜀)이라 결국 같아집니다.
+
+typedef struct {
+    int active;
+    int fd;
+    int syncing;
+    int pinned;                 // 전체 동기화를 시작한 뒤 처음 따라잡을 때까지 sent 뒤의 로그를 지우지 않게 함
+    uint64_t sent;              // 보낸 로그 위치
+    uint64_t acked;             // 복제본이 적용했다고 알린 로그 위치
+    uint64_t apply_delay_ms;    // 복제본이 마지막 ACK에서 알린 적용 지연 (변경 기록부터 복제본 적용까지)
+    uint32_t synced_entries;    // 전체 동기화로 보낸 메시지 수
+    time_t connected_at;
+} ReplicaConnection;
+
+typedef struct {
+    int connected;
+    int syncing;
+    uint64_t epoch;             // 따라가는 주 서버 로그 (0이면 아직 없음, 다음 연결에서 전체 동기화)
+    uint64_t position;          // 적용한 로그 위치
+    uint64_t primary_position;  // 주 서버가 알려 준 로그 끝 위치
+    uint64_t applied;           // 적용한 변경 수
+    uint64_t synced_entries;    // 전체 동기화로 받은 메시지 수
+    uint32_t syncs;             // 전체 동기화 횟수
+    uint32_t failed_syncs;      // 전체 동기화를 받고도 따라잡기 전에 끊긴 연결이 이어진 수
+    int stopped;                // failed_syncs가 REPLICATION_MAX_FAILED_SYNCS에 닿아 더 연결하지 않음
+    uint32_t connects;
+    uint64_t apply_delay_ms;    // 마지막 변경이 주 서버에 기록된 뒤 여기서 적용되기까지 걸린 시간
+    uint64_t last_frame_ms;     // 마지막으로 프레임을 받은 시각
+} ReplicaState;
+
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_cond = PTHREAD_COND_INITIALIZER;
+static unsigned char *log_ring = NULL;
+static uint64_t log_capacity = REPLICATION_LOG_BYTES; // 동기화 중인 복제본이 있으면 REPLICATION_LOG_MAX_BYTES까지 늘어남
+static uint64_t log_start = 0;  // 링에 남아 있는 가장 오래된 프레임 위치
+static uint64_t log_end = 0;
+static uint64_t log_epoch = 0;
+static uint64_t log_frames = 0;
+static int log_enabled = 0;     // 복제본이 한 번이라도 붙은 뒤로는 계속 기록 (끊긴 복제본이 이어 받을 수 있도록)
+static ReplicaConnection replicas[REPLICATION_MAX_REPLICAS];
+
+static int running = 0;
+static int listen_fd = -1;
+static int replica_mode = 0;
+static char primary_socket[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static ReplicaState replica_state = {0};
+static pthread_mutex_t replica_state_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t now_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void ring_copy_in(uint64_t position, const void *data, uint32_t length)
+{
+    uint64_t at = position % log_capacity;
+    uint32_t first = log_capacity - at < length ? (uint32_t)(log_capacity - at) : length;
+    memcpy(log_ring + at, data, first);
+    memcpy(log_ring, (const unsigned char *)data + first, length - first);
+}
+
+static void ring_copy_out(uint64_t position, void *out, uint32_t length)
+{
+    uint64_t at = position % log_capacity;
+    uint32_t first = log_capacity - at < length ? (uint32_t)(log_capacity - at) : length;
+    memcpy(out, log_ring + at, first);
+    memcpy((unsigned char *)out + first, log_ring, length - first);
+}
+
+// 전체 동기화 뒤 아직 따라잡지 못한 복제본이 이어 받을 가장 앞 위치 (없으면 UINT64_MAX). log_lock을 잡고 부릅니다.
+static uint64_t log_pin()
+{
+    uint64_t pin = UINT64_MAX;
+    for (int i = 0; i < REPLICATION_MAX_REPLICAS; i++)
+    {
+        if (replicas[i].active && replicas[i].pinned && replicas[i].sent < pin)
+        {
+            pin = replicas[i].sent;
+        }
+    }
+    return pin;
+}
+
+// 링을 두 배로 늘리고 [log_start, log_end)를 새 링의 같은 위치로 옮깁니다. log_lock을 잡고 부릅니다.
+// REPLICATION_LOG_MAX_BYTES를 넘거나 메모리가 없으면 0을 반환합니다.
+static int grow_log_ring()
+{
+    uint64_t capacity = log_capacity * 2;
+    if (capacity > REPLICATION_LOG_MAX_BYTES)
+    {
+        return 0;
+    }
+    unsigned char *grown = malloc(capacity);
+    if (grown == NULL)
+    {
+        syslog(LOG_ERR, "Failed to grow replication log");
+        return 0;
+    }
+    for (uint64_t position = log_start; position < log_end;)
+    {
+        uint64_t from = position % log_capacity, to = position % capacity;
+        uint64_t length = log_end - position;
+        length = log_capacity - from < length ? log_capacity - from : length;
+        length = capacity - to < length ? capacity - to : length;
+        memcpy(grown + to, log_ring + from, length);
+        position += length;
+    }
+    free(log_ring);
+    log_ring = grown;
+    log_capacity = capacity;
+    syslog(LOG_INFO, "Replication log grown to %llu bytes for a synchronizing replica", (unsigned long long)capacity);
+    return 1;
+}
+
+// 프레임 하나를 로그에 붙입니다. store_lock을 쓰기로 잡은 저장소 변경 경로에서 불리므로 로그 순서가 곧 적용 순서입니다.
+static void log_frame(ReplicationFrame *frame, const void *body)
+{
+    if (!log_enabled)
+    {
+        return; // log_enabled는 store_lock 아래에서만 바뀜
+    }
+    frame->commit_ms = now_ms();
+    uint64_t size = sizeof(ReplicationFrame) + frame->length;
+
+    pthread_mutex_lock(&log_lock);
+    uint64_t pin = log_pin();
+    while (size > log_capacity && pin != UINT64_MAX && grow_log_ring())
+    {
+    }
+    if (size > log_capacity)
+    {
+        // 링에 들어가지 않는 변경: 로그를 비워 모든 복제본이 전체 동기화하게 함
+        log_end += size;
+        log_start = log_end;
+    }
+    else
+    {
+        while (log_end + size - log_start > log_capacity)
+        {
+            // 동기화한 복제본이 아직 보내지 못한 프레임이면 지우지 않고 링을 늘림 (더 늘릴 수 없으면 그 복제본은 다시 동기화)
+            if (log_start >= pin && grow_log_ring())
+            {
+                continue;
+            }
+            ReplicationFrame oldest;
+            ring_copy_out(log_start, &oldest, sizeof(oldest));
+            log_start += sizeof(ReplicationFrame) + oldest.length;
+        }
+        ring_copy_in(log_end, frame, sizeof(ReplicationFrame));
+        if (frame->length > 0)
+        {
+            ring_copy_in(log_end + sizeof(ReplicationFrame), body, frame->length);
+        }
+        log_end += size;
+    }
+    log_frames++;
+    pthread_cond_broadcast(&log_cond);
+    pthread_mutex_unlock(&log_lock);
+}
+
+void replication_on_append(uint32_t index, const char *message, uint32_t length, int64_t timestamp)
+{
+    ReplicationFrame frame = {length, REPLICATION_APPEND, {0}, index, 1, timestamp, 0, 0};
+    log_frame(&frame, message);
+}
+
+void replication_on_modify(uint32_t index, uint32_t version, const char *message, uint32_t length, int64_t timestamp)
+{
+    ReplicationFrame frame = {length, REPLICATION_MODIFY, {0}, index, version, timestamp, 0, 0};
+    log_frame(&frame, message);
+}
+
+void replication_on_delete(uint32_t index)
+{
+    ReplicationFrame frame = {0, REPLICATION_DELETE, {0}, index, 0, 0, 0, 0};
+    log_frame(&frame, NULL);
+}
+
+void replication_on_link(int type, uint32_t source, uint32_t target)
+{
+    ReplicationFrame frame = {0, (uint8_t)type, {0}, source, target, 0, 0, 0};
+    log_frame(&frame, NULL);
+}
+
+static int send_all(int fd, const void *data, size_t length)
+{
+    size_t done = 0;
+    while (done < length)
+    {
+        ssize_t n = send(fd, (const char *)data + done, length - done, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return 0;
+        }
+        done += n;
+    }
+    return 1;
+}
+
+// 제한 시간 안에 length 바이트를 모두 받습니다. 실패하거나 시간이 지나면 0을 반환합니다.
+static int recv_all(int fd, void *data, size_t length, int timeout_ms)
+{
+    size_t done = 0;
+    while (done < length)
+    {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, timeout_ms) <= 0)
+        {
+            return 0;
+        }
+        ssize_t n = recv(fd, (char *)data + done, length - done, 0);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return 0;
+        }
+        done += n;
+    }
+    return 1;
+}
+
+// 송신 버퍼에 SYNC_ENTRY 프레임을 붙입니다. 필요하면 버퍼를 늘립니다.
+static int append_sync_entry(unsigned char **buffer, size_t *used, size_t *capacity, const IndexEntry *entry, const char *text, int64_t timestamp)
+{
+    uint32_t text_length = text != NULL ? strlen(text) : 0;
+    uint32_t link_bytes = sizeof(uint32_t) * (entry->forward_link_count + entry->backward_link_count);
+    ReplicationFrame frame = {2 * sizeof(uint32_t) + link_bytes + text_length, REPLICATION_SYNC_ENTRY, {0},
+                              entry->index, entry->version, timestamp, 0, now_ms()};
+    size_t needed = *used + sizeof(frame) + frame.length;
+    if (needed > *capacity)
+    {
+        size_t new_capacity = needed * 2;
+        unsigned char *grown = realloc(*buffer, new_capacity);
+        if (grown == NULL)
+        {
+            return 0;
+        }
+        *buffer = grown;
+        *capacity = new_capacity;
+    }
+    unsigned char *p = *buffer + *used;
+    memcpy(p, &frame, sizeof(frame));
+    p += sizeof(frame);
+    memcpy(p, &entry->forward_link_count, sizeof(uint32_t));
+    memcpy(p + sizeof(uint32_t), &entry->backward_link_count, sizeof(uint32_t));
+    p += 2 * sizeof(uint32_t);
+    memcpy(p, entry->forward_links, sizeof(uint32_t) * entry->forward_link_count);
+    p += sizeof(uint32_t) * entry->forward_link_count;
+    memcpy(p, entry->backward_links, sizeof(uint32_t) * entry->backward_link_count);
+    p += sizeof(uint32_t) * entry->backward_link_count;
+    if (text_length > 0)
+    {
+        memcpy(p, text, text_length);
+    }
+    *used = needed;
+    return 1;
+}
+
+// 저장소 전체를 REPLICATION_SYNC_BATCH개씩 read lock 아래에서 읽어 보냅니다.
+static int send_full_sync(ReplicaConnection *connection, uint64_t start_position)
+{
+    size_t capacity = 256 * 1024, used = 0;
+    unsigned char *buffer = malloc(capacity);
+    uint32_t ids[REPLICATION_SYNC_BATCH];
+    int64_t timestamps[REPLICATION_SYNC_BATCH];
+    int ok = buffer != NULL;
+    uint32_t next = 1;
+    uint32_t total = 0;
+
+    while (ok && running)
+    {
+        uint32_t size = __atomic_load_n(&index_table_size, __ATOMIC_ACQUIRE);
+        if (next > size)
+        {
+            total = size;
+            break;
+        }
+        uint32_t count = size - next + 1 < REPLICATION_SYNC_BATCH ? size - next + 1 : REPLICATION_SYNC_BATCH;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            ids[i] = next + i;
+        }
+        read_record_timestamps(ids, count, timestamps);
+
+        used = 0;
+        pthread_rwlock_rdlock(&store_lock);
+        for (uint32_t i = 0; ok && i < count; i++)
+        {
+            char *text = read_message_text_locked(ids[i]);
+            ok = append_sync_entry(&buffer, &used, &capacity, &index_table[ids[i] - 1], text, timestamps[i]);
+            free(text);
+        }
+        pthread_rwlock_unlock(&store_lock);
+
+        ok = ok && send_all(connection->fd, buffer, used);
+        next += count;
+        pthread_mutex_lock(&log_lock);
+        connection->synced_entries += count;
+        pthread_mutex_unlock(&log_lock);
+    }
+    free(buffer);
+
+    ReplicationFrame end = {0, REPLICATION_SYNC_END, {0}, 0, total, (int64_t)log_epoch, start_position, now_ms()};
+    return ok && running && send_all(connection->fd, &end, sizeof(end));
+}
+
+// 복제본이 보낸 ACK를 기다리지 않고 모두 읽습니다. 연결이 끊겼으면 0을 반환합니다.
+static int drain_acks(ReplicaConnection *connection, unsigned char *pending, uint32_t *pending_length)
+{
+    for (;;)
+    {
+        ssize_t n = recv(connection->fd, pending + *pending_length, sizeof(ReplicationFrame) - *pending_length, MSG_DONTWAIT);
+        if (n == 0)
+        {
+            return 0;
+        }
+        if (n < 0)
+        {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        *pending_length += n;
+        if (*pending_length == sizeof(ReplicationFrame))
+        {
+            ReplicationFrame ack;
+            memcpy(&ack, pending, sizeof(ack));
+            *pending_length = 0;
+            if (ack.type == REPLICATION_ACK)
+            {
+                pthread_mutex_lock(&log_lock);
+                connection->acked = ack.position;
+                connection->apply_delay_ms = ack.timestamp;
+                pthread_mutex_unlock(&log_lock);
+            }
+        }
+    }
+}
+
+static void *replica_sender_thread(void *arg)
+{
+    ReplicaConnection *connection = arg;
+    unsigned char *chunk = malloc(REPLICATION_SEND_CHUNK);
+    ReplicationFrame hello;
+    if (chunk == NULL || !recv_all(connection->fd, &hello, sizeof(hello), REPLICATION_TIMEOUT_MS) || hello.type != REPLICATION_HELLO)
+    {
+        goto done;
+    }
+
+    // 이 시점까지의 변경은 모두 저장소에 반영되어 있고 이후 변경은 모두 로그에 남도록 read lock 아래에서 위치를 정함
+    pthread_rwlock_rdlock(&store_lock);
+    pthread_mutex_lock(&log_lock);
+    log_enabled = 1;
+    int resume = (uint64_t)hello.timestamp == log_epoch && hello.position >= log_start && hello.position <= log_end;
+    uint64_t cursor = resume ? hello.position : log_end;
+    connection->syncing = !resume;
+    connection->pinned = !resume;
+    connection->sent = connection->acked = cursor;
+    pthread_mutex_unlock(&log_lock);
+    pthread_rwlock_unlock(&store_lock);
+
+    if (resume)
+    {
+        ReplicationFrame end = {0, REPLICATION_SYNC_END, {0}, 0, get_max_index(), (int64_t)log_epoch, cursor, now_ms()};
+        if (!send_all(connection->fd, &end, sizeof(end)))
+        {
+            goto done;
+        }
+        syslog(LOG_INFO, "Replica resumed at log position %llu", (unsigned long long)cursor);
+    }
+    else if (!send_full_sync(connection, cursor))
+    {
+        goto done;
+    }
+    else
+    {
+        syslog(LOG_INFO, "Replica synchronized %u entries", connection->synced_entries);
+    }
+    pthread_mutex_lock(&log_lock);
+    connection->syncing = 0;
+    pthread_mutex_unlock(&log_lock);
+
+    unsigned char pending[sizeof(ReplicationFrame)];
+    uint32_t pending_length = 0;
+    uint64_t last_heartbeat = 0;
+    while (running)
+    {
+        pthread_mutex_lock(&log_lock);
+        if (cursor == log_end)
+        {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += REPLICATION_HEARTBEAT_MS * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&log_cond, &log_lock, &deadline);
+        }
+        if (cursor < log_start)
+        {
+            pthread_mutex_unlock(&log_lock);
+            syslog(LOG_WARNING, "Replica fell behind the replication log, it will resynchronize");
+            break;
+        }
+        uint64_t head = log_end;
+        uint32_t length = head - cursor < REPLICATION_SEND_CHUNK ? (uint32_t)(head - cursor) : REPLICATION_SEND_CHUNK;
+        ring_copy_out(cursor, chunk, length);
+        pthread_mutex_unlock(&log_lock);
+
+        if (length > 0 && !send_all(connection->fd, chunk, length))
+        {
+            break;
+        }
+        cursor += length;
+        uint64_t now = now_ms();
+        // 덩어리는 프레임 경계와 상관없이 잘리므로 heartbeat는 로그 끝(프레임 경계)까지 다 보냈을 때만 끼워 넣음
+        if (cursor == head && now - last_heartbeat >= REPLICATION_HEARTBEAT_MS)
+        {
+            ReplicationFrame heartbeat = {0, REPLICATION_HEARTBEAT, {0}, 0, 0, 0, head, now};
+            if (!send_all(connection->fd, &heartbeat, sizeof(heartbeat)))
+            {
+                break;
+            }
+            last_heartbeat = now;
+        }
+        pthread_mutex_lock(&log_lock);
+        connection->sent = cursor;
+        if (cursor == head)
+        {
+            connection->pinned = 0;
+        }
+        pthread_mutex_unlock(&log_lock);
+        if (!drain_acks(connection, pending, &pending_length))
+        {
+            break;
+        }
+    }
+
+done:
+    free(chunk);
+    close(connection->fd);
+    pthread_mutex_lock(&log_lock);
+    connection->active = 0;
+    pthread_mutex_unlock(&log_lock);
+    syslog(LOG_INFO, "Replica disconnected");
+    return NULL;
+}
+
+static void *accept_thread(void *arg)
+{
+    (void)arg;
+    while (running)
+    {
+        struct pollfd pfd = {listen_fd, POLLIN, 0};
+        if (poll(&pfd, 1, REPLICATION_HEARTBEAT_MS) <= 0)
+        {
+            continue;
+        }
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        ReplicaConnection *connection = NULL;
+        pthread_mutex_lock(&log_lock);
+        for (int i = 0; i < REPLICATION_MAX_REPLICAS && connection == NULL; i++)
+        {
+            if (!replicas[i].active)
+            {
+                connection = &replicas[i];
+                memset(connection, 0, sizeof(*connection));
+                connection->active = 1;
+                connection->fd = fd;
+                connection->connected_at = time(NULL);
+            }
+        }
+        pthread_mutex_unlock(&log_lock);
+
+        pthread_t thread;
+        if (connection == NULL)
+        {
+            syslog(LOG_WARNING, "Replication: too many replicas, connection refused");
+            close(fd);
+        }
+        else if (pthread_create(&thread, NULL, replica_sender_thread, connection) != 0)
+        {
+            syslog(LOG_ERR, "Failed to create replica sender thread");
+            close(fd);
+            pthread_mutex_lock(&log_lock);
+            connection->active = 0;
+            pthread_mutex_unlock(&log_lock);
+        }
+        else
+        {
+            pthread_detach(thread);
+        }
+    }
+    return NULL;
+}
+
+// 주 서버로서 REPLICATION_SOCKET에서 복제본을 받기 시작합니다.
+int replication_start_primary()
+{
+    log_ring = malloc(REPLICATION_LOG_BYTES);
+    if (log_ring == NULL)
+    {
+        syslog(LOG_ERR, "Failed to allocate replication log");
+        return 0;
+    }
+    log_epoch = ((uint64_t)time(NULL) << 20) ^ (uint64_t)getpid();
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", REPLICATION_SOCKET);
+    unlink(REPLICATION_SOCKET); // 이전 실행이 남긴 소켓 파일
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_fd, REPLICATION_MAX_REPLICAS) != 0)
+    {
+        syslog(LOG_ERR, "Replication: cannot listen on %s: %s", REPLICATION_SOCKET, strerror(errno));
+        if (listen_fd >= 0)
+        {
+            close(listen_fd);
+            listen_fd = -1;
+        }
+        return 0;
+    }
+
+    running = 1;
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, accept_thread, NULL) != 0)
+    {
+        syslog(LOG_ERR, "Failed to create replication accept thread");
+        running = 0;
+        return 0;
+    }
+    pthread_detach(thread);
+    syslog(LOG_INFO, "Replication: accepting replicas on %s", REPLICATION_SOCKET);
+    return 1;
+}
+
+static void send_ack(int fd)
+{
+    pthread_mutex_lock(&replica_state_lock);
+    ReplicationFrame ack = {0, REPLICATION_ACK, {0}, 0, 0, (int64_t)replica_state.apply_delay_ms, replica_state.position, now_ms()};
+    pthread_mutex_unlock(&replica_state_lock);
+    send_all(fd, &ack, sizeof(ack));
+}
+
+// 받은 프레임 하나를 저장소에 적용합니다. 이어 받을 수 없으면 (인덱스가 비거나 어긋나면) 0을 반환합니다.
+static int apply_frame(const ReplicationFrame *frame, const unsigned char *body)
+{
+    int ok = 1;
+    char *text = NULL;
+    switch (frame->type)
+    {
+    case REPLICATION_SYNC_ENTRY:
+    {
+        uint32_t counts[2];
+        if (frame->length < sizeof(counts))
+        {
+            return 0;
+        }
+        memcpy(counts, body, sizeof(counts));
+        uint32_t link_bytes = sizeof(uint32_t) * (counts[0] + counts[1]);
+        if (counts[0] > MAX_LINKS || counts[1] > MAX_LINKS || sizeof(counts) + link_bytes > frame->length)
+        {
+            return 0;
+        }
+        uint32_t links[2 * MAX_LINKS];
+        memcpy(links, body + sizeof(counts), link_bytes);
+        uint32_t text_length = frame->length - sizeof(counts) - link_bytes;
+        text = malloc(text_length + 1);
+        if (text == NULL)
+        {
+            return 0;
+        }
+        memcpy(text, body + sizeof(counts) + link_bytes, text_length);
+        text[text_length] = '\0';
+        ok = apply_replicated_message(frame->index, frame->aux, text, frame->timestamp) &&
+             apply_replicated_links(frame->index, links, counts[0], links + counts[0], counts[1]);
+        pthread_mutex_lock(&replica_state_lock);
+        replica_state.syncing = 1;
+        replica_state.synced_entries++;
+        pthread_mutex_unlock(&replica_state_lock);
+        break;
+    }
+    case REPLICATION_SYNC_END:
+        pthread_mutex_lock(&replica_state_lock);
+        if (replica_state.syncing)
+        {
+            replica_state.syncs++;
+        }
+        replica_state.syncing = 0;
+        replica_state.epoch = frame->timestamp;
+        replica_state.position = replica_state.primary_position = frame->position;
+        pthread_mutex_unlock(&replica_state_lock);
+        if (get_max_index() > frame->aux)
+        {
+            syslog(LOG_WARNING, "Replica has %u messages but the primary has %u", get_max_index(), frame->aux);
+        }
+        break;
+    case REPLICATION_HEARTBEAT:
+        pthread_mutex_lock(&replica_state_lock);
+        if (frame->position > replica_state.primary_position)
+        {
+            replica_state.primary_position = frame->position;
+        }
+        pthread_mutex_unlock(&replica_state_lock);
+        break;
+    case REPLICATION_APPEND:
+    case REPLICATION_MODIFY:
+        text = malloc(frame->length + 1);
+        if (text == NULL)
+        {
+            return 0;
+        }
+        memcpy(text, body, frame->length);
+        text[frame->length] = '\0';
+        ok = apply_replicated_message(frame->index, frame->aux, text, frame->timestamp);
+        break;
+    case REPLICATION_ADD_FORWARD_LINK:
+        add_forward_link(frame->index, frame->aux);
+        break;
+    case REPLICATION_ADD_BACKWARD_LINK:
+        add_backward_link(frame->index, frame->aux);
+        break;
+    case REPLICATION_REMOVE_FORWARD_LINK:
+        remove_forward_link(frame->index, frame->aux);
+        break;
+    case REPLICATION_REMOVE_BACKWARD_LINK:
+        remove_backward_link(frame->index, frame->aux);
+        break;
+    case REPLICATION_DELETE:
+        delete_message(frame->index);
+        break;
+    default:
+        ok = 0;
+        break;
+    }
+    free(text);
+
+    if (ok && frame->type < REPLICATION_SYNC_ENTRY)
+    {
+        uint64_t now = now_ms();
+        pthread_mutex_lock(&replica_state_lock);
+        replica_state.position += sizeof(ReplicationFrame) + frame->length;
+        if (replica_state.position > replica_state.primary_position)
+        {
+            replica_state.primary_position = replica_state.position;
+        }
+        replica_state.applied++;
+        replica_state.apply_delay_ms = now > frame->commit_ms ? now - frame->commit_ms : 0;
+        pthread_mutex_unlock(&replica_state_lock);
+    }
+    return ok;
+}
+
+// 주 서버에 연결해 프레임을 받아 적용합니다. 연결이 끊기거나 적용할 수 없으면 돌아옵니다.
+static void follow_primary(int fd)
+{
+    pthread_mutex_lock(&replica_state_lock);
+    ReplicationFrame hello = {0, REPLICATION_HELLO, {0}, 0, 0, (int64_t)replica_state.epoch, replica_state.position, now_ms()};
+    pthread_mutex_unlock(&replica_state_lock);
+    if (!send_all(fd, &hello, sizeof(hello)))
+    {
+        return;
+    }
+
+    uint32_t capacity = 64 * 1024;
+    unsigned char *body = malloc(capacity);
+    int synced = 0, caught_up = 0;
+    ReplicationFrame frame;
+    while (running && body != NULL && recv_all(fd, &frame, sizeof(frame), REPLICATION_TIMEOUT_MS))
+    {
+        if (frame.length > capacity)
+        {
+            unsigned char *grown = realloc(body, frame.length);
+            if (grown == NULL)
+            {
+                break;
+            }
+            body = grown;
+            capacity = frame.length;
+        }
+        if (!recv_all(fd, body, frame.length, REPLICATION_TIMEOUT_MS))
+        {
+            break;
+        }
+        pthread_mutex_lock(&replica_state_lock);
+        replica_state.last_frame_ms = now_ms();
+        pthread_mutex_unlock(&replica_state_lock);
+        if (!apply_frame(&frame, body))
+        {
+            // 로그를 이어 받을 수 없는 상태: 다음 연결에서 전체 동기화
+            syslog(LOG_ERR, "Replica cannot apply frame type %u for index %u, resynchronizing", frame.type, frame.index);
+            pthread_mutex_lock(&replica_state_lock);
+            replica_state.epoch = 0;
+            pthread_mutex_unlock(&replica_state_lock);
+            break;
+        }
+        if (frame.type == REPLICATION_SYNC_ENTRY)
+        {
+            synced = 1;
+        }
+        else if (frame.type == REPLICATION_HEARTBEAT && !caught_up)
+        {
+            caught_up = 1;
+            pthread_mutex_lock(&replica_state_lock);
+            replica_state.failed_syncs = 0;
+            pthread_mutex_unlock(&replica_state_lock);
+        }
+        // 쌓인 프레임을 다 적용했을 때만 ACK를 보냄 (프레임마다 보내지 않음)
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (frame.type != REPLICATION_SYNC_ENTRY && poll(&pfd, 1, 0) == 0)
+        {
+            send_ack(fd);
+        }
+    }
+    free(body);
+
+    if (synced && !caught_up)
+    {
+        // 동기화하는 동안 주 서버 로그가 시작 위치를 지웠을 수 있음. 끝없이 다시 동기화하지 않도록 셈
+        pthread_mutex_lock(&replica_state_lock);
+        replica_state.failed_syncs++;
+        pthread_mutex_unlock(&replica_state_lock);
+    }
+}
+
+static void *replica_thread(void *arg)
+{
+    (void)arg;
+    while (running)
+    {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", primary_socket);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+        {
+            pthread_mutex_lock(&replica_state_lock);
+            replica_state.connected = 1;
+            replica_state.connects++;
+            pthread_mutex_unlock(&replica_state_lock);
+            syslog(LOG_INFO, "Replica connected to %s", primary_socket);
+
+            follow_primary(fd);
+
+            pthread_mutex_lock(&replica_state_lock);
+            replica_state.connected = 0;
+            replica_state.syncing = 0;
+            replica_state.stopped = replica_state.failed_syncs >= REPLICATION_MAX_FAILED_SYNCS;
+            pthread_mutex_unlock(&replica_state_lock);
+            syslog(LOG_WARNING, "Replica lost connection to %s", primary_socket);
+        }
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        if (replica_state.stopped)
+        {
+            syslog(LOG_ERR, "Replica could not catch up after %d full synchronizations, giving up on %s",
+                   REPLICATION_MAX_FAILED_SYNCS, primary_socket);
+            break;
+        }
+        for (int waited = 0; running && waited < REPLICATION_RECONNECT_MS; waited += REPLICATION_HEARTBEAT_MS)
+        {
+            usleep(REPLICATION_HEARTBEAT_MS * 1000);
+        }
+    }
+    return NULL;
+}
+
+// 복제본으로서 socket_path의 주 서버를 따라가기 시작합니다. 이후 저장소 쓰기는 복제 스레드만 합니다.
+int replication_start_replica(const char *socket_path)
+{
+    if (strlen(socket_path) >= sizeof(primary_socket))
+    {
+        syslog(LOG_ERR, "Replication: socket path is too long: %s", socket_path);
+        return 0;
+    }
+    snprintf(primary_socket, sizeof(primary_socket), "%s", socket_path);
+    replica_mode = 1;
+    running = 1;
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, replica_thread, NULL) != 0)
+    {
+        syslog(LOG_ERR, "Failed to create replica thread");
+        running = 0;
+        return 0;
+    }
+    pthread_detach(thread);
+    return 1;
+}
+
+void replication_stop()
+{
+    running = 0;
+    pthread_mutex_lock(&log_lock);
+    pthread_cond_broadcast(&log_cond);
+    pthread_mutex_unlock(&log_lock);
+    if (listen_fd >= 0)
+    {
+        close(listen_fd);
+        listen_fd = -1;
+        unlink(REPLICATION_SOCKET);
+    }
+}
+
+int replication_is_replica()
+{
+    return replica_mode;
+}
+
+// 주 서버면 로그와 복제본별 지연을, 복제본이면 따라가는 위치와 지연을 JSON 형식으로 반환하는 함수
+char *get_replication_stats_info()
+{
+    json_object *data = json_object_new_object();
+    uint64_t now = now_ms();
+    if (replica_mode)
+    {
+        pthread_mutex_lock(&replica_state_lock);
+        ReplicaState state = replica_state;
+        pthread_mutex_unlock(&replica_state_lock);
+        json_object_object_add(data, "role", json_object_new_string("replica"));
+        json_object_object_add(data, "primary", json_object_new_string(primary_socket));
+        json_object_object_add(data, "connected", json_object_new_boolean(state.connected));
+        json_object_object_add(data, "syncing", json_object_new_boolean(state.syncing));
+        json_object_object_add(data, "connects", json_object_new_int(state.connects));
+        json_object_object_add(data, "syncs", json_object_new_int(state.syncs));
+        json_object_object_add(data, "failed_syncs", json_object_new_int(state.failed_syncs));
+        json_object_object_add(data, "stopped", json_object_new_boolean(state.stopped));
+        json_object_object_add(data, "synced_entries", json_object_new_int64(state.synced_entries));
+        json_object_object_add(data, "applied", json_object_new_int64(state.applied));
+        json_object_object_add(data, "position", json_object_new_int64(state.position));
+        json_object_object_add(data, "primary_position", json_object_new_int64(state.primary_position));
+        json_object_object_add(data, "lag_bytes", json_object_new_int64(state.primary_position - state.position));
+        json_object_object_add(data, "apply_delay_ms", json_object_new_int64(state.apply_delay_ms));
+        json_object_object_add(data, "last_contact_ms", json_object_new_int64(state.last_frame_ms > 0 && now > state.last_frame_ms ? now - state.last_frame_ms : 0));
+    }
+    else
+    {
+        json_object *list = json_object_new_array();
+        pthread_mutex_lock(&log_lock);
+        json_object_object_add(data, "role", json_object_new_string("primary"));
+        json_object_object_add(data, "socket", json_object_new_string(REPLICATION_SOCKET));
+        json_object_object_add(data, "log_start", json_object_new_int64(log_start));
+        json_object_object_add(data, "log_end", json_object_new_int64(log_end));
+        json_object_object_add(data, "log_capacity", json_object_new_int64(log_capacity));
+        json_object_object_add(data, "log_frames", json_object_new_int64(log_frames));
+        for (int i = 0; i < REPLICATION_MAX_REPLICAS; i++)
+        {
+            if (!replicas[i].active)
+            {
+                continue;
+            }
+            json_object *replica = json_object_new_object();
+            json_object_object_add(replica, "syncing", json_object_new_boolean(replicas[i].syncing));
+            json_object_object_add(replica, "synced_entries", json_object_new_int(replicas[i].synced_entries));
+            json_object_object_add(replica, "sent", json_object_new_int64(replicas[i].sent));
+            json_object_object_add(replica, "acked", json_object_new_int64(replicas[i].acked));
+            json_object_object_add(replica, "lag_bytes", json_object_new_int64(log_end - replicas[i].acked));
+            json_object_object_add(replica, "apply_delay_ms", json_object_new_int64(replicas[i].apply_delay_ms));
+            json_object_object_add(replica, "connected_at", json_object_new_int64(replicas[i].connected_at));
+            json_object_array_add(list, replica);
+        }
+        pthread_mutex_unlock(&log_lock);
+        json_object_object_add(data, "replicas", list);
+    }
+
+    json_object *result = json_object_new_object();
+    json_object_object_add(result, "action", json_object_new_string("replication_stats"));
+    json_object_object_add(result, "data", data);
+
+    const char *json_string = json_object_to_json_string(result);
+    char *response = strdup(json_string);
+
+    json_object_put(result);
+    return response;
+}
@@ -0,0 +1,57 @@
+#ifndef REPLICATION_H
+#define REPLICATION_H
+
+#include <stdint.h>
+
+#define REPLICATION_SOCKET "binary file/replication.sock" // 주 서버가 복제본을 받는 Unix 소켓 (서버 작업 디렉터리 기준)
+#define REPLICATION_LOG_BYTES (8 * 1024 * 1024) // 주 서버가 메모리에 들고 있는 변경 로그 크기. 이보다 뒤처진 복제본은 전체 동기화
+#define REPLICATION_LOG_MAX_BYTES (64 * 1024 * 1024) // 전체 동기화가 시작 위치를 붙잡고 있을 때 로그가 늘어날 수 있는 최대 크기
+#define REPLICATION_SEND_CHUNK (64 * 1024)      // 로그를 복제본으로 보낼 때 한 번에 보내는 최대 바이트 수
+#define REPLICATION_SYNC_BATCH 256              // 전체 동기화에서 read lock 한 번에 읽어 보내는 메시지 수
+#define REPLICATION_HEARTBEAT_MS 100            // 보낼 변경이 없을 때 주 서버 로그 위치를 알리는 간격
+#define REPLICATION_TIMEOUT_MS 3000             // 이 시간 동안 아무것도 받지 못하면 연결을 끊고 다시 연결
+#define REPLICATION_RECONNECT_MS 1000           // 복제본이 주 서버에 다시 연결을 시도하는 간격
+#define REPLICATION_MAX_REPLICAS 8              // 주 서버에 동시에 붙을 수 있는 복제본 수
+#define REPLICATION_MAX_FAILED_SYNCS 5          // 따라잡지 못하고 끝난 전체 동기화가 이만큼 이어지면 복제본이 다시 연결하지 않음
+
+// 주 서버와 복제본 사이의 프레임 종류. 1..7은 변경 로그에 남는 변경이고 나머지는 연결 제어입니다.
+typedef enum {
+    REPLICATION_APPEND = 1,             // index에 본문 추가 (timestamp: 레코드 타임스탬프)
+    REPLICATION_MODIFY,                 // index의 본문을 바꿈 (aux: 바뀐 뒤 버전)
+    REPLICATION_ADD_FORWARD_LINK,       // add_forward_link(index, aux)
+    REPLICATION_ADD_BACKWARD_LINK,      // add_backward_link(index, aux)
+    REPLICATION_REMOVE_FORWARD_LINK,    // remove_forward_link(index, aux)
+    REPLICATION_REMOVE_BACKWARD_LINK,   // remove_backward_link(index, aux)
+    REPLICATION_DELETE,                 // delete_message(index). 이웃의 링크도 함께 지워지므로 unlink 프레임은 따로 없음
+    REPLICATION_SYNC_ENTRY = 16,        // 전체 동기화의 메시지 하나 (aux: 버전, 0이면 지워진 메시지, 본문: 링크 개수 2개, 링크들, 메시지)
+    REPLICATION_SYNC_END,               // 전체 동기화 끝 (aux: 엔트리 수, timestamp: 로그 epoch, position: 이어 받을 로그 위치)
+    REPLICATION_HEARTBEAT,              // 주 서버 로그 끝 위치 (position). 보낼 로그를 모두 보낸 뒤에만 보내므로 받으면 따라잡은 것
+    REPLICATION_HELLO,                  // 복제본 -> 주 서버: 마지막으로 받은 로그 (timestamp: epoch, position)
+    REPLICATION_ACK                     // 복제본 -> 주 서버: 적용한 로그 위치 (position), 마지막 변경의 적용 지연 ms (timestamp)
+} ReplicationFrameType;
+
+// 모든 프레임의 머리. 뒤에 length 바이트의 본문이 이어집니다.
+// 로그 위치(position)는 주 서버가 이번 실행에서 로그에 쓴 바이트 수이고, epoch는 실행마다 바뀝니다.
+typedef struct {
+    uint32_t length;
+    uint8_t type;
+    uint8_t reserved[3];
+    uint32_t index;
+    uint32_t aux;
+    int64_t timestamp;      // 레코드 타임스탬프, HELLO/SYNC_END에서는 로그 epoch
+    uint64_t position;      // 로그 위치 (HELLO/SYNC_END/HEARTBEAT/ACK)
+    uint64_t commit_ms;     // 주 서버가 프레임을 만든 시각 (CLOCK_REALTIME ms, 지연 측정)
+} ReplicationFrame;
+
+// Function declarations
+int replication_start_primary();
+int replication_start_replica(const char *socket_path);
+void replication_stop();
+int replication_is_replica();
+void replication_on_append(uint32_t index, const char *message, uint32_t length, int64_t timestamp);
+void replication_on_modify(uint32_t index, uint32_t version, const char *message, uint32_t length, int64_t timestamp);
+void replication_on_link(int type, uint32_t source, uint32_t target);
+void replication_on_delete(uint32_t index);
+char *get_replication_stats_info();
+
+#endif // REPLICATION_H
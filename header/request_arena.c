@@ -0,0 +1,364 @@
+#include "request_arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <syslog.h>
+#include <pthread.h>
+#include <json-c/json.h>
+
+// arena 메모리 한 덩어리. 머리 뒤에 capacity 바이트가 이어집니다.
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t capacity;
+    size_t used;
+} ArenaChunk;
+
+#define CHUNK_HEADER ((sizeof(ArenaChunk) + REQUEST_ARENA_ALIGN - 1) & ~(size_t)(REQUEST_ARENA_ALIGN - 1))
+
+// 지금 할당 중인 청크. next를 따라가면 이번 요청에 이어 붙인 청크들을 지나 마지막에 기본 블록이 있습니다.
+static __thread ArenaChunk *current = NULL;
+static __thread char *last_allocation = NULL; // 그 자리에서 늘릴 수 있는 마지막 할당 (ArenaBuffer용)
+static __thread uint64_t request_allocations = 0;
+static __thread uint64_t request_bytes = 0;
+static __thread uint64_t request_overflows = 0;
+
+// 연결이 끝난 스레드의 기본 블록을 다음 연결 스레드가 이어 받는 슬랩. 통계도 이 락으로 보호합니다.
+static pthread_mutex_t slab_lock = PTHREAD_MUTEX_INITIALIZER;
+static ArenaChunk *slab[REQUEST_ARENA_SLAB_BLOCKS];
+static uint32_t slab_count = 0;
+static RequestArenaStats stats;
+
+static inline size_t align_up(size_t size)
+{
+    return (size + REQUEST_ARENA_ALIGN - 1) & ~(size_t)(REQUEST_ARENA_ALIGN - 1);
+}
+
+static inline char *chunk_data(ArenaChunk *chunk)
+{
+    return (char *)chunk + CHUNK_HEADER;
+}
+
+// 슬랩에서 블록을 꺼내고, 비어 있으면 새로 잡습니다.
+static ArenaChunk *take_block()
+{
+    ArenaChunk *block = NULL;
+    pthread_mutex_lock(&slab_lock);
+    if (slab_count > 0)
+    {
+        block = slab[--slab_count];
+        stats.slab_hits++;
+    }
+    else
+    {
+        stats.slab_misses++;
+    }
+    pthread_mutex_unlock(&slab_lock);
+
+    if (block == NULL)
+    {
+        block = malloc(REQUEST_ARENA_BLOCK_SIZE);
+        if (block == NULL)
+        {
+            return NULL;
+        }
+        block->capacity = REQUEST_ARENA_BLOCK_SIZE - CHUNK_HEADER;
+    }
+    block->next = NULL;
+    block->used = 0;
+    return block;
+}
+
+// 이번 요청에 이어 붙인 청크를 해제하고 기본 블록만 남깁니다.
+static void free_overflow_chunks()
+{
+    while (current != NULL && current->next != NULL)
+    {
+        ArenaChunk *next = current->next;
+        free(current);
+        current = next;
+    }
+    if (current != NULL)
+    {
+        current->used = 0;
+    }
+    last_allocation = NULL;
+}
+
+void *arena_alloc(size_t size)
+{
+    size_t aligned = align_up(size > 0 ? size : 1);
+    if (current == NULL)
+    {
+        current = take_block();
+        if (current == NULL)
+        {
+            syslog(LOG_ERR, "Memory allocation failed for request arena");
+            return NULL;
+        }
+    }
+    if (aligned > current->capacity - current->used)
+    {
+        // 큰 본문처럼 블록을 넘는 요청은 청크를 이어 붙임 (기본 블록보다 작게는 잡지 않음)
+        size_t capacity = aligned > REQUEST_ARENA_BLOCK_SIZE - CHUNK_HEADER ? aligned : REQUEST_ARENA_BLOCK_SIZE - CHUNK_HEADER;
+        ArenaChunk *chunk = malloc(CHUNK_HEADER + capacity);
+        if (chunk == NULL)
+        {
+            syslog(LOG_ERR, "Memory allocation failed for request arena chunk");
+            return NULL;
+        }
+        chunk->next = current;
+        chunk->capacity = capacity;
+        chunk->used = 0;
+        current = chunk;
+        request_overflows++;
+    }
+
+    char *memory = chunk_data(current) + current->used;
+    current->used += aligned;
+    request_allocations++;
+    request_bytes += aligned;
+    last_allocation = memory;
+    return memory;
+}
+
+// memory가 마지막 할당이고 청크에 자리가 남아 있으면 복사 없이 size까지 늘립니다.
+static int arena_extend(char *memory, size_t size)
+{
+    if (memory == NULL || memory != last_allocation)
+    {
+        return 0;
+    }
+    size_t end = (size_t)(memory - chunk_data(current)) + align_up(size);
+    if (end > current->capacity)
+    {
+        return 0;
+    }
+    if (end > current->used)
+    {
+        request_bytes += end - current->used;
+        current->used = end;
+    }
+    return 1;
+}
+
+char *arena_strdup(const char *text)
+{
+    size_t length = strlen(text);
+    char *copy = arena_alloc(length + 1);
+    if (copy != NULL)
+    {
+        memcpy(copy, text, length + 1);
+    }
+    return copy;
+}
+
+char *arena_printf(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    va_list measure;
+    va_copy(measure, args);
+    int length = vsnprintf(NULL, 0, format, measure);
+    va_end(measure);
+
+    char *text = length >= 0 ? arena_alloc((size_t)length + 1) : NULL;
+    if (text != NULL)
+    {
+        vsnprintf(text, (size_t)length + 1, format, args);
+    }
+    va_end(args);
+    return text;
+}
+
+// 응답을 보낸 뒤 호출합니다. 이번 요청이 잡은 arena 메모리를 모두 버리고 통계에 더합니다.
+void arena_reset()
+{
+    free_overflow_chunks();
+
+    pthread_mutex_lock(&slab_lock);
+    stats.requests++;
+    stats.allocations += request_allocations;
+    stats.bytes += request_bytes;
+    stats.overflow_chunks += request_overflows;
+    if (request_bytes > stats.peak_request_bytes)
+    {
+        stats.peak_request_bytes = request_bytes;
+    }
+    pthread_mutex_unlock(&slab_lock);
+
+    request_allocations = 0;
+    request_bytes = 0;
+    request_overflows = 0;
+}
+
+// 연결 스레드가 끝날 때 호출합니다. 기본 블록은 슬랩에 자리가 있으면 돌려주고 없으면 해제합니다.
+void arena_release()
+{
+    free_overflow_chunks();
+    if (current == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&slab_lock);
+    if (slab_count < REQUEST_ARENA_SLAB_BLOCKS)
+    {
+        slab[slab_count++] = current;
+        current = NULL;
+    }
+    pthread_mutex_unlock(&slab_lock);
+
+    free(current);
+    current = NULL;
+}
+
+void arena_buffer_init(ArenaBuffer *buffer, size_t capacity)
+{
+    buffer->length = 0;
+    buffer->capacity = capacity > 0 ? capacity : 1;
+    buffer->data = arena_alloc(buffer->capacity);
+    buffer->failed = buffer->data == NULL;
+    if (!buffer->failed)
+    {
+        buffer->data[0] = '\0';
+    }
+}
+
+// extra 바이트와 끝의 NUL이 들어갈 자리를 만듭니다. 마지막 할당이면 그 자리에서 늘리고 아니면 두 배로 옮깁니다.
+static int buffer_reserve(ArenaBuffer *buffer, size_t extra)
+{
+    if (buffer->failed)
+    {
+        return 0;
+    }
+    size_t needed = buffer->length + extra + 1;
+    if (needed <= buffer->capacity)
+    {
+        return 1;
+    }
+    size_t capacity = buffer->capacity * 2 > needed ? buffer->capacity * 2 : needed;
+    if (arena_extend(buffer->data, capacity))
+    {
+        buffer->capacity = capacity;
+        return 1;
+    }
+    char *grown = arena_alloc(capacity);
+    if (grown == NULL)
+    {
+        buffer->failed = 1;
+        return 0;
+    }
+    memcpy(grown, buffer->data, buffer->length + 1);
+    buffer->data = grown;
+    buffer->capacity = capacity;
+    return 1;
+}
+
+void arena_buffer_append(ArenaBuffer *buffer, const char *text, size_t length)
+{
+    if (!buffer_reserve(buffer, length))
+    {
+        return;
+    }
+    memcpy(buffer->data + buffer->length, text, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+}
+
+void arena_buffer_append_string(ArenaBuffer *buffer, const char *text)
+{
+    arena_buffer_append(buffer, text, strlen(text));
+}
+
+void arena_buffer_printf(ArenaBuffer *buffer, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    va_list measure;
+    va_copy(measure, args);
+    int length = vsnprintf(NULL, 0, format, measure);
+    va_end(measure);
+
+    if (length >= 0 && buffer_reserve(buffer, (size_t)length))
+    {
+        vsnprintf(buffer->data + buffer->length, (size_t)length + 1, format, args);
+        buffer->length += (size_t)length;
+    }
+    va_end(args);
+}
+
+// 따옴표로 감싼 JSON 문자열을 붙입니다. json-c와 같은 규칙으로 이스케이프하므로 ('/'와 제어 문자 포함)
+// json_object_to_json_string()으로 만들던 응답과 바이트 단위로 같습니다.
+void arena_buffer_append_json_string(ArenaBuffer *buffer, const char *text, size_t length)
+{
+    static const char hex_chars[] = "0123456789abcdef";
+    arena_buffer_append(buffer, "\"", 1);
+    size_t start = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        unsigned char c = (unsigned char)text[i];
+        const char *escape = NULL;
+        char unicode[7];
+        switch (c)
+        {
+        case '\b': escape = "\\b"; break;
+        case '\n': escape = "\\n"; break;
+        case '\r': escape = "\\r"; break;
+        case '\t': escape = "\\t"; break;
+        case '\f': escape = "\\f"; break;
+        case '"': escape = "\\\""; break;
+        case '\\': escape = "\\\\"; break;
+        case '/': escape = "\\/"; break;
+        default:
+            if (c < ' ')
+            {
+                snprintf(unicode, sizeof(unicode), "\\u00%c%c", hex_chars[c >> 4], hex_chars[c & 0xf]);
+                escape = unicode;
+            }
+            break;
+        }
+        if (escape != NULL)
+        {
+            arena_buffer_append(buffer, text + start, i - start);
+            arena_buffer_append(buffer, escape, strlen(escape));
+            start = i + 1;
+        }
+    }
+    arena_buffer_append(buffer, text + start, length - start);
+    arena_buffer_append(buffer, "\"", 1);
+}
+
+RequestArenaStats request_arena_get_stats()
+{
+    pthread_mutex_lock(&slab_lock);
+    RequestArenaStats current_stats = stats;
+    current_stats.slab_free = slab_count;
+    pthread_mutex_unlock(&slab_lock);
+    return current_stats;
+}
+
+// 요청 arena 사용량을 JSON 형식으로 반환하는 함수 (다른 *_info처럼 malloc으로 잡으므로 호출자가 해제)
+char *get_arena_stats_info()
+{
+    RequestArenaStats current_stats = request_arena_get_stats();
+
+    json_object *data = json_object_new_object();
+    json_object_object_add(data, "requests", json_object_new_int64(current_stats.requests));
+    json_object_object_add(data, "allocations", json_object_new_int64(current_stats.allocations));
+    json_object_object_add(data, "bytes", json_object_new_int64(current_stats.bytes));
+    json_object_object_add(data, "allocations_per_request", json_object_new_double(current_stats.requests > 0 ? (double)current_stats.allocations / current_stats.requests : 0.0));
+    json_object_object_add(data, "overflow_chunks", json_object_new_int64(current_stats.overflow_chunks));
+    json_object_object_add(data, "peak_request_bytes", json_object_new_int64(current_stats.peak_request_bytes));
+    json_object_object_add(data, "slab_hits", json_object_new_int64(current_stats.slab_hits));
+    json_object_object_add(data, "slab_misses", json_object_new_int64(current_stats.slab_misses));
+    json_object_object_add(data, "slab_free", json_object_new_int(current_stats.slab_free));
+
+    json_object *result = json_object_new_object();
+    json_object_object_add(result, "action", json_object_new_string("arena_stats"));
+    json_object_object_add(result, "data", data);
+
+    char *response = strdup(json_object_to_json_string(result));
+    json_object_put(result);
+    return response;
+}
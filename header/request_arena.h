@@ -0,0 +1,48 @@
+#ifndef REQUEST_ARENA_H
+#define REQUEST_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define REQUEST_ARENA_BLOCK_SIZE (64 * 1024) // 연결 스레드마다 요청 사이에 다시 쓰는 arena 블록 크기
+#define REQUEST_ARENA_ALIGN 16               // arena_alloc()이 돌려주는 주소의 정렬
+#define REQUEST_ARENA_SLAB_BLOCKS 16         // 끝난 연결의 블록을 다음 연결이 쓰도록 모아 두는 최대 수
+
+// 요청 하나 동안만 쓰는 메모리입니다. 할당은 포인터를 앞으로 미는 것뿐이고 해제는 arena_reset()에서 한꺼번에 합니다.
+// 블록을 넘는 요청은 추가 청크를 malloc으로 잡아 이어 붙이고, 그 청크는 reset에서 해제됩니다.
+// 상태는 스레드마다 따로이므로 락 없이 쓰지만, 다른 스레드로 포인터를 넘겨서는 안 됩니다.
+
+// arena 안에서 자라는 문자열 (응답 JSON 조립용). 메모리가 모자라면 failed가 켜지고 이후 추가는 무시됩니다.
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+    int failed;
+} ArenaBuffer;
+
+typedef struct {
+    uint64_t requests;          // arena_reset()까지 마친 요청 수
+    uint64_t allocations;       // arena_alloc() 호출 수
+    uint64_t bytes;             // arena에서 잡은 바이트 수 (정렬 포함)
+    uint64_t overflow_chunks;   // 블록이 모자라 malloc으로 이어 붙인 청크 수
+    uint64_t slab_hits;         // 연결이 블록을 슬랩에서 다시 얻은 수
+    uint64_t slab_misses;       // 슬랩이 비어 블록을 새로 잡은 수
+    uint32_t slab_free;         // 지금 슬랩에 쉬고 있는 블록 수
+    size_t peak_request_bytes;  // 요청 하나가 arena에서 가장 많이 잡은 바이트 수
+} RequestArenaStats;
+
+// Function declarations
+void *arena_alloc(size_t size);
+char *arena_strdup(const char *text);
+char *arena_printf(const char *format, ...);
+void arena_reset();
+void arena_release();
+void arena_buffer_init(ArenaBuffer *buffer, size_t capacity);
+void arena_buffer_append(ArenaBuffer *buffer, const char *text, size_t length);
+void arena_buffer_append_string(ArenaBuffer *buffer, const char *text);
+void arena_buffer_printf(ArenaBuffer *buffer, const char *format, ...);
+void arena_buffer_append_json_string(ArenaBuffer *buffer, const char *text, size_t length);
+RequestArenaStats request_arena_get_stats();
+char *get_arena_stats_info();
+
+#endif // REQUEST_ARENA_H
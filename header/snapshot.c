@@ -0,0 +1,415 @@
+#include "snapshot.h"
+#include "message_handler.h"
+#include "compression.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <json-c/json.h>
+
+// 쓰기를 멈추지 않고 shard 데이터 파일들 (messages.<s>.bin) / index.bin / free_space.bin (과 압축 사전)의 한 시점을 SNAPSHOT_DIR 아래에 떠 둡니다.
+//  1. 모든 shard writer와 read lock 아래에서 인덱스/free space 테이블을 스냅숏 디렉터리에 쓰고,
+//     그 시점의 shard 파일 크기를 각 shard의 frozen_end로 얼림 (쓰기 요청은 테이블을 쓰는 동안만 기다림)
+//  2. 얼린 동안 [0, frozen_end)는 덮어쓰이지 않음: free space를 재사용하지 않고, 수정은 새 슬롯에 씀 (copy-on-write).
+//     새 레코드와 옮겨 간 레코드는 모두 그 뒤에 쌓이므로 락 없이 앞부분을 복사할 수 있음
+//  3. shard 파일마다 복사가 끝나면 그 shard의 얼림을 풀고, 압축 사전을 복사한 뒤 디렉터리를 완성된 이름으로 rename
+//     (사전은 파일에 저장된 뒤에야 쓰이므로 얼린 구간의 압축 레코드가 쓰는 사전은 이미 파일에 있음)
+// 스냅숏의 index.bin은 단일 파일 형식이고 free_space.bin은 모든 shard의 테이블을 합친 것이라, 복원하면 시작할 때 shard별 파일로 다시 나뉩니다.
+// 복원은 서버를 멈추고 스냅숏 디렉터리의 파일들을 "binary file/"에 복사하면 됩니다. 복사 중인 스냅숏은 .tmp 디렉터리에 있고, 실패하면 지웁니다.
+
+static SnapshotStats stats = {0};
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static double elapsed_ms_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+static void record_progress(uint64_t bytes_copied)
+{
+    pthread_mutex_lock(&stats_mutex);
+    stats.bytes_copied = bytes_copied;
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+static void finish_snapshot(int ok, const char *path)
+{
+    pthread_mutex_lock(&stats_mutex);
+    stats.running = 0;
+    if (ok)
+    {
+        stats.runs++;
+        snprintf(stats.last_path, sizeof(stats.last_path), "%s", path);
+    }
+    else
+    {
+        stats.failures++;
+    }
+    stats.last_finished = time(NULL);
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+static void remove_snapshot_dir(const char *dir)
+{
+    const char *names[] = {"index.bin", "free_space.bin", "compression.dict"};
+    char path[320];
+    for (int i = 0; i < 3; i++)
+    {
+        snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+        unlink(path);
+    }
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        snprintf(path, sizeof(path), "%s/messages.%u.bin", dir, shard);
+        unlink(path);
+    }
+    rmdir(dir);
+}
+
+static int close_table_file(FILE *file)
+{
+    int ok = fflush(file) == 0 && !ferror(file) && fsync(fileno(file)) == 0;
+    return fclose(file) == 0 && ok;
+}
+
+static int write_all(int fd, const unsigned char *buffer, uint32_t length, uint64_t offset)
+{
+    uint32_t done = 0;
+    while (done < length)
+    {
+        ssize_t n = pwrite(fd, buffer + done, length - done, offset + done);
+        if (n <= 0)
+        {
+            return 0;
+        }
+        done += n;
+    }
+    return 1;
+}
+
+// shard 데이터 파일의 [0, end)를 data_fd로 복사합니다. 가능하면 reflink로 블록을 공유하고, 안 되면 속도를 제한하며 직접 복사합니다.
+// copied는 앞 shard까지 복사한 바이트 수이고, 이 shard를 복사한 만큼 늘어납니다 (진행 상황과 속도 제한용).
+static int copy_message_data(uint32_t shard, int data_fd, uint64_t end, int *reflinked, uint64_t *copied, const struct timespec *start)
+{
+#if SNAPSHOT_USE_REFLINK && defined(FICLONE)
+    // 파일 전체를 공유한 뒤 얼린 시점의 크기로 자름. 얼린 구간은 복제 도중에도 바뀌지 않음
+    if (ioctl(data_fd, FICLONE, store_shards[shard].fd) == 0)
+    {
+        *reflinked = 1;
+        *copied += end;
+        record_progress(*copied);
+        return ftruncate(data_fd, end) == 0;
+    }
+#endif
+    *reflinked = 0;
+
+    unsigned char *buffer = malloc(SNAPSHOT_COPY_CHUNK);
+    if (buffer == NULL)
+    {
+        return 0;
+    }
+    int ok = 1;
+    uint64_t done = 0;
+    while (ok && done < end)
+    {
+        uint32_t length = end - done < SNAPSHOT_COPY_CHUNK ? (uint32_t)(end - done) : SNAPSHOT_COPY_CHUNK;
+        // 얼린 구간에는 쓰기가 없지만, 중복 제거가 공유 표시를 위해 헤더를 다시 쓰는 경우와 겹치지 않도록 read lock 아래에서 읽음
+        pthread_rwlock_rdlock(&store_lock);
+        ok = read_message_data(STORE_OFFSET(shard, done), buffer, length);
+        pthread_rwlock_unlock(&store_lock);
+        ok = ok && write_all(data_fd, buffer, length, done);
+        done += length;
+        *copied += length;
+        record_progress(*copied);
+
+        if (SNAPSHOT_COPY_BYTES_PER_SEC > 0)
+        {
+            double target_ms = *copied * 1000.0 / SNAPSHOT_COPY_BYTES_PER_SEC;
+            double elapsed = elapsed_ms_since(start);
+            if (target_ms > elapsed)
+            {
+                usleep((useconds_t)((target_ms - elapsed) * 1000));
+            }
+        }
+    }
+    free(buffer);
+    return ok;
+}
+
+// 압축 사전 파일을 스냅숏에 복사합니다. 아직 사전이 없으면 아무것도 하지 않고 1을 반환합니다.
+static int copy_dictionary_file(const char *dest_path)
+{
+    FILE *src = fopen(COMPRESSION_DICT_FILE, "rb");
+    if (src == NULL)
+    {
+        return 1;
+    }
+    FILE *dest = fopen(dest_path, "wb");
+    if (dest == NULL)
+    {
+        fclose(src);
+        return 0;
+    }
+    unsigned char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), src)) > 0)
+    {
+        fwrite(buffer, 1, n, dest);
+    }
+    int ok = !ferror(src);
+    fclose(src);
+    return close_table_file(dest) && ok;
+}
+
+// frozen_end는 그 shard의 writer를 잡은 스레드만 보므로 writer 아래에서 풉니다.
+static void thaw_message_data(uint32_t shard)
+{
+    lock_store_shard(shard);
+    __atomic_store_n(&store_shards[shard].frozen_end, 0, __ATOMIC_RELEASE);
+    unlock_store_shard(shard);
+}
+
+// compaction이 돌고 있는지 확인합니다 (free space 재사용을 끈 shard가 하나라도 있으면 실행 중).
+static int compaction_in_progress()
+{
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        if (__atomic_load_n(&store_shards[shard].reuse_disabled, __ATOMIC_ACQUIRE))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void *snapshot_thread(void *arg)
+{
+    (void)arg;
+    char name[64], temp_dir[272], final_dir[256], path[320];
+    time_t now = time(NULL);
+    struct tm tm_now;
+    localtime_r(&now, &tm_now);
+    strftime(name, sizeof(name), "%Y%m%d-%H%M%S", &tm_now);
+
+    if (mkdir(SNAPSHOT_DIR, 0755) != 0 && errno != EEXIST)
+    {
+        syslog(LOG_ERR, "Snapshot: cannot create %s", SNAPSHOT_DIR);
+        finish_snapshot(0, NULL);
+        return NULL;
+    }
+    // 같은 초에 찍은 스냅숏은 -2, -3 ...을 붙임
+    struct stat st;
+    int created = 0;
+    for (int n = 1; n <= 100 && !created; n++)
+    {
+        if (n == 1)
+        {
+            snprintf(final_dir, sizeof(final_dir), "%s/%s", SNAPSHOT_DIR, name);
+        }
+        else
+        {
+            snprintf(final_dir, sizeof(final_dir), "%s/%s-%d", SNAPSHOT_DIR, name, n);
+        }
+        snprintf(temp_dir, sizeof(temp_dir), "%s.tmp", final_dir);
+        created = stat(final_dir, &st) != 0 && mkdir(temp_dir, 0755) == 0;
+    }
+    if (!created)
+    {
+        syslog(LOG_ERR, "Snapshot: cannot create a directory under %s", SNAPSHOT_DIR);
+        finish_snapshot(0, NULL);
+        return NULL;
+    }
+
+    snprintf(path, sizeof(path), "%s/index.bin", temp_dir);
+    FILE *index_file = fopen(path, "wb");
+    snprintf(path, sizeof(path), "%s/free_space.bin", temp_dir);
+    FILE *free_space_file = fopen(path, "wb");
+    int data_fds[STORE_SHARD_COUNT];
+    int files_ok = index_file != NULL && free_space_file != NULL;
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        snprintf(path, sizeof(path), "%s/messages.%u.bin", temp_dir, shard);
+        data_fds[shard] = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        files_ok = files_ok && data_fds[shard] >= 0;
+    }
+    if (!files_ok)
+    {
+        syslog(LOG_ERR, "Snapshot: cannot create files in %s", temp_dir);
+        if (index_file != NULL)
+            fclose(index_file);
+        if (free_space_file != NULL)
+            fclose(free_space_file);
+        for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+        {
+            if (data_fds[shard] >= 0)
+                close(data_fds[shard]);
+        }
+        remove_snapshot_dir(temp_dir);
+        finish_snapshot(0, NULL);
+        return NULL;
+    }
+
+    // 테이블과 shard 파일 크기를 한 시점으로 고정. read lock이므로 읽기 요청은 계속 처리됨
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t ends[STORE_SHARD_COUNT];
+    uint64_t total = 0;
+    lock_all_store_shards();
+    pthread_rwlock_rdlock(&store_lock);
+    int compacting = compaction_in_progress();
+    int ok = !compacting && write_index_table(index_file) && write_free_space_table(free_space_file);
+    uint32_t entries = index_table_size;
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        ends[shard] = store_shards[shard].file_size;
+        total += ends[shard];
+        if (ok)
+        {
+            __atomic_store_n(&store_shards[shard].frozen_end, ends[shard], __ATOMIC_RELEASE);
+        }
+    }
+    pthread_rwlock_unlock(&store_lock);
+    unlock_all_store_shards();
+    double freeze_ms = elapsed_ms_since(&start);
+
+    pthread_mutex_lock(&stats_mutex);
+    stats.entries = entries;
+    stats.bytes_total = total;
+    stats.freeze_ms = freeze_ms;
+    pthread_mutex_unlock(&stats_mutex);
+
+    ok = close_table_file(index_file) && ok;
+    ok = close_table_file(free_space_file) && ok;
+    int reflinked = ok;
+    uint64_t copied = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t shard = 0; shard < STORE_SHARD_COUNT; shard++)
+    {
+        int shard_reflinked = 0;
+        ok = ok && copy_message_data(shard, data_fds[shard], ends[shard], &shard_reflinked, &copied, &start) &&
+             fsync(data_fds[shard]) == 0;
+        reflinked = reflinked && shard_reflinked;
+        close(data_fds[shard]);
+        if (ends[shard] > 0)
+        {
+            thaw_message_data(shard);
+        }
+    }
+    double copy_ms = elapsed_ms_since(&start);
+
+    snprintf(path, sizeof(path), "%s/compression.dict", temp_dir);
+    ok = ok && copy_dictionary_file(path);
+    if (ok && rename(temp_dir, final_dir) != 0)
+    {
+        ok = 0;
+    }
+    if (!ok)
+    {
+        if (compacting)
+        {
+            syslog(LOG_WARNING, "Snapshot skipped: compaction is running");
+        }
+        else
+        {
+            syslog(LOG_ERR, "Snapshot failed: %s", temp_dir);
+        }
+        remove_snapshot_dir(temp_dir);
+        finish_snapshot(0, NULL);
+        return NULL;
+    }
+    int dir_fd = open(SNAPSHOT_DIR, O_RDONLY | O_DIRECTORY);
+    if (dir_fd >= 0)
+    {
+        fsync(dir_fd); // rename을 디스크에 남김
+        close(dir_fd);
+    }
+
+    pthread_mutex_lock(&stats_mutex);
+    stats.reflinked = reflinked;
+    stats.copy_ms = copy_ms;
+    pthread_mutex_unlock(&stats_mutex);
+    finish_snapshot(1, final_dir);
+    syslog(LOG_INFO, "Snapshot %s: %u entries, %lu bytes in %u shards (%s) in %.1f ms, writes paused %.2f ms",
+           final_dir, entries, (unsigned long)total, STORE_SHARD_COUNT, reflinked ? "reflink" : "copy", copy_ms, freeze_ms);
+    return NULL;
+}
+
+// 백그라운드 스냅숏을 시작합니다. 이미 실행 중이거나 compaction 중이면 0을 반환합니다.
+int start_snapshot()
+{
+    pthread_mutex_lock(&stats_mutex);
+    if (stats.running || compaction_in_progress())
+    {
+        pthread_mutex_unlock(&stats_mutex);
+        return 0;
+    }
+    stats.running = 1;
+    stats.reflinked = 0;
+    stats.entries = 0;
+    stats.bytes_total = 0;
+    stats.bytes_copied = 0;
+    stats.freeze_ms = 0;
+    stats.copy_ms = 0;
+    stats.last_started = time(NULL);
+    pthread_mutex_unlock(&stats_mutex);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, snapshot_thread, NULL) != 0)
+    {
+        syslog(LOG_ERR, "Failed to create snapshot thread");
+        pthread_mutex_lock(&stats_mutex);
+        stats.running = 0;
+        pthread_mutex_unlock(&stats_mutex);
+        return 0;
+    }
+    pthread_detach(thread);
+    return 1;
+}
+
+SnapshotStats get_snapshot_stats()
+{
+    pthread_mutex_lock(&stats_mutex);
+    SnapshotStats copy = stats;
+    pthread_mutex_unlock(&stats_mutex);
+    return copy;
+}
+
+// 스냅숏 진행 상황과 마지막 스냅숏 위치를 JSON 형식으로 반환하는 함수
+char *get_snapshot_stats_info()
+{
+    SnapshotStats current = get_snapshot_stats();
+
+    json_object *data = json_object_new_object();
+    json_object_object_add(data, "running", json_object_new_boolean(current.running));
+    json_object_object_add(data, "runs", json_object_new_int(current.runs));
+    json_object_object_add(data, "failures", json_object_new_int(current.failures));
+    json_object_object_add(data, "method", json_object_new_string(current.reflinked ? "reflink" : "copy"));
+    json_object_object_add(data, "entries", json_object_new_int(current.entries));
+    json_object_object_add(data, "bytes_total", json_object_new_int64(current.bytes_total));
+    json_object_object_add(data, "bytes_copied", json_object_new_int64(current.bytes_copied));
+    json_object_object_add(data, "progress", json_object_new_double(current.bytes_total > 0 ? (double)current.bytes_copied / current.bytes_total : 0.0));
+    json_object_object_add(data, "freeze_ms", json_object_new_double(current.freeze_ms));
+    json_object_object_add(data, "copy_ms", json_object_new_double(current.copy_ms));
+    json_object_object_add(data, "last_started", json_object_new_int64(current.last_started));
+    json_object_object_add(data, "last_finished", json_object_new_int64(current.last_finished));
+    json_object_object_add(data, "last_path", json_object_new_string(current.last_path));
+
+    json_object *result = json_object_new_object();
+    json_object_object_add(result, "action", json_object_new_string("snapshot_stats"));
+    json_object_object_add(result, "data", data);
+
+    const char *json_string = json_object_to_json_string(result);
+    char *response = strdup(json_string);
+
+    json_object_put(result);
+    return response;
+}
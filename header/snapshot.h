@@ -0,0 +1,32 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define SNAPSHOT_DIR "binary file/snapshots"  // 스냅숏마다 이 아래에 shard 데이터 파일들 (messages.<s>.bin) / index.bin / free_space.bin / compression.dict를 담은 디렉터리를 만듦
+#define SNAPSHOT_USE_REFLINK 1                // 1이면 먼저 FICLONE으로 shard 데이터 파일을 공유 복사 (btrfs/xfs 등), 안 되면 직접 복사
+#define SNAPSHOT_COPY_CHUNK (1024 * 1024)     // 직접 복사할 때 read lock 한 번에 읽는 바이트 수
+#define SNAPSHOT_COPY_BYTES_PER_SEC (64 * 1024 * 1024) // 직접 복사의 최대 속도 (0이면 제한 없음)
+
+typedef struct {
+    int running;
+    uint32_t runs;              // 완료된 스냅숏 수
+    uint32_t failures;          // 실패한 스냅숏 수
+    int reflinked;              // 마지막 스냅숏이 모든 shard 데이터 파일을 reflink로 복사했는지
+    uint32_t entries;           // 현재/마지막 스냅숏의 인덱스 엔트리 수
+    uint64_t bytes_total;       // 현재/마지막 스냅숏이 담는 shard 데이터 파일 크기의 합
+    uint64_t bytes_copied;      // 그중 복사를 마친 바이트 수
+    double freeze_ms;           // 테이블을 쓰는 동안 쓰기 요청을 막은 시간
+    double copy_ms;             // shard 데이터 파일 복사에 걸린 시간
+    time_t last_started;
+    time_t last_finished;
+    char last_path[256];        // 마지막으로 완성된 스냅숏 디렉터리
+} SnapshotStats;
+
+// Function declarations
+int start_snapshot();
+SnapshotStats get_snapshot_stats();
+char *get_snapshot_stats_info();
+
+#endif // SNAPSHOT_H
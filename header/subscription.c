@@ -0,0 +1,550 @@
+#include "subscription.h"
+#include "message_handler.h"
+#include "event_bus.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <json-c/json.h>
+
+// 변경 훅은 store_lock을 쓰기로 잡은 채 불리므로 락을 잡지 않고 event_bus 링에 넣기만 합니다.
+// 디스패처 스레드가 링에서 배치로 꺼내 store_lock(읽기) -> hub_lock -> subscriber->lock 순서로 잡고 나눠 줍니다.
+static pthread_mutex_t hub_lock = PTHREAD_MUTEX_INITIALIZER;
+static Subscriber *subscribers = NULL;
+static int subscriber_count = 0; // 구독자가 없을 때 훅이 링에 넣지 않도록 따로 둠
+static SubscriptionStats stats = {0};
+
+static pthread_t dispatcher_thread;
+static int dispatcher_running = 0;
+static int dispatcher_stopping = 0;
+
+// subtree 판정용 방문 표시. 디스패처 스레드에서만 쓰므로 따로 보호하지 않습니다.
+static uint32_t *visit_stamp = NULL;
+static uint32_t visit_capacity = 0;
+static uint32_t visit_generation = 0;
+static uint32_t visit_queue[SUBSCRIPTION_SUBTREE_MAX_VISIT];
+
+Subscriber *subscriber_create()
+{
+    Subscriber *subscriber = calloc(1, sizeof(Subscriber));
+    if (subscriber == NULL)
+    {
+        return NULL;
+    }
+    subscriber->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (subscriber->event_fd < 0)
+    {
+        syslog(LOG_ERR, "Failed to create subscription eventfd");
+        free(subscriber);
+        return NULL;
+    }
+    pthread_mutex_init(&subscriber->lock, NULL);
+
+    pthread_mutex_lock(&hub_lock);
+    subscriber->next = subscribers;
+    subscribers = subscriber;
+    __atomic_add_fetch(&subscriber_count, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&hub_lock);
+    return subscriber;
+}
+
+void subscriber_destroy(Subscriber *subscriber)
+{
+    if (subscriber == NULL)
+    {
+        return;
+    }
+    pthread_mutex_lock(&hub_lock);
+    for (Subscriber **link = &subscribers; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == subscriber)
+        {
+            *link = subscriber->next;
+            break;
+        }
+    }
+    __atomic_sub_fetch(&subscriber_count, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&hub_lock);
+
+    close(subscriber->event_fd);
+    pthread_mutex_destroy(&subscriber->lock);
+    free(subscriber);
+}
+
+// 빈 자리에 구독을 넣고 id(1부터)를 반환합니다. 자리가 없으면 0을 반환합니다.
+int subscriber_add(Subscriber *subscriber, SubscriptionKind kind, uint32_t index)
+{
+    int id = 0;
+    pthread_mutex_lock(&subscriber->lock);
+    for (int i = 0; i < SUBSCRIPTION_MAX_PER_CONNECTION; i++)
+    {
+        if (subscriber->subscriptions[i].kind == 0)
+        {
+            subscriber->subscriptions[i].kind = kind;
+            subscriber->subscriptions[i].index = index;
+            id = i + 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&subscriber->lock);
+    return id;
+}
+
+// id가 0이면 모든 구독을 지웁니다. 지운 구독이 있으면 1을 반환합니다.
+int subscriber_remove(Subscriber *subscriber, int id)
+{
+    int removed = 0;
+    pthread_mutex_lock(&subscriber->lock);
+    for (int i = 0; i < SUBSCRIPTION_MAX_PER_CONNECTION; i++)
+    {
+        if ((id == 0 || id == i + 1) && subscriber->subscriptions[i].kind != 0)
+        {
+            subscriber->subscriptions[i].kind = 0;
+            removed = 1;
+        }
+    }
+    pthread_mutex_unlock(&subscriber->lock);
+    return removed;
+}
+
+// store_lock을 읽기로 잡은 채 호출합니다. start에서 역방향 링크를 따라 올라가며 조상(자기 자신 포함)을
+// visit_stamp에 표시합니다. 방문 한도에 걸려 다 보지 못했으면 0을 반환합니다.
+static int mark_ancestors(uint32_t start)
+{
+    if (visit_capacity < index_table_size)
+    {
+        uint32_t capacity = visit_capacity > 0 ? visit_capacity : 1024;
+        while (capacity < index_table_size)
+        {
+            capacity *= 2;
+        }
+        uint32_t *stamps = realloc(visit_stamp, sizeof(uint32_t) * capacity);
+        if (stamps == NULL)
+        {
+            return 0;
+        }
+        memset(stamps + visit_capacity, 0, sizeof(uint32_t) * (capacity - visit_capacity));
+        visit_stamp = stamps;
+        visit_capacity = capacity;
+    }
+    if (++visit_generation == 0)
+    {
+        memset(visit_stamp, 0, sizeof(uint32_t) * visit_capacity);
+        visit_generation = 1;
+    }
+    stats.subtree_checks++;
+
+    uint32_t head = 0, tail = 0;
+    visit_stamp[start - 1] = visit_generation;
+    visit_queue[tail++] = start;
+    while (head < tail)
+    {
+        IndexEntry *entry = &index_table[visit_queue[head++] - 1];
+        for (uint32_t i = 0; i < entry->backward_link_count; i++)
+        {
+            uint32_t parent = entry->backward_links[i];
+            if (parent == 0 || parent > index_table_size || visit_stamp[parent - 1] == visit_generation)
+            {
+                continue;
+            }
+            if (tail == SUBSCRIPTION_SUBTREE_MAX_VISIT)
+            {
+                return 0;
+            }
+            visit_stamp[parent - 1] = visit_generation;
+            visit_queue[tail++] = parent;
+        }
+    }
+    return 1;
+}
+
+static int has_forward_link(uint32_t source, uint32_t target)
+{
+    IndexEntry *entry = &index_table[source - 1];
+    for (uint32_t i = 0; i < entry->forward_link_count; i++)
+    {
+        if (entry->forward_links[i] == target)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void wake_subscriber(Subscriber *subscriber)
+{
+    uint64_t one = 1;
+    if (write(subscriber->event_fd, &one, sizeof(one)) < 0)
+    {
+        // 카운터가 가득 찬 경우뿐이며 이미 깨울 신호가 있는 상태
+    }
+}
+
+// subscriber->lock을 잡은 채 호출합니다. 같은 변경이 아직 큐에 있으면 구독 비트만 합칩니다.
+static void enqueue_event(Subscriber *subscriber, const ChangeEvent *event)
+{
+    for (uint32_t i = 0; i < subscriber->count; i++)
+    {
+        ChangeEvent *queued = &subscriber->queue[(subscriber->head + i) % SUBSCRIPTION_QUEUE_LENGTH];
+        if (queued->type == event->type && queued->index == event->index && queued->target == event->target)
+        {
+            queued->subscriptions |= event->subscriptions;
+            stats.coalesced++;
+            return;
+        }
+    }
+
+    int wake = subscriber->count == 0 && subscriber->dropped == 0;
+    if (subscriber->count == SUBSCRIPTION_QUEUE_LENGTH)
+    {
+        // 느린 연결 때문에 메모리가 늘지 않도록 버리고, 다음 프레임에서 다시 읽어 오라고 알림
+        subscriber->dropped++;
+        stats.dropped++;
+        return;
+    }
+    subscriber->queue[(subscriber->head + subscriber->count) % SUBSCRIPTION_QUEUE_LENGTH] = *event;
+    subscriber->count++;
+    stats.enqueued++;
+
+    if (wake)
+    {
+        wake_subscriber(subscriber);
+    }
+}
+
+// store_lock(읽기)과 hub_lock을 잡은 채 디스패처가 호출합니다. 변경에 걸리는 구독을 찾아 각 연결의 큐에 넣습니다.
+// 링을 거치는 동안 다른 쓰기가 끝났을 수 있으므로 링크/subtree 판정은 꺼낸 시점의 링크 상태로 합니다.
+static void dispatch_event(const ChangeEvent *change)
+{
+    ChangeType type = change->type;
+    uint32_t index = change->index;
+    uint32_t target = change->target;
+    // 링크 변경은 from이 subtree 안에 있을 때 그 subtree의 변경
+    uint32_t subject = index;
+    int ancestors_marked = -1; // -1: 아직 계산 안 함, 0: 한도 초과 (모두 해당한다고 봄), 1: 계산됨
+
+    stats.published++;
+    for (Subscriber *subscriber = subscribers; subscriber != NULL; subscriber = subscriber->next)
+    {
+        pthread_mutex_lock(&subscriber->lock);
+        ChangeEvent event = {type, index, target, 0};
+        for (int i = 0; i < SUBSCRIPTION_MAX_PER_CONNECTION; i++)
+        {
+            Subscription *subscription = &subscriber->subscriptions[i];
+            int match = 0;
+            switch (subscription->kind)
+            {
+            case SUBSCRIBE_ALL:
+                match = 1;
+                break;
+            case SUBSCRIBE_LINKS:
+                if (subscription->index == 0 || subscription->index > index_table_size)
+                {
+                    break;
+                }
+                if (type == CHANGE_LINK || type == CHANGE_UNLINK)
+                {
+                    match = index == subscription->index;
+                }
+                else if (type == CHANGE_MODIFY || type == CHANGE_DELETE)
+                {
+                    match = index == subscription->index || has_forward_link(subscription->index, index);
+                }
+                break;
+            case SUBSCRIBE_SUBTREE:
+                if (type == CHANGE_APPEND || subscription->index == 0 || subscription->index > index_table_size)
+                {
+                    break; // 새 메시지는 링크가 생길 때 subtree에 들어옴
+                }
+                if (ancestors_marked < 0)
+                {
+                    ancestors_marked = mark_ancestors(subject);
+                }
+                match = ancestors_marked == 0 || visit_stamp[subscription->index - 1] == visit_generation;
+                break;
+            }
+            if (match)
+            {
+                event.subscriptions |= 1u << i;
+            }
+        }
+        if (event.subscriptions != 0)
+        {
+            enqueue_event(subscriber, &event);
+        }
+        pthread_mutex_unlock(&subscriber->lock);
+    }
+}
+
+// 링이 넘쳐 버린 변경은 누구에게 가야 했는지 모르므로 모든 구독자에게 다시 읽으라고 알립니다.
+static void dispatch_bus_drops(uint64_t count)
+{
+    for (Subscriber *subscriber = subscribers; subscriber != NULL; subscriber = subscriber->next)
+    {
+        pthread_mutex_lock(&subscriber->lock);
+        if (subscriber->count == 0 && subscriber->dropped == 0)
+        {
+            wake_subscriber(subscriber);
+        }
+        subscriber->dropped += count;
+        pthread_mutex_unlock(&subscriber->lock);
+    }
+    stats.dropped += count;
+}
+
+static void *dispatcher_main(void *arg)
+{
+    (void)arg;
+    ChangeEvent batch[EVENT_BUS_BATCH];
+    uint64_t reported_drops = 0;
+    int idle = 0;
+    while (!__atomic_load_n(&dispatcher_stopping, __ATOMIC_ACQUIRE))
+    {
+        uint32_t count = event_bus_pop_batch(batch, EVENT_BUS_BATCH);
+        uint64_t drops = event_bus_get_stats().dropped;
+        if (count == 0 && drops == reported_drops)
+        {
+            // 바로 잠들면 변경마다 생산자가 eventfd로 깨워야 하므로, 잠시 양보하며 변경이 모이기를 기다림
+            if (++idle <= EVENT_BUS_SPIN_YIELDS)
+            {
+                sched_yield();
+            }
+            else
+            {
+                event_bus_wait(EVENT_BUS_IDLE_MS);
+                idle = 0;
+            }
+            continue;
+        }
+        idle = 0;
+
+        // 배치 하나에 락을 한 번씩만 잡음
+        pthread_rwlock_rdlock(&store_lock);
+        pthread_mutex_lock(&hub_lock);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            dispatch_event(&batch[i]);
+        }
+        if (drops != reported_drops)
+        {
+            dispatch_bus_drops(drops - reported_drops);
+            reported_drops = drops;
+        }
+        pthread_mutex_unlock(&hub_lock);
+        pthread_rwlock_unlock(&store_lock);
+    }
+    return NULL;
+}
+
+void subscription_start()
+{
+    if (!event_bus_init())
+    {
+        return;
+    }
+    dispatcher_stopping = 0;
+    if (pthread_create(&dispatcher_thread, NULL, dispatcher_main, NULL) != 0)
+    {
+        syslog(LOG_ERR, "Failed to start subscription dispatcher");
+        event_bus_destroy();
+        return;
+    }
+    __atomic_store_n(&dispatcher_running, 1, __ATOMIC_RELEASE);
+}
+
+void subscription_stop()
+{
+    if (!dispatcher_running)
+    {
+        return;
+    }
+    __atomic_store_n(&dispatcher_running, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&dispatcher_stopping, 1, __ATOMIC_RELEASE);
+    event_bus_wake();
+    pthread_join(dispatcher_thread, NULL);
+    event_bus_destroy();
+}
+
+// store_lock을 쓰기로 잡은 채 불리므로 락 없이 링에 넣기만 합니다. 구독자가 없으면 아무것도 하지 않습니다.
+static void publish(ChangeType type, uint32_t index, uint32_t target)
+{
+    if (__atomic_load_n(&subscriber_count, __ATOMIC_ACQUIRE) == 0 || !__atomic_load_n(&dispatcher_running, __ATOMIC_ACQUIRE))
+    {
+        return;
+    }
+    ChangeEvent event = {type, index, target, 0};
+    event_bus_push(&event);
+}
+
+
+void subscription_on_append(uint32_t index)
+{
+    publish(CHANGE_APPEND, index, 0);
+}
+
+void subscription_on_modify(uint32_t index)
+{
+    publish(CHANGE_MODIFY, index, 0);
+}
+
+// from -> to 순방향 링크가 생기거나(added) 없어졌을 때. 역방향 링크 명령은 호출하는 쪽에서 뒤집어 넘깁니다.
+void subscription_on_link(uint32_t from, uint32_t to, int added)
+{
+    publish(added ? CHANGE_LINK : CHANGE_UNLINK, from, to);
+}
+
+void subscription_on_delete(uint32_t index)
+{
+    publish(CHANGE_DELETE, index, 0);
+}
+
+static const char *change_type_name(uint8_t type)
+{
+    switch (type)
+    {
+    case CHANGE_APPEND:
+        return "append";
+    case CHANGE_MODIFY:
+        return "modify";
+    case CHANGE_LINK:
+        return "link";
+    case CHANGE_DELETE:
+        return "delete";
+    default:
+        return "unlink";
+    }
+}
+
+// 연결 스레드에서 eventfd가 깨우면 호출합니다. 쌓인 이벤트를 SUBSCRIPTION_FRAME_EVENTS개씩
+// subscription_events 프레임으로 보냅니다. 보내는 동안에는 락을 잡지 않으므로 느린 연결이 발행을 막지 않습니다.
+int subscriber_flush(Subscriber *subscriber, SubscriptionFrameWriter writer, void *context)
+{
+    uint64_t signal;
+    if (read(subscriber->event_fd, &signal, sizeof(signal)) < 0)
+    {
+        // EAGAIN: 이미 다른 flush가 신호를 가져감
+    }
+
+    ChangeEvent events[SUBSCRIPTION_FRAME_EVENTS];
+    for (;;)
+    {
+        pthread_mutex_lock(&subscriber->lock);
+        uint32_t count = subscriber->count < SUBSCRIPTION_FRAME_EVENTS ? subscriber->count : SUBSCRIPTION_FRAME_EVENTS;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            events[i] = subscriber->queue[(subscriber->head + i) % SUBSCRIPTION_QUEUE_LENGTH];
+        }
+        subscriber->head = (subscriber->head + count) % SUBSCRIPTION_QUEUE_LENGTH;
+        subscriber->count -= count;
+        uint64_t dropped = subscriber->dropped;
+        subscriber->dropped = 0;
+        pthread_mutex_unlock(&subscriber->lock);
+
+        if (count == 0 && dropped == 0)
+        {
+            return 1;
+        }
+
+        json_object *array = json_object_new_array();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            json_object *event = json_object_new_object();
+            json_object_object_add(event, "type", json_object_new_string(change_type_name(events[i].type)));
+            if (events[i].type == CHANGE_LINK || events[i].type == CHANGE_UNLINK)
+            {
+                json_object_object_add(event, "from", json_object_new_int64(events[i].index));
+                json_object_object_add(event, "to", json_object_new_int64(events[i].target));
+            }
+            else
+            {
+                json_object_object_add(event, "index", json_object_new_int64(events[i].index));
+            }
+            json_object *ids = json_object_new_array();
+            for (int id = 1; id <= SUBSCRIPTION_MAX_PER_CONNECTION; id++)
+            {
+                if (events[i].subscriptions & (1u << (id - 1)))
+                {
+                    json_object_array_add(ids, json_object_new_int(id));
+                }
+            }
+            json_object_object_add(event, "subscriptions", ids);
+            json_object_array_add(array, event);
+        }
+
+        json_object *frame = json_object_new_object();
+        json_object_object_add(frame, "action", json_object_new_string("subscription_events"));
+        json_object_object_add(frame, "events", array);
+        // dropped가 0이 아니면 일부 변경을 놓쳤으므로 클라이언트는 보고 있는 것을 다시 읽어야 함
+        json_object_object_add(frame, "dropped", json_object_new_int64(dropped));
+        int ok = writer(context, json_object_to_json_string(frame));
+        json_object_put(frame);
+        if (!ok)
+        {
+            return 0;
+        }
+        __atomic_add_fetch(&stats.delivered, count, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&stats.frames, 1, __ATOMIC_RELAXED);
+    }
+}
+
+SubscriptionStats subscription_get_stats()
+{
+    pthread_mutex_lock(&hub_lock);
+    SubscriptionStats snapshot = stats;
+    snapshot.delivered = __atomic_load_n(&stats.delivered, __ATOMIC_RELAXED);
+    snapshot.frames = __atomic_load_n(&stats.frames, __ATOMIC_RELAXED);
+    snapshot.subscribers = 0;
+    snapshot.subscriptions = 0;
+    for (Subscriber *subscriber = subscribers; subscriber != NULL; subscriber = subscriber->next)
+    {
+        uint32_t active = 0;
+        pthread_mutex_lock(&subscriber->lock);
+        for (int i = 0; i < SUBSCRIPTION_MAX_PER_CONNECTION; i++)
+        {
+            active += subscriber->subscriptions[i].kind != 0;
+        }
+        pthread_mutex_unlock(&subscriber->lock);
+        snapshot.subscribers += active > 0;
+        snapshot.subscriptions += active;
+    }
+    pthread_mutex_unlock(&hub_lock);
+    return snapshot;
+}
+
+char *get_subscription_stats_info()
+{
+    SubscriptionStats stats = subscription_get_stats();
+
+    json_object *data = json_object_new_object();
+    json_object_object_add(data, "subscribers", json_object_new_int64(stats.subscribers));
+    json_object_object_add(data, "subscriptions", json_object_new_int64(stats.subscriptions));
+    json_object_object_add(data, "published", json_object_new_int64(stats.published));
+    json_object_object_add(data, "enqueued", json_object_new_int64(stats.enqueued));
+    json_object_object_add(data, "coalesced", json_object_new_int64(stats.coalesced));
+    json_object_object_add(data, "dropped", json_object_new_int64(stats.dropped));
+    json_object_object_add(data, "delivered", json_object_new_int64(stats.delivered));
+    json_object_object_add(data, "frames", json_object_new_int64(stats.frames));
+    json_object_object_add(data, "subtree_checks", json_object_new_int64(stats.subtree_checks));
+
+    EventBusStats bus = event_bus_get_stats();
+    json_object *bus_obj = json_object_new_object();
+    json_object_object_add(bus_obj, "capacity", json_object_new_int(EVENT_BUS_CAPACITY));
+    json_object_object_add(bus_obj, "pushed", json_object_new_int64(bus.pushed));
+    json_object_object_add(bus_obj, "dropped", json_object_new_int64(bus.dropped));
+    json_object_object_add(bus_obj, "pending", json_object_new_int64(bus.pushed - bus.popped));
+    json_object_object_add(bus_obj, "batches", json_object_new_int64(bus.batches));
+    json_object_object_add(bus_obj, "max_batch", json_object_new_int64(bus.max_batch));
+    json_object_object_add(bus_obj, "wakeups", json_object_new_int64(bus.wakeups));
+    json_object_object_add(data, "bus", bus_obj);
+
+    json_object *result = json_object_new_object();
+    json_object_object_add(result, "action", json_object_new_string("subscription_stats"));
+    json_object_object_add(result, "data", data);
+
+    char *response = strdup(json_object_to_json_string(result));
+    json_object_put(result);
+    return response;
+}
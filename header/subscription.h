@@ -0,0 +1,81 @@
+#ifndef SUBSCRIPTION_H
+#define SUBSCRIPTION_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#define SUBSCRIPTION_QUEUE_LENGTH 256       // 연결 하나에 쌓아 두는 최대 이벤트 수 (넘치면 버리고 overflow 알림)
+#define SUBSCRIPTION_MAX_PER_CONNECTION 16  // 연결 하나가 가질 수 있는 구독 수 (id는 1..16, 이벤트에 비트마스크로 표시)
+#define SUBSCRIPTION_FRAME_EVENTS 64        // 한 프레임에 담아 보내는 최대 이벤트 수
+#define SUBSCRIPTION_SUBTREE_MAX_VISIT 4096 // subtree 구독 판정에서 조상을 찾아 방문하는 최대 노드 수
+#define SUBSCRIPTION_POLL_MS 1000           // 구독 중인 연결이 keep_running을 확인하는 간격
+
+typedef enum {
+    SUBSCRIBE_ALL = 1,  // 모든 append/modify/link/delete 변경
+    SUBSCRIBE_LINKS,    // 한 인덱스의 순방향 링크 변경과 그 링크 대상의 수정
+    SUBSCRIBE_SUBTREE   // 한 인덱스에서 순방향 링크로 닿는 메시지들의 변경
+} SubscriptionKind;
+
+typedef enum {
+    CHANGE_APPEND = 1,
+    CHANGE_MODIFY,
+    CHANGE_LINK,        // from -> to 순방향 링크가 생김
+    CHANGE_UNLINK,      // from -> to 순방향 링크가 없어짐
+    CHANGE_DELETE       // 메시지가 지워짐 (걸려 있던 링크는 먼저 unlink로 알림)
+} ChangeType;
+
+typedef struct {
+    uint8_t type;           // ChangeType
+    uint32_t index;         // append/modify 대상, 링크 변경이면 from
+    uint32_t target;        // 링크 변경의 to (그 밖에는 0)
+    uint32_t subscriptions; // 이 이벤트에 걸린 구독 id 비트마스크 (id n은 1 << (n - 1))
+} ChangeEvent;
+
+typedef struct {
+    SubscriptionKind kind;
+    uint32_t index;         // LINKS/SUBTREE의 기준 인덱스
+} Subscription;
+
+// 구독한 연결 하나. 디스패처가 queue에 쌓고, 연결 스레드가 eventfd로 깨어나 꺼내 보냅니다.
+typedef struct Subscriber {
+    pthread_mutex_t lock;
+    int event_fd;
+    Subscription subscriptions[SUBSCRIPTION_MAX_PER_CONNECTION]; // kind가 0이면 빈 자리
+    ChangeEvent queue[SUBSCRIPTION_QUEUE_LENGTH];                // 원형 큐
+    uint32_t head;
+    uint32_t count;
+    uint64_t dropped;       // 큐가 넘쳐 버린 뒤 아직 알리지 않은 이벤트 수
+    struct Subscriber *next;
+} Subscriber;
+
+typedef struct {
+    uint32_t subscribers;       // 구독이 하나 이상 있는 연결 수
+    uint32_t subscriptions;
+    uint64_t published;         // 디스패처가 구독자에게 나눠 준 변경 수
+    uint64_t enqueued;          // 연결 큐에 들어간 이벤트 수
+    uint64_t coalesced;         // 이미 큐에 같은 이벤트가 있어 합쳐진 수
+    uint64_t dropped;           // 연결 큐가 넘치거나 event_bus 링이 넘쳐 버린 이벤트 수
+    uint64_t delivered;         // 연결로 보낸 이벤트 수
+    uint64_t frames;            // 보낸 subscription_events 프레임 수
+    uint64_t subtree_checks;    // subtree 구독 판정을 위해 조상을 거슬러 올라간 횟수
+} SubscriptionStats;
+
+// 꺼낸 이벤트들을 JSON 프레임 하나로 보냅니다. 실패하면 0을 반환합니다.
+typedef int (*SubscriptionFrameWriter)(void *context, const char *frame);
+
+// Function declarations
+void subscription_start();
+void subscription_stop();
+Subscriber *subscriber_create();
+void subscriber_destroy(Subscriber *subscriber);
+int subscriber_add(Subscriber *subscriber, SubscriptionKind kind, uint32_t index);
+int subscriber_remove(Subscriber *subscriber, int id);
+int subscriber_flush(Subscriber *subscriber, SubscriptionFrameWriter writer, void *context);
+void subscription_on_append(uint32_t index);
+void subscription_on_modify(uint32_t index);
+void subscription_on_link(uint32_t from, uint32_t to, int added);
+void subscription_on_delete(uint32_t index);
+SubscriptionStats subscription_get_stats();
+char *get_subscription_stats_info();
+
+#endif // SUBSCRIPTION_H
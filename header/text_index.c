@@ -0,0 +1,1187 @@
+#include "text_index.h"
+#include "message_handler.h"
+#include "crc32c.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <pthread.h>
+#include <time.h>
+#include <json-c/json.h>
+
+// 단어 하나의 포스팅 목록.
+// 끝에 붙는 인덱스(새 메시지)는 data에 차이값을 varint로 이어 붙이고,
+// 수정으로 생긴 중간 삽입/삭제는 정렬된 added/removed에 모았다가 충분히 쌓이면 data를 다시 압축합니다.
+typedef struct {
+    unsigned char *data;
+    uint32_t data_used;
+    uint32_t data_capacity;
+    uint32_t data_count;    // data에 든 인덱스 수
+    uint32_t last;          // data의 마지막 인덱스
+    uint32_t *added;        // data 중간에 끼어든 인덱스 (정렬)
+    uint32_t added_count;
+    uint32_t added_capacity;
+    uint32_t *removed;      // data에서 지워진 인덱스 (정렬)
+    uint32_t removed_count;
+    uint32_t removed_capacity;
+} PostingList;
+
+typedef struct {
+    PostingList postings;
+    uint32_t hash;
+    uint32_t length;
+    char term[];
+} TermEntry;
+
+typedef struct {
+    const char *text;
+    uint32_t length;
+} Token;
+
+typedef struct {
+    Token token;
+    int prefix;
+    uint32_t group;         // OR로 나뉜 그룹 번호
+} QueryTerm;
+
+typedef struct {
+    uint32_t *indices;
+    uint32_t count;
+} DocList;
+
+typedef struct {
+    uint32_t score;
+    uint32_t index;
+} ScoredDoc;
+
+// 단어 사전과 포스팅 목록을 보호하는 락. store_lock을 잡은 채로 이 락을 잡을 수 있지만 반대는 안 됩니다.
+static pthread_rwlock_t text_index_lock = PTHREAD_RWLOCK_INITIALIZER;
+static int text_index_ready = 0;
+
+// 단어 -> TermEntry 해시 테이블 (open addressing)
+static TermEntry **term_table = NULL;
+static uint32_t term_table_capacity = 0;
+static uint32_t term_count = 0;
+
+// 접두어 검색용 정렬된 단어 목록과 아직 합치지 않은 새 단어들
+static TermEntry **sorted_terms = NULL;
+static uint32_t sorted_count = 0;
+static uint32_t sorted_capacity = 0;
+static TermEntry *recent_terms[TEXT_INDEX_UNSORTED_TERMS];
+static uint32_t recent_count = 0;
+
+static uint64_t document_count = 0;
+static uint64_t posting_count = 0;
+static uint64_t posting_bytes = 0;
+
+// 시작할 때의 백그라운드 구축 상태
+static pthread_t build_thread;
+static int build_thread_started = 0;
+static volatile int build_stop = 0;
+static int building = 0;
+static uint32_t build_target = 0;
+static uint32_t indexed_upto = 0;
+static uint64_t *modified_during_build = NULL; // 구축 스레드가 읽기 전에 수정되어 이미 인덱스에 들어간 메시지
+static double build_ms = 0;
+
+static int grow_array(void **array, uint32_t *capacity, uint32_t needed, size_t element_size)
+{
+    if (needed <= *capacity)
+    {
+        return 1;
+    }
+    uint32_t new_capacity = *capacity > 0 ? *capacity : 8;
+    while (new_capacity < needed)
+    {
+        new_capacity *= 2;
+    }
+    void *grown = realloc(*array, (size_t)new_capacity * element_size);
+    if (grown == NULL)
+    {
+        syslog(LOG_ERR, "Memory allocation failed for text index");
+        return 0;
+    }
+    *array = grown;
+    *capacity = new_capacity;
+    return 1;
+}
+
+static uint32_t lower_bound(const uint32_t *values, uint32_t count, uint32_t value)
+{
+    uint32_t lo = 0, hi = count;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (values[mid] < value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// 정렬된 배열에 값을 넣습니다. 새로 넣었으면 1, 이미 있으면 0, 메모리가 없으면 -1
+static int sorted_insert(uint32_t **values, uint32_t *count, uint32_t *capacity, uint32_t value)
+{
+    uint32_t pos = lower_bound(*values, *count, value);
+    if (pos < *count && (*values)[pos] == value)
+    {
+        return 0;
+    }
+    if (!grow_array((void **)values, capacity, *count + 1, sizeof(uint32_t)))
+    {
+        return -1;
+    }
+    memmove(*values + pos + 1, *values + pos, sizeof(uint32_t) * (*count - pos));
+    (*values)[pos] = value;
+    (*count)++;
+    return 1;
+}
+
+static int sorted_erase(uint32_t *values, uint32_t *count, uint32_t value)
+{
+    uint32_t pos = lower_bound(values, *count, value);
+    if (pos == *count || values[pos] != value)
+    {
+        return 0;
+    }
+    memmove(values + pos, values + pos + 1, sizeof(uint32_t) * (*count - pos - 1));
+    (*count)--;
+    return 1;
+}
+
+static inline uint32_t varint_encode(unsigned char *out, uint32_t value)
+{
+    uint32_t n = 0;
+    while (value >= 0x80)
+    {
+        out[n++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (unsigned char)value;
+    return n;
+}
+
+// 포스팅 목록을 정렬된 인덱스 배열로 풉니다. out에는 data_count + added_count개가 들어갈 자리가 필요합니다.
+static uint32_t posting_decode(const PostingList *list, uint32_t *out)
+{
+    uint32_t count = 0, value = 0, pos = 0, r = 0, a = 0;
+    for (uint32_t k = 0; k < list->data_count; k++)
+    {
+        uint32_t delta = 0, shift = 0;
+        unsigned char byte;
+        do
+        {
+            byte = list->data[pos++];
+            delta |= (uint32_t)(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        value += delta;
+
+        while (r < list->removed_count && list->removed[r] < value)
+            r++;
+        if (r < list->removed_count && list->removed[r] == value)
+            continue;
+        while (a < list->added_count && list->added[a] < value)
+            out[count++] = list->added[a++];
+        out[count++] = value;
+    }
+    while (a < list->added_count)
+        out[count++] = list->added[a++];
+    return count;
+}
+
+static void posting_compact(PostingList *list)
+{
+    uint32_t *merged = malloc(sizeof(uint32_t) * ((size_t)list->data_count + list->added_count + 1));
+    if (merged == NULL)
+    {
+        return;
+    }
+    uint32_t count = posting_decode(list, merged);
+    unsigned char *data = malloc((size_t)count * 5 + 1);
+    if (data == NULL)
+    {
+        free(merged);
+        return;
+    }
+
+    uint32_t used = 0, last = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        used += varint_encode(data + used, merged[i] - last);
+        last = merged[i];
+    }
+    free(merged);
+
+    unsigned char *shrunk = realloc(data, used + 1);
+    if (shrunk != NULL)
+    {
+        data = shrunk;
+    }
+    posting_bytes = posting_bytes - list->data_used + used;
+    free(list->data);
+    list->data = data;
+    list->data_capacity = shrunk != NULL ? used + 1 : (uint32_t)((size_t)count * 5 + 1);
+    list->data_used = used;
+    list->data_count = count;
+    list->last = last;
+    list->added_count = 0;
+    list->removed_count = 0;
+}
+
+static void posting_maybe_compact(PostingList *list)
+{
+    uint32_t pending = list->added_count + list->removed_count;
+    if (pending > TEXT_INDEX_PENDING_MIN && (uint64_t)pending * 8 > list->data_count)
+    {
+        posting_compact(list);
+    }
+}
+
+// data에 index가 들어 있는지 앞에서부터 풀어 보며 찾습니다 (removed는 보지 않음).
+static int posting_data_contains(const PostingList *list, uint32_t index)
+{
+    uint32_t value = 0, pos = 0;
+    for (uint32_t k = 0; k < list->data_count && value < index; k++)
+    {
+        uint32_t delta = 0, shift = 0;
+        unsigned char byte;
+        do
+        {
+            byte = list->data[pos++];
+            delta |= (uint32_t)(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        value += delta;
+    }
+    return list->data_count > 0 && value == index;
+}
+
+// check_data가 1이면 data 중간에 이미 있는 인덱스를 added에 다시 넣지 않습니다.
+// 옛 내용을 빼지 못한 수정처럼 이미 들어 있을 수 있는 경우에만 씁니다 (data를 풀어 보므로 느림).
+static void posting_add(PostingList *list, uint32_t index, int check_data)
+{
+    if (sorted_erase(list->removed, &list->removed_count, index))
+    {
+        posting_count++;
+        return;
+    }
+    if (check_data && list->data_count > 0 && index <= list->last && posting_data_contains(list, index))
+    {
+        return;
+    }
+    if (list->data_count == 0 || index > list->last)
+    {
+        if (!grow_array((void **)&list->data, &list->data_capacity, list->data_used + 5, 1))
+        {
+            return;
+        }
+        uint32_t n = varint_encode(list->data + list->data_used, index - list->last);
+        list->data_used += n;
+        list->data_count++;
+        list->last = index;
+        posting_bytes += n;
+        posting_count++;
+        return;
+    }
+    if (sorted_insert(&list->added, &list->added_count, &list->added_capacity, index) == 1)
+    {
+        posting_count++;
+        posting_maybe_compact(list);
+    }
+}
+
+static void posting_remove(PostingList *list, uint32_t index)
+{
+    if (sorted_erase(list->added, &list->added_count, index))
+    {
+        posting_count--;
+        return;
+    }
+    if (list->data_count == 0 || index > list->last)
+    {
+        return;
+    }
+    if (sorted_insert(&list->removed, &list->removed_count, &list->removed_capacity, index) == 1)
+    {
+        posting_count--;
+        posting_maybe_compact(list);
+    }
+}
+
+static int compare_term_entry(const void *a, const void *b)
+{
+    const TermEntry *ta = *(const TermEntry *const *)a;
+    const TermEntry *tb = *(const TermEntry *const *)b;
+    int c = memcmp(ta->term, tb->term, ta->length < tb->length ? ta->length : tb->length);
+    if (c != 0)
+        return c;
+    return (ta->length > tb->length) - (ta->length < tb->length);
+}
+
+// 새 단어들을 정렬해 정렬된 단어 목록에 뒤에서부터 병합합니다.
+static void merge_recent_terms()
+{
+    if (recent_count == 0)
+    {
+        return;
+    }
+    qsort(recent_terms, recent_count, sizeof(TermEntry *), compare_term_entry);
+    if (!grow_array((void **)&sorted_terms, &sorted_capacity, sorted_count + recent_count, sizeof(TermEntry *)))
+    {
+        return;
+    }
+
+    uint32_t i = sorted_count, j = recent_count, out = sorted_count + recent_count;
+    while (j > 0)
+    {
+        if (i > 0 && compare_term_entry(&sorted_terms[i - 1], &recent_terms[j - 1]) > 0)
+            sorted_terms[--out] = sorted_terms[--i];
+        else
+            sorted_terms[--out] = recent_terms[--j];
+    }
+    sorted_count += recent_count;
+    recent_count = 0;
+}
+
+static TermEntry *find_term(const char *term, uint32_t length, uint32_t hash)
+{
+    if (term_table_capacity == 0)
+    {
+        return NULL;
+    }
+    uint32_t mask = term_table_capacity - 1;
+    for (uint32_t i = hash & mask; term_table[i] != NULL; i = (i + 1) & mask)
+    {
+        TermEntry *entry = term_table[i];
+        if (entry->hash == hash && entry->length == length && memcmp(entry->term, term, length) == 0)
+        {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static int grow_term_table()
+{
+    uint32_t new_capacity = term_table_capacity > 0 ? term_table_capacity * 2 : 4096;
+    TermEntry **table = calloc(new_capacity, sizeof(TermEntry *));
+    if (table == NULL)
+    {
+        syslog(LOG_ERR, "Memory allocation failed for text index");
+        return 0;
+    }
+    for (uint32_t i = 0; i < term_table_capacity; i++)
+    {
+        if (term_table[i] != NULL)
+        {
+            uint32_t slot = term_table[i]->hash & (new_capacity - 1);
+            while (table[slot] != NULL)
+            {
+                slot = (slot + 1) & (new_capacity - 1);
+            }
+            table[slot] = term_table[i];
+        }
+    }
+    free(term_table);
+    term_table = table;
+    term_table_capacity = new_capacity;
+    return 1;
+}
+
+static TermEntry *get_or_add_term(const char *term, uint32_t length, uint32_t hash)
+{
+    TermEntry *entry = find_term(term, length, hash);
+    if (entry != NULL)
+    {
+        return entry;
+    }
+    if ((uint64_t)(term_count + 1) * 10 > (uint64_t)term_table_capacity * 7 && !grow_term_table())
+    {
+        return NULL;
+    }
+
+    entry = calloc(1, sizeof(TermEntry) + length + 1);
+    if (entry == NULL)
+    {
+        syslog(LOG_ERR, "Memory allocation failed for text index");
+        return NULL;
+    }
+    memcpy(entry->term, term, length);
+    entry->length = length;
+    entry->hash = hash;
+
+    uint32_t mask = term_table_capacity - 1;
+    uint32_t slot = hash & mask;
+    while (term_table[slot] != NULL)
+    {
+        slot = (slot + 1) & mask;
+    }
+    term_table[slot] = entry;
+    term_count++;
+
+    recent_terms[recent_count++] = entry;
+    if (recent_count == TEXT_INDEX_UNSORTED_TERMS)
+    {
+        merge_recent_terms();
+        recent_count = 0; // 병합에 실패해도 새 단어는 계속 받음 (그 단어들은 접두어 검색에서만 빠짐)
+    }
+    return entry;
+}
+
+static inline int is_term_byte(unsigned char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+}
+
+// text를 제자리에서 소문자로 바꾸며 단어로 자릅니다. 영숫자와 UTF-8 바이트(한글 등)가 단어를 이루고 나머지는 구분자입니다.
+// tokens에는 length / 2 + 1개가 들어갈 자리가 필요합니다.
+static uint32_t tokenize(char *text, uint32_t length, Token *tokens, uint32_t max_tokens)
+{
+    uint32_t count = 0, i = 0;
+    while (i < length && count < max_tokens)
+    {
+        while (i < length && !is_term_byte((unsigned char)text[i]))
+        {
+            i++;
+        }
+        uint32_t start = i;
+        while (i < length && is_term_byte((unsigned char)text[i]))
+        {
+            if (text[i] >= 'A' && text[i] <= 'Z')
+            {
+                text[i] += 'a' - 'A';
+            }
+            i++;
+        }
+
+        uint32_t token_length = i - start;
+        if (token_length > TEXT_INDEX_MAX_TERM)
+        {
+            // UTF-8 문자 중간에서 자르지 않도록 연속 바이트 앞까지 물러남
+            token_length = TEXT_INDEX_MAX_TERM;
+            while (token_length > 0 && ((unsigned char)text[start + token_length] & 0xC0) == 0x80)
+            {
+                token_length--;
+            }
+        }
+        if (token_length > 0)
+        {
+            tokens[count].text = text + start;
+            tokens[count].length = token_length;
+            count++;
+        }
+    }
+    return count;
+}
+
+static int compare_token(const void *a, const void *b)
+{
+    const Token *ta = a;
+    const Token *tb = b;
+    int c = memcmp(ta->text, tb->text, ta->length < tb->length ? ta->length : tb->length);
+    if (c != 0)
+        return c;
+    return (ta->length > tb->length) - (ta->length < tb->length);
+}
+
+// 메시지의 단어를 모두 포스팅 목록에 넣거나(add) 뺍니다. 같은 단어는 한 번만 처리합니다.
+// text_index_lock을 쓰기로 잡은 상태여야 합니다.
+// add가 0이면 빼고, 1이면 넣고, 2이면 이미 들어 있지 않은 단어에만 넣습니다.
+static void index_document(uint32_t index, const char *text, uint32_t length, int add)
+{
+    char *normalized = malloc(length + 1);
+    Token *tokens = malloc(sizeof(Token) * (length / 2 + 1));
+    if (normalized == NULL || tokens == NULL)
+    {
+        syslog(LOG_ERR, "Memory allocation failed for text index");
+        free(normalized);
+        free(tokens);
+        return;
+    }
+    memcpy(normalized, text, length);
+
+    uint32_t count = tokenize(normalized, length, tokens, length / 2 + 1);
+    qsort(tokens, count, sizeof(Token), compare_token);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (i > 0 && compare_token(&tokens[i - 1], &tokens[i]) == 0)
+        {
+            continue;
+        }
+        uint32_t hash = crc32c(0, tokens[i].text, tokens[i].length);
+        TermEntry *entry = add ? get_or_add_term(tokens[i].text, tokens[i].length, hash) : find_term(tokens[i].text, tokens[i].length, hash);
+        if (entry == NULL)
+        {
+            continue;
+        }
+        if (add)
+            posting_add(&entry->postings, index, add == 2);
+        else
+            posting_remove(&entry->postings, index);
+    }
+
+    free(normalized);
+    free(tokens);
+}
+
+static inline int bitmap_test(const uint64_t *bitmap, uint32_t index)
+{
+    return (bitmap[index >> 6] >> (index & 63)) & 1;
+}
+
+static double elapsed_ms_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+// 시작할 때 있던 메시지를 TEXT_INDEX_BUILD_BATCH개씩 읽어 인덱스에 넣습니다.
+// 캐시를 거치지 않는 배치 읽기를 쓰므로 레코드 캐시를 밀어내지 않습니다.
+static void *build_text_index(void *arg)
+{
+    (void)arg;
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    uint32_t indices[TEXT_INDEX_BUILD_BATCH];
+
+    for (uint32_t first = 1; first <= build_target && !build_stop; first += TEXT_INDEX_BUILD_BATCH)
+    {
+        uint32_t count = build_target - first + 1;
+        if (count > TEXT_INDEX_BUILD_BATCH)
+        {
+            count = TEXT_INDEX_BUILD_BATCH;
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+            indices[i] = first + i;
+        }
+
+        MessageBatch *batch = scan_messages_by_indices(indices, count);
+
+        pthread_rwlock_wrlock(&text_index_lock);
+        for (uint32_t i = 0; i < count && batch != NULL; i++)
+        {
+            // 읽은 뒤에 수정된 메시지는 수정 쪽에서 이미 새 내용으로 넣었음
+            if (batch->texts[i] != NULL && !bitmap_test(modified_during_build, indices[i]))
+            {
+                index_document(indices[i], batch->texts[i], batch->lengths[i], 1);
+                document_count++;
+            }
+        }
+        indexed_upto = first + count - 1;
+        pthread_rwlock_unlock(&text_index_lock);
+
+        free_message_batch(batch);
+    }
+
+    pthread_rwlock_wrlock(&text_index_lock);
+    building = 0;
+    free(modified_during_build);
+    modified_during_build = NULL;
+    merge_recent_terms();
+    build_ms = elapsed_ms_since(&started);
+    syslog(LOG_INFO, "Text index built: %u messages, %u terms in %.1f ms", indexed_upto, term_count, build_ms);
+    pthread_rwlock_unlock(&text_index_lock);
+    return NULL;
+}
+
+// 전문 검색 인덱스를 켜고 기존 메시지로 백그라운드 구축을 시작합니다.
+// 요청을 받기 시작하기 전에 (recover_store() 뒤에) 호출해야 합니다.
+void text_index_start()
+{
+    if (!TEXT_INDEX_ENABLED)
+    {
+        return;
+    }
+
+    pthread_rwlock_wrlock(&text_index_lock);
+    build_target = get_max_index();
+    indexed_upto = 0;
+    build_stop = 0;
+    modified_during_build = calloc(build_target / 64 + 1, sizeof(uint64_t));
+    building = build_target > 0 && modified_during_build != NULL;
+    text_index_ready = 1;
+    pthread_rwlock_unlock(&text_index_lock);
+
+    if (!building)
+    {
+        return;
+    }
+    if (pthread_create(&build_thread, NULL, build_text_index, NULL) == 0)
+    {
+        build_thread_started = 1;
+    }
+    else
+    {
+        syslog(LOG_ERR, "Failed to start text index thread, building in foreground");
+        build_text_index(NULL);
+    }
+}
+
+// 구축 스레드를 멈추고 인덱스를 해제합니다.
+void text_index_stop()
+{
+    build_stop = 1;
+    if (build_thread_started)
+    {
+        pthread_join(build_thread, NULL);
+        build_thread_started = 0;
+    }
+
+    pthread_rwlock_wrlock(&text_index_lock);
+    text_index_ready = 0;
+    for (uint32_t i = 0; i < term_table_capacity; i++)
+    {
+        TermEntry *entry = term_table[i];
+        if (entry != NULL)
+        {
+            free(entry->postings.data);
+            free(entry->postings.added);
+            free(entry->postings.removed);
+            free(entry);
+        }
+    }
+    free(term_table);
+    free(sorted_terms);
+    term_table = NULL;
+    sorted_terms = NULL;
+    term_table_capacity = term_count = sorted_count = sorted_capacity = recent_count = 0;
+    document_count = posting_count = posting_bytes = 0;
+    pthread_rwlock_unlock(&text_index_lock);
+}
+
+// append_message_to_file()에서 store_lock을 쓰기로 잡은 채 호출됩니다.
+void text_index_on_append(uint32_t index, const char *text, uint32_t length)
+{
+    if (!text_index_ready)
+    {
+        return;
+    }
+    pthread_rwlock_wrlock(&text_index_lock);
+    index_document(index, text, length, 1);
+    document_count++;
+    pthread_rwlock_unlock(&text_index_lock);
+}
+
+// modify_message_by_index()에서 store_lock을 쓰기로 잡은 채 호출됩니다. old_text를 읽지 못했으면 NULL입니다.
+void text_index_on_modify(uint32_t index, const char *old_text, const char *new_text)
+{
+    if (!text_index_ready)
+    {
+        return;
+    }
+    pthread_rwlock_wrlock(&text_index_lock);
+    if (building && index > indexed_upto && index <= build_target && !bitmap_test(modified_during_build, index))
+    {
+        // 구축 스레드가 아직 넣지 않은 메시지: 새 내용만 넣고 구축 스레드가 건너뛰게 표시
+        modified_during_build[index >> 6] |= (uint64_t)1 << (index & 63);
+        index_document(index, new_text, strlen(new_text), 1);
+        document_count++;
+    }
+    else
+    {
+        if (old_text != NULL)
+        {
+            index_document(index, old_text, strlen(old_text), 0);
+            index_document(index, new_text, strlen(new_text), 1);
+        }
+        else
+        {
+            // 옛 단어를 빼지 못했으므로 새 내용의 단어가 이미 들어 있을 수 있음
+            index_document(index, new_text, strlen(new_text), 2);
+        }
+    }
+    pthread_rwlock_unlock(&text_index_lock);
+}
+
+// delete_message_locked()에서 store_lock을 쓰기로 잡은 채 호출됩니다. old_text를 읽지 못했으면 NULL입니다.
+void text_index_on_delete(uint32_t index, const char *old_text)
+{
+    if (!text_index_ready)
+    {
+        return;
+    }
+    pthread_rwlock_wrlock(&text_index_lock);
+    if (building && index > indexed_upto && index <= build_target && !bitmap_test(modified_during_build, index))
+    {
+        // 구축 스레드가 아직 넣지 않은 메시지: 건너뛰게 표시만 함
+        modified_during_build[index >> 6] |= (uint64_t)1 << (index & 63);
+    }
+    else
+    {
+        if (old_text != NULL)
+        {
+            index_document(index, old_text, strlen(old_text), 0);
+        }
+        if (document_count > 0)
+        {
+            document_count--;
+        }
+    }
+    pthread_rwlock_unlock(&text_index_lock);
+}
+
+// "a b OR c*" 형식의 질의를 단어로 나눕니다. 공백으로 나뉜 단어는 AND, 대문자 OR은 그룹을 나누고,
+// '*'로 끝나는 단어는 접두어로 찾습니다. query는 제자리에서 바뀝니다.
+static uint32_t parse_query(char *query, QueryTerm *terms, uint32_t *group_count)
+{
+    uint32_t count = 0, group = 0, group_terms = 0;
+    char *saveptr = NULL;
+    for (char *word = strtok_r(query, " \t\r\n", &saveptr); word != NULL && count < TEXT_INDEX_MAX_QUERY_TERMS; word = strtok_r(NULL, " \t\r\n", &saveptr))
+    {
+        if (strcmp(word, "OR") == 0)
+        {
+            if (group_terms > 0)
+            {
+                group++;
+                group_terms = 0;
+            }
+            continue;
+        }
+        if (strcmp(word, "AND") == 0)
+        {
+            continue;
+        }
+
+        uint32_t length = strlen(word);
+        int prefix = length > 0 && word[length - 1] == '*';
+        Token tokens[TEXT_INDEX_MAX_QUERY_TERMS];
+        uint32_t token_count = tokenize(word, length - prefix, tokens, TEXT_INDEX_MAX_QUERY_TERMS - count);
+        for (uint32_t i = 0; i < token_count; i++)
+        {
+            terms[count].token = tokens[i];
+            terms[count].prefix = prefix && i == token_count - 1;
+            terms[count].group = group;
+            count++;
+            group_terms++;
+        }
+    }
+    *group_count = group_terms > 0 ? group + 1 : group;
+    return count;
+}
+
+static int compare_uint32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static inline int term_has_prefix(const TermEntry *entry, const Token *prefix)
+{
+    return entry->length >= prefix->length && memcmp(entry->term, prefix->text, prefix->length) == 0;
+}
+
+// 단어(또는 접두어에 맞는 모든 단어)가 든 메시지 인덱스를 정렬된 배열로 모읍니다. text_index_lock을 읽기로 잡은 상태여야 합니다.
+static int collect_term(const QueryTerm *term, DocList *out)
+{
+    out->indices = NULL;
+    out->count = 0;
+
+    TermEntry *single = NULL;
+    TermEntry **matches = &single;
+    uint32_t match_count = 0;
+    if (!term->prefix)
+    {
+        single = find_term(term->token.text, term->token.length, crc32c(0, term->token.text, term->token.length));
+        match_count = single != NULL;
+    }
+    else
+    {
+        matches = malloc(sizeof(TermEntry *) * TEXT_INDEX_MAX_PREFIX_TERMS);
+        if (matches == NULL)
+        {
+            return 0;
+        }
+        // 정렬된 목록에서 접두어 이상인 첫 단어를 찾고, 새 단어들은 하나씩 확인
+        uint32_t lo = 0, hi = sorted_count;
+        while (lo < hi)
+        {
+            uint32_t mid = lo + (hi - lo) / 2;
+            const TermEntry *entry = sorted_terms[mid];
+            int c = memcmp(entry->term, term->token.text, entry->length < term->token.length ? entry->length : term->token.length);
+            if (c < 0 || (c == 0 && entry->length < term->token.length))
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        for (uint32_t i = lo; i < sorted_count && match_count < TEXT_INDEX_MAX_PREFIX_TERMS && term_has_prefix(sorted_terms[i], &term->token); i++)
+        {
+            matches[match_count++] = sorted_terms[i];
+        }
+        for (uint32_t i = 0; i < recent_count && match_count < TEXT_INDEX_MAX_PREFIX_TERMS; i++)
+        {
+            if (term_has_prefix(recent_terms[i], &term->token))
+            {
+                matches[match_count++] = recent_terms[i];
+            }
+        }
+    }
+
+    size_t capacity = 1;
+    for (uint32_t i = 0; i < match_count; i++)
+    {
+        capacity += (size_t)matches[i]->postings.data_count + matches[i]->postings.added_count;
+    }
+    out->indices = malloc(sizeof(uint32_t) * capacity);
+    if (out->indices == NULL)
+    {
+        if (matches != &single)
+            free(matches);
+        return 0;
+    }
+    for (uint32_t i = 0; i < match_count; i++)
+    {
+        out->count += posting_decode(&matches[i]->postings, out->indices + out->count);
+    }
+
+    if (match_count > 1)
+    {
+        // 여러 목록의 합집합은 정렬 대신 비트맵으로 중복을 없애고 순서대로 다시 꺼냄
+        uint32_t max_index = 0;
+        for (uint32_t i = 0; i < out->count; i++)
+        {
+            if (out->indices[i] > max_index)
+                max_index = out->indices[i];
+        }
+        uint32_t words = max_index / 64 + 1;
+        uint64_t *bitmap = calloc(words, sizeof(uint64_t));
+        if (bitmap != NULL)
+        {
+            for (uint32_t i = 0; i < out->count; i++)
+            {
+                bitmap[out->indices[i] >> 6] |= (uint64_t)1 << (out->indices[i] & 63);
+            }
+            out->count = 0;
+            for (uint32_t w = 0; w < words; w++)
+            {
+                for (uint64_t bits = bitmap[w]; bits != 0; bits &= bits - 1)
+                {
+                    out->indices[out->count++] = w * 64 + __builtin_ctzll(bits);
+                }
+            }
+            free(bitmap);
+        }
+        else
+        {
+            qsort(out->indices, out->count, sizeof(uint32_t), compare_uint32);
+            uint32_t unique = 0;
+            for (uint32_t i = 0; i < out->count; i++)
+            {
+                if (unique == 0 || out->indices[unique - 1] != out->indices[i])
+                {
+                    out->indices[unique++] = out->indices[i];
+                }
+            }
+            out->count = unique;
+        }
+    }
+    if (matches != &single)
+        free(matches);
+    return 1;
+}
+
+// a에서 b에도 있는 인덱스만 남깁니다. a가 작다고 보고 b를 갤로핑(지수 탐색 후 이진 탐색)으로 건너뜁니다.
+static uint32_t intersect(uint32_t *a, uint32_t a_count, const uint32_t *b, uint32_t b_count)
+{
+    uint32_t kept = 0, lo = 0;
+    for (uint32_t i = 0; i < a_count && lo < b_count; i++)
+    {
+        uint32_t step = 1;
+        while (lo + step < b_count && b[lo + step] < a[i])
+        {
+            step *= 2;
+        }
+        uint32_t hi = lo + step < b_count ? lo + step + 1 : b_count;
+        lo += lower_bound(b + lo, hi - lo, a[i]);
+        if (lo < b_count && b[lo] == a[i])
+        {
+            a[kept++] = a[i];
+        }
+    }
+    return kept;
+}
+
+static inline int scored_less(const ScoredDoc *a, const ScoredDoc *b)
+{
+    return a->score < b->score || (a->score == b->score && a->index < b->index);
+}
+
+static int compare_scored_desc(const void *a, const void *b)
+{
+    const ScoredDoc *x = a;
+    const ScoredDoc *y = b;
+    return scored_less(x, y) ? 1 : scored_less(y, x) ? -1 : 0;
+}
+
+// 크기 k의 최소 힙으로 점수가 높은(같으면 최신) 메시지 k개를 고릅니다.
+static void heap_offer(ScoredDoc *heap, uint32_t *size, uint32_t k, ScoredDoc doc)
+{
+    uint32_t i;
+    if (*size < k)
+    {
+        i = (*size)++;
+        while (i > 0 && scored_less(&doc, &heap[(i - 1) / 2]))
+        {
+            heap[i] = heap[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+        heap[i] = doc;
+        return;
+    }
+    if (k == 0 || !scored_less(&heap[0], &doc))
+    {
+        return;
+    }
+    i = 0;
+    for (;;)
+    {
+        uint32_t child = i * 2 + 1;
+        if (child >= k)
+            break;
+        if (child + 1 < k && scored_less(&heap[child + 1], &heap[child]))
+            child++;
+        if (!scored_less(&heap[child], &doc))
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = doc;
+}
+
+// 질의를 실행해 상위 k개를 돌려줍니다. 질의가 비었거나 인덱스가 꺼져 있으면 0을 반환합니다.
+// 결과는 free_search_result()로 해제합니다.
+int text_index_search(const char *query, uint32_t k, SearchResult *result)
+{
+    memset(result, 0, sizeof(SearchResult));
+    if (!text_index_ready)
+    {
+        return 0;
+    }
+
+    char *query_copy = strdup(query);
+    QueryTerm terms[TEXT_INDEX_MAX_QUERY_TERMS];
+    uint32_t group_count = 0;
+    uint32_t term_total = query_copy != NULL ? parse_query(query_copy, terms, &group_count) : 0;
+    if (term_total == 0)
+    {
+        free(query_copy);
+        return 0;
+    }
+
+    DocList lists[TEXT_INDEX_MAX_QUERY_TERMS];
+    int ok = 1;
+    pthread_rwlock_rdlock(&text_index_lock);
+    for (uint32_t i = 0; i < term_total; i++)
+    {
+        if (!collect_term(&terms[i], &lists[i]))
+        {
+            ok = 0;
+        }
+    }
+    result->complete = !building;
+    pthread_rwlock_unlock(&text_index_lock);
+    free(query_copy);
+
+    // 그룹마다 가장 짧은 목록을 기준으로 나머지와 교집합을 구함
+    DocList groups[TEXT_INDEX_MAX_QUERY_TERMS];
+    for (uint32_t g = 0; g < group_count; g++)
+    {
+        int base = -1;
+        for (uint32_t i = 0; i < term_total; i++)
+        {
+            if (terms[i].group == g && (base < 0 || lists[i].count < lists[base].count))
+            {
+                base = i;
+            }
+        }
+        groups[g] = lists[base];
+        lists[base].indices = NULL;
+        for (uint32_t i = 0; i < term_total; i++)
+        {
+            if (terms[i].group == g && lists[i].indices != NULL && groups[g].indices != NULL)
+            {
+                groups[g].count = intersect(groups[g].indices, groups[g].count, lists[i].indices, lists[i].count);
+            }
+        }
+    }
+    for (uint32_t i = 0; i < term_total; i++)
+    {
+        free(lists[i].indices);
+    }
+
+    if (k > TEXT_INDEX_MAX_RESULTS)
+    {
+        k = TEXT_INDEX_MAX_RESULTS;
+    }
+    ScoredDoc *heap = malloc(sizeof(ScoredDoc) * (k > 0 ? k : 1));
+    uint32_t *cursors = calloc(group_count, sizeof(uint32_t));
+    result->indices = malloc(sizeof(uint32_t) * (k > 0 ? k : 1));
+    result->scores = malloc(sizeof(uint32_t) * (k > 0 ? k : 1));
+    for (uint32_t g = 0; g < group_count; g++)
+    {
+        if (groups[g].indices == NULL)
+        {
+            ok = 0;
+        }
+    }
+    if (!ok || heap == NULL || cursors == NULL || result->indices == NULL || result->scores == NULL)
+    {
+        syslog(LOG_ERR, "Memory allocation failed for search");
+        ok = 0;
+    }
+
+    uint32_t heap_size = 0;
+    if (ok && group_count == 1)
+    {
+        // 점수가 모두 같으므로 가장 최신(뒤쪽) k개가 곧 상위 k개
+        result->total = groups[0].count;
+        while (heap_size < k && heap_size < groups[0].count)
+        {
+            heap[heap_size].index = groups[0].indices[groups[0].count - 1 - heap_size];
+            heap[heap_size].score = 1;
+            heap_size++;
+        }
+    }
+    else if (ok)
+    {
+        // 정렬된 그룹 결과들을 병합하며 메시지마다 맞은 그룹 수를 점수로 셈
+        for (;;)
+        {
+            ScoredDoc doc = {0, UINT32_MAX};
+            for (uint32_t g = 0; g < group_count; g++)
+            {
+                if (cursors[g] < groups[g].count && groups[g].indices[cursors[g]] < doc.index)
+                    doc.index = groups[g].indices[cursors[g]];
+            }
+            if (doc.index == UINT32_MAX)
+            {
+                break;
+            }
+            for (uint32_t g = 0; g < group_count; g++)
+            {
+                if (cursors[g] < groups[g].count && groups[g].indices[cursors[g]] == doc.index)
+                {
+                    doc.score++;
+                    cursors[g]++;
+                }
+            }
+            result->total++;
+            heap_offer(heap, &heap_size, k, doc);
+        }
+        qsort(heap, heap_size, sizeof(ScoredDoc), compare_scored_desc);
+    }
+    if (ok)
+    {
+        for (uint32_t i = 0; i < heap_size; i++)
+        {
+            result->indices[i] = heap[i].index;
+            result->scores[i] = heap[i].score;
+        }
+        result->count = heap_size;
+    }
+
+    for (uint32_t g = 0; g < group_count; g++)
+    {
+        free(groups[g].indices);
+    }
+    free(cursors);
+    free(heap);
+    if (!ok)
+    {
+        free_search_result(result);
+        return 0;
+    }
+    return 1;
+}
+
+void free_search_result(SearchResult *result)
+{
+    free(result->indices);
+    free(result->scores);
+    result->indices = NULL;
+    result->scores = NULL;
+    result->count = 0;
+}
+
+TextIndexStats text_index_get_stats()
+{
+    TextIndexStats stats;
+    pthread_rwlock_rdlock(&text_index_lock);
+    stats.documents = document_count;
+    stats.terms = term_count;
+    stats.postings = posting_count;
+    stats.posting_bytes = posting_bytes;
+    stats.indexed_upto = indexed_upto;
+    stats.build_target = build_target;
+    stats.building = building;
+    stats.build_ms = build_ms;
+    pthread_rwlock_unlock(&text_index_lock);
+    return stats;
+}
+
+// 검색 결과를 본문과 함께 JSON 형식으로 반환하는 함수
+char *get_search_info(const char *query, uint32_t k)
+{
+    json_object *result = json_object_new_object();
+    json_object_object_add(result, "action", json_object_new_string("search_result"));
+    json_object_object_add(result, "query", json_object_new_string(query));
+
+    SearchResult search;
+    if (!text_index_search(query, k, &search))
+    {
+        json_object_object_add(result, "error", json_object_new_string(text_index_ready ? "Empty query" : "Search index disabled"));
+    }
+    else
+    {
+        MessageBatch *contents = get_messages_by_indices(search.indices, search.count);
+        json_object *results = json_object_new_array();
+        for (uint32_t i = 0; i < search.count; i++)
+        {
+            const char *content = contents != NULL ? contents->texts[i] : NULL;
+            json_object *item = json_object_new_object();
+            json_object_object_add(item, "index", json_object_new_int(search.indices[i]));
+            json_object_object_add(item, "score", json_object_new_int(search.scores[i]));
+            json_object_object_add(item, "content", json_object_new_string_len(content != NULL ? content : "", content != NULL ? contents->lengths[i] : 0));
+            json_object_array_add(results, item);
+        }
+        json_object_object_add(result, "results", results);
+        json_object_object_add(result, "total", json_object_new_int64(search.total));
+        json_object_object_add(result, "complete", json_object_new_boolean(search.complete));
+        free_message_batch(contents);
+        free_search_result(&search);
+    }
+
+    char *response = strdup(json_object_to_json_string(result));
+    json_object_put(result);
+    return response;
+}
+
+// 전문 검색 인덱스 크기와 구축 상태를 JSON 형식으로 반환하는 함수
+char *get_text_index_stats_info()
+{
+    TextIndexStats stats = text_index_get_stats();
+
+    json_object *data = json_object_new_object();
+    json_object_object_add(data, "enabled", json_object_new_boolean(text_index_ready));
+    json_object_object_add(data, "documents", json_object_new_int64(stats.documents));
+    json_object_object_add(data, "terms", json_object_new_int64(stats.terms));
+    json_object_object_add(data, "postings", json_object_new_int64(stats.postings));
+    json_object_object_add(data, "posting_bytes", json_object_new_int64(stats.posting_bytes));
+    json_object_object_add(data, "building", json_object_new_boolean(stats.building));
+    json_object_object_add(data, "indexed_upto", json_object_new_int64(stats.indexed_upto));
+    json_object_object_add(data, "build_target", json_object_new_int64(stats.build_target));
+    json_object_object_add(data, "build_ms", json_object_new_double(stats.build_ms));
+
+    json_object *result = json_object_new_object();
+    json_object_object_add(result, "action", json_object_new_string("search_stats"));
+    json_object_object_add(result, "data", data);
+
+    char *response = strdup(json_object_to_json_string(result));
+    json_object_put(result);
+    return response;
+}
@@ -0,0 +1,48 @@
+#ifndef TEXT_INDEX_H
+#define TEXT_INDEX_H
+
+#include <stdint.h>
+
+#define TEXT_INDEX_ENABLED 1               // 0이면 전문 검색 인덱스를 만들지 않음
+#define TEXT_INDEX_MAX_TERM 32             // 단어 하나의 최대 바이트 수 (넘으면 UTF-8 경계에서 자름)
+#define TEXT_INDEX_BUILD_BATCH 1024        // 시작할 때 인덱스를 만들며 한 번에 읽는 메시지 수
+#define TEXT_INDEX_UNSORTED_TERMS 4096     // 정렬된 단어 목록에 합치기 전까지 따로 모아 두는 새 단어 수
+#define TEXT_INDEX_PENDING_MIN 64          // 포스팅 목록을 다시 압축하기 전까지 허용하는 중간 삽입/삭제 수
+#define TEXT_INDEX_MAX_QUERY_TERMS 32      // 질의 하나에 쓸 수 있는 단어 수
+#define TEXT_INDEX_MAX_PREFIX_TERMS 4096   // 접두어 하나가 펼칠 수 있는 최대 단어 수
+#define TEXT_INDEX_DEFAULT_RESULTS 20      // 결과 수를 지정하지 않았을 때
+#define TEXT_INDEX_MAX_RESULTS 1000        // 요청할 수 있는 최대 결과 수
+
+// 검색 결과. indices는 점수(일치한 OR 그룹 수) 내림차순, 같으면 최신 메시지 순입니다.
+typedef struct {
+    uint32_t *indices;
+    uint32_t *scores;
+    uint32_t count;     // indices에 담긴 수 (최대 요청한 k)
+    uint32_t total;     // 질의에 맞는 전체 메시지 수
+    int complete;       // 시작 시 인덱스 구축이 끝났는지 (0이면 일부 메시지만 검색됨)
+} SearchResult;
+
+typedef struct {
+    uint64_t documents;     // 인덱스에 들어간 메시지 수
+    uint64_t terms;         // 서로 다른 단어 수
+    uint64_t postings;      // (단어, 메시지) 쌍 수
+    uint64_t posting_bytes; // 압축된 포스팅 목록 크기
+    uint32_t indexed_upto;  // 시작 시 구축이 끝난 마지막 인덱스
+    uint32_t build_target;  // 시작 시 구축해야 하는 마지막 인덱스
+    int building;           // 백그라운드 구축이 진행 중인지
+    double build_ms;        // 구축에 걸린 시간
+} TextIndexStats;
+
+// Function declarations
+void text_index_start();
+void text_index_stop();
+void text_index_on_append(uint32_t index, const char *text, uint32_t length);
+void text_index_on_modify(uint32_t index, const char *old_text, const char *new_text);
+void text_index_on_delete(uint32_t index, const char *old_text);
+int text_index_search(const char *query, uint32_t k, SearchResult *result);
+void free_search_result(SearchResult *result);
+TextIndexStats text_index_get_stats();
+char *get_search_info(const char *query, uint32_t k);
+char *get_text_index_stats_info();
+
+#endif // TEXT_INDEX_H
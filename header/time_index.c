@@ -0,0 +1,530 @@
+#include "time_index.h"
+#include "message_handler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <pthread.h>
+#include <time.h>
+#include <json-c/json.h>
+
+// 정렬 배열과 skip 인덱스를 보호하는 락. store_lock을 잡은 채로 이 락을 잡을 수 있지만 반대는 안 됩니다.
+static pthread_rwlock_t time_index_lock = PTHREAD_RWLOCK_INITIALIZER;
+static int time_index_ready = 0;
+
+// (타임스탬프, 인덱스) 순으로 정렬된 엔트리. 쓰기는 거의 항상 현재 시각이므로 대부분 끝에 붙습니다.
+static TimeEntry *entries = NULL;
+static uint32_t entry_count = 0;
+static uint32_t entry_capacity = 0;
+
+// entries[j * TIME_INDEX_SKIP_INTERVAL]의 타임스탬프. 범위 시작을 찾을 때 먼저 이 작은 배열을 탐색합니다.
+static int64_t *skip_index = NULL;
+static uint32_t skip_count = 0;
+static uint32_t skip_capacity = 0;
+
+// 메시지별 현재 타임스탬프 (0이면 아직 모름). 이 값과 다른 엔트리는 수정으로 낡은 것입니다.
+static int64_t *current_timestamps = NULL;
+static uint32_t stale_count = 0;
+static uint32_t out_of_order_count = 0;
+
+// 시작할 때의 백그라운드 구축 상태
+static pthread_t build_thread;
+static int build_thread_started = 0;
+static volatile int build_stop = 0;
+static int building = 0;
+static uint32_t build_target = 0;
+static double build_ms = 0;
+
+static int grow_array(void **array, uint32_t *capacity, uint32_t needed, size_t element_size)
+{
+    if (needed <= *capacity)
+    {
+        return 1;
+    }
+    uint32_t new_capacity = *capacity > 0 ? *capacity : 1024;
+    while (new_capacity < needed)
+    {
+        new_capacity *= 2;
+    }
+    void *grown = realloc(*array, (size_t)new_capacity * element_size);
+    if (grown == NULL)
+    {
+        syslog(LOG_ERR, "Memory allocation failed for time index");
+        return 0;
+    }
+    *array = grown;
+    *capacity = new_capacity;
+    return 1;
+}
+
+static inline int entry_less(const TimeEntry *a, const TimeEntry *b)
+{
+    return a->timestamp < b->timestamp || (a->timestamp == b->timestamp && a->index < b->index);
+}
+
+static int compare_time_entry(const void *a, const void *b)
+{
+    const TimeEntry *x = a;
+    const TimeEntry *y = b;
+    return entry_less(x, y) ? -1 : entry_less(y, x) ? 1 : 0;
+}
+
+static inline int entry_valid(const TimeEntry *entry)
+{
+    return current_timestamps[entry->index] == entry->timestamp;
+}
+
+// from_entry가 속한 블록부터 skip 인덱스를 다시 채웁니다.
+static void rebuild_skip_index(uint32_t from_entry)
+{
+    uint32_t needed = (entry_count + TIME_INDEX_SKIP_INTERVAL - 1) / TIME_INDEX_SKIP_INTERVAL;
+    if (!grow_array((void **)&skip_index, &skip_capacity, needed, sizeof(int64_t)))
+    {
+        skip_count = 0; // lower_bound_time()이 전체 이진 탐색으로 대신함
+        return;
+    }
+    for (uint32_t j = from_entry / TIME_INDEX_SKIP_INTERVAL; j < needed; j++)
+    {
+        skip_index[j] = entries[(size_t)j * TIME_INDEX_SKIP_INTERVAL].timestamp;
+    }
+    skip_count = needed;
+}
+
+// 타임스탬프가 t 이상인 첫 엔트리 위치. skip 인덱스로 블록을 고른 뒤 그 블록 안에서만 이진 탐색합니다.
+static uint32_t lower_bound_time(int64_t t)
+{
+    if (skip_count != (entry_count + TIME_INDEX_SKIP_INTERVAL - 1) / TIME_INDEX_SKIP_INTERVAL)
+    {
+        // 메모리 부족으로 skip 인덱스를 유지하지 못한 경우
+        uint32_t start = 0, end = entry_count;
+        while (start < end)
+        {
+            uint32_t mid = start + (end - start) / 2;
+            if (entries[mid].timestamp < t)
+                start = mid + 1;
+            else
+                end = mid;
+        }
+        return start;
+    }
+
+    uint32_t lo = 0, hi = skip_count;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (skip_index[mid] < t)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    // skip_index[lo] >= t 이므로 답은 블록 lo - 1 안이거나 블록 lo의 첫 엔트리
+    uint32_t start = lo > 0 ? (lo - 1) * TIME_INDEX_SKIP_INTERVAL : 0;
+    uint32_t end = (uint64_t)lo * TIME_INDEX_SKIP_INTERVAL < entry_count ? lo * TIME_INDEX_SKIP_INTERVAL : entry_count;
+    while (start < end)
+    {
+        uint32_t mid = start + (end - start) / 2;
+        if (entries[mid].timestamp < t)
+            start = mid + 1;
+        else
+            end = mid;
+    }
+    return start;
+}
+
+// 엔트리를 정렬 위치에 넣습니다. 같은 엔트리가 (낡은 채로) 이미 있으면 넣지 않고 0을 반환합니다.
+static int insert_entry(int64_t timestamp, uint32_t index)
+{
+    TimeEntry entry = {timestamp, index};
+    if (entry_count == 0 || entry_less(&entries[entry_count - 1], &entry))
+    {
+        if (!grow_array((void **)&entries, &entry_capacity, entry_count + 1, sizeof(TimeEntry)))
+        {
+            return 1;
+        }
+        entries[entry_count++] = entry;
+        if ((entry_count - 1) % TIME_INDEX_SKIP_INTERVAL == 0 && skip_count == (entry_count - 1) / TIME_INDEX_SKIP_INTERVAL &&
+            grow_array((void **)&skip_index, &skip_capacity, skip_count + 1, sizeof(int64_t)))
+        {
+            skip_index[skip_count++] = timestamp;
+        }
+        return 1;
+    }
+
+    // 시계가 거꾸로 간 경우: 중간에 끼워 넣고 그 뒤의 skip 인덱스를 고침
+    uint32_t lo = 0, hi = entry_count;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (entry_less(&entries[mid], &entry))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (entries[lo].timestamp == timestamp && entries[lo].index == index)
+    {
+        return 0;
+    }
+    if (!grow_array((void **)&entries, &entry_capacity, entry_count + 1, sizeof(TimeEntry)))
+    {
+        return 1;
+    }
+    memmove(&entries[lo + 1], &entries[lo], sizeof(TimeEntry) * (entry_count - lo));
+    entries[lo] = entry;
+    entry_count++;
+    out_of_order_count++;
+    rebuild_skip_index(lo);
+    return 1;
+}
+
+static void drop_stale_entries()
+{
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < entry_count; i++)
+    {
+        if (entry_valid(&entries[i]))
+        {
+            entries[kept++] = entries[i];
+        }
+    }
+    entry_count = kept;
+    stale_count = 0;
+    rebuild_skip_index(0);
+}
+
+static double elapsed_ms_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+// 시작할 때 있던 레코드의 헤더만 읽어 타임스탬프를 모으고, 정렬한 뒤 그동안 쓰인 엔트리와 한 번에 병합합니다.
+static void *build_time_index(void *arg)
+{
+    (void)arg;
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    TimeEntry *built = malloc(sizeof(TimeEntry) * ((size_t)build_target + 1));
+    uint32_t built_count = 0;
+    uint32_t indices[TIME_INDEX_BUILD_BATCH];
+    int64_t timestamps[TIME_INDEX_BUILD_BATCH];
+
+    for (uint32_t first = 1; built != NULL && first <= build_target && !build_stop; first += TIME_INDEX_BUILD_BATCH)
+    {
+        uint32_t count = build_target - first + 1;
+        if (count > TIME_INDEX_BUILD_BATCH)
+        {
+            count = TIME_INDEX_BUILD_BATCH;
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+            indices[i] = first + i;
+        }
+        read_record_timestamps(indices, count, timestamps);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (timestamps[i] > 0)
+            {
+                built[built_count].timestamp = timestamps[i];
+                built[built_count].index = indices[i];
+                built_count++;
+            }
+        }
+    }
+    if (built != NULL && !build_stop)
+    {
+        qsort(built, built_count, sizeof(TimeEntry), compare_time_entry);
+    }
+
+    pthread_rwlock_wrlock(&time_index_lock);
+    TimeEntry *merged = built != NULL && !build_stop ? malloc(sizeof(TimeEntry) * ((size_t)built_count + entry_count + 1)) : NULL;
+    if (merged != NULL)
+    {
+        // 구축 중에 수정된 메시지는 이미 새 타임스탬프로 들어가 있으므로 읽어 둔 값을 버림
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < built_count; i++)
+        {
+            if (current_timestamps[built[i].index] == 0)
+            {
+                current_timestamps[built[i].index] = built[i].timestamp;
+                built[kept++] = built[i];
+            }
+        }
+
+        uint32_t i = 0, j = 0, out = 0;
+        while (i < kept || j < entry_count)
+        {
+            if (j == entry_count || (i < kept && entry_less(&built[i], &entries[j])))
+                merged[out++] = built[i++];
+            else
+                merged[out++] = entries[j++];
+        }
+        entry_capacity = built_count + entry_count + 1;
+        free(entries);
+        entries = merged;
+        entry_count = out;
+        rebuild_skip_index(0);
+    }
+    else if (!build_stop)
+    {
+        syslog(LOG_ERR, "Memory allocation failed for time index build");
+    }
+    building = 0;
+    build_ms = elapsed_ms_since(&started);
+    syslog(LOG_INFO, "Time index built: %u entries in %.1f ms", entry_count, build_ms);
+    pthread_rwlock_unlock(&time_index_lock);
+
+    free(built);
+    return NULL;
+}
+
+// 타임스탬프 인덱스를 켜고 기존 레코드로 백그라운드 구축을 시작합니다.
+// 요청을 받기 시작하기 전에 (recover_store() 뒤에) 호출해야 합니다.
+void time_index_start()
+{
+    if (!TIME_INDEX_ENABLED)
+    {
+        return;
+    }
+
+    pthread_rwlock_wrlock(&time_index_lock);
+    current_timestamps = calloc((size_t)MAX_MESSAGES + 1, sizeof(int64_t));
+    if (current_timestamps == NULL)
+    {
+        syslog(LOG_ERR, "Memory allocation failed for time index");
+        pthread_rwlock_unlock(&time_index_lock);
+        return;
+    }
+    build_target = get_max_index();
+    build_stop = 0;
+    building = build_target > 0;
+    time_index_ready = 1;
+    pthread_rwlock_unlock(&time_index_lock);
+
+    if (!building)
+    {
+        return;
+    }
+    if (pthread_create(&build_thread, NULL, build_time_index, NULL) == 0)
+    {
+        build_thread_started = 1;
+    }
+    else
+    {
+        syslog(LOG_ERR, "Failed to start time index thread, building in foreground");
+        build_time_index(NULL);
+    }
+}
+
+// 구축 스레드를 멈추고 인덱스를 해제합니다.
+void time_index_stop()
+{
+    build_stop = 1;
+    if (build_thread_started)
+    {
+        pthread_join(build_thread, NULL);
+        build_thread_started = 0;
+    }
+
+    pthread_rwlock_wrlock(&time_index_lock);
+    time_index_ready = 0;
+    free(entries);
+    free(skip_index);
+    free(current_timestamps);
+    entries = NULL;
+    skip_index = NULL;
+    current_timestamps = NULL;
+    entry_count = entry_capacity = skip_count = skip_capacity = stale_count = 0;
+    pthread_rwlock_unlock(&time_index_lock);
+}
+
+// append_message_to_file() / modify_message_by_index()에서 store_lock을 쓰기로 잡은 채,
+// 레코드 헤더에 기록한 타임스탬프로 호출됩니다.
+void time_index_on_write(uint32_t index, int64_t timestamp)
+{
+    if (!time_index_ready || index == 0 || index > MAX_MESSAGES || timestamp <= 0)
+    {
+        return;
+    }
+
+    pthread_rwlock_wrlock(&time_index_lock);
+    int64_t previous = current_timestamps[index];
+    if (previous != timestamp)
+    {
+        current_timestamps[index] = timestamp;
+        if (previous != 0)
+        {
+            stale_count++;
+        }
+        if (!insert_entry(timestamp, index))
+        {
+            stale_count--; // 낡은 엔트리가 다시 유효해짐
+        }
+        if (stale_count > TIME_INDEX_COMPACT_MIN && (uint64_t)stale_count * 4 > entry_count)
+        {
+            drop_stale_entries();
+        }
+    }
+    pthread_rwlock_unlock(&time_index_lock);
+}
+
+// delete_message_locked()에서 store_lock을 쓰기로 잡은 채 호출됩니다.
+// 타임스탬프를 -1로 두어 남은 엔트리를 낡은 것으로 만들고, 구축 스레드가 읽어 둔 값도 버리게 합니다.
+void time_index_on_delete(uint32_t index)
+{
+    if (!time_index_ready || index == 0 || index > MAX_MESSAGES)
+    {
+        return;
+    }
+
+    pthread_rwlock_wrlock(&time_index_lock);
+    int64_t previous = current_timestamps[index];
+    current_timestamps[index] = -1;
+    if (previous > 0)
+    {
+        stale_count++;
+        if (stale_count > TIME_INDEX_COMPACT_MIN && (uint64_t)stale_count * 4 > entry_count)
+        {
+            drop_stale_entries();
+        }
+    }
+    pthread_rwlock_unlock(&time_index_lock);
+}
+
+// [from, to] 구간(초 단위, 양끝 포함)에 마지막으로 쓰인 메시지를 최대 limit개 돌려줍니다.
+// reverse이면 최신 메시지부터. 인덱스가 꺼져 있으면 0을 반환하며, 결과는 free_time_range_result()로 해제합니다.
+int time_index_range(int64_t from, int64_t to, uint32_t limit, int reverse, TimeRangeResult *result)
+{
+    memset(result, 0, sizeof(TimeRangeResult));
+    if (!time_index_ready)
+    {
+        return 0;
+    }
+    if (limit > TIME_INDEX_MAX_LIMIT)
+    {
+        limit = TIME_INDEX_MAX_LIMIT;
+    }
+    result->entries = malloc(sizeof(TimeEntry) * (limit > 0 ? limit : 1));
+    if (result->entries == NULL)
+    {
+        syslog(LOG_ERR, "Memory allocation failed for time range");
+        return 0;
+    }
+
+    pthread_rwlock_rdlock(&time_index_lock);
+    if (from <= to)
+    {
+        uint32_t lo = lower_bound_time(from);
+        uint32_t hi = to == INT64_MAX ? entry_count : lower_bound_time(to + 1);
+        for (uint32_t k = 0; k < hi - lo; k++)
+        {
+            const TimeEntry *entry = &entries[reverse ? hi - 1 - k : lo + k];
+            if (!entry_valid(entry))
+            {
+                continue;
+            }
+            if (result->count == limit)
+            {
+                result->more = 1;
+                break;
+            }
+            result->entries[result->count++] = *entry;
+        }
+    }
+    result->complete = !building;
+    pthread_rwlock_unlock(&time_index_lock);
+    return 1;
+}
+
+void free_time_range_result(TimeRangeResult *result)
+{
+    free(result->entries);
+    result->entries = NULL;
+    result->count = 0;
+}
+
+TimeIndexStats time_index_get_stats()
+{
+    TimeIndexStats stats;
+    pthread_rwlock_rdlock(&time_index_lock);
+    stats.entries = entry_count;
+    stats.stale = stale_count;
+    stats.skip_entries = skip_count;
+    stats.out_of_order = out_of_order_count;
+    stats.building = building;
+    stats.build_ms = build_ms;
+    pthread_rwlock_unlock(&time_index_lock);
+    return stats;
+}
+
+// 시간 범위 질의 결과를 본문과 함께 JSON 형식으로 반환하는 함수
+char *get_time_range_info(int64_t from, int64_t to, uint32_t limit, int reverse)
+{
+    json_object *result = json_object_new_object();
+    json_object_object_add(result, "action", json_object_new_string("time_range_result"));
+    json_object_object_add(result, "from", json_object_new_int64(from));
+    json_object_object_add(result, "to", json_object_new_int64(to));
+    json_object_object_add(result, "order", json_object_new_string(reverse ? "desc" : "asc"));
+
+    TimeRangeResult range;
+    if (!time_index_range(from, to, limit, reverse, &range))
+    {
+        json_object_object_add(result, "error", json_object_new_string("Time index disabled"));
+    }
+    else
+    {
+        uint32_t *indices = malloc(sizeof(uint32_t) * (range.count > 0 ? range.count : 1));
+        for (uint32_t i = 0; indices != NULL && i < range.count; i++)
+        {
+            indices[i] = range.entries[i].index;
+        }
+        MessageBatch *contents = indices != NULL ? get_messages_by_indices(indices, range.count) : NULL;
+
+        json_object *results = json_object_new_array();
+        for (uint32_t i = 0; i < range.count; i++)
+        {
+            const char *content = contents != NULL ? contents->texts[i] : NULL;
+            json_object *item = json_object_new_object();
+            json_object_object_add(item, "index", json_object_new_int(range.entries[i].index));
+            json_object_object_add(item, "timestamp", json_object_new_int64(range.entries[i].timestamp));
+            json_object_object_add(item, "content", json_object_new_string_len(content != NULL ? content : "", content != NULL ? contents->lengths[i] : 0));
+            json_object_array_add(results, item);
+        }
+        json_object_object_add(result, "results", results);
+        json_object_object_add(result, "count", json_object_new_int(range.count));
+        json_object_object_add(result, "more", json_object_new_boolean(range.more));
+        json_object_object_add(result, "complete", json_object_new_boolean(range.complete));
+        free_message_batch(contents);
+        free(indices);
+        free_time_range_result(&range);
+    }
+
+    char *response = strdup(json_object_to_json_string(result));
+    json_object_put(result);
+    return response;
+}
+
+// 타임스탬프 인덱스 크기와 구축 상태를 JSON 형식으로 반환하는 함수
+char *get_time_index_stats_info()
+{
+    TimeIndexStats stats = time_index_get_stats();
+
+    json_object *data = json_object_new_object();
+    json_object_object_add(data, "enabled", json_object_new_boolean(time_index_ready));
+    json_object_object_add(data, "entries", json_object_new_int64(stats.entries));
+    json_object_object_add(data, "stale", json_object_new_int64(stats.stale));
+    json_object_object_add(data, "skip_entries", json_object_new_int64(stats.skip_entries));
+    json_object_object_add(data, "out_of_order", json_object_new_int64(stats.out_of_order));
+    json_object_object_add(data, "building", json_object_new_boolean(stats.building));
+    json_object_object_add(data, "build_ms", json_object_new_double(stats.build_ms));
+
+    json_object *result = json_object_new_object();
+    json_object_object_add(result, "action", json_object_new_string("time_index_stats"));
+    json_object_object_add(result, "data", data);
+
+    char *response = strdup(json_object_to_json_string(result));
+    json_object_put(result);
+    return response;
+}
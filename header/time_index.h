@@ -0,0 +1,46 @@
+#ifndef TIME_INDEX_H
+#define TIME_INDEX_H
+
+#include <stdint.h>
+
+#define TIME_INDEX_ENABLED 1            // 0이면 타임스탬프 인덱스를 만들지 않음
+#define TIME_INDEX_SKIP_INTERVAL 256    // 희소 skip 인덱스가 타임스탬프를 기록하는 엔트리 간격
+#define TIME_INDEX_BUILD_BATCH 4096     // 시작할 때 레코드 헤더를 한 번에 읽는 수
+#define TIME_INDEX_COMPACT_MIN 1024     // 수정으로 낡은 엔트리가 이보다 많고 전체의 1/4을 넘으면 정리
+#define TIME_INDEX_DEFAULT_LIMIT 100    // 결과 수를 지정하지 않았을 때
+#define TIME_INDEX_MAX_LIMIT 1000       // 요청할 수 있는 최대 결과 수
+
+// (타임스탬프, 인덱스) 순으로 정렬되는 엔트리
+typedef struct {
+    int64_t timestamp;
+    uint32_t index;
+} TimeEntry;
+
+typedef struct {
+    TimeEntry *entries; // reverse이면 최신 순, 아니면 오래된 순
+    uint32_t count;
+    int more;           // limit 때문에 범위 안의 메시지를 다 담지 못했는지
+    int complete;       // 시작 시 인덱스 구축이 끝났는지 (0이면 그 전 메시지가 빠질 수 있음)
+} TimeRangeResult;
+
+typedef struct {
+    uint32_t entries;       // 정렬 배열의 엔트리 수 (낡은 것 포함)
+    uint32_t stale;         // 수정으로 낡은 엔트리 수
+    uint32_t skip_entries;  // 희소 skip 인덱스 크기
+    uint32_t out_of_order;  // 시계가 거꾸로 가서 중간에 끼워 넣은 수
+    int building;
+    double build_ms;
+} TimeIndexStats;
+
+// Function declarations
+void time_index_start();
+void time_index_stop();
+void time_index_on_write(uint32_t index, int64_t timestamp);
+void time_index_on_delete(uint32_t index);
+int time_index_range(int64_t from, int64_t to, uint32_t limit, int reverse, TimeRangeResult *result);
+void free_time_range_result(TimeRangeResult *result);
+TimeIndexStats time_index_get_stats();
+char *get_time_range_info(int64_t from, int64_t to, uint32_t limit, int reverse);
+char *get_time_index_stats_info();
+
+#endif // TIME_INDEX_H
@@ -4,6 +4,7 @@
 #include <string.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
+#include <netinet/tcp.h>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 #include <openssl/sha.h>
@@ -16,7 +17,22 @@
 #include <sys/stat.h>
 #include <linux/limits.h>
 #include <time.h>
+#include <poll.h>
 #include "header/message_handler.h"
+#include "header/compactor.h"
+#include "header/async_io.h"
+#include "header/record_cache.h"
+#include "header/recovery.h"
+#include "header/graph.h"
+#include "header/text_index.h"
+#include "header/time_index.h"
+#include "header/dedup.h"
+#include "header/compression.h"
+#include "header/subscription.h"
+#include "header/snapshot.h"
+#include "header/replication.h"
+#include "header/expiry.h"
+#include "header/request_arena.h"
 
 #define MAX_CLIENTS 10
 #define BUFFER_SIZE 4096
@@ -29,9 +45,10 @@ typedef struct
     int port;
     char *cert_file;
     char *key_file;
+    char *replica_of; // NULL이면 주 서버, 아니면 이 Unix 소켓의 주 서버를 따라가는 읽기 전용 복제본
 } ServerConfig;
 
-ServerConfig config = {8443, "cert.pem", "key.pem"};
+ServerConfig config = {8443, "cert.pem", "key.pem", NULL};
 volatile sig_atomic_t keep_running = 1;
 
 void handle_signal()
@@ -277,9 +294,12 @@ int websocket_read(SSL *ssl, char *buf)
     buf[bytes] = '\0';
     return bytes;
 }
-int websocket_write(SSL *ssl, const char *buf, int len)
+// WebSocket 프레임 하나를 씁니다. opcode는 0x1(text) 또는 0x0(continuation)이고, fin이 0이면 뒤에 조각이 더 옵니다.
+int websocket_write_frame(SSL *ssl, unsigned char opcode, int fin, const char *buf, size_t len)
 {
-    unsigned char header[2] = {0x81, 0x00};
+    unsigned char header[10];
+    size_t header_len = 2;
+    header[0] = (fin ? 0x80 : 0x00) | opcode;
     if (len <= 125)
     {
         header[1] = len;
@@ -287,28 +307,50 @@ int websocket_write(SSL *ssl, const char *buf, int len)
     else if (len <= 65535)
     {
         header[1] = 126;
+        header[2] = (len >> 8) & 0xFF;
+        header[3] = len & 0xFF;
+        header_len = 4;
     }
     else
     {
         header[1] = 127;
+        for (int i = 0; i < 8; i++)
+        {
+            header[2 + i] = ((uint64_t)len >> (56 - 8 * i)) & 0xFF;
+        }
+        header_len = 10;
     }
 
-    SSL_write(ssl, header, 2);
-
-    if (len > 125 && len <= 65535)
+    if (SSL_write(ssl, header, header_len) <= 0)
     {
-        unsigned char extended_len[2];
-        extended_len[0] = (len >> 8) & 0xFF;
-        extended_len[1] = len & 0xFF;
-        SSL_write(ssl, extended_len, 2);
+        return -1;
     }
-    else if (len > 65535)
+    if (len == 0)
     {
-        // 64-bit integer handling omitted for simplicity
+        return 0;
     }
-
     return SSL_write(ssl, buf, len);
 }
+int websocket_write(SSL *ssl, const char *buf, int len)
+{
+    // 일부 호출부는 길이 대신 -1을 넘기므로 그때는 문자열 길이를 씁니다.
+    return websocket_write_frame(ssl, 0x1, 1, buf, len < 0 ? strlen(buf) : (size_t)len);
+}
+// 스트리밍 응답을 조각난 WebSocket 메시지로 보내는 StreamChunkWriter
+// 첫 조각은 text 프레임, 이후는 continuation 프레임이며 마지막 조각에만 FIN을 켭니다.
+typedef struct
+{
+    SSL *ssl;
+    int started;
+} FragmentedWriter;
+
+int write_stream_chunk(void *context, const char *data, size_t length, int final)
+{
+    FragmentedWriter *writer = context;
+    unsigned char opcode = writer->started ? 0x0 : 0x1;
+    writer->started = 1;
+    return websocket_write_frame(writer->ssl, opcode, final, data, length) >= 0;
+}
 json_object *list_directory_contents(const char *base_path, const char *rel_path)
 {
     char full_path[PATH_MAX];
@@ -558,34 +600,44 @@ void handle_run(SSL *ssl)
     free(output);
     free(response);
 }
-// 새로운 헬퍼 함수
-void add_links_to_response(uint32_t index, const char* direction, json_object *links_obj)
+// 링크된 메시지들을 "<name>": [ { "index": ..., "content": ... }, ... ] 형태로 응답에 붙입니다.
+// 링크 목록과 본문은 모두 요청 arena에 읽고, 오프셋 순으로 합쳐 한 번의 배치로 읽어 옵니다.
+void append_links_json(ArenaBuffer *out, uint32_t index, const char *name, int backward)
 {
-    uint32_t count;
-    uint32_t *links = strcmp(direction, "forward") == 0 ? get_forward_links(index, &count) : get_backward_links(index, &count);
-    if (strcmp(direction, "forward2") == 0){
-            links = get_forward_links(index, &count);
-    }
+    uint32_t links[MAX_LINKS];
+    uint32_t count = backward ? read_backward_links(index, links) : read_forward_links(index, links);
+    MessageBatch *contents = count > 0 ? get_messages_by_indices_with(links, count, arena_alloc) : NULL;
 
-    json_object *array = json_object_new_array();
+    arena_buffer_printf(out, "\"%s\": [ ", name);
     for (uint32_t i = 0; i < count; i++)
     {
-        json_object *link_obj = json_object_new_object();
-        json_object_object_add(link_obj, "index", json_object_new_int(links[i]));
-        char *link_content = get_message_by_index_and_format(links[i], "text");
-        json_object_object_add(link_obj, "content", json_object_new_string(link_content));
-        json_object_array_add(array, link_obj);
-        free(link_content);
+        const char *link_content = contents != NULL ? contents->texts[i] : NULL;
+        arena_buffer_printf(out, "%s{ \"index\": %u, \"content\": ", i > 0 ? ", " : "", links[i]);
+        arena_buffer_append_json_string(out, link_content != NULL ? link_content : "", link_content != NULL ? contents->lengths[i] : 0);
+        arena_buffer_append_string(out, " }");
     }
-    json_object_object_add(links_obj, direction, array);
-    free(links);
+    arena_buffer_append_string(out, count > 0 ? " ]" : "]");
 }
-void handle_message(SSL *ssl, const char *message)
+// 순회 결과 프레임을 클라이언트로 보내는 GraphFrameWriter
+int write_graph_frame(void *context, const char *frame)
 {
-    char *response;
+    return websocket_write((SSL *)context, frame, strlen(frame)) > 0;
+}
+// 구독 이벤트 프레임을 클라이언트로 보내는 SubscriptionFrameWriter
+int write_subscription_frame(void *context, const char *frame)
+{
+    return websocket_write((SSL *)context, frame, strlen(frame)) > 0;
+}
+// subscriber는 연결마다 하나이며 첫 subscribe 명령에서 만들어집니다 (handle_client가 정리)
+void handle_message(SSL *ssl, const char *message, Subscriber **subscriber)
+{
+    // 응답과 작업용 메모리는 요청 arena에서 잡고 응답을 보낸 뒤 arena_reset()으로 한꺼번에 버립니다.
+    // 모듈의 *_info 함수처럼 malloc으로 만든 응답만 heap_response에 두고 해제합니다.
+    const char *response;
+    char *heap_response = NULL;
     // message는 이미 content 문자열입니다.
     // 새로운 메시지와 현재 인덱스를 분리합니다.
-    char *message_copy = strdup(message);
+    char *message_copy = arena_strdup(message);
     char *new_message = strtok(message_copy, "|");
     char *current_index_str = strtok(NULL, "|");
 
@@ -595,19 +647,183 @@ void handle_message(SSL *ssl, const char *message)
         current_index = atoi(current_index_str);
     }
 
-    if (strcmp(message, "get_index_table_info") == 0)
+    if (replication_is_replica() && (strncmp(message, "modify:", 7) == 0 || strncmp(message, "modify_if:", 10) == 0 ||
+                                     strncmp(message, "link:", 5) == 0 || strncmp(message, "unlink:", 7) == 0 ||
+                                     strncmp(message, "ttl:", 4) == 0 || strncmp(message, "delete:", 7) == 0 ||
+                                     strncmp(message, "delete_subtree:", 15) == 0))
+    {
+        response = "{\"action\":\"message_response\",\"content\":\"Error: This server is a read-only replica\"}";
+    }
+    else if (strncmp(message, "get_index_table_info", 20) == 0 && (message[20] == '\0' || message[20] == ':'))
+    {
+        // "get_index_table_info"는 전체 테이블을, "get_index_table_info:<start>:<limit>[:<fields>]"는 한 페이지를
+        // 조각난 프레임으로 보냅니다. fields는 index,offset,length,forward_links,backward_links,links 중 쉼표로 구분한 목록입니다.
+        uint32_t start = 0, limit = UINT32_MAX;
+        int fields = INDEX_FIELD_ALL;
+        int paginated = message[20] == ':';
+        if (paginated)
+        {
+            char *start_str = strtok((char *)message + 21, ":");
+            char *limit_str = strtok(NULL, ":");
+            char *fields_str = strtok(NULL, "");
+            start = start_str != NULL ? (uint32_t)atoi(start_str) : 0;
+            limit = limit_str != NULL ? (uint32_t)atoi(limit_str) : UINT32_MAX;
+            fields = parse_index_fields(fields_str);
+        }
+        FragmentedWriter writer = {ssl, 0};
+        stream_index_table_info(start, limit, fields, paginated, write_stream_chunk, &writer);
+        response = NULL;
+    }
+    else if (strncmp(message, "get_free_space_table_info", 25) == 0 && (message[25] == '\0' || message[25] == ':'))
+    {
+        // "get_free_space_table_info[:<start>:<limit>]"
+        uint32_t start = 0, limit = UINT32_MAX;
+        int paginated = message[25] == ':';
+        if (paginated)
+        {
+            char *start_str = strtok((char *)message + 26, ":");
+            char *limit_str = strtok(NULL, "");
+            start = start_str != NULL ? (uint32_t)atoi(start_str) : 0;
+            limit = limit_str != NULL ? (uint32_t)atoi(limit_str) : UINT32_MAX;
+        }
+        FragmentedWriter writer = {ssl, 0};
+        stream_free_space_table_info(start, limit, paginated, write_stream_chunk, &writer);
+        response = NULL;
+    }
+    else if (strcmp(message, "get_storage_stats") == 0)
+    {
+        response = heap_response = get_storage_stats_info();
+    }
+    else if (strcmp(message, "get_cache_stats") == 0)
+    {
+        response = heap_response = get_record_cache_stats_info();
+    }
+    else if (strcmp(message, "get_search_stats") == 0)
+    {
+        response = heap_response = get_text_index_stats_info();
+    }
+    else if (strcmp(message, "get_time_index_stats") == 0)
+    {
+        response = heap_response = get_time_index_stats_info();
+    }
+    else if (strcmp(message, "get_dedup_stats") == 0)
+    {
+        response = heap_response = get_dedup_stats_info();
+    }
+    else if (strcmp(message, "get_compression_stats") == 0)
+    {
+        response = heap_response = get_compression_stats_info();
+    }
+    else if (strcmp(message, "get_subscription_stats") == 0)
+    {
+        response = heap_response = get_subscription_stats_info();
+    }
+    else if (strncmp(message, "subscribe:", 10) == 0)
+    {
+        // "subscribe:all", "subscribe:links:<index>", "subscribe:subtree:<index>"
+        // 이후 변경은 subscription_events 프레임으로 밀어 보내므로 get_max_index/get: 폴링이 필요 없습니다.
+        char *kind_str = strtok((char *)message + 10, ":");
+        char *index_str = strtok(NULL, "");
+        SubscriptionKind kind = 0;
+        uint32_t index = index_str != NULL ? (uint32_t)atoi(index_str) : 0;
+        if (kind_str != NULL && strcmp(kind_str, "all") == 0)
+        {
+            kind = SUBSCRIBE_ALL;
+            index = 0;
+        }
+        else if (kind_str != NULL && strcmp(kind_str, "links") == 0)
+        {
+            kind = SUBSCRIBE_LINKS;
+        }
+        else if (kind_str != NULL && strcmp(kind_str, "subtree") == 0)
+        {
+            kind = SUBSCRIBE_SUBTREE;
+        }
+
+        if (kind == 0 || (kind != SUBSCRIBE_ALL && (index == 0 || index > get_max_index())))
+        {
+            response = "{\"action\":\"message_response\",\"content\":\"Error: Invalid subscribe command format\"}";
+        }
+        else
+        {
+            if (*subscriber == NULL)
+            {
+                *subscriber = subscriber_create();
+            }
+            int id = *subscriber != NULL ? subscriber_add(*subscriber, kind, index) : 0;
+            if (id > 0)
+            {
+                response = arena_printf("{\"action\":\"subscribed\",\"subscription\":%d,\"kind\":\"%s\",\"index\":%u}", id, kind_str, index);
+            }
+            else
+            {
+                response = arena_printf("{\"action\":\"message_response\",\"content\":\"Error: Too many subscriptions (max %d)\"}", SUBSCRIPTION_MAX_PER_CONNECTION);
+            }
+        }
+    }
+    else if (strcmp(message, "unsubscribe") == 0 || strncmp(message, "unsubscribe:", 12) == 0)
+    {
+        // "unsubscribe"는 이 연결의 모든 구독을, "unsubscribe:<id>"는 하나를 지웁니다
+        int id = message[11] == ':' ? atoi(message + 12) : 0;
+        if (*subscriber != NULL && (message[11] == '\0' || id > 0) && subscriber_remove(*subscriber, id))
+        {
+            response = arena_printf("{\"action\":\"unsubscribed\",\"subscription\":%d}", id);
+        }
+        else
+        {
+            response = "{\"action\":\"message_response\",\"content\":\"Error: No such subscription\"}";
+        }
+    }
+    else if (strcmp(message, "compact") == 0)
+    {
+        if (start_compaction())
+        {
+            response = "{\"action\":\"message_response\",\"content\":\"Compaction started\"}";
+        }
+        else
+        {
+            response = "{\"action\":\"message_response\",\"content\":\"Error: Compaction or a snapshot is already running\"}";
+        }
+    }
+    else if (strcmp(message, "get_compaction_stats") == 0)
+    {
+        response = heap_response = get_compaction_stats_info();
+    }
+    else if (strcmp(message, "snapshot") == 0)
+    {
+        if (start_snapshot())
+        {
+            response = "{\"action\":\"message_response\",\"content\":\"Snapshot started\"}";
+        }
+        else
+        {
+            response = "{\"action\":\"message_response\",\"content\":\"Error: A snapshot or compaction is already running\"}";
+        }
+    }
+    else if (strcmp(message, "get_snapshot_stats") == 0)
     {
-        response = get_index_table_info();
+        response = heap_response = get_snapshot_stats_info();
     }
-    else if (strcmp(message, "get_free_space_table_info") == 0)
+    else if (strcmp(message, "get_replication_stats") == 0)
     {
-        response = get_free_space_table_info();
+        response = heap_response = get_replication_stats_info();
+    }
+    else if (strcmp(message, "get_expiry_stats") == 0)
+    {
+        response = heap_response = get_expiry_stats_info();
+    }
+    else if (strcmp(message, "get_arena_stats") == 0)
+    {
+        response = heap_response = get_arena_stats_info();
+    }
+    else if (strcmp(message, "get_recovery_report") == 0)
+    {
+        response = heap_response = get_recovery_report_info();
     }
     else if (strcmp(message, "get_max_index") == 0)
     {
         uint32_t max_index = get_max_index();
-        response = malloc(64);
-        snprintf(response, 64, "{\"action\":\"max_index\",\"value\":%u}", max_index);
+        response = arena_printf("{\"action\":\"max_index\",\"value\":%u}", max_index);
     }
     else if (strncmp(message, "get:", 4) == 0)
     {
@@ -619,56 +835,67 @@ void handle_message(SSL *ssl, const char *message)
         if (index_str != NULL && format != NULL)
         {
             uint32_t index = atoi(index_str);
-            char *content = get_message_by_index_and_format(index, format);
+            uint32_t version;
+            char *content = get_versioned_message_with(index, format, &version, arena_alloc);
             if (content != NULL)
             {
-                json_object *response_obj = json_object_new_object();
-                json_object_object_add(response_obj, "action", json_object_new_string("message_response"));
-                json_object_object_add(response_obj, "content", json_object_new_string(content));
-                json_object_object_add(response_obj, "format", json_object_new_string(format));
+                // json-c로 만들던 것과 같은 키 순서와 모양으로 arena에 바로 씁니다
+                ArenaBuffer out;
+                arena_buffer_init(&out, strlen(content) + 256);
+                arena_buffer_append_string(&out, "{ \"action\": \"message_response\", \"content\": ");
+                arena_buffer_append_json_string(&out, content, strlen(content));
+                arena_buffer_append_string(&out, ", \"format\": ");
+                arena_buffer_append_json_string(&out, format, strlen(format));
+                arena_buffer_printf(&out, ", \"version\": %u", version); // modify_if에 넘길 버전
 
                 if (direction != NULL)
                 {
-                    json_object *links_obj = json_object_new_object();
+                    int forward = strcmp(direction, "forward") == 0 || strcmp(direction, "both") == 0;
+                    int backward = strcmp(direction, "backward") == 0 || strcmp(direction, "both") == 0;
+                    int forward2 = strcmp(direction, "forward2") == 0 && parent_number_str != NULL;
 
-                    if (strcmp(direction, "forward") == 0 || strcmp(direction, "both") == 0)
-                    {
-                        add_links_to_response(index, "forward", links_obj);
-                    }
-                    if (strcmp(direction, "backward") == 0 || strcmp(direction, "both") == 0)
-                    {
-                        add_links_to_response(index, "backward", links_obj);
-                    }
-                    if (strcmp(direction, "forward2") == 0 && parent_number_str != NULL)
+                    if (forward2)
                     {
-                        add_links_to_response(index, "forward2", links_obj);
-                        json_object_object_add(response_obj, "parentNumber", json_object_new_string(parent_number_str));
+                        arena_buffer_append_string(&out, ", \"parentNumber\": ");
+                        arena_buffer_append_json_string(&out, parent_number_str, strlen(parent_number_str));
                     }
-
-                    if (json_object_object_length(links_obj) > 0)
+                    if (forward || backward || forward2)
                     {
-                        json_object_object_add(response_obj, "links", links_obj);
+                        arena_buffer_append_string(&out, ", \"links\": { ");
+                        if (forward)
+                        {
+                            append_links_json(&out, index, "forward", 0);
+                        }
+                        if (backward)
+                        {
+                            if (forward)
+                            {
+                                arena_buffer_append_string(&out, ", ");
+                            }
+                            append_links_json(&out, index, "backward", 1);
+                        }
+                        if (forward2)
+                        {
+                            append_links_json(&out, index, "forward2", 0);
+                        }
+                        arena_buffer_append_string(&out, " }");
                     }
                     else
                     {
-                        json_object_put(links_obj);
-                        json_object_object_add(response_obj, "error", json_object_new_string("Invalid direction"));
+                        arena_buffer_append_string(&out, ", \"error\": \"Invalid direction\"");
                     }
                 }
-
-                const char *json_string = json_object_to_json_string(response_obj);
-                response = strdup(json_string);
-                json_object_put(response_obj);
-                free(content);
+                arena_buffer_append_string(&out, " }");
+                response = out.failed ? NULL : out.data;
             }
             else
             {
-                response = strdup("{\"action\":\"message_response\",\"content\":\"Error: Message not found\",\"format\":\"text\"}");
+                response = "{\"action\":\"message_response\",\"content\":\"Error: Message not found\",\"format\":\"text\"}";
             }
         }
         else
         {
-            response = strdup("{\"action\":\"message_response\",\"content\":\"Error: Invalid get command format\",\"format\":\"text\"}");
+            response = "{\"action\":\"message_response\",\"content\":\"Error: Invalid get command format\",\"format\":\"text\"}";
         }
     }
     else if (strncmp(message, "modify:", 7) == 0)
@@ -681,18 +908,103 @@ void handle_message(SSL *ssl, const char *message)
             uint32_t index = atoi(index_str);
             if (modify_message_by_index(index, new_message))
             {
-                response = malloc(256);
-                snprintf(response, 256, "{\"action\":\"message_response\",\"content\":\"Message with index %u modified successfully\"}", index);
+                response = arena_printf("{\"action\":\"message_response\",\"content\":\"Message with index %u modified successfully\"}", index);
+            }
+            else
+            {
+                response = arena_printf("{\"action\":\"message_response\",\"content\":\"Error: Failed to modify message with index %u\"}", index);
+            }
+        }
+        else
+        {
+            response = "{\"action\":\"message_response\",\"content\":\"Error: Invalid modify command format\"}";
+        }
+    }
+    else if (strncmp(message, "modify_if:", 10) == 0)
+    {
+        // "modify_if:<index>:<version>:<message>" 메시지 버전이 <version>일 때만 수정 (get: 응답의 version)
+        // 다른 편집이 먼저 들어갔으면 modify_conflict로 현재 버전을 알려 주므로 클라이언트는 다시 읽고 합칩니다.
+        char *index_str = strtok((char *)message + 10, ":");
+        char *version_str = strtok(NULL, ":");
+        char *new_message = strtok(NULL, "");
+        if (index_str != NULL && version_str != NULL && new_message != NULL)
+        {
+            uint32_t index = atoi(index_str);
+            uint32_t expected = (uint32_t)strtoul(version_str, NULL, 10);
+            uint32_t current;
+            int result = modify_message_if_version(index, expected, new_message, &current);
+            if (result > 0)
+            {
+                response = arena_printf("{\"action\":\"message_response\",\"content\":\"Message with index %u modified successfully\",\"index\":%u,\"version\":%u}", index, index, current);
+            }
+            else if (result < 0)
+            {
+                response = arena_printf("{\"action\":\"modify_conflict\",\"index\":%u,\"expected\":%u,\"version\":%u}", index, expected, current);
+            }
+            else
+            {
+                response = arena_printf("{\"action\":\"message_response\",\"content\":\"Error: Failed to modify message with index %u\"}", index);
+            }
+        }
+        else
+        {
+            response = "{\"action\":\"message_response\",\"content\":\"Error: Invalid modify_if command format\"}";
+        }
+    }
+    else if (strncmp(message, "ttl:", 4) == 0)
+    {
+        // "ttl:<index>:<seconds>" 메시지를 <seconds>초 뒤에 지움. 0이면 걸려 있던 TTL을 없앰
+        char *index_str = strtok((char *)message + 4, ":");
+        char *seconds_str = strtok(NULL, "");
+        if (index_str != NULL && seconds_str != NULL)
+        {
+            uint32_t index = atoi(index_str);
+            uint32_t seconds = (uint32_t)strtoul(seconds_str, NULL, 10);
+            if (set_message_ttl(index, seconds))
+            {
+                response = arena_printf("{\"action\":\"message_response\",\"content\":\"TTL of message %u set to %u seconds\"}", index, seconds);
             }
             else
             {
-                response = malloc(256);
-                snprintf(response, 256, "{\"action\":\"message_response\",\"content\":\"Error: Failed to modify message with index %u\"}", index);
+                response = arena_printf("{\"action\":\"message_response\",\"content\":\"Error: Failed to set TTL of message %u\"}", index);
             }
         }
         else
         {
-            response = strdup("{\"action\":\"message_response\",\"content\":\"Error: Invalid modify command format\"}");
+            response = "{\"action\":\"message_response\",\"content\":\"Error: Invalid ttl command format\"}";
+        }
+    }
+    else if (strncmp(message, "delete:", 7) == 0)
+    {
+        // "delete:<index>" 메시지를 지우고 이웃의 링크에서도 뺌. 슬롯은 free space로 돌아가고 인덱스 번호는 비어 있게 됨
+        uint32_t index = atoi(message + 7);
+        if (delete_message(index))
+        {
+            response = arena_printf("{\"action\":\"message_response\",\"content\":\"Message with index %u deleted successfully\"}", index);
+        }
+        else
+        {
+            response = arena_printf("{\"action\":\"message_response\",\"content\":\"Error: Failed to delete message with index %u\"}", index);
+        }
+    }
+    else if (strncmp(message, "delete_subtree:", 15) == 0)
+    {
+        // "delete_subtree:<index>[:<max_nodes>]" index와 순방향 링크로 닿는 메시지를 모두 지움. 자손이 max_nodes보다 많으면 지우지 않음
+        char *index_str = strtok((char *)message + 15, ":");
+        char *nodes_str = strtok(NULL, "");
+        uint32_t max_nodes = nodes_str != NULL ? (uint32_t)atoi(nodes_str) : GRAPH_DELETE_DEFAULT_NODES;
+        if (max_nodes == 0 || max_nodes >= GRAPH_MAX_NODES)
+        {
+            max_nodes = GRAPH_MAX_NODES - 1;
+        }
+
+        if (index_str != NULL)
+        {
+            response = heap_response = delete_subtree_info(atoi(index_str), max_nodes);
+        }
+        else
+        {
+            response = "{\"action\":\"message_response\",\"content\":\"Error: Invalid delete_subtree command format\"}";
         }
     }
     else if (strncmp(message, "link:", 5) == 0)
@@ -704,38 +1016,23 @@ void handle_message(SSL *ssl, const char *message)
         {
             uint32_t source_index = atoi(source_str);
             uint32_t target_index = atoi(target_str);
-            int result;
-            if (strcmp(direction, "forward") == 0)
+            if (strcmp(direction, "forward") != 0 && strcmp(direction, "backward") != 0)
             {
-                result = add_forward_link(source_index, target_index);
+                response = "{\"action\":\"message_response\",\"content\":\"Error: Invalid link direction\"}";
             }
-            else if (strcmp(direction, "backward") == 0)
+            else if (strcmp(direction, "forward") == 0 ? add_forward_link(source_index, target_index)
+                                                       : add_backward_link(source_index, target_index))
             {
-                result = add_backward_link(source_index, target_index);
+                response = arena_printf("{\"action\":\"message_response\",\"content\":\"%s link added from index %u to %u\"}", direction, source_index, target_index);
             }
             else
             {
-                response = strdup("{\"action\":\"message_response\",\"content\":\"Error: Invalid link direction\"}");
-                websocket_write(ssl, response, strlen(response));
-                free(response);
-                free(message_copy);
-                return;
-            }
-
-            if (result)
-            {
-                response = malloc(256);
-                snprintf(response, 256, "{\"action\":\"message_response\",\"content\":\"%s link added from index %u to %u\"}", direction, source_index, target_index);
-            }
-            else
-            {
-                response = malloc(256);
-                snprintf(response, 256, "{\"action\":\"message_response\",\"content\":\"Error: Failed to add %s link from index %u to %u\"}", direction, source_index, target_index);
+                response = arena_printf("{\"action\":\"message_response\",\"content\":\"Error: Failed to add %s link from index %u to %u\"}", direction, source_index, target_index);
             }
         }
         else
         {
-            response = strdup("{\"action\":\"message_response\",\"content\":\"Error: Invalid link command format\"}");
+            response = "{\"action\":\"message_response\",\"content\":\"Error: Invalid link command format\"}";
         }
     }
     else if (strncmp(message, "unlink:", 7) == 0)
@@ -747,39 +1044,168 @@ void handle_message(SSL *ssl, const char *message)
         {
             uint32_t source_index = atoi(source_str);
             uint32_t target_index = atoi(target_str);
-            int result;
-            if (strcmp(direction, "forward") == 0)
+            if (strcmp(direction, "forward") != 0 && strcmp(direction, "backward") != 0)
             {
-                result = remove_forward_link(source_index, target_index);
+                response = "{\"action\":\"message_response\",\"content\":\"Error: Invalid link direction\"}";
             }
-            else if (strcmp(direction, "backward") == 0)
+            else if (strcmp(direction, "forward") == 0 ? remove_forward_link(source_index, target_index)
+                                                       : remove_backward_link(source_index, target_index))
             {
-                result = remove_backward_link(source_index, target_index);
+                response = arena_printf("{\"action\":\"message_response\",\"content\":\"%s link removed from index %u to %u\"}", direction, source_index, target_index);
             }
             else
             {
-                response = strdup("{\"action\":\"message_response\",\"content\":\"Error: Invalid link direction\"}");
-                websocket_write(ssl, response, strlen(response));
-                free(response);
-                free(message_copy);
-                return;
+                response = arena_printf("{\"action\":\"message_response\",\"content\":\"Error: Failed to remove %s link from index %u to %u\"}", direction, source_index, target_index);
             }
+        }
+        else
+        {
+            response = "{\"action\":\"message_response\",\"content\":\"Error: Invalid unlink command format\"}";
+        }
+    }
+    else if (strncmp(message, "traverse:", 9) == 0)
+    {
+        // "traverse:<index>:<bfs|dfs>:<forward|backward|both>[:<max_depth>[:<max_nodes>[:<bodies 0|1>]]]"
+        // 결과는 traverse_result 프레임 여러 개로 나누어 보내고, 마지막에 traverse_done 요약을 보냅니다.
+        char *index_str = strtok((char *)message + 9, ":");
+        char *mode = strtok(NULL, ":");
+        char *direction = strtok(NULL, ":");
+        char *depth_str = strtok(NULL, ":");
+        char *nodes_str = strtok(NULL, ":");
+        char *bodies_str = strtok(NULL, "");
+
+        TraversalOptions options;
+        options.start = index_str != NULL ? atoi(index_str) : 0;
+        options.mode = mode != NULL && strcmp(mode, "dfs") == 0 ? GRAPH_DFS : GRAPH_BFS;
+        options.directions = direction != NULL ? parse_graph_direction(direction) : 0;
+        options.max_depth = depth_str != NULL ? (uint32_t)atoi(depth_str) : GRAPH_DEFAULT_DEPTH;
+        options.max_nodes = nodes_str != NULL ? (uint32_t)atoi(nodes_str) : GRAPH_DEFAULT_NODES;
+        options.include_bodies = bodies_str != NULL ? atoi(bodies_str) != 0 : 1;
+        if (options.max_depth > GRAPH_MAX_DEPTH)
+        {
+            options.max_depth = GRAPH_MAX_DEPTH;
+        }
+        if (options.max_nodes == 0 || options.max_nodes > GRAPH_MAX_NODES)
+        {
+            options.max_nodes = GRAPH_MAX_NODES;
+        }
+
+        if (mode != NULL && (strcmp(mode, "bfs") == 0 || strcmp(mode, "dfs") == 0) && options.directions != 0)
+        {
+            response = heap_response = stream_traversal(&options, write_graph_frame, ssl);
+        }
+        else
+        {
+            response = "{\"action\":\"message_response\",\"content\":\"Error: Invalid traverse command format\"}";
+        }
+    }
+    else if (strncmp(message, "path:", 5) == 0 || strncmp(message, "reach:", 6) == 0)
+    {
+        // "path:<from>:<to>[:<forward|backward|both>[:<max_depth>[:<max_visited>]]]" (기본 both)
+        // "reach:<from>:<to>[:<forward|backward|both>[:<max_depth>[:<max_visited>]]]" (기본 forward)
+        int reach_only = message[0] == 'r';
+        char *from_str = strtok((char *)message + (reach_only ? 6 : 5), ":");
+        char *to_str = strtok(NULL, ":");
+        char *direction = strtok(NULL, ":");
+        char *depth_str = strtok(NULL, ":");
+        char *visited_str = strtok(NULL, "");
+
+        int directions = direction != NULL ? parse_graph_direction(direction) : (reach_only ? GRAPH_FORWARD : GRAPH_FORWARD | GRAPH_BACKWARD);
+        uint32_t max_depth = depth_str != NULL ? (uint32_t)atoi(depth_str) : GRAPH_MAX_DEPTH;
+        uint32_t max_visited = visited_str != NULL ? (uint32_t)atoi(visited_str) : GRAPH_PATH_DEFAULT_VISITED;
+        if (max_depth > GRAPH_MAX_DEPTH)
+        {
+            max_depth = GRAPH_MAX_DEPTH;
+        }
+        if (max_visited == 0 || max_visited > GRAPH_PATH_MAX_VISITED)
+        {
+            max_visited = GRAPH_PATH_MAX_VISITED;
+        }
+
+        if (from_str != NULL && to_str != NULL && directions != 0)
+        {
+            response = heap_response = get_path_info(atoi(from_str), atoi(to_str), directions, max_depth, max_visited, reach_only);
+        }
+        else
+        {
+            response = "{\"action\":\"message_response\",\"content\":\"Error: Invalid path command format\"}";
+        }
+    }
+    else if (strncmp(message, "ancestors:", 10) == 0 || strncmp(message, "descendants:", 12) == 0)
+    {
+        // "ancestors:<index>[:<max_depth>[:<max_nodes>]]", "descendants:<index>[:<max_depth>[:<max_nodes>]]"
+        int ancestors = message[0] == 'a';
+        char *index_str = strtok((char *)message + (ancestors ? 10 : 12), ":");
+        char *depth_str = strtok(NULL, ":");
+        char *nodes_str = strtok(NULL, "");
+
+        uint32_t max_depth = depth_str != NULL ? (uint32_t)atoi(depth_str) : GRAPH_MAX_DEPTH;
+        uint32_t max_nodes = nodes_str != NULL ? (uint32_t)atoi(nodes_str) : GRAPH_DEFAULT_NODES;
+        if (max_depth > GRAPH_MAX_DEPTH)
+        {
+            max_depth = GRAPH_MAX_DEPTH;
+        }
+        if (max_nodes == 0 || max_nodes >= GRAPH_MAX_NODES)
+        {
+            max_nodes = GRAPH_MAX_NODES - 1;
+        }
 
-            if (result)
+        if (index_str != NULL)
+        {
+            response = heap_response = get_related_set_info(atoi(index_str), ancestors ? GRAPH_BACKWARD : GRAPH_FORWARD, max_depth, max_nodes);
+        }
+        else
+        {
+            response = ancestors ? "{\"action\":\"message_response\",\"content\":\"Error: Invalid ancestors command format\"}"
+                                 : "{\"action\":\"message_response\",\"content\":\"Error: Invalid descendants command format\"}";
+        }
+    }
+    else if (strncmp(message, "range:", 6) == 0)
+    {
+        // "range:<from>:<to>[:<limit>[:<asc|desc>]]" 마지막으로 쓰인 시각이 [from, to]인 메시지 (초 단위, 양끝 포함)
+        // 0 이하의 값은 현재 시각 기준 상대값입니다. 예: "range:-3600:0:50:desc"는 최근 1시간의 최신 50개
+        char *from_str = strtok((char *)message + 6, ":");
+        char *to_str = strtok(NULL, ":");
+        char *limit_str = strtok(NULL, ":");
+        char *order = strtok(NULL, "");
+
+        if (from_str != NULL && to_str != NULL && (order == NULL || strcmp(order, "asc") == 0 || strcmp(order, "desc") == 0))
+        {
+            int64_t now = time(NULL);
+            int64_t from = strtoll(from_str, NULL, 10);
+            int64_t to = strtoll(to_str, NULL, 10);
+            uint32_t limit = limit_str != NULL ? (uint32_t)atoi(limit_str) : TIME_INDEX_DEFAULT_LIMIT;
+            if (from <= 0)
             {
-                response = malloc(256);
-                snprintf(response, 256, "{\"action\":\"message_response\",\"content\":\"%s link removed from index %u to %u\"}", direction, source_index, target_index);
+                from += now;
             }
-            else
+            if (to <= 0)
             {
-                response = malloc(256);
-                snprintf(response, 256, "{\"action\":\"message_response\",\"content\":\"Error: Failed to remove %s link from index %u to %u\"}", direction, source_index, target_index);
+                to += now;
             }
+            response = heap_response = get_time_range_info(from, to, limit, order != NULL && strcmp(order, "desc") == 0);
         }
         else
         {
-            response = strdup("{\"action\":\"message_response\",\"content\":\"Error: Invalid unlink command format\"}");
+            response = "{\"action\":\"message_response\",\"content\":\"Error: Invalid range command format\"}";
+        }
+    }
+    else if (strncmp(message, "search:", 7) == 0)
+    {
+        // "search:<query>" 또는 "search:<k>:<query>". 공백은 AND, 대문자 OR은 그룹 구분, 끝의 '*'는 접두어
+        const char *query = message + 7;
+        uint32_t k = TEXT_INDEX_DEFAULT_RESULTS;
+        const char *colon = strchr(query, ':');
+        if (colon != NULL && colon > query && strspn(query, "0123456789") == (size_t)(colon - query))
+        {
+            k = (uint32_t)atoi(query);
+            query = colon + 1;
+        }
+        if (k > TEXT_INDEX_MAX_RESULTS)
+        {
+            k = TEXT_INDEX_MAX_RESULTS;
         }
+        response = heap_response = get_search_info(query, k);
     }
     else if (strncmp(message, "getlinks:", 9) == 0)
     {
@@ -788,48 +1214,38 @@ void handle_message(SSL *ssl, const char *message)
         if (index_str != NULL && direction != NULL)
         {
             uint32_t index = atoi(index_str);
-            uint32_t link_count;
-            uint32_t *links;
-
-            json_object *response_obj = json_object_new_object();
-            json_object_object_add(response_obj, "action", json_object_new_string("message_response"));
-
-            json_object *links_obj = json_object_new_object();
-
-            if (strcmp(direction, "forward") == 0)
+            int forward = strcmp(direction, "forward") == 0;
+            ArenaBuffer out;
+            arena_buffer_init(&out, 256);
+            arena_buffer_append_string(&out, "{ \"action\": \"message_response\", \"links\": { ");
+            if (forward || strcmp(direction, "backward") == 0)
             {
-                links = get_forward_links(index, &link_count);
-                json_object *forward_array = json_object_new_array();
+                uint32_t links[MAX_LINKS];
+                uint32_t link_count = forward ? read_forward_links(index, links) : read_backward_links(index, links);
+                arena_buffer_printf(&out, "\"%s\": [ ", forward ? "forward" : "backward");
                 for (uint32_t i = 0; i < link_count; i++)
                 {
-                    json_object_array_add(forward_array, json_object_new_int(links[i]));
+                    arena_buffer_printf(&out, i > 0 ? ", %u" : "%u", links[i]);
                 }
-                json_object_object_add(links_obj, "forward", forward_array);
+                arena_buffer_append_string(&out, link_count > 0 ? " ] }" : "] }");
             }
-            else if (strcmp(direction, "backward") == 0)
+            else
             {
-                links = get_backward_links(index, &link_count);
-                json_object *backward_array = json_object_new_array();
-                for (uint32_t i = 0; i < link_count; i++)
-                {
-                    json_object_array_add(backward_array, json_object_new_int(links[i]));
-                }
-                json_object_object_add(links_obj, "backward", backward_array);
+                arena_buffer_append_string(&out, "}");
             }
-
-            json_object_object_add(response_obj, "links", links_obj);
-
-            const char *json_string = json_object_to_json_string(response_obj);
-            response = strdup(json_string);
-
-            json_object_put(response_obj);
-            free(links);
+            arena_buffer_append_string(&out, " }");
+            response = out.failed ? NULL : out.data;
         }
         else
         {
-            response = strdup("{\"action\":\"message_response\",\"content\":\"Error: Invalid getlinks command format\"}");
+            response = "{\"action\":\"message_response\",\"content\":\"Error: Invalid getlinks command format\"}";
         }
     }
+    else if (replication_is_replica())
+    {
+        // 복제본에서는 알 수 없는 명령을 새 메시지로 저장하지 않음
+        response = "{\"action\":\"message_response\",\"content\":\"Error: This server is a read-only replica\"}";
+    }
     else
     {
         // 모든 메시지를 새 인덱스에 저장
@@ -837,45 +1253,43 @@ void handle_message(SSL *ssl, const char *message)
 
         if (saved_index > 0)
         {
-            json_object *response_obj = json_object_new_object();
-            json_object_object_add(response_obj, "action", json_object_new_string("message_response"));
-            json_object_object_add(response_obj, "content", json_object_new_string("Message saved successfully"));
-            json_object_object_add(response_obj, "saved_index", json_object_new_int(saved_index));
-            json_object_object_add(response_obj, "max_index", json_object_new_int(get_max_index()));
-
-            json_object *links_obj = json_object_new_object();
-            json_object *forward_array = json_object_new_array();
-            json_object *backward_array = json_object_new_array();
+            ArenaBuffer out;
+            arena_buffer_init(&out, 256);
+            arena_buffer_printf(&out, "{ \"action\": \"message_response\", \"content\": \"Message saved successfully\", \"saved_index\": %u, \"max_index\": %u",
+                                saved_index, get_max_index());
 
             // 새로 저장된 메시지를 현재 인덱스에 링크
+            int linked = 0;
             if (current_index > 0 && current_index <= (int)get_max_index())
             {
-                if (add_forward_link(current_index, saved_index))
-                {
-                    json_object_array_add(backward_array, json_object_new_int(current_index));
-                }
-                json_object_object_add(response_obj, "linked_index", json_object_new_int(current_index));
+                linked = add_forward_link(current_index, saved_index);
+                arena_buffer_printf(&out, ", \"linked_index\": %d", current_index);
             }
 
             // 링크 정보 추가
-            json_object_object_add(links_obj, "forward", forward_array);
-            json_object_object_add(links_obj, "backward", backward_array);
-            json_object_object_add(response_obj, "links", links_obj);
-
-            const char *json_string = json_object_to_json_string(response_obj);
-            response = strdup(json_string);
-
-            json_object_put(response_obj);
+            if (linked)
+            {
+                arena_buffer_printf(&out, ", \"links\": { \"forward\": [ ], \"backward\": [ %d ] } }", current_index);
+            }
+            else
+            {
+                arena_buffer_append_string(&out, ", \"links\": { \"forward\": [ ], \"backward\": [ ] } }");
+            }
+            response = out.failed ? NULL : out.data;
         }
         else
         {
-            response = strdup("{\"action\":\"message_response\",\"content\":\"Error: Failed to save message\"}");
+            response = "{\"action\":\"message_response\",\"content\":\"Error: Failed to save message\"}";
         }
     }
 
-    websocket_write(ssl, response, strlen(response));
-    free(response);
-    free(message_copy);
+    // 스트리밍 명령은 이미 응답을 보냈으므로 response가 NULL입니다.
+    if (response != NULL)
+    {
+        websocket_write(ssl, response, strlen(response));
+    }
+    free(heap_response);
+    arena_reset();
 }
 
 void *handle_client(void *ssl_ptr)
@@ -908,8 +1322,31 @@ void *handle_client(void *ssl_ptr)
         if (handle_websocket_handshake(ssl, buf) > 0)
         {
             syslog(LOG_INFO, "WebSocket connection established");
+            Subscriber *subscriber = NULL;
+            // 토크나이저는 연결 동안 다시 써서 프레임마다 새로 잡지 않음 (json_tokener_parse는 매번 만들고 버림)
+            json_tokener *tokener = json_tokener_new();
             while (keep_running)
             {
+                // 구독 중이면 소켓과 eventfd를 함께 기다려, 요청이 없어도 변경 이벤트를 바로 보냅니다.
+                // SSL이 이미 복호화해 둔 데이터는 소켓에 보이지 않으므로 SSL_pending이면 바로 읽습니다.
+                if (subscriber != NULL && SSL_pending(ssl) == 0)
+                {
+                    struct pollfd fds[2] = {{SSL_get_fd(ssl), POLLIN, 0}, {subscriber->event_fd, POLLIN, 0}};
+                    if (poll(fds, 2, SUBSCRIPTION_POLL_MS) < 0 && errno != EINTR)
+                    {
+                        log_error("Error polling WebSocket");
+                        break;
+                    }
+                    if ((fds[1].revents & POLLIN) && !subscriber_flush(subscriber, write_subscription_frame, ssl))
+                    {
+                        log_error("Error writing subscription events");
+                        break;
+                    }
+                    if (!(fds[0].revents & (POLLIN | POLLHUP | POLLERR)))
+                    {
+                        continue;
+                    }
+                }
                 bytes = websocket_read(ssl, buf);
                 if (bytes <= 0)
                 {
@@ -924,7 +1361,15 @@ void *handle_client(void *ssl_ptr)
                     break;
                 }
                 struct json_object *parsed_json;
-                parsed_json = json_tokener_parse(buf);
+                if (tokener != NULL)
+                {
+                    json_tokener_reset(tokener);
+                    parsed_json = json_tokener_parse_ex(tokener, buf, bytes);
+                }
+                else
+                {
+                    parsed_json = json_tokener_parse(buf);
+                }
 
                 struct json_object *action_obj;
                 if (json_object_object_get_ex(parsed_json, "action", &action_obj))
@@ -975,12 +1420,17 @@ void *handle_client(void *ssl_ptr)
                         if (json_object_object_get_ex(parsed_json, "content", &content_obj))
                         {
                             const char *content = json_object_get_string(content_obj);
-                            handle_message(ssl, content);
+                            handle_message(ssl, content, &subscriber);
                         }
                     }
                 }
                 json_object_put(parsed_json);
             }
+            subscriber_destroy(subscriber);
+            if (tokener != NULL)
+            {
+                json_tokener_free(tokener);
+            }
         }
         else
         {
@@ -999,6 +1449,8 @@ void *handle_client(void *ssl_ptr)
     }
 
 cleanup:
+    // 이 연결의 arena 블록을 다음 연결 스레드가 쓰도록 슬랩에 돌려줌
+    arena_release();
     SSL_shutdown(ssl);
     SSL_free(ssl);
     pthread_exit(NULL);
@@ -1006,35 +1458,81 @@ cleanup:
 // 메모리 해제 함수
 void cleanup()
 {
+    wait_for_recovery_validation();
+    expiry_stop();
+    replication_stop();
+    subscription_stop();
+    text_index_stop();
+    time_index_stop();
+    dedup_stop();
+    compression_stop();
     if (index_table != NULL)
     {
         free(index_table);
         index_table = NULL;
     }
-    if (free_space_table != NULL)
+    async_io_shutdown();
+    record_cache_destroy();
+    close_message_file();
+    syslog(LOG_INFO, "Cleaned up resources");
+}
+
+// 명령행 옵션: --port <번호>, --replica-of <주 서버의 복제 소켓 경로>
+// 복제본은 자기 작업 디렉터리의 "binary file/"에 따로 저장소를 두므로 주 서버와 다른 디렉터리에서 실행합니다.
+static void parse_arguments(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
     {
-        free(free_space_table);
-        free_space_table = NULL;
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc)
+        {
+            config.port = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--replica-of") == 0 && i + 1 < argc)
+        {
+            config.replica_of = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--port <port>] [--replica-of <socket>]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
     }
-    syslog(LOG_INFO, "Cleaned up resources");
 }
 
-int main()
+int main(int argc, char *argv[])
 {
     int sock;
     SSL_CTX *ctx;
-    // 인덱스 테이블과 free space 테이블 초기화
-    initialize_index_table();
-    initialize_free_space_table();
-
-    // 메시지 파일이 존재하지 않으면 생성
-    FILE *msg_file = fopen(MESSAGE_FILE, "ab");
-    if (msg_file == NULL)
+    parse_arguments(argc, argv);
+    // 메시지 파일을 열어 둡니다 (존재하지 않으면 생성)
+    if (!open_message_file())
     {
-        syslog(LOG_ERR, "Error creating message file: %s", MESSAGE_FILE);
+        syslog(LOG_ERR, "Error creating message files: %s", STORE_SHARD_FILE);
         exit(EXIT_FAILURE);
     }
-    fclose(msg_file);
+    // 인덱스 테이블과 free space 테이블을 읽고 shard 데이터 파일들과 맞춰 봅니다 (중단된 쓰기 복구)
+    recover_store();
+    async_io_init();
+    record_cache_init(RECORD_CACHE_BUDGET);
+    // 압축 레코드를 읽는 인덱스 구축보다 먼저 공유 사전을 읽어 둡니다
+    compression_start();
+    // 검색 인덱스는 기존 메시지를 백그라운드에서 읽어 만듭니다 (그동안의 검색 결과는 complete: false)
+    text_index_start();
+    time_index_start();
+    // 같은 본문의 append가 기존 슬롯을 공유하도록 참조 수를 되살리고 해시를 채웁니다
+    dedup_start();
+    // 저장소 변경을 구독한 연결들로 나눠 주는 디스패처 (쓰기 쪽은 lock-free 링에 넣기만 함)
+    subscription_start();
+    // 복제본은 주 서버의 변경 로그를 받아 적용하고, 주 서버는 복제본이 붙을 소켓을 엽니다
+    if (config.replica_of != NULL ? !replication_start_replica(config.replica_of) : !replication_start_primary())
+    {
+        syslog(LOG_ERR, "Replication is not available");
+    }
+    // TTL이 지난 메시지를 지우는 스레드. 복제본은 주 서버가 보낸 delete를 따름
+    if (config.replica_of == NULL)
+    {
+        expiry_start();
+    }
 
     openlog("https_websocket_server", LOG_PID | LOG_CONS, LOG_USER);
     syslog(LOG_INFO, "Server starting...");
@@ -1049,6 +1547,8 @@ int main()
     configure_context(ctx);
 
     sock = create_socket(config.port);
+    // 포트를 연 뒤에 레코드 CRC 검증을 백그라운드에서 시작 (그동안 읽기 경로가 CRC를 직접 확인함)
+    start_recovery_validation();
 
     syslog(LOG_INFO, "Server started on port %d", config.port);
 
@@ -1065,6 +1565,11 @@ int main()
             continue;
         }
 
+        // 프레임 헤더와 본문을 따로 SSL_write하므로 Nagle이 켜져 있으면 본문이 지연 ACK(~40ms)를 기다림.
+        // 응답과 요청 없이 밀어 보내는 구독 이벤트 모두 작은 프레임이라 지연이 그대로 드러나므로 끕니다.
+        int nodelay = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
         ssl = SSL_new(ctx);
         SSL_set_fd(ssl, client);
 